@@ -2,6 +2,53 @@
 
 #include "object.h"
 
+#include <chrono>
+
+namespace
+{
+
+auto mobius = [](float u, float v) 
+{
+  u = u * 2 * M_PI;
+  v = 2 * v - 1;
+
+  return glm::vec3(
+      5 * (1 + (v/2)*cos(u/2)) * cos(u),
+      5 * (1 + (v/2)*cos(u/2)) * sin(u),
+      5 * (v/2) * sin(u/2)
+    );
+};
+
+// Same surface on dual numbers: normals come with the positions (see dual.h).
+auto mobiusDual = [](Dual u, Dual v) 
+{
+  u = u * 2 * M_PI;
+  v = 2 * v - 1;
+
+  return DualVec3(
+      5 * (1 + (v/2)*cos(u/2)) * cos(u),
+      5 * (1 + (v/2)*cos(u/2)) * sin(u),
+      5 * (v/2) * sin(u/2)
+    );
+};
+
+// Circular ripples over a 20 x 20 square, travelling outwards with time.
+auto ripples = [](Dual u, Dual v, float t)
+{
+  Dual x = 20 * u - 10;
+  Dual y = 20 * v - 10;
+  Dual r = sqrt(x*x + y*y + 0.01f);
+
+  return DualVec3(x, 0.5f * sin(3*r - 4*t) / (1 + 0.2f*r) - 6, y);
+};
+
+auto mobiusColor = [](float u, float v)
+{
+  return glm::vec3(u/2 + 0.5, v/2 + 0.5, 1 - u/4 - v/4);
+};
+
+}  // namespace.
+
 SampleProgram::SampleProgram() : GlutProgram()
 {
   mScene = new Scene();
@@ -17,18 +64,6 @@ void SampleProgram::Init(int* argc, char* argv[], const char* windowTitle)
 
 void SampleProgram::InitScene(int argc, char *argv[])
 {
-  auto mobius = [](float u, float v) 
-  {
-    u = u * 2 * M_PI;
-    v = 2 * v - 1;
-
-    return glm::vec3(
-        5 * (1 + (v/2)*cos(u/2)) * cos(u),
-        5 * (1 + (v/2)*cos(u/2)) * sin(u),
-        5 * (v/2) * sin(u/2)
-      );
-  };
-
   auto sphereFunc = [](float u, float v) 
   {
     u = u * 2 * M_PI;
@@ -54,11 +89,6 @@ void SampleProgram::InitScene(int argc, char *argv[])
       );
   };
 
-  auto mobiusColor = [](float u, float v)
-  {
-    return glm::vec3(u/2 + 0.5, v/2 + 0.5, 1 - u/4 - v/4);
-  };
-
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
   glEnable(GL_DEPTH_TEST);
   glEnable(GL_LINE_SMOOTH);
@@ -69,6 +99,26 @@ void SampleProgram::InitScene(int argc, char *argv[])
   testObject = new obj::Object(mPipelineProgram, mProgramHandle);
   testObject->LoadParametricSurf(mobius, mobiusColor, 320, 320, true);
 
+  // The same surface with the same chordal error: uniform 320 x 320 grid vs adaptive.
+  AdaptiveTessellator::SurfaceFunc mobiusFrame = [](float u, float v, glm::vec3& position,
+                                                    glm::vec3& normal)
+  {
+    glm::vec3 tangent;
+    EvaluateSurfaceFrame(mobiusDual, u, v, position, normal, tangent);
+  };
+
+  AdaptiveTessellator::Params params;
+  params.chordTolerance = AdaptiveTessellator::MeasureGridError(mobiusFrame, 320, 320);
+  params.maxLevel = 12;
+
+  uniformObject = new obj::Object(mPipelineProgram, mProgramHandle);
+  uniformObject->LoadParametricSurfSolid(mobiusDual, 320, 320);
+  adaptiveObject = new obj::Object(mPipelineProgram, mProgramHandle);
+  adaptiveObject->LoadParametricSurfAdaptive(mobiusDual, params);
+
+  waveSurface = new DynamicParametricSurface(mPipelineProgram, mProgramHandle);
+  waveSurface->Load(ripples, 512, 512);
+
   // Insert new objects here!!
   AxisObject* originAxis = new AxisObject(mPipelineProgram, mProgramHandle);
 
@@ -85,6 +135,7 @@ void SampleProgram::InitScene(int argc, char *argv[])
   originAxis->Load();
 
   mScene->Add(originAxis);
+  mScene->Add(waveSurface);
   mScene->Add(l1);
   mScene->Add(l2);
   mScene->Add(l3);
@@ -97,7 +148,12 @@ void SampleProgram::DisplayFunc()
 {
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   mScene->Render();
-  testObject->Render();
+  switch (mSurfaceMode)
+  {
+    case 0: testObject->Render();     break;
+    case 1: uniformObject->Render();  break;
+    case 2: adaptiveObject->Render(); break;
+  }
   glutSwapBuffers();
   mVideoRecorder->Update();
 }
@@ -244,7 +300,61 @@ void SampleProgram::KeyboardFunc(unsigned char key, int x, int y)
       // take a screenshot
       mVideoRecorder->TakeScreenshot();
     break;
+
+    case 'b':
+      SampleProgram::BenchmarkTessellation(2048);
+    break;
+
+    case 'a':
+      SampleProgram::NextSurfaceMode();
+    break;
+
+    case 'p':
+      mWavePlaying = !mWavePlaying;
+      waveSurface->SetPlaying(mWavePlaying);
+      std::cout << "Ripples 512x512: last update " << waveSurface->GetUpdateTime() << " ms."
+                << std::endl;
+    break;
   }
 }
 
+void SampleProgram::BenchmarkTessellation(int numSamples)
+{
+  typedef std::chrono::high_resolution_clock Clock;
+
+  // Explicit std::function arguments select the original (non-template) loader.
+  std::function<glm::vec3 (float, float)> surfFunction  = mobius;
+  std::function<glm::vec3 (float, float)> colorFunction = mobiusColor;
+
+  obj::Object functionObject(mPipelineProgram, mProgramHandle);
+  auto start = Clock::now();
+  functionObject.LoadParametricSurf(surfFunction, colorFunction, numSamples, numSamples, true);
+  double functionTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  obj::Object templateObject(mPipelineProgram, mProgramHandle);
+  start = Clock::now();
+  templateObject.LoadParametricSurf(mobius, mobiusColor, numSamples, numSamples, true);
+  double templateTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  obj::Object dualObject(mPipelineProgram, mProgramHandle);
+  start = Clock::now();
+  dualObject.LoadParametricSurfSolid(mobiusDual, numSamples, numSamples);
+  double dualTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  std::cout << "Mobius " << numSamples << "x" << numSamples << ": std::function " << functionTime
+            << " ms, template " << templateTime << " ms (" << functionTime / templateTime
+            << "x), template with exact normals " << dualTime
+            << " ms (mesh upload included)." << std::endl;
+}
+
+void SampleProgram::NextSurfaceMode()
+{
+  mSurfaceMode = (mSurfaceMode + 1) % 3;
+
+  const char* names[3] = { "original", "uniform 320x320", "adaptive" };
+  std::cout << "Surface: " << names[mSurfaceMode] << ". Vertices: uniform "
+            << uniformObject->GetNumVertices() << ", adaptive "
+            << adaptiveObject->GetNumVertices() << " (same chordal error)." << std::endl;
+}
+
 // GLUT Callback methods end ------------------------------------------------------------
\ No newline at end of file
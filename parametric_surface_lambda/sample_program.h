@@ -11,6 +11,7 @@
 #include "video_recorder.h"
 
 #include "object.h"
+#include "dynamic_parametric_surface.h"
 
 using namespace gloo;
 
@@ -26,6 +27,8 @@ class SampleProgram : public GlutProgram
     delete mScene;
 
     delete testObject;
+    delete uniformObject;
+    delete adaptiveObject;
   }
 
   void Init(int* argc, char* argv[], const char *windowTitle);
@@ -42,6 +45,13 @@ class SampleProgram : public GlutProgram
   void MotionFunc(int x, int y);                        // Mouse drag callback.
   void KeyboardFunc(unsigned char key, int x, int y);   // Key pressed.
 
+  // Times LoadParametricSurf with std::function arguments against the template overload.
+  void BenchmarkTessellation(int numSamples);
+
+  // Cycles the original surface, a uniform grid with exact normals and the adaptive
+  // tessellation with the same chordal error.
+  void NextSurfaceMode();
+
  private:
   Scene* mScene                 { nullptr };
   VideoRecorder *mVideoRecorder { nullptr };
@@ -49,4 +59,10 @@ class SampleProgram : public GlutProgram
   ControlState mControlState {kROTATE};
 
   obj::Object* testObject;
+  obj::Object* uniformObject  { nullptr };
+  obj::Object* adaptiveObject { nullptr };
+  int mSurfaceMode { 0 };
+
+  DynamicParametricSurface* waveSurface { nullptr };  // Owned by the scene.
+  bool mWavePlaying { true };
 };
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include "adaptive_tessellator.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace gloo
+{
+
+namespace
+{
+
+// Distance of the surface point m from the midpoint of a and b.
+inline float Deviation(const glm::vec3& m, const glm::vec3& a, const glm::vec3& b)
+{
+  return glm::length(m - 0.5f * (a + b));
+}
+
+// Chordal errors of a cell from its 3 x 3 samples p[3*b + a] (a along u, b along v): along u
+// (edges and middle line), along v, and at the center for the better of the two diagonals.
+void CellErrors(const glm::vec3* p, float& errorU, float& errorV, float& errorDiagonal)
+{
+  errorU = std::max(std::max(Deviation(p[1], p[0], p[2]), Deviation(p[7], p[6], p[8])),
+                    Deviation(p[4], p[3], p[5]));
+  errorV = std::max(std::max(Deviation(p[3], p[0], p[6]), Deviation(p[5], p[2], p[8])),
+                    Deviation(p[4], p[1], p[7]));
+  errorDiagonal = std::min(Deviation(p[4], p[0], p[8]), Deviation(p[4], p[2], p[6]));
+}
+
+}  // namespace.
+
+// ================= Tessellation ================= //
+
+void AdaptiveTessellator::Tessellate(const SurfaceFunc& surface, const Params& params)
+{
+  mSurface  = &surface;
+  mMaxLevel = std::min(std::max(params.maxLevel, 1), kMaxLevel);
+
+  mLeaves.clear();
+  mSamples.clear();
+  mPositions.clear();
+  mNormals.clear();
+  mVertices.clear();
+  mIndices.clear();
+
+  int minLevel = std::min(std::max(params.minLevel, 0), mMaxLevel);
+  int size = 1 << (mMaxLevel + 1 - minLevel);
+  for (int y = 0; y < (1 << minLevel); y++)
+  {
+    for (int x = 0; x < (1 << minLevel); x++)
+    {
+      AdaptiveTessellator::Refine({ x*size, y*size, (x+1)*size, (y+1)*size }, params);
+    }
+  }
+
+  AdaptiveTessellator::EqualizeBorder();
+  AdaptiveTessellator::Triangulate();
+
+  // Keep only the samples used by triangles (the others were taken to measure errors).
+  const GLuint kUnused = std::numeric_limits<GLuint>::max();
+  std::vector<GLuint> vertexIndex(mPositions.size(), kUnused);
+  for (GLuint& index : mIndices)
+  {
+    if (vertexIndex[index] == kUnused)
+    {
+      GLuint i = static_cast<GLuint>(mVertices.size() / 6);
+      vertexIndex[index] = i;
+      mVertices.insert(mVertices.end(), { mPositions[index].x, mPositions[index].y,
+                                          mPositions[index].z, mNormals[index].x,
+                                          mNormals[index].y, mNormals[index].z });
+    }
+    index = vertexIndex[index];
+  }
+
+  mSurface = nullptr;
+}
+
+void AdaptiveTessellator::Refine(const Cell& cell, const Params& params)
+{
+  bool splitU, splitV;
+  AdaptiveTessellator::NeedsSplit(cell, params, splitU, splitV);
+
+  int im = (cell.i0 + cell.i1) / 2;
+  int jm = (cell.j0 + cell.j1) / 2;
+
+  if (splitU && splitV)
+  {
+    AdaptiveTessellator::Refine({ cell.i0, cell.j0, im, jm }, params);
+    AdaptiveTessellator::Refine({ im, cell.j0, cell.i1, jm }, params);
+    AdaptiveTessellator::Refine({ cell.i0, jm, im, cell.j1 }, params);
+    AdaptiveTessellator::Refine({ im, jm, cell.i1, cell.j1 }, params);
+  }
+  else if (splitU)
+  {
+    AdaptiveTessellator::Refine({ cell.i0, cell.j0, im, cell.j1 }, params);
+    AdaptiveTessellator::Refine({ im, cell.j0, cell.i1, cell.j1 }, params);
+  }
+  else if (splitV)
+  {
+    AdaptiveTessellator::Refine({ cell.i0, cell.j0, cell.i1, jm }, params);
+    AdaptiveTessellator::Refine({ cell.i0, jm, cell.i1, cell.j1 }, params);
+  }
+  else
+  {
+    mLeaves.push_back(cell);
+  }
+}
+
+void AdaptiveTessellator::NeedsSplit(const Cell& cell, const Params& params,
+                                     bool& splitU, bool& splitV)
+{
+  // Halves are at least 2 samples wide.
+  bool canSplitU = (cell.i1 - cell.i0 >= 4);
+  bool canSplitV = (cell.j1 - cell.j0 >= 4);
+  splitU = splitV = false;
+  if (!canSplitU && !canSplitV)
+  {
+    return;
+  }
+
+  const int is[3] = { cell.i0, (cell.i0 + cell.i1) / 2, cell.i1 };
+  const int js[3] = { cell.j0, (cell.j0 + cell.j1) / 2, cell.j1 };
+  GLuint s[9];
+  for (int k = 0; k < 9; k++)
+  {
+    s[k] = Sample(is[k % 3], js[k / 3]);
+  }
+
+  glm::vec3 p[9], n[9];
+  for (int k = 0; k < 9; k++)
+  {
+    p[k] = mPositions[s[k]];
+    n[k] = mNormals[s[k]];
+  }
+
+  float errorU, errorV, errorDiagonal;
+  CellErrors(p, errorU, errorV, errorDiagonal);
+
+  // Normals turning along u (v): across the cell, on its edges and middle line.
+  float minCos = std::cos(params.normalTolerance);
+  float cosU = std::min(std::min(glm::dot(n[0], n[2]), glm::dot(n[6], n[8])), glm::dot(n[3], n[5]));
+  float cosV = std::min(std::min(glm::dot(n[0], n[6]), glm::dot(n[2], n[8])), glm::dot(n[1], n[7]));
+
+  splitU = canSplitU && (errorU > params.chordTolerance || cosU < minCos);
+  splitV = canSplitV && (errorV > params.chordTolerance || cosV < minCos);
+
+  // Twisted, but straight along both directions (e.g. a saddle).
+  if (!splitU && !splitV && errorDiagonal > params.chordTolerance)
+  {
+    splitU = canSplitU;
+    splitV = canSplitV;
+  }
+}
+
+void AdaptiveTessellator::EqualizeBorder()
+{
+  // Finest spacing along the u = 0, 1 sides (in v) and along the v = 0, 1 sides (in u).
+  const int n = 2 << mMaxLevel;
+  int spacingU = n, spacingV = n;
+  for (const Cell& cell : mLeaves)
+  {
+    if (cell.i0 == 0 || cell.i1 == n)
+      spacingV = std::min(spacingV, cell.j1 - cell.j0);
+    if (cell.j0 == 0 || cell.j1 == n)
+      spacingU = std::min(spacingU, cell.i1 - cell.i0);
+  }
+
+  std::vector<Cell> cells;
+  cells.swap(mLeaves);
+  while (!cells.empty())
+  {
+    Cell cell = cells.back();
+    cells.pop_back();
+
+    if ((cell.i0 == 0 || cell.i1 == n) && cell.j1 - cell.j0 > spacingV)
+    {
+      int jm = (cell.j0 + cell.j1) / 2;
+      cells.push_back({ cell.i0, cell.j0, cell.i1, jm });
+      cells.push_back({ cell.i0, jm, cell.i1, cell.j1 });
+    }
+    else if ((cell.j0 == 0 || cell.j1 == n) && cell.i1 - cell.i0 > spacingU)
+    {
+      int im = (cell.i0 + cell.i1) / 2;
+      cells.push_back({ cell.i0, cell.j0, im, cell.j1 });
+      cells.push_back({ im, cell.j0, cell.i1, cell.j1 });
+    }
+    else
+    {
+      mLeaves.push_back(cell);
+    }
+  }
+}
+
+void AdaptiveTessellator::Triangulate()
+{
+  // Leaf corners on each grid line: rows[j] holds the i's, columns[i] the j's.
+  std::unordered_map<int, std::vector<int>> rows, columns;
+  for (const Cell& cell : mLeaves)
+  {
+    rows[cell.j0].insert(rows[cell.j0].end(), { cell.i0, cell.i1 });
+    rows[cell.j1].insert(rows[cell.j1].end(), { cell.i0, cell.i1 });
+    columns[cell.i0].insert(columns[cell.i0].end(), { cell.j0, cell.j1 });
+    columns[cell.i1].insert(columns[cell.i1].end(), { cell.j0, cell.j1 });
+  }
+
+  for (auto& line : rows)
+  {
+    std::sort(line.second.begin(), line.second.end());
+    line.second.erase(std::unique(line.second.begin(), line.second.end()), line.second.end());
+  }
+  for (auto& line : columns)
+  {
+    std::sort(line.second.begin(), line.second.end());
+    line.second.erase(std::unique(line.second.begin(), line.second.end()), line.second.end());
+  }
+
+  std::vector<GLuint> ring;
+  for (const Cell& cell : mLeaves)
+  {
+    const std::vector<int>& bottom = rows[cell.j0];
+    const std::vector<int>& top    = rows[cell.j1];
+    const std::vector<int>& left   = columns[cell.i0];
+    const std::vector<int>& right  = columns[cell.i1];
+
+    // Boundary, counterclockwise in (u, v) from (i0, j0): each side up to its last corner.
+    ring.clear();
+    for (auto it = std::lower_bound(bottom.begin(), bottom.end(), cell.i0); *it < cell.i1; ++it)
+      ring.push_back(Sample(*it, cell.j0));
+    for (auto it = std::lower_bound(right.begin(), right.end(), cell.j0); *it < cell.j1; ++it)
+      ring.push_back(Sample(cell.i1, *it));
+    for (auto it = std::lower_bound(top.begin(), top.end(), cell.i1); *it > cell.i0; --it)
+      ring.push_back(Sample(*it, cell.j1));
+    for (auto it = std::lower_bound(left.begin(), left.end(), cell.j1); *it > cell.j0; --it)
+      ring.push_back(Sample(cell.i0, *it));
+
+    if (ring.size() == 4)
+    {
+      // Two triangles, split along the shorter diagonal.
+      const std::vector<glm::vec3>& p = mPositions;
+      if (glm::length(p[ring[2]] - p[ring[0]]) <= glm::length(p[ring[1]] - p[ring[3]]))
+      {
+        mIndices.insert(mIndices.end(), { ring[0], ring[1], ring[2], ring[0], ring[2], ring[3] });
+      }
+      else
+      {
+        mIndices.insert(mIndices.end(), { ring[0], ring[1], ring[3], ring[1], ring[2], ring[3] });
+      }
+      continue;
+    }
+
+    // Fan around the center (strictly inside, as cells are at least 2 samples wide).
+    GLuint center = Sample((cell.i0 + cell.i1) / 2, (cell.j0 + cell.j1) / 2);
+    for (size_t k = 0; k < ring.size(); k++)
+    {
+      mIndices.insert(mIndices.end(), { center, ring[k], ring[(k + 1) % ring.size()] });
+    }
+  }
+}
+
+GLuint AdaptiveTessellator::Sample(int i, int j)
+{
+  uint32_t key = SampleKey(i, j);
+  auto it = mSamples.find(key);
+  if (it != mSamples.end())
+  {
+    return it->second;
+  }
+
+  float scale = 1.0f / (2 << mMaxLevel);
+  glm::vec3 position, normal;
+  (*mSurface)(i * scale, j * scale, position, normal);
+
+  GLuint index = static_cast<GLuint>(mPositions.size());
+  mPositions.push_back(position);
+  mNormals.push_back(normal);
+  mSamples[key] = index;
+  return index;
+}
+
+// ================= Error Measurement ================= //
+
+float AdaptiveTessellator::MeasureGridError(const SurfaceFunc& surface, int w, int h)
+{
+  // Samples at twice the resolution: even indices are grid vertices, odd ones midpoints.
+  int sw = 2*w - 1, sh = 2*h - 1;
+  std::vector<glm::vec3> p(static_cast<size_t>(sw) * sh);
+  glm::vec3 normal;
+  for (int j = 0; j < sh; j++)
+  {
+    for (int i = 0; i < sw; i++)
+    {
+      surface(0.5f * i / (w-1), 0.5f * j / (h-1), p[j * sw + i], normal);
+    }
+  }
+
+  float error = 0.0f;
+  for (int j = 0; j + 2 < sh; j += 2)
+  {
+    for (int i = 0; i + 2 < sw; i += 2)
+    {
+      glm::vec3 cell[9];
+      for (int k = 0; k < 9; k++)
+      {
+        cell[k] = p[(j + k / 3) * sw + i + k % 3];
+      }
+
+      float errorU, errorV, errorDiagonal;
+      CellErrors(cell, errorU, errorV, errorDiagonal);
+      error = std::max(error, std::max(std::max(errorU, errorV), errorDiagonal));
+    }
+  }
+
+  return error;
+}
+
+}  // namespace gloo.
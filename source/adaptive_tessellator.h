@@ -0,0 +1,108 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "openGLHeader.h"
+
+//  +-------------------------------------------------+
+//  |  Curvature-adaptive tessellation of parametric  |
+//  |  surfaces over [0, 1]^2.                        |
+//  |                                                 |
+//  |  The domain is split recursively into dyadic    |
+//  |  rectangles: a cell is halved along u (v) while |
+//  |  the surface deviates from it by more than the  |
+//  |  chordal tolerance, or its normals turn more    |
+//  |  than the normal tolerance, along u (v). Cells  |
+//  |  stretch along directions the surface is flat   |
+//  |  in (e.g. the rulings of a Mobius strip).       |
+//  |                                                 |
+//  |  Each leaf is fanned through every corner of    |
+//  |  its neighbors lying on its sides, so there are |
+//  |  no T-junctions (cracks). The domain border is  |
+//  |  sampled uniformly, so surfaces whose borders   |
+//  |  meet in space (tubes, spheres, Mobius strips)  |
+//  |  stay closed. Samples are evaluated once.       |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class AdaptiveTessellator
+{
+public:
+  struct Params
+  {
+    float chordTolerance  { 0.01f };  // Model units.
+    float normalTolerance { 0.2f };   // Radians.
+    int minLevel { 2 };   // The domain starts as 2^minLevel x 2^minLevel cells.
+    int maxLevel { 10 };  // Cells are at least 2^-maxLevel wide (maxLevel <= kMaxLevel).
+  };
+
+  // Position and unit normal at (u, v) (see EvaluateSurfaceFrame in dual.h).
+  typedef std::function<void (float u, float v, glm::vec3& position, glm::vec3& normal)> SurfaceFunc;
+
+  AdaptiveTessellator() { }
+
+  void Tessellate(const SurfaceFunc& surface, const Params& params);
+
+  // Largest chordal error of the cells of a uniform w x h sample grid (same measure as the
+  // tolerance), e.g. to ask for the same accuracy with fewer vertices.
+  static float MeasureGridError(const SurfaceFunc& surface, int w, int h);
+
+  // Output: interleaved (x, y, z, nx, ny, nz) vertices and triangle indices.
+  inline const std::vector<GLfloat>& GetVertices() const { return mVertices; }
+  inline const std::vector<GLuint>&  GetIndices()  const { return mIndices;  }
+  inline int GetNumVertices()  const { return static_cast<int>(mVertices.size() / 6); }
+  inline int GetNumTriangles() const { return static_cast<int>(mIndices.size() / 3); }
+
+  static const int kMaxLevel = 14;
+
+private:
+  // Cell [i0, i1] x [j0, j1] of the sample grid, 2^(mMaxLevel + 1) + 1 samples per side (so
+  // even the smallest cells have a sample in the middle).
+  struct Cell
+  {
+    int i0, j0, i1, j1;
+  };
+
+  void Refine(const Cell& cell, const Params& params);
+
+  // Whether the cell must be halved along u and/or along v.
+  void NeedsSplit(const Cell& cell, const Params& params, bool& splitU, bool& splitV);
+
+  // Halves border cells until the border is sampled uniformly.
+  void EqualizeBorder();
+  void Triangulate();
+
+  // Index of the sample at (i, j) / 2^(mMaxLevel + 1), evaluated on first use.
+  GLuint Sample(int i, int j);
+
+  static inline uint32_t SampleKey(int i, int j)
+  {
+    return (static_cast<uint32_t>(j) << 16) | static_cast<uint32_t>(i);
+  }
+
+  const SurfaceFunc* mSurface { nullptr };
+  int mMaxLevel { 0 };
+
+  std::vector<Cell> mLeaves;
+  std::unordered_map<uint32_t, GLuint> mSamples;  // Grid position to sample index.
+  std::vector<glm::vec3> mPositions, mNormals;
+
+  std::vector<GLfloat> mVertices;
+  std::vector<GLuint> mIndices;
+};
+
+}  // namespace gloo.
@@ -1,4 +1,10 @@
 #include "basic_obj_library.h"
+#include "heightmap.h"
+#include "parallel.h"
+#include "primitive_cache.h"
+
+#include <algorithm>
+#include <cmath>
 
 
 #define INDEX(a, b) (((w) * (b)) + a)
@@ -6,6 +12,15 @@
 namespace gloo
 {
 
+namespace
+{
+
+// Terrain heights from heightmap samples in [0, 1] (the 8-bit range of the original loader).
+const float kHeightRange  = 255.0f / 4.0f;
+const float kHeightOffset = -63.0f;
+
+}  // namespace.
+
 void AxisObject::Load()
 {
   GLfloat positions[] = { 0.0f, 0.0f, 0.0f,
@@ -45,64 +60,10 @@ void GridObject::Load(int w, int h)
 {
   mWidth  = w;
   mHeight = h;
-  int numVertices = (w * h);
-  int numIndices  = (2 * w * h);
-
-  std::vector<GLfloat> vertices;
-  std::vector<GLuint> indices; 
-
-  vertices.reserve(numVertices * 6);
-  indices.reserve(numIndices);
-
-  // Initialize vertices.
-  for (int y = 0; y < h; y++)
-  {
-    for (int x = 0; x < w; x++)
-    {
-      // Positions x, y, z.
-      vertices.push_back(static_cast<float>(x - w/2)/w);
-      vertices.push_back(0.0);
-      vertices.push_back(static_cast<float>(y - h/2)/h);
-
-      // Colors RGB.
-      vertices.push_back(0.45f);
-      vertices.push_back(0.45f);
-      vertices.push_back(0.45f);
-    }
-  }
-
-  // Initialize indices.
-  // Wire frame Element array - indices are written in a zig-zag pattern,
-  // first horizontally and then vertically. It uses GL_LINE_STRIP. 
-  int index = 0;
-  int x = 0, y = 0;
-  int dx = 1, dy = -1;
-
-  for (y = 0; y < h; y++)  // Horizontally.
-  {
-    x = ((dx == 1) ? 0 : w-1);
-    for (int k = 0; k < w; k++, x += dx)
-      indices.push_back(INDEX(x, y));
-    dx *= -1;
-  }
 
-  // Start from the last point to allow continuity in GL_LINE_STRIP.
-  x = ((dx == 1) ? 0 : w-1);
-  y = h-1;  
-  dy = -1;
-  for (int i = 0; i < w; i++, x += dx)  // Vertically.
-  {
-    y = ((dy == 1) ? 0 : h-1);
-    for (int j = 0; j < h; j++, y += dy)
-      indices.push_back(INDEX(x, y));
-    dy *= -1;
-  }
-
-  mMesh = new Mesh();
-  mMesh->SetProgramHandle(mProgramHandle);
-  mMesh->Load(&vertices[0], &indices[0], numVertices, numIndices, true, false, false, GL_LINE_STRIP);
+  mMesh = PrimitiveCache::Instance().GetGrid(mProgramHandle, w, h);
+  mIsMeshOwner = false;
   SceneObject::SetScale(w, 1.0f, h);
-  mIsMeshOwner = true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -110,96 +71,105 @@ void GridObject::Load(int w, int h)
 void TexturedSphere::Load(const std::string& fileName, bool completeDome, int detailLevel)
 {
   mDetailLevel = detailLevel;
-  int n = mDetailLevel + 1;
-  int h = mDetailLevel + 1;
-  int numVertices = (n * h);
-  int numIndices  = 2*(h-2)*n + 2*n + 2*(h-2);
+  mMesh = PrimitiveCache::Instance().GetSphere(mProgramHandle, detailLevel, completeDome);
+  mIsMeshOwner = false;
 
-  std::vector<GLfloat> positions;
-  std::vector<GLfloat> texCoords;
-  std::vector<GLfloat> normals;
-  std::vector<GLuint> indices;
+  mTexture = new Texture();
+  mTexture->Load(fileName);
+  mMaterial = new Material( glm::vec3(0.18), 
+                            glm::vec3(0.8), 
+                            glm::vec3(0.02) );
 
-  positions.reserve(3 * numVertices);
-  texCoords.reserve(2 * numVertices);
-  normals.reserve(3 * numVertices);
-  indices.reserve(numIndices);
+  mUsingLighting = true;
+}
 
-  GLfloat position[3];
+///////////////////////////////////////////////////////////////////////////////////////////////////
 
-  // Initialize vertices.
-  for (int v = 0; v < h; v++)
+void TexturedTerrain::Load(const std::string& heightmapFileName, const std::string& textureFileName, 
+  int w, int h)
+{
+  Heightmap heightmap;
+  heightmap.Load(heightmapFileName);
+  TexturedTerrain::Load(heightmap, textureFileName, w, h);
+}
+
+void TexturedTerrain::Load(const Heightmap& heightmap, const std::string& textureFileName, 
+  int w, int h)
+{
+  bool loaded = heightmap.IsLoaded();
+
+  mWidth  = w;
+  mHeight = h;
+  int numVertices = (w * h);
+  int numIndices = PrimitiveCache::NumStripIndices(w, h);
+
+  // Heights are kept on the CPU side for sculpting and ray queries. The whole heightmap
+  // is resampled to the grid, mapping [0, 1] to [-63, 0.75] as 8-bit pixels did before.
+  // Integer samples come normalized (16-bit ones by 65535, see Heightmap), so a 16-bit map
+  // spans the same range with finer steps. Float samples are kept as is (e.g. meters), so
+  // their own [min, max] is mapped instead.
+  mHeights.assign(numVertices, 0.0f);
+  if (loaded)
   {
-    for (int u = 0; u < n; u++)
+    float scale  = kHeightRange;
+    float offset = kHeightOffset;
+
+    if (heightmap.GetFormat() == Heightmap::kFloat32)
     {
-      int index = (v*n + u);
-      GLfloat theta_u = (2*M_PI * u) / (n-1);
-      GLfloat theta_v = (M_PI * v) / (h-1);
-
-      position[0] = cos(theta_u) * sin(theta_v);
-      position[2] = sin(theta_u) * sin(theta_v);
-      position[1] = cos(theta_v);
-
-      // Positions.
-      positions.push_back(position[0]);
-      positions.push_back(position[1]);
-      positions.push_back(position[2]);
-
-      // Normals.
-      normals.push_back(2*position[0]);
-      normals.push_back(2*position[1]);
-      normals.push_back(2*position[2]);
-      
-      // Texture UV.
-      texCoords.push_back(1 - static_cast<float>(u) / (n-1));
-      if (completeDome)
-      {
-        texCoords.push_back(1 - static_cast<float>(v) / (h-1));
-      }
-      else
-      {
-        texCoords.push_back(2 - 2*static_cast<float>(v) / (h-1));
-      }
+      const float* data = heightmap.GetData();
+      auto range = std::minmax_element(data, data + heightmap.GetWidth() * heightmap.GetHeight());
+      float extent = *range.second - *range.first;
+
+      scale  = (extent > 0.0f) ? kHeightRange / extent : 0.0f;
+      offset = kHeightOffset - scale * (*range.first);
     }
+
+    heightmap.Resample(w, h, scale, offset, mHeights.data());
   }
 
-  // Initialize indices.
-  for (int v = 0; v < h-1; v++)
+  auto range = std::minmax_element(mHeights.begin(), mHeights.end());
+  mMinHeight = *range.first;
+  mMaxHeight = *range.second;
+
+  // Same layout and triangle split as the strip below (see GridPosition).
+  glm::vec3 origin = TexturedTerrain::GridPosition(0, 0);
+  mHeightfield.Set(mHeights.data(), w, h, glm::vec3(origin[0], 0.0f, origin[2]), 1.0f/w, 1.0f/h,
+                   1.0f, Heightfield::kAntiDiagonal);
+
+  mMesh = new Mesh();
+  mMesh->SetProgramHandle(mProgramHandle);
+  mMesh->Preallocate(numVertices, numIndices, false, true, true);
+  mMesh->SetDrawMode(GL_TRIANGLE_STRIP);
+  mIsMeshOwner = true;
+
+  // Initialize vertices.
+  tool::ParallelFor(0, h, 64, [this, w](int first, int last)
   {
-    // Zig-zag pattern: alternate between top and bottom.
-    for (int u = 0; u < n; u++)
+    for (int y = first; y < last; y++)
     {
-      indices.push_back((v+0)*n + u);
-      indices.push_back((v+1)*n + u);
+      for (int x = 0; x < w; x++)
+      {
+        glm::vec3 position = TexturedTerrain::GridPosition(x, y);
+        GLfloat* p = mMesh->PositionAt(INDEX(x, y));
+        p[0] = position[0];
+        p[1] = position[1];
+        p[2] = position[2];
+
+        GLfloat* uv = mMesh->TexCoordAt(INDEX(x, y));
+        uv[0] = static_cast<float>(x);
+        uv[1] = static_cast<float>(y);
+      }
     }
+  });
 
-    // Triangle row transition: handle discontinuity.
-    if (v < h-2)
-    {
-      // Repeat last vertex and the next row first vertex to generate 
-      // two invalid triangles and get continuity in the mesh.
-      indices.push_back((v+1)*n + (n-1)); //INDEX(this->width-1, y+1);
-      indices.push_back((v+1)*n + 0);     //INDEX(0, y+1);
-    }
-  }
+  TexturedTerrain::ComputeNormals(0, 0, w-1, h-1);
 
-  mMesh = new Mesh();
-  mMesh->SetProgramHandle(mProgramHandle);
-  mMesh->Load(&positions[0], 
-              nullptr, 
-              &normals[0], 
-              &texCoords[0], 
-              &indices[0], 
-              numVertices, 
-              numIndices, 
-              GL_TRIANGLE_STRIP, 
-              Mesh::kSubBuffered
-            );
+  PrimitiveCache::BuildStripIndices(w, h, mMesh->IndexAt(0));
 
-  mIsMeshOwner = true;
+  mMesh->Upload();
 
   mTexture = new Texture();
-  mTexture->Load(fileName);
+  mTexture->Load(textureFileName);
   mMaterial = new Material( glm::vec3(0.18), 
                             glm::vec3(0.8), 
                             glm::vec3(0.02) );
@@ -207,83 +177,196 @@ void TexturedSphere::Load(const std::string& fileName, bool completeDome, int de
   mUsingLighting = true;
 }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////
-
-void TexturedTerrain::Load(const std::string& heightmapFileName, const std::string& textureFileName, 
-  int w, int h)
+void TexturedTerrain::ComputeNormals(int x0, int y0, int x1, int y1)
 {
-  ImageIO* source = new ImageIO();
-  bool loaded = false;
+  // Written in place into the interleaved vertex array.
+  Heightmap::ComputeNormals(mHeights.data(), mWidth, mHeight, 1.0f/mWidth, 1.0f/mHeight, 
+                            mMesh->NormalAt(0), mMesh->GetVertexSize(), x0, y0, x1, y1);
+}
 
-  // Try to load the heightmap.
-  if (source->loadJPEG(heightmapFileName.c_str()) == ImageIO::OK)
+bool TexturedTerrain::ApplyBrush(const glm::vec3& center, const Brush& brush)
+{
+  if (!IsInitialized() || brush.radius <= 0.0f)
   {
-    loaded = true;
+    return false;
   }
 
-  mWidth  = w;
-  mHeight = h;
-  int numVertices = (w * h);
-  int numIndices = 2*(h-2)*w + 2*w + 2*(h-2);
-  std::vector<GLfloat> vertices;
-  std::vector<GLuint> indices;
+  int w = mWidth;
+  int h = mHeight;
 
-  vertices.reserve((3 + 3 + 2)*numVertices);
-  indices.reserve(numIndices);
+  // Brush footprint in grid coordinates.
+  float gx = center[0]*w + w/2;
+  float gy = center[2]*h + h/2;
+  float rx = brush.radius * w;
+  float ry = brush.radius * h;
 
-  // Initialize vertices.
-  for (int y = 0; y < h; y++)
+  int x0 = std::max(static_cast<int>(std::ceil(gx - rx)), 0);
+  int y0 = std::max(static_cast<int>(std::ceil(gy - ry)), 0);
+  int x1 = std::min(static_cast<int>(std::floor(gx + rx)), w-1);
+  int y1 = std::min(static_cast<int>(std::floor(gy + ry)), h-1);
+
+  if (x0 > x1 || y0 > y1)
   {
-    for (int x = 0; x < w; x++)
-    {
-      vertices.push_back(static_cast<float>(x - w/2)/w);
-      vertices.push_back(loaded ? (source->getPixel(x, y, 0)/4.0f - 255/4) : 0.0f);
-      vertices.push_back(static_cast<float>(y - h/2)/h);
+    return false;
+  }
 
-      // TODO: compute normals if heightmap is loaded.
-      vertices.push_back(0);
-      vertices.push_back(1);
-      vertices.push_back(0);
+  // Smoothing reads the heights before this application (with a one vertex border).
+  int sx0 = std::max(x0-1, 0), sy0 = std::max(y0-1, 0);
+  int sx1 = std::min(x1+1, w-1), sy1 = std::min(y1+1, h-1);
+  int sw = sx1 - sx0 + 1;
 
-      vertices.push_back(static_cast<float>(x));
-      vertices.push_back(static_cast<float>(y));
+  if (brush.mode == kSmooth)
+  {
+    mScratch.resize(sw * (sy1 - sy0 + 1));
+    for (int y = sy0; y <= sy1; y++)
+    {
+      std::copy(&mHeights[INDEX(sx0, y)], &mHeights[INDEX(sx0, y)] + sw, &mScratch[sw*(y - sy0)]);
     }
   }
 
-  // Initialize indices.
-  for (int y = 0; y < h-1; y++)
+  auto scratch = [&](int x, int y) { return mScratch[sw*(y - sy0) + (x - sx0)]; };
+
+  for (int y = y0; y <= y1; y++)
   {
-    // Zig-zag pattern: alternate between top and bottom.
-    for (int x = 0; x < w; x++)
+    for (int x = x0; x <= x1; x++)
     {
-      indices.push_back(INDEX(x, y));
-      indices.push_back(INDEX(x, y+1));
-    }
+      float dx = (x - gx) / rx;
+      float dy = (y - gy) / ry;
+      float d2 = dx*dx + dy*dy;
+      if (d2 >= 1.0f)
+        continue;
 
-    // Triangle row transition: handle discontinuity.
-    if (y < h-2)
-    {
-      // Repeat last vertex and the next row first vertex to generate 
-      // two invalid triangles and get continuity in the mesh.
-      indices.push_back(INDEX(w-1, y+1));
-      indices.push_back(INDEX(0, y+1));
+      float falloff = (1.0f - d2) * (1.0f - d2);  // Smooth, zero slope at the rim.
+      float amount  = std::min(brush.strength * falloff, 1.0f);
+      float& height = mHeights[INDEX(x, y)];
+
+      switch (brush.mode)
+      {
+        case kRaise:
+          height += brush.strength * falloff;
+        break;
+
+        case kLower:
+          height -= brush.strength * falloff;
+        break;
+
+        case kSmooth:
+        {
+          float average = 0.25f * (scratch(std::max(x-1, sx0), y) + scratch(std::min(x+1, sx1), y) + 
+                                   scratch(x, std::max(y-1, sy0)) + scratch(x, std::min(y+1, sy1)));
+          height += amount * (average - height);
+        }
+        break;
+
+        case kFlatten:
+          height += amount * (brush.target - height);
+        break;
+      }
+
+      mMesh->PositionAt(INDEX(x, y))[1] = height;
+      mMinHeight = std::min(mMinHeight, height);
+      mMaxHeight = std::max(mMaxHeight, height);
     }
   }
 
+  // Normals change one vertex around the edited region.
+  TexturedTerrain::ComputeNormals(sx0, sy0, sx1, sy1);
+  mHeightfield.Update(x0, y0, x1, y1);
 
-  mMesh = new Mesh();
-  mMesh->SetProgramHandle(mProgramHandle);
-  mMesh->Load(&vertices[0], &indices[0], numVertices, numIndices, false, true, true, GL_TRIANGLE_STRIP);
-  mIsMeshOwner = true;
+  // Each row is a contiguous range in the vertex buffer.
+  for (int y = sy0; y <= sy1; y++)
+  {
+    mMesh->UpdateVertices(INDEX(sx0, y), sw);
+  }
+
+  mMesh->MarkPositionsDirty();
+  return true;
+}
+
+bool TexturedTerrain::PickPoint(const Ray& ray, glm::vec3& point) const
+{
+  RayHit hit;
+  if (TexturedTerrain::IntersectRay(ray, hit))
+  {
+    point = glm::vec3(mWorldToModel * glm::vec4(ray.At(hit.t), 1.0f));
+    return true;
+  }
+
+  return false;
+}
+
+bool TexturedTerrain::IntersectRay(const Ray& ray, RayHit& hit) const
+{
+  if (!IsInitialized())
+  {
+    return false;
+  }
+
+  // Triangle indices follow Mesh::GetTriangles for the strip.
+  return mHeightfield.IntersectWorldRay(mWorldToModel, ray, hit);
+}
+
+bool TexturedTerrain::GetGroundHeight(const glm::vec3& point, float& height) const
+{
+  return IsInitialized() &&
+         mHeightfield.GetWorldHeight(mModelMatrix.GetGLMatrix(), mWorldToModel, point, height);
+}
+
+AABB TexturedTerrain::GetWorldBounds() const
+{
+  if (!IsInitialized())
+  {
+    return AABB();
+  }
+
+  glm::vec3 lo(static_cast<float>(0 - mWidth/2)/mWidth, mMinHeight, 
+               static_cast<float>(0 - mHeight/2)/mHeight);
+  glm::vec3 hi(static_cast<float>(mWidth-1 - mWidth/2)/mWidth, mMaxHeight, 
+               static_cast<float>(mHeight-1 - mHeight/2)/mHeight);
+
+  return SceneObject::TransformBounds(AABB(lo, hi));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PrimitiveObject::LoadPrimitive(Mesh* mesh, const std::string& textureFileName)
+{
+  mMesh = mesh;
+  mIsMeshOwner = false;
+
+  if (!textureFileName.empty())
+  {
+    mTexture = new Texture();
+    mTexture->Load(textureFileName);
+  }
 
-  mTexture = new Texture();
-  mTexture->Load(textureFileName);
   mMaterial = new Material( glm::vec3(0.18), 
                             glm::vec3(0.8), 
                             glm::vec3(0.02) );
 
   mUsingLighting = true;
-  delete source;
+}
+
+void CubeObject::Load(const std::string& textureFileName)
+{
+  PrimitiveObject::LoadPrimitive(PrimitiveCache::Instance().GetCube(mProgramHandle), textureFileName);
+}
+
+void TetrahedronObject::Load(const std::string& textureFileName)
+{
+  PrimitiveObject::LoadPrimitive(PrimitiveCache::Instance().GetTetrahedron(mProgramHandle),
+                                 textureFileName);
+}
+
+void QuadObject::Load(const std::string& textureFileName)
+{
+  PrimitiveObject::LoadPrimitive(PrimitiveCache::Instance().GetQuad(mProgramHandle), textureFileName);
+}
+
+void IcosphereObject::Load(int subdivisions)
+{
+  PrimitiveObject::LoadPrimitive(PrimitiveCache::Instance().GetIcosphere(mProgramHandle, subdivisions),
+                                 "");
 }
 
 }  // namespace gloo.
@@ -7,6 +7,8 @@
 #pragma once
 
 #include "scene_object.h"
+#include "heightfield.h"
+#include "heightmap.h"
 
 /*********************************************************
 * This file provides classes for rendering primitive objs
@@ -31,7 +33,13 @@
 // | 3. class GridObject      |    off   |   no    |    no    |
 // | 4. class TexturedSphere  |    opt   |   yes   |    no    |
 // | 5. class TexturedTerrain |    opt   |   yes   |    no    |
+// | 6. class CubeObject      |    on    |   opt   |   yes    |
+// | 7. class TetrahedronObj. |    on    |   opt   |   yes    |
+// | 8. class QuadObject      |    on    |   opt   |   yes    |
+// | 9. class IcosphereObject |    on    |   no    |   yes    |
 // +----------------------------------------------------------+
+// Meshes of 1 and 3-9 are shared between objects (see PrimitiveCache).
+// GroundGrid (ground_grid.h) draws an unbounded grid without any mesh.
 // Constructors' default is Object(pipelineProgram, programHandle)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -94,13 +102,55 @@ private:
 class TexturedTerrain : public SceneObject
 {
 public:
+  enum BrushMode
+  {
+    kRaise,    // Adds strength * falloff to the heights.
+    kLower,    // Subtracts strength * falloff from the heights.
+    kSmooth,   // Moves heights towards the average of their neighbors (strength in [0, 1]).
+    kFlatten,  // Moves heights towards target (strength in [0, 1]).
+  };
+
+  struct Brush
+  {
+    BrushMode mode  { kRaise };
+    float radius    { 0.05f };  // Model space units (the terrain spans [-0.5, 0.5] in x and z).
+    float strength  { 0.5f  };
+    float target    { 0.0f  };  // Flatten height.
+  };
+
   TexturedTerrain(BasicPipelineProgram* pipelineProgram, GLuint programHandle)
   : SceneObject(pipelineProgram, programHandle)
   { }
 
+  // The heightmap can be a JPEG or a raw 8-bit, 16-bit or float grid (see Heightmap).
+  // It is resampled to w x h vertices, with heights in [-63, 0.75] (the full range of the
+  // integer formats, or the float map's own minimum to maximum).
   void Load(const std::string& heightmapFileName, const std::string& textureFileName, 
     int w = 21, int h = 21);
 
+  // Same, from a heightmap in memory (e.g. from TerrainGenerator). Flat if it isn't loaded.
+  void Load(const Heightmap& heightmap, const std::string& textureFileName, 
+    int w = 21, int h = 21);
+
+  // Sculpts the terrain around center (model coordinates, only x and z are used). Only the 
+  // vertices under the brush are changed, normals are recomputed around them and just those 
+  // rows are sent to the graphics card. Returns false if the brush misses the terrain.
+  bool ApplyBrush(const glm::vec3& center, const Brush& brush);
+
+  // Intersects a world space ray with the height field. point is in model coordinates.
+  bool PickPoint(const Ray& ray, glm::vec3& point) const;
+
+  // Height field ray cast (no triangle BVH is needed, so edits stay cheap).
+  virtual bool IntersectRay(const Ray& ray, RayHit& hit) const;
+  virtual bool GetGroundHeight(const glm::vec3& point, float& height) const;
+  virtual AABB GetWorldBounds() const;
+
+  inline int GetWidth()  const { return mWidth;  }
+  inline int GetHeight() const { return mHeight; }
+
+  // Height, normal and ray queries in model coordinates.
+  inline const Heightfield& GetHeightfield() const { return mHeightfield; }
+
   virtual ~TexturedTerrain()
   {
     delete mTexture;
@@ -108,9 +158,94 @@ public:
   }
 
 private:
+  // Recomputes normals of the vertices in [x0, x1] x [y0, y1] (see Heightmap::ComputeNormals).
+  void ComputeNormals(int x0, int y0, int x1, int y1);
+
+  // Model space position of grid vertex (x, y).
+  inline glm::vec3 GridPosition(int x, int y) const;
+
   int mWidth  { 21 };
   int mHeight { 21 };
 
+  std::vector<float> mHeights;  // Row major, mWidth * mHeight.
+  Heightfield mHeightfield;     // Queries over mHeights.
+  std::vector<float> mScratch;  // Smoothing input copy.
+  float mMinHeight { 0.0f };
+  float mMaxHeight { 0.0f };
+
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Lit solid with a shared mesh, a material and an optional texture.
+class PrimitiveObject : public SceneObject
+{
+public:
+  PrimitiveObject(BasicPipelineProgram* pipelineProgram, GLuint programHandle)
+  : SceneObject(pipelineProgram, programHandle)
+  { }
+
+  virtual ~PrimitiveObject()
+  {
+    delete mTexture;
+    delete mMaterial;
+  }
+
+protected:
+  // No texture if textureFileName is empty.
+  void LoadPrimitive(Mesh* mesh, const std::string& textureFileName);
+};
+
+class CubeObject : public PrimitiveObject
+{
+public:
+  CubeObject(BasicPipelineProgram* pipelineProgram, GLuint programHandle)
+  : PrimitiveObject(pipelineProgram, programHandle)
+  { }
+
+  // Side 1, centered at the origin. The texture is repeated on every face.
+  void Load(const std::string& textureFileName = "");
 };
 
+class TetrahedronObject : public PrimitiveObject
+{
+public:
+  TetrahedronObject(BasicPipelineProgram* pipelineProgram, GLuint programHandle)
+  : PrimitiveObject(pipelineProgram, programHandle)
+  { }
+
+  // Regular, inscribed in the unit sphere.
+  void Load(const std::string& textureFileName = "");
+};
+
+class QuadObject : public PrimitiveObject
+{
+public:
+  QuadObject(BasicPipelineProgram* pipelineProgram, GLuint programHandle)
+  : PrimitiveObject(pipelineProgram, programHandle)
+  { }
+
+  // [-0.5, 0.5]^2 on the xy plane, facing +z (billboards, mirrors, screens).
+  void Load(const std::string& textureFileName = "");
+};
+
+class IcosphereObject : public PrimitiveObject
+{
+public:
+  IcosphereObject(BasicPipelineProgram* pipelineProgram, GLuint programHandle)
+  : PrimitiveObject(pipelineProgram, programHandle)
+  { }
+
+  // Unit sphere of 20 * 4^subdivisions even triangles (at most 7 subdivisions).
+  void Load(int subdivisions = 3);
+};
+
+inline
+glm::vec3 TexturedTerrain::GridPosition(int x, int y) const
+{
+  return glm::vec3(static_cast<float>(x - mWidth/2)/mWidth, 
+                   mHeights[mWidth * y + x], 
+                   static_cast<float>(y - mHeight/2)/mHeight);
+}
+
 }  // namespace gloo.
\ No newline at end of file
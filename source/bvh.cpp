@@ -0,0 +1,709 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace gloo
+{
+
+namespace
+{
+
+const int kNumBins        = 16;   // Number of SAH bins per split.
+const int kMaxLeafSize    = 8;    // Leaves are forced to split beyond this.
+const int kStackSize      = 256;  // Traversal stack size (nodes).
+const float kTraversalCost = 1.0f;  // SAH cost of visiting an inner node (triangle test = 1).
+
+// Spreads the 10 lower bits of x so that there are two zero bits between each one.
+inline uint64_t ExpandBits(uint64_t x)
+{
+  x &= 0x3ff;
+  x = (x | (x << 16)) & 0x30000ff;
+  x = (x | (x <<  8)) & 0x300f00f;
+  x = (x | (x <<  4)) & 0x30c30c3;
+  x = (x | (x <<  2)) & 0x9249249;
+  return x;
+}
+
+inline uint64_t Morton3(const glm::vec3& p)  // p in [0, 1]^3.
+{
+  uint64_t x = static_cast<uint64_t>(glm::clamp(p[0], 0.0f, 1.0f) * 1023.0f);
+  uint64_t y = static_cast<uint64_t>(glm::clamp(p[1], 0.0f, 1.0f) * 1023.0f);
+  uint64_t z = static_cast<uint64_t>(glm::clamp(p[2], 0.0f, 1.0f) * 1023.0f);
+  return (ExpandBits(x) << 2) | (ExpandBits(y) << 1) | ExpandBits(z);
+}
+
+void BuildTask(BVH* bvh, const std::vector<glm::vec3>& positions, 
+               const std::vector<GLuint>& triangles, std::atomic<bool>* ready)
+{
+  bvh->Build(positions, triangles);
+  ready->store(true);
+}
+
+template <int N>
+void TracePackets(const BVH& bvh, const std::vector<Ray>& rays, std::vector<RayHit>& hits)
+{
+  RayPacket<N> packet;
+  int n = rays.size();
+
+  for (int i = 0; i < n; i += N)
+  {
+    packet.Load(&rays[i], n - i);
+    bvh.Intersect<N>(packet, &hits[i]);
+  }
+}
+
+}  // namespace.
+
+// ================= Construction ================= //
+
+bool BVH::Build(const Mesh& mesh)
+{
+  std::vector<GLuint> triangles;
+  if (mesh.GetTriangles(triangles) == 0)
+  {
+    return false;
+  }
+
+  std::vector<glm::vec3> positions(mesh.GetNumVertices());
+  for (int i = 0; i < mesh.GetNumVertices(); i++)
+  {
+    positions[i] = mesh.GetPosition(i);
+  }
+
+  return BVH::Build(positions, triangles);
+}
+
+bool BVH::Build(const std::vector<glm::vec3>& positions, const std::vector<GLuint>& triangles)
+{
+  mNodes.clear();
+  mTriangles.clear();
+  mTriangleIds.clear();
+
+  int numTriangles = triangles.size() / 3;
+  if (numTriangles == 0)
+  {
+    return false;
+  }
+
+  // Per-triangle bounds and centroids.
+  std::vector<AABB> boxes(numTriangles);
+  std::vector<glm::vec3> centroids(numTriangles);
+  std::vector<int> triangleIds(numTriangles);
+
+  for (int i = 0; i < numTriangles; i++)
+  {
+    boxes[i].Expand(positions[triangles[3*i + 0]]);
+    boxes[i].Expand(positions[triangles[3*i + 1]]);
+    boxes[i].Expand(positions[triangles[3*i + 2]]);
+    centroids[i] = boxes[i].Center();
+    triangleIds[i] = i;
+  }
+
+  mNodes.reserve(2 * numTriangles);
+  BVH::BuildRecursive(triangleIds, boxes, centroids, 0, numTriangles);
+
+  // Store triangles in leaf order so that leaves read contiguous memory.
+  mTriangles.resize(numTriangles);
+  mTriangleIds = triangleIds;
+  mTriangleList = triangles;
+
+  for (int i = 0; i < numTriangles; i++)
+  {
+    int id = triangleIds[i];
+    const glm::vec3& v0 = positions[triangles[3*id + 0]];
+    const glm::vec3& v1 = positions[triangles[3*id + 1]];
+    const glm::vec3& v2 = positions[triangles[3*id + 2]];
+
+    mTriangles[i].v0 = v0;
+    mTriangles[i].e1 = v1 - v0;
+    mTriangles[i].e2 = v2 - v0;
+  }
+
+  mCost = mBuildCost = BVH::ComputeSAHCost();
+  return true;
+}
+
+int BVH::BuildRecursive(std::vector<int>& triangleIds, std::vector<AABB>& boxes,
+                        std::vector<glm::vec3>& centroids, int begin, int end)
+{
+  int nodeIndex = mNodes.size();
+  mNodes.push_back(Node());
+
+  AABB bounds, centroidBounds;
+  for (int i = begin; i < end; i++)
+  {
+    bounds.Expand(boxes[triangleIds[i]]);
+    centroidBounds.Expand(centroids[triangleIds[i]]);
+  }
+
+  int count = end - begin;
+  int axis = centroidBounds.MaxAxis();
+  float cmin = centroidBounds.min[axis];
+  float extent = centroidBounds.max[axis] - cmin;
+
+  auto makeLeaf = [&]()
+  {
+    Node& node = mNodes[nodeIndex];
+    node.mMin = bounds.min;
+    node.mMax = bounds.max;
+    node.mStart = begin;
+    node.mCount = count;
+    node.mAxis  = 0;
+    return nodeIndex;
+  };
+
+  if (count <= 2 || extent <= 0.0f)  // Nothing to gain (or all centroids coincide).
+  {
+    return makeLeaf();
+  }
+
+  // Binned SAH: project centroids into kNumBins bins along the largest axis.
+  int binCount[kNumBins] = { 0 };
+  AABB binBounds[kNumBins];
+  float scale = kNumBins / extent;
+
+  auto binOf = [&](int id)
+  {
+    int b = static_cast<int>((centroids[id][axis] - cmin) * scale);
+    return std::min(b, kNumBins - 1);
+  };
+
+  for (int i = begin; i < end; i++)
+  {
+    int b = binOf(triangleIds[i]);
+    binCount[b]++;
+    binBounds[b].Expand(boxes[triangleIds[i]]);
+  }
+
+  // Sweep from the right to accumulate right-side costs.
+  float rightArea[kNumBins];
+  int rightCount[kNumBins];
+  AABB acc;
+  int accCount = 0;
+  for (int b = kNumBins - 1; b > 0; b--)
+  {
+    acc.Expand(binBounds[b]);
+    accCount += binCount[b];
+    rightArea[b]  = acc.SurfaceArea();
+    rightCount[b] = accCount;
+  }
+
+  // Sweep from the left and find the best split plane (between bin b-1 and b).
+  float bestCost = kRayInfinity;
+  int bestSplit = -1;
+  acc = AABB();
+  accCount = 0;
+  for (int b = 1; b < kNumBins; b++)
+  {
+    acc.Expand(binBounds[b-1]);
+    accCount += binCount[b-1];
+    if (accCount == 0 || rightCount[b] == 0)
+      continue;
+
+    float cost = accCount * acc.SurfaceArea() + rightCount[b] * rightArea[b];
+    if (cost < bestCost)
+    {
+      bestCost  = cost;
+      bestSplit = b;
+    }
+  }
+
+  float parentArea = bounds.SurfaceArea();
+  float leafCost = static_cast<float>(count);
+  float splitCost = kTraversalCost + ((parentArea > 0.0f) ? bestCost / parentArea : kRayInfinity);
+
+  if (count <= kMaxLeafSize && (bestSplit < 0 || splitCost >= leafCost))
+  {
+    return makeLeaf();
+  }
+
+  // Partition triangles - fall back to a median split if SAH can't separate them.
+  int mid = begin;
+  if (bestSplit > 0)
+  {
+    auto it = std::partition(triangleIds.begin() + begin, triangleIds.begin() + end,
+                             [&](int id) { return binOf(id) < bestSplit; });
+    mid = it - triangleIds.begin();
+  }
+
+  if (mid == begin || mid == end)
+  {
+    mid = (begin + end) / 2;
+    std::nth_element(triangleIds.begin() + begin, triangleIds.begin() + mid,
+                     triangleIds.begin() + end,
+                     [&](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+  }
+
+  BVH::BuildRecursive(triangleIds, boxes, centroids, begin, mid);  // Left child: nodeIndex + 1.
+  int right = BVH::BuildRecursive(triangleIds, boxes, centroids, mid, end);
+
+  Node& node = mNodes[nodeIndex];
+  node.mMin = bounds.min;
+  node.mMax = bounds.max;
+  node.mStart = right;
+  node.mCount = 0;
+  node.mAxis  = axis;
+  return nodeIndex;
+}
+
+// ================= Refitting ================= //
+
+float BVH::Refit(const Mesh& mesh)
+{
+  return BVH::RefitWith([&mesh](GLuint i) { return mesh.GetPosition(i); });
+}
+
+float BVH::Refit(const std::vector<glm::vec3>& positions)
+{
+  return BVH::RefitWith([&positions](GLuint i) { return positions[i]; });
+}
+
+template <typename PositionFunc>
+float BVH::RefitWith(PositionFunc position)
+{
+  if (!IsBuilt())
+  {
+    return 0.0f;
+  }
+
+  // Update triangles (they are stored in leaf order).
+  for (int i = 0; i < static_cast<int>(mTriangles.size()); i++)
+  {
+    const GLuint* triangle = &mTriangleList[3 * mTriangleIds[i]];
+    glm::vec3 v0 = position(triangle[0]);
+
+    mTriangles[i].v0 = v0;
+    mTriangles[i].e1 = position(triangle[1]) - v0;
+    mTriangles[i].e2 = position(triangle[2]) - v0;
+  }
+
+  // Update bounds bottom-up: children are always stored after their parent.
+  for (int i = mNodes.size() - 1; i >= 0; i--)
+  {
+    Node& node = mNodes[i];
+    AABB bounds;
+
+    if (node.IsLeaf())
+    {
+      for (int k = node.mStart; k < node.mStart + node.mCount; k++)
+      {
+        const Triangle& tri = mTriangles[k];
+        bounds.Expand(tri.v0);
+        bounds.Expand(tri.v0 + tri.e1);
+        bounds.Expand(tri.v0 + tri.e2);
+      }
+    }
+    else
+    {
+      const Node& left  = mNodes[i + 1];
+      const Node& right = mNodes[node.mStart];
+      bounds = AABB(glm::min(left.mMin, right.mMin), glm::max(left.mMax, right.mMax));
+    }
+
+    node.mMin = bounds.min;
+    node.mMax = bounds.max;
+  }
+
+  mCost = BVH::ComputeSAHCost();
+  return mCost;
+}
+
+float BVH::ComputeSAHCost() const
+{
+  float rootArea = AABB(mNodes[0].mMin, mNodes[0].mMax).SurfaceArea();
+  if (rootArea <= 0.0f)
+  {
+    return 0.0f;
+  }
+
+  // Expected cost of a random ray hitting the root: area ratios weight each node.
+  float cost = 0.0f;
+  for (const Node& node : mNodes)
+  {
+    float area = AABB(node.mMin, node.mMax).SurfaceArea();
+    cost += area * (node.IsLeaf() ? node.mCount : kTraversalCost);
+  }
+
+  return cost / rootArea;
+}
+
+// ================= Single Ray Queries ================= //
+
+bool BVH::Intersect(const Ray& ray, RayHit& hit) const
+{
+  if (!IsBuilt())
+  {
+    return false;
+  }
+
+  glm::vec3 invDir(1.0f / ray.dir[0], 1.0f / ray.dir[1], 1.0f / ray.dir[2]);
+  float tMax = std::min(ray.tMax, hit.t);
+  bool found = false;
+
+  int stack[kStackSize];
+  int sp = 0;
+  stack[sp++] = 0;
+
+  while (sp > 0)
+  {
+    int index = stack[--sp];
+    const Node& node = mNodes[index];
+
+    if (!AABB(node.mMin, node.mMax).Intersect(ray.origin, invDir, ray.tMin, tMax))
+      continue;
+
+    if (node.IsLeaf())
+    {
+      for (int k = node.mStart; k < node.mStart + node.mCount; k++)
+      {
+        const Triangle& tri = mTriangles[k];
+        float t, u, v;
+        if (IntersectTriangle(tri.v0, tri.e1, tri.e2, ray.origin, ray.dir, ray.tMin, tMax, t, u, v))
+        {
+          tMax = t;
+          hit.t = t;
+          hit.u = u;
+          hit.v = v;
+          hit.triangle = mTriangleIds[k];
+          found = true;
+        }
+      }
+    }
+    else
+    {
+      // Visit the child on the ray side first (pushed last).
+      int nearChild = index + 1;
+      int farChild  = node.mStart;
+      if (ray.dir[node.mAxis] < 0.0f)
+        std::swap(nearChild, farChild);
+
+      stack[sp++] = farChild;
+      stack[sp++] = nearChild;
+    }
+  }
+
+  return found;
+}
+
+bool BVH::Occluded(const Ray& ray) const
+{
+  if (!IsBuilt())
+  {
+    return false;
+  }
+
+  glm::vec3 invDir(1.0f / ray.dir[0], 1.0f / ray.dir[1], 1.0f / ray.dir[2]);
+
+  int stack[kStackSize];
+  int sp = 0;
+  stack[sp++] = 0;
+
+  while (sp > 0)
+  {
+    int index = stack[--sp];
+    const Node& node = mNodes[index];
+
+    if (!AABB(node.mMin, node.mMax).Intersect(ray.origin, invDir, ray.tMin, ray.tMax))
+      continue;
+
+    if (node.IsLeaf())
+    {
+      for (int k = node.mStart; k < node.mStart + node.mCount; k++)
+      {
+        const Triangle& tri = mTriangles[k];
+        float t, u, v;
+        if (IntersectTriangle(tri.v0, tri.e1, tri.e2, ray.origin, ray.dir, ray.tMin, ray.tMax, t, u, v))
+          return true;
+      }
+    }
+    else
+    {
+      stack[sp++] = node.mStart;
+      stack[sp++] = index + 1;
+    }
+  }
+
+  return false;
+}
+
+// ================= Packet Queries ================= //
+
+// Per-lane loops below (see ray.h): the slab test runs once per node for the whole
+// packet and the triangle test runs once per triangle for the whole packet.
+template <int N>
+void BVH::Intersect(RayPacket<N>& p, RayHit* hits) const
+{
+  if (!IsBuilt() || p.numActive == 0)
+  {
+    return;
+  }
+
+  alignas(64) float hitU[N];
+  alignas(64) float hitV[N];
+  alignas(64) int hitTri[N];
+
+  for (int i = 0; i < N; i++)
+  {
+    hitTri[i] = -1;
+    hitU[i] = hitV[i] = 0.0f;
+  }
+
+  for (int i = 0; i < p.numActive; i++)
+  {
+    p.tMax[i] = std::min(p.tMax[i], hits[i].t);
+  }
+
+  // Packets are assembled from sorted streams: lanes share the direction octant.
+  bool dirNeg[3] = { p.dx[0] < 0.0f, p.dy[0] < 0.0f, p.dz[0] < 0.0f };
+
+  int stack[kStackSize];
+  int sp = 0;
+  stack[sp++] = 0;
+
+  while (sp > 0)
+  {
+    int index = stack[--sp];
+    const Node& node = mNodes[index];
+
+    // SIMD slab test.
+    int anyHit = 0;
+    for (int i = 0; i < N; i++)
+    {
+      float tx0 = (node.mMin[0] - p.ox[i]) * p.idx[i];
+      float tx1 = (node.mMax[0] - p.ox[i]) * p.idx[i];
+      float ty0 = (node.mMin[1] - p.oy[i]) * p.idy[i];
+      float ty1 = (node.mMax[1] - p.oy[i]) * p.idy[i];
+      float tz0 = (node.mMin[2] - p.oz[i]) * p.idz[i];
+      float tz1 = (node.mMax[2] - p.oz[i]) * p.idz[i];
+
+      float tNear = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)),
+                             std::max(std::min(tz0, tz1), p.tMin[i]));
+      float tFar  = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)),
+                             std::min(std::max(tz0, tz1), p.tMax[i]));
+      anyHit |= (tNear <= tFar);
+    }
+
+    if (!anyHit)
+      continue;
+
+    if (node.IsLeaf())
+    {
+      for (int k = node.mStart; k < node.mStart + node.mCount; k++)
+      {
+        const Triangle& tri = mTriangles[k];
+
+        // SIMD Moller-Trumbore.
+        for (int i = 0; i < N; i++)
+        {
+          float px = p.dy[i]*tri.e2[2] - p.dz[i]*tri.e2[1];
+          float py = p.dz[i]*tri.e2[0] - p.dx[i]*tri.e2[2];
+          float pz = p.dx[i]*tri.e2[1] - p.dy[i]*tri.e2[0];
+
+          float det = tri.e1[0]*px + tri.e1[1]*py + tri.e1[2]*pz;
+          float invDet = 1.0f / det;
+
+          float tx = p.ox[i] - tri.v0[0];
+          float ty = p.oy[i] - tri.v0[1];
+          float tz = p.oz[i] - tri.v0[2];
+          float u = (tx*px + ty*py + tz*pz) * invDet;
+
+          float qx = ty*tri.e1[2] - tz*tri.e1[1];
+          float qy = tz*tri.e1[0] - tx*tri.e1[2];
+          float qz = tx*tri.e1[1] - ty*tri.e1[0];
+          float v = (p.dx[i]*qx + p.dy[i]*qy + p.dz[i]*qz) * invDet;
+          float t = (tri.e2[0]*qx + tri.e2[1]*qy + tri.e2[2]*qz) * invDet;
+
+          bool hit = (std::abs(det) >= 1e-12f) && (u >= 0.0f) && (v >= 0.0f) && (u + v <= 1.0f)
+                  && (t > p.tMin[i]) && (t < p.tMax[i]);
+
+          p.tMax[i] = hit ? t : p.tMax[i];
+          hitU[i]   = hit ? u : hitU[i];
+          hitV[i]   = hit ? v : hitV[i];
+          hitTri[i] = hit ? k : hitTri[i];
+        }
+      }
+    }
+    else
+    {
+      int nearChild = index + 1;
+      int farChild  = node.mStart;
+      if (dirNeg[node.mAxis])
+        std::swap(nearChild, farChild);
+
+      stack[sp++] = farChild;
+      stack[sp++] = nearChild;
+    }
+  }
+
+  for (int i = 0; i < p.numActive; i++)
+  {
+    if (hitTri[i] >= 0)
+    {
+      hits[i].t = p.tMax[i];
+      hits[i].u = hitU[i];
+      hits[i].v = hitV[i];
+      hits[i].triangle = mTriangleIds[hitTri[i]];
+    }
+  }
+}
+
+template void BVH::Intersect<4> (RayPacket<4>&  packet, RayHit* hits) const;
+template void BVH::Intersect<8> (RayPacket<8>&  packet, RayHit* hits) const;
+template void BVH::Intersect<16>(RayPacket<16>& packet, RayHit* hits) const;
+
+// ================= Stream Queries ================= //
+
+void BVH::IntersectStream(const std::vector<Ray>& rays, std::vector<RayHit>& hits,
+                          int packetWidth) const
+{
+  int n = rays.size();
+  hits.resize(n);
+
+  // Widest supported packet not above packetWidth.
+  packetWidth = (packetWidth >= 16) ? 16 : (packetWidth >= 8) ? 8 : (packetWidth >= 4) ? 4 : 1;
+
+  if (packetWidth == 1)  // Single ray path.
+  {
+    for (int i = 0; i < n; i++)
+    {
+      BVH::Intersect(rays[i], hits[i]);
+    }
+    return;
+  }
+
+  // Gather rays (and current hits, which bound tMax) in coherent order.
+  std::vector<int> order;
+  SortRaysByCoherence(rays, order);
+
+  std::vector<Ray> sortedRays(n);
+  std::vector<RayHit> sortedHits(n);
+  for (int i = 0; i < n; i++)
+  {
+    sortedRays[i] = rays[order[i]];
+    sortedHits[i] = hits[order[i]];
+  }
+
+  switch (packetWidth)
+  {
+    case 4:  TracePackets<4> (*this, sortedRays, sortedHits); break;
+    case 8:  TracePackets<8> (*this, sortedRays, sortedHits); break;
+    case 16: TracePackets<16>(*this, sortedRays, sortedHits); break;
+  }
+
+  for (int i = 0; i < n; i++)
+  {
+    hits[order[i]] = sortedHits[i];
+  }
+}
+
+// ================= Dynamic BVH ================= //
+
+void DynamicBVH::Update(const Mesh& mesh, unsigned revision)
+{
+  // Swap in a finished rebuild - the worker is done, so join doesn't block.
+  if (mRebuilding && mBackReady.load())
+  {
+    mWorker.join();
+    mRebuilding = false;
+
+    if (mBack->IsBuilt())
+    {
+      mFront.swap(mBack);
+      mFrontRevision = mBackRevision;
+    }
+    mBack.reset();
+  }
+
+  if (!mFront)  // First use: nothing to answer queries with yet.
+  {
+    mFront.reset(new BVH());
+    mFront->Build(mesh);
+    mFrontRevision = revision;
+    return;
+  }
+
+  if (!mFront->IsBuilt())
+  {
+    return;
+  }
+
+  // Positions changed - same topology, so refit in place.
+  if (mFrontRevision != revision)
+  {
+    mFront->Refit(mesh);
+    mFrontRevision = revision;
+  }
+
+  // Quality dropped too much - rebuild from a snapshot of the current positions.
+  if (!mRebuilding && mFront->GetSAHCost() > mRebuildThreshold * mFront->GetBuildCost())
+  {
+    DynamicBVH::StartRebuild(mesh, revision);
+  }
+}
+
+void DynamicBVH::StartRebuild(const Mesh& mesh, unsigned revision)
+{
+  std::vector<glm::vec3> positions(mesh.GetNumVertices());
+  for (int i = 0; i < mesh.GetNumVertices(); i++)
+  {
+    positions[i] = mesh.GetPosition(i);
+  }
+
+  mBack.reset(new BVH());
+  mBackRevision = revision;
+  mBackReady.store(false);
+  mRebuilding = true;
+
+  mWorker = std::thread(BuildTask, mBack.get(), std::move(positions), 
+                        mFront->GetTriangleList(), &mBackReady);
+}
+
+DynamicBVH::~DynamicBVH()
+{
+  if (mWorker.joinable())
+  {
+    mWorker.join();
+  }
+}
+
+// ================= Ray Sorting ================= //
+
+void SortRaysByCoherence(const std::vector<Ray>& rays, std::vector<int>& order)
+{
+  int n = rays.size();
+  order.resize(n);
+
+  AABB originBounds;
+  for (const Ray& ray : rays)
+  {
+    originBounds.Expand(ray.origin);
+  }
+
+  glm::vec3 extent = originBounds.Extent();
+  glm::vec3 invExtent(extent[0] > 0.0f ? 1.0f / extent[0] : 0.0f,
+                      extent[1] > 0.0f ? 1.0f / extent[1] : 0.0f,
+                      extent[2] > 0.0f ? 1.0f / extent[2] : 0.0f);
+
+  // Key = [octant : 3 bits][origin morton : 30 bits][direction morton : 30 bits].
+  std::vector<std::pair<uint64_t, int>> keys(n);
+  for (int i = 0; i < n; i++)
+  {
+    const Ray& ray = rays[i];
+    uint64_t octant = (ray.dir[0] < 0.0f) | ((ray.dir[1] < 0.0f) << 1) | ((ray.dir[2] < 0.0f) << 2);
+    glm::vec3 o = (ray.origin - originBounds.min) * invExtent;
+    glm::vec3 d = 0.5f * (glm::normalize(ray.dir) + glm::vec3(1.0f));
+
+    keys[i].first  = (octant << 60) | (Morton3(o) << 30) | Morton3(d);
+    keys[i].second = i;
+  }
+
+  std::sort(keys.begin(), keys.end());
+
+  for (int i = 0; i < n; i++)
+  {
+    order[i] = keys[i].second;
+  }
+}
+
+}  // namespace gloo.
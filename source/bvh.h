@@ -0,0 +1,165 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+#include "mesh.h"
+#include "ray.h"
+
+//  +-------------------------------------------------+
+//  |  Bounding volume hierarchy over the triangles   |
+//  |  of a Mesh, built with binned SAH.              |
+//  |                                                 |
+//  |  Nodes are stored depth-first in a flat array:  |
+//  |  the left child of an inner node is the next    |
+//  |  node and the right child is at mStart.         |
+//  |  Leaves reference [mStart, mStart + mCount) in  |
+//  |  the reordered triangle list.                   |
+//  |                                                 |
+//  |  Queries: single closest hit, any hit (for      |
+//  |  visibility), 4/8/16-wide packets and streams   |
+//  |  of rays sorted for coherence.                  |
+//  |                                                 |
+//  |  Deforming meshes keep their topology, so the   |
+//  |  tree is refit in place. DynamicBVH tracks the  |
+//  |  SAH cost growth and rebuilds in a background   |
+//  |  thread, swapping the new tree in when ready.   |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class BVH
+{
+public:
+  struct Node
+  {
+    glm::vec3 mMin;
+    int mStart;     // Leaf: first triangle. Inner: right child index.
+    glm::vec3 mMax;
+    int mCount;     // Leaf: number of triangles. Inner: 0.
+    int mAxis;      // Split axis (inner nodes only).
+
+    inline bool IsLeaf() const { return (mCount > 0); }
+  };
+
+  BVH() { }
+
+  // Builds the hierarchy from the mesh triangles (strips and fans are unrolled).
+  bool Build(const Mesh& mesh);
+
+  // Builds the hierarchy from a position array and a triangle list { i0, i1, i2, ... }.
+  bool Build(const std::vector<glm::vec3>& positions, const std::vector<GLuint>& triangles);
+
+  // Updates the triangles and node bounds in place for new vertex positions. The topology
+  // (triangle list) must be the same used to build the tree. Returns the new SAH cost.
+  float Refit(const Mesh& mesh);
+  float Refit(const std::vector<glm::vec3>& positions);
+
+  // Single ray queries. Intersect keeps the closest hit, Occluded returns on the first one.
+  bool Intersect(const Ray& ray, RayHit& hit) const;
+  bool Occluded(const Ray& ray) const;
+
+  // Packet query: N must be 4, 8 or 16. hits[i] is only updated if lane i finds a closer hit.
+  template <int N>
+  void Intersect(RayPacket<N>& packet, RayHit* hits) const;
+
+  // Stream query: rays are sorted for coherence and traced in packets of packetWidth
+  // (1, 4, 8 or 16 - other widths are rounded down to one of these, and anything below 4
+  // traces single rays). hits[i] corresponds to rays[i] and must have rays.size() elements.
+  void IntersectStream(const std::vector<Ray>& rays, std::vector<RayHit>& hits,
+                       int packetWidth = 8) const;
+
+  // Getters.
+  inline bool IsBuilt() const { return !mNodes.empty(); }
+  inline int GetNumNodes() const { return mNodes.size(); }
+  inline int GetNumTriangles() const { return mTriangleIds.size(); }
+  inline AABB GetBounds() const;
+  inline const std::vector<GLuint>& GetTriangleList() const { return mTriangleList; }
+
+  // Surface area heuristic cost - it grows as refits loosen the bounds.
+  inline float GetSAHCost()   const { return mCost;      }
+  inline float GetBuildCost() const { return mBuildCost; }
+
+private:
+  struct Triangle  // Precomputed for Moller-Trumbore: v0, e1 = v1 - v0, e2 = v2 - v0.
+  {
+    glm::vec3 v0, e1, e2;
+  };
+
+  int BuildRecursive(std::vector<int>& triangleIds, std::vector<AABB>& boxes,
+                     std::vector<glm::vec3>& centroids, int begin, int end);
+
+  template <typename PositionFunc>
+  float RefitWith(PositionFunc position);
+
+  float ComputeSAHCost() const;
+
+  std::vector<Node> mNodes;
+  std::vector<Triangle> mTriangles;  // In leaf order.
+  std::vector<int> mTriangleIds;     // Original triangle index, in leaf order.
+  std::vector<GLuint> mTriangleList; // Triangle list used to build (for refits).
+
+  float mCost      { 0.0f };
+  float mBuildCost { 0.0f };
+};
+
+// ============================================================================================= //
+
+class DynamicBVH
+{
+public:
+  DynamicBVH() { }
+
+  // Brings the tree up to date with the mesh. revision must change whenever positions do.
+  // - First call: builds synchronously.
+  // - Positions changed: refits the current tree in place.
+  // - SAH cost grew beyond the threshold: starts a rebuild in a background thread.
+  // - Rebuild finished: swaps it in (refit first if positions changed meanwhile).
+  // It never waits for a background rebuild.
+  void Update(const Mesh& mesh, unsigned revision);
+
+  inline const BVH* Get() const { return (mFront && mFront->IsBuilt()) ? mFront.get() : nullptr; }
+  inline bool IsRebuilding() const { return mRebuilding; }
+
+  // Rebuild when cost > threshold * cost at build time (default 1.5).
+  inline void SetRebuildThreshold(float threshold) { mRebuildThreshold = threshold; }
+
+  ~DynamicBVH();
+
+private:
+  void StartRebuild(const Mesh& mesh, unsigned revision);
+
+  std::unique_ptr<BVH> mFront;  // Used by queries.
+  std::unique_ptr<BVH> mBack;   // Being built by mWorker.
+  std::thread mWorker;
+  std::atomic<bool> mBackReady { false };
+  bool mRebuilding { false };
+
+  unsigned mFrontRevision { 0 };
+  unsigned mBackRevision  { 0 };
+  float mRebuildThreshold { 1.5f };
+};
+
+// Sorts ray indices so that consecutive rays share direction octant and are close in
+// origin and direction (Morton order). Used to assemble coherent packets from streams.
+void SortRaysByCoherence(const std::vector<Ray>& rays, std::vector<int>& order);
+
+// ============================================================================================= //
+
+inline
+AABB BVH::GetBounds() const
+{
+  return IsBuilt() ? AABB(mNodes[0].mMin, mNodes[0].mMax) : AABB();
+}
+
+}  // namespace gloo.
@@ -2,6 +2,8 @@
 
 #include "scene_object.h"
 
+#include <algorithm>
+
 namespace gloo
 {
 
@@ -55,6 +57,13 @@ void Camera::Animate()
   }
   else
   {
+    // Ground collision.
+    GLfloat groundHeight;
+    if (mGround && mGround->GetGroundHeight(mPos, groundHeight))
+    {
+      mPos[1] = std::max(mPos[1], groundHeight + mEyeHeight);
+    }
+
     mViewMatrix.LookAt(          mPos[0],           mPos[1],           mPos[2],
                        mPos[0] + mDir[0], mPos[1] + mDir[1], mPos[2] + mDir[2],
                               mUpVec[0],          mUpVec[1],         mUpVec[2]);
@@ -92,6 +101,24 @@ glm::vec3 Camera::ComputeRayAt(float x_v, float y_v, float w, float h)
   return glm::vec3(ray[0], ray[1], ray[2]);
 }
 
+Ray Camera::ComputeRay(float x_v, float y_v, float w, float h)
+{
+  // Convert viewport coordinates to normalized device coordinates.
+  y_v = (h - y_v);
+  float xp = 2.0f * (x_v / w) - 1.0f;
+  float yp = 2.0f * (y_v / h) - 1.0f;
+
+  const glm::mat4& V = mViewMatrix.GetGLMatrix();
+  const glm::mat4& P = mProjMatrix.GetGLMatrix();
+
+  // Unproject the far plane point and shoot from the camera center towards it.
+  glm::vec4 farPoint = glm::inverse(P*V) * glm::vec4(xp, yp, 1.0, 1.0);
+  farPoint /= farPoint[3];
+
+  glm::vec3 C = Camera::GetCenterCoordinates();
+  return Ray(C, glm::normalize(glm::vec3(farPoint) - C));
+}
+
 glm::vec3 Camera::GetCenterCoordinates() 
 { 
   const glm::mat4& V = mViewMatrix.GetGLMatrix();
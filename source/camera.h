@@ -14,6 +14,8 @@
 #include "openGLMatrix.h"
 #include "basicPipelineProgram.h"
 
+#include "ray.h"
+
 
 namespace gloo
 {
@@ -37,6 +39,9 @@ public:
 
   // Computes the line which goes from camera origin to mouse coords at projection plane.
   glm::vec3 ComputeRayAt(float x_v, float y_v, float w, float h);
+
+  // Computes the world space ray from the camera center through the pixel (x_v, y_v).
+  Ray ComputeRay(float x_v, float y_v, float w, float h);
   glm::vec3 GetCenterCoordinates();
   
   void Scale(GLfloat d_sx, GLfloat d_sy, GLfloat d_sz);
@@ -52,8 +57,12 @@ public:
   void SetCameraType(CameraType type) { mType = type; }
   void SetFocusObject(SceneObject* focusObject) { mFocusObject = focusObject; }
 
+  // FPV cameras stay eyeHeight above the ground object (see SceneObject::GetGroundHeight).
+  void SetGround(const SceneObject* ground, GLfloat eyeHeight = 1.7f) { mGround = ground; mEyeHeight = eyeHeight; }
+
   CameraType   GetCameraType()  { return mType;        }
   SceneObject* GetFocusObject() { return mFocusObject; }
+  GLfloat      GetFovy() const  { return mFovy;        }
 
   void SetPipelineProgramParam(BasicPipelineProgram *pipelineProgram, GLuint programHandle);
 
@@ -66,6 +75,8 @@ private:
   glm::vec3 mUpVec { 0.0f, 1.0f,  0.0f};      // Up vector.
   glm::vec3 mScale { 1.0f, 1.0f,  1.0f};      // Scales.
   SceneObject* mFocusObject { nullptr };      // The object at which the camera is looking.
+  const SceneObject* mGround { nullptr };     // Walkable surface (FPV).
+  GLfloat mEyeHeight { 1.7f };
   CameraType mType { EDITOR  };   // Type of camera.
 
   // Projection parameters
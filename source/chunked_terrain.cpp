@@ -0,0 +1,701 @@
+#include "chunked_terrain.h"
+#include "parallel.h"
+
+#include <cmath>
+#include <limits>
+#include <iostream>
+#include <algorithm>
+
+namespace gloo
+{
+
+namespace
+{
+
+const uint64_t kNoTile = std::numeric_limits<uint64_t>::max();
+
+// Vertices morph over the last third of each range.
+const float kMorphStartRatio = 0.66f;
+
+// Streamed children are requested when the camera is this close (relative to their range).
+const float kPrefetchRange = 1.5f;
+
+// A range must cover a few nodes of its level, otherwise neighbors could be more than one
+// level apart (and morphing wouldn't close the gaps).
+const float kMinRangeInNodes = 2.5f;
+
+// Triangle budget controller: relax fast, tighten slowly.
+const float kRelaxFactor   = 1.25f;
+const float kTightenFactor = 1.1f;
+const float kTightenBelow  = 0.7f;
+
+inline uint64_t TileKey(int level, int x, int z)
+{
+  return (static_cast<uint64_t>(level) << 56) | (static_cast<uint64_t>(z) << 28) |
+          static_cast<uint64_t>(x);
+}
+
+inline int PopCount(int bits)
+{
+  int count = 0;
+  for (; bits; bits &= bits - 1)
+    count++;
+  return count;
+}
+
+}  // namespace.
+
+// ================= Loading ================= //
+
+bool ChunkedTerrain::Load(const std::string& heightmapFileName, float spacing, float heightScale,
+                          const std::string& shaderPath)
+{
+  Heightmap heightmap;
+  if (!heightmap.Load(heightmapFileName))
+  {
+    return false;
+  }
+
+  return ChunkedTerrain::Load(std::move(heightmap), spacing, heightScale, shaderPath);
+}
+
+bool ChunkedTerrain::Load(Heightmap&& heightmap, float spacing, float heightScale,
+                          const std::string& shaderPath)
+{
+  if (!heightmap.IsLoaded() || heightmap.GetWidth() < 2 || heightmap.GetHeight() < 2)
+  {
+    std::cerr << "ERROR Terrain heightmap must be at least 2x2.\n";
+    return false;
+  }
+
+  mStreamer.Stop();
+  mTiledHeightmap.Close();
+  mHeightmap = std::move(heightmap);
+
+  if (!ChunkedTerrain::Init(mHeightmap.GetWidth(), mHeightmap.GetHeight(), spacing, heightScale,
+                            shaderPath))
+  {
+    return false;
+  }
+
+  mHeightfield.Set(mHeightmap.GetData(), mWidth, mHeight, glm::vec3(mOrigin[0], 0.0f, mOrigin[1]),
+                   spacing, spacing, heightScale, Heightfield::kMainDiagonal);
+  return true;
+}
+
+bool ChunkedTerrain::LoadTiled(const std::string& fileName, float spacing, float heightScale,
+                               size_t memoryBudget, const std::string& shaderPath)
+{
+  mStreamer.Stop();
+  if (!mTiledHeightmap.Open(fileName))
+  {
+    return false;
+  }
+
+  // Every node must lie inside a single tile of its level.
+  if (mTiledHeightmap.GetBlockSize() != kGridSize || mTiledHeightmap.GetTileSize() % kGridSize != 0)
+  {
+    std::cerr << "ERROR " << fileName << " must have blocks of " << kGridSize
+              << " and tiles that are a multiple of it.\n";
+    mTiledHeightmap.Close();
+    return false;
+  }
+
+  mHeightmap = Heightmap();
+  mHeightfield = Heightfield();
+
+  if (!ChunkedTerrain::Init(mTiledHeightmap.GetWidth(), mTiledHeightmap.GetHeight(), spacing,
+                            heightScale, shaderPath) ||
+      !mStreamer.Start(&mTiledHeightmap, memoryBudget))
+  {
+    mTiledHeightmap.Close();
+    return false;
+  }
+
+  // The coarsest level is always resident, so there's always something to draw.
+  int top = mNumLevels - 1;
+  for (int tz = 0; tz < mTiledHeightmap.GetTilesZ(top); tz++)
+  {
+    for (int tx = 0; tx < mTiledHeightmap.GetTilesX(top); tx++)
+    {
+      mStreamer.Pin(top, tx, tz);
+    }
+  }
+
+  return true;
+}
+
+bool ChunkedTerrain::Init(int w, int h, float spacing, float heightScale,
+                          const std::string& shaderPath)
+{
+  // Attributes at the locations of the main program, so the grid mesh VAO works for both.
+  if (!mProgram.Load(shaderPath, mProgramHandle))
+  {
+    return false;
+  }
+
+  mWidth       = w;
+  mHeight      = h;
+  mSpacing     = spacing;
+  mHeightScale = heightScale;
+
+  mExtent = 0.5f * spacing * glm::vec2(w - 1, h - 1);
+  mOrigin = -1.0f * mExtent;
+
+  // Enough levels for the root node to cover the whole map.
+  int size = std::max(w, h) - 1;
+  mNumLevels = 1;
+  while ((kGridSize << (mNumLevels - 1)) < size)
+  {
+    mNumLevels++;
+  }
+
+  ChunkedTerrain::BuildMinMax();
+
+  // Shared grid: (kGridSize + 1)^2 vertices at integer (x, 0, z). Indices are grouped by
+  // quadrant, so any subset of quadrants is a few contiguous ranges.
+  int side = kGridSize + 1;
+  int half = kGridSize / 2;
+  std::vector<GLfloat> positions(3 * side * side);
+  std::vector<GLuint> indices;
+  indices.reserve(6 * kGridSize * kGridSize);
+
+  for (int z = 0; z < side; z++)
+  {
+    for (int x = 0; x < side; x++)
+    {
+      GLfloat* p = &positions[3 * (z * side + x)];
+      p[0] = static_cast<GLfloat>(x);
+      p[1] = 0.0f;
+      p[2] = static_cast<GLfloat>(z);
+    }
+  }
+
+  for (int q = 0; q < 4; q++)
+  {
+    int qx = (q & 1) * half;
+    int qz = (q >> 1) * half;
+    for (int z = qz; z < qz + half; z++)
+    {
+      for (int x = qx; x < qx + half; x++)
+      {
+        // Split along the (x, z) - (x+1, z+1) diagonal, which the morph keeps intact.
+        GLuint v00 = z * side + x, v10 = v00 + 1;
+        GLuint v01 = v00 + side,   v11 = v01 + 1;
+        indices.insert(indices.end(), { v00, v11, v10, v00, v01, v11 });
+      }
+    }
+  }
+
+  delete mGridMesh;
+  mGridMesh = new Mesh();
+  mGridMesh->SetProgramHandle(mProgramHandle);
+  if (!mGridMesh->Load(positions.data(), nullptr, nullptr, nullptr, indices.data(),
+                       side * side, indices.size(), GL_TRIANGLES))
+  {
+    std::cerr << "ERROR Couldn't create the terrain grid.\n";
+    return false;
+  }
+
+  // Height tiles: one layer per cached node.
+  if (mTileArray == 0)
+  {
+    glGenTextures(1, &mTileArray);
+  }
+  glBindTexture(GL_TEXTURE_2D_ARRAY, mTileArray);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, kTileSize, kTileSize, kMaxTiles, 0,
+               GL_RED, GL_FLOAT, nullptr);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  mTileLayers.clear();
+  mLayerKeys.assign(kMaxTiles, kNoTile);
+  mLayerFrames.assign(kMaxTiles, 0);
+  mTileScratch.resize(kTileSize * kTileSize);
+
+  mRanges.resize(mNumLevels);
+  mMorphs.resize(mNumLevels);
+
+  return true;
+}
+
+void ChunkedTerrain::BuildMinMax()
+{
+  mMinMax.assign(mNumLevels, std::vector<glm::vec2>());
+
+  const float inf = std::numeric_limits<float>::infinity();
+  int w = mWidth;
+  int h = mHeight;
+
+  // Level 0 from the samples (nodes outside the map stay empty).
+  int n0 = GetNodesPerSide(0);
+  mMinMax[0].assign(n0 * n0, glm::vec2(inf, -inf));
+
+  if (ChunkedTerrain::IsStreaming())
+  {
+    // Precomputed by the converter.
+    const glm::vec2* blocks = mTiledHeightmap.GetBlockMinMax();
+    int blocksX = mTiledHeightmap.GetBlocksX();
+
+    for (int z = 0; z < mTiledHeightmap.GetBlocksZ(); z++)
+    {
+      for (int x = 0; x < blocksX; x++)
+      {
+        float a = mHeightScale * blocks[z * blocksX + x][0];
+        float b = mHeightScale * blocks[z * blocksX + x][1];
+        mMinMax[0][z * n0 + x] = glm::vec2(std::min(a, b), std::max(a, b));
+      }
+    }
+  }
+  else
+  {
+    tool::ParallelFor(0, n0, 1, [&](int first, int last)
+    {
+      for (int z = first; z < last; z++)
+      {
+        for (int x = 0; x < n0; x++)
+        {
+          if (!ChunkedTerrain::NodeExists(0, x, z))
+            continue;
+
+          int x0 = x * kGridSize, x1 = std::min(x0 + kGridSize, w - 1);
+          int z0 = z * kGridSize, z1 = std::min(z0 + kGridSize, h - 1);
+
+          float lo = inf, hi = -inf;
+          for (int sz = z0; sz <= z1; sz++)
+          {
+            const float* row = mHeightmap.GetData() + static_cast<size_t>(w) * sz;
+            for (int sx = x0; sx <= x1; sx++)
+            {
+              lo = std::min(lo, row[sx]);
+              hi = std::max(hi, row[sx]);
+            }
+          }
+
+          // A negative scale flips the range.
+          float a = mHeightScale * lo, b = mHeightScale * hi;
+          mMinMax[0][z * n0 + x] = glm::vec2(std::min(a, b), std::max(a, b));
+        }
+      }
+    });
+  }
+
+  // Parents from their 4 children.
+  for (int level = 1; level < mNumLevels; level++)
+  {
+    int n = GetNodesPerSide(level);
+    int nc = GetNodesPerSide(level - 1);
+    const std::vector<glm::vec2>& children = mMinMax[level - 1];
+    mMinMax[level].assign(n * n, glm::vec2(inf, -inf));
+
+    for (int z = 0; z < n; z++)
+    {
+      for (int x = 0; x < n; x++)
+      {
+        glm::vec2& node = mMinMax[level][z * n + x];
+        for (int k = 0; k < 4; k++)
+        {
+          const glm::vec2& child = children[(2*z + (k >> 1)) * nc + 2*x + (k & 1)];
+          node[0] = std::min(node[0], child[0]);
+          node[1] = std::max(node[1], child[1]);
+        }
+      }
+    }
+  }
+}
+
+// ================= Selection ================= //
+
+bool ChunkedTerrain::NodeExists(int level, int x, int z) const
+{
+  int nodeSize = kGridSize << level;
+  return (x * nodeSize < mWidth - 1) && (z * nodeSize < mHeight - 1);
+}
+
+AABB ChunkedTerrain::NodeBounds(int level, int x, int z) const
+{
+  int nodeSize = kGridSize << level;
+  int x0 = x * nodeSize, x1 = std::min(x0 + nodeSize, mWidth  - 1);
+  int z0 = z * nodeSize, z1 = std::min(z0 + nodeSize, mHeight - 1);
+  const glm::vec2& range = mMinMax[level][z * GetNodesPerSide(level) + x];
+
+  return AABB(glm::vec3(mOrigin[0] + x0 * mSpacing, range[0], mOrigin[1] + z0 * mSpacing),
+              glm::vec3(mOrigin[0] + x1 * mSpacing, range[1], mOrigin[1] + z1 * mSpacing));
+}
+
+void ChunkedTerrain::ComputeRanges(float viewportHeight) const
+{
+  // A world space error e at distance d covers e * K / d pixels.
+  float K = viewportHeight / (2.0f * std::tan(0.5f * mCamera->GetFovy()));
+
+  // Level l vertices are spacing * 2^l apart - that's the error of skipping that level.
+  float maxError = K / (kMinRangeInNodes * kGridSize);
+  float tau = std::min(std::max(mScreenError, 1e-3f), maxError);
+  mStats.screenError = tau;
+
+  for (int level = 0; level < mNumLevels; level++)
+  {
+    bool top = (level == mNumLevels - 1);
+    mRanges[level] = top ? std::numeric_limits<float>::infinity()
+                         : mSpacing * (1 << level) * K / tau;
+
+    float previous = (level > 0) ? mRanges[level - 1] : 0.0f;
+    float start = previous + kMorphStartRatio * (mRanges[level] - previous);
+    mMorphs[level] = top ? glm::vec2(std::numeric_limits<float>::max(), 0.0f)
+                         : glm::vec2(start, 1.0f / std::max(mRanges[level] - start, 1e-6f));
+  }
+}
+
+ChunkedTerrain::SelectResult ChunkedTerrain::SelectNode(int level, int x, int z,
+                                                        const Frustum& frustum,
+                                                        const glm::vec3& cameraPos) const
+{
+  if (!ChunkedTerrain::NodeExists(level, x, z))
+  {
+    return kCulled;
+  }
+
+  AABB bounds = ChunkedTerrain::NodeBounds(level, x, z);
+
+  // Squared distance from the camera to the box.
+  glm::vec3 closest = glm::clamp(cameraPos, bounds.min, bounds.max);
+  float distance2 = glm::dot(closest - cameraPos, closest - cameraPos);
+
+  if (distance2 > mRanges[level] * mRanges[level])
+  {
+    return kOutOfRange;
+  }
+
+  if (!frustum.Intersects(bounds))
+  {
+    mStats.numCulled++;
+    return kCulled;
+  }
+
+  Selection selection;
+  selection.level = level;
+  selection.x = x;
+  selection.z = z;
+  selection.quadrants = 0xF;
+  selection.distance = glm::length(bounds.Center() - cameraPos);
+
+  // Children are needed only when the finer level range reaches this node. When streaming,
+  // their data must be resident too (it's requested a bit before it's needed).
+  float range = (level > 0) ? mRanges[level - 1] : 0.0f;
+  bool refine = (level > 0 && distance2 <= range * range);
+  bool prefetch = (level > 0 && distance2 <= kPrefetchRange * kPrefetchRange * range * range);
+
+  if (ChunkedTerrain::IsStreaming() && prefetch &&
+      !ChunkedTerrain::ChildrenResident(level, x, z, std::sqrt(distance2)) && refine)
+  {
+    refine = false;
+    mStats.numStreamMisses++;
+  }
+
+  if (refine)
+  {
+    selection.quadrants = 0;
+    for (int k = 0; k < 4; k++)
+    {
+      SelectResult result = ChunkedTerrain::SelectNode(level - 1, 2*x + (k & 1), 2*z + (k >> 1),
+                                                       frustum, cameraPos);
+      if (result == kOutOfRange)
+      {
+        selection.quadrants |= (1 << k);  // This node covers it.
+      }
+    }
+  }
+
+  if (selection.quadrants != 0)
+  {
+    mSelection.push_back(selection);
+  }
+
+  return kSelected;
+}
+
+// ================= Height tiles ================= //
+
+bool ChunkedTerrain::BuildTile(int level, int x, int z, float* texels) const
+{
+  if (ChunkedTerrain::IsStreaming())
+  {
+    // The node is a window of a tile of the same level, apron included.
+    int offsetX, offsetZ;
+    const uint16_t* tile = ChunkedTerrain::AcquireSourceTile(level, x, z, offsetX, offsetZ, 0.0f);
+    if (!tile)
+    {
+      return false;
+    }
+
+    int samples = mTiledHeightmap.GetTileSamples();
+    for (int j = 0; j < kTileSize; j++)
+    {
+      const uint16_t* row = tile + (offsetZ + j) * samples + offsetX;
+      float* out = texels + j * kTileSize;
+
+      for (int i = 0; i < kTileSize; i++)
+      {
+        out[i] = mHeightScale * mTiledHeightmap.Decode(row[i]);
+      }
+    }
+    return true;
+  }
+
+  // Texel i covers grid vertex i - 1 (the apron gives normals their neighbors).
+  int stride = 1 << level;
+  int x0 = x * (kGridSize << level) - stride;
+  int z0 = z * (kGridSize << level) - stride;
+  int maxX = mWidth  - 1;
+  int maxZ = mHeight - 1;
+
+  for (int j = 0; j < kTileSize; j++)
+  {
+    int sz = std::min(std::max(z0 + j * stride, 0), maxZ);
+    const float* row = mHeightmap.GetData() + static_cast<size_t>(mWidth) * sz;
+    float* out = texels + j * kTileSize;
+
+    for (int i = 0; i < kTileSize; i++)
+    {
+      int sx = std::min(std::max(x0 + i * stride, 0), maxX);
+      out[i] = mHeightScale * row[sx];
+    }
+  }
+  return true;
+}
+
+const uint16_t* ChunkedTerrain::AcquireSourceTile(int level, int x, int z, int& offsetX,
+                                                  int& offsetZ, float priority) const
+{
+  int tileSize = mTiledHeightmap.GetTileSize();
+  int tx = x * kGridSize / tileSize;
+  int tz = z * kGridSize / tileSize;
+  offsetX = x * kGridSize - tx * tileSize;
+  offsetZ = z * kGridSize - tz * tileSize;
+
+  return mStreamer.Acquire(level, tx, tz, priority);
+}
+
+bool ChunkedTerrain::ChildrenResident(int level, int x, int z, float priority) const
+{
+  bool resident = true;
+  for (int k = 0; k < 4; k++)
+  {
+    int childX = 2*x + (k & 1), childZ = 2*z + (k >> 1);
+    int offsetX, offsetZ;
+
+    // Every missing child is requested, not just the first.
+    if (ChunkedTerrain::NodeExists(level - 1, childX, childZ) &&
+        !ChunkedTerrain::AcquireSourceTile(level - 1, childX, childZ, offsetX, offsetZ, priority))
+    {
+      resident = false;
+    }
+  }
+  return resident;
+}
+
+int ChunkedTerrain::AcquireTile(int level, int x, int z) const
+{
+  uint64_t key = TileKey(level, x, z);
+  auto it = mTileLayers.find(key);
+  if (it != mTileLayers.end())
+  {
+    mLayerFrames[it->second] = mFrame;
+    return it->second;
+  }
+
+  // A free layer, or the least recently used one (never one used this frame).
+  int layer = -1;
+  unsigned oldest = mFrame;
+  for (int i = 0; i < kMaxTiles; i++)
+  {
+    if (mLayerKeys[i] == kNoTile)
+    {
+      layer = i;
+      break;
+    }
+    if (mLayerFrames[i] < oldest)
+    {
+      oldest = mLayerFrames[i];
+      layer = i;
+    }
+  }
+
+  if (layer < 0)
+  {
+    return -1;
+  }
+
+  if (!ChunkedTerrain::BuildTile(level, x, z, mTileScratch.data()))
+  {
+    return -1;
+  }
+
+  if (mLayerKeys[layer] != kNoTile)
+  {
+    mTileLayers.erase(mLayerKeys[layer]);
+  }
+
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, kTileSize, kTileSize, 1,
+                  GL_RED, GL_FLOAT, mTileScratch.data());
+
+  mTileLayers[key] = layer;
+  mLayerKeys[layer] = key;
+  mLayerFrames[layer] = mFrame;
+  mStats.numTileUploads++;
+
+  return layer;
+}
+
+// ================= Rendering ================= //
+
+void ChunkedTerrain::Render() const
+{
+  if (!ChunkedTerrain::IsLoaded() || !mCamera)
+  {
+    return;
+  }
+
+  mFrame++;
+  mStats = Stats();
+
+  if (ChunkedTerrain::IsStreaming())
+  {
+    mStreamer.BeginFrame();
+  }
+
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  ChunkedTerrain::ComputeRanges(static_cast<float>(std::max(viewport[3], 1)));
+
+  // Selection and culling happen in model space.
+  const glm::mat4& M = mModelMatrix.GetGLMatrix();
+  const glm::mat4& V = mCamera->GetViewMatrix().GetGLMatrix();
+  const glm::mat4& P = mCamera->GetProjMatrix().GetGLMatrix();
+  glm::mat4 VM = V * M;
+
+  Frustum frustum(P * VM);
+  glm::vec3 cameraPos = glm::vec3(glm::inverse(VM) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+  mSelection.clear();
+  ChunkedTerrain::SelectNode(mNumLevels - 1, 0, 0, frustum, cameraPos);
+
+  // Front to back, so that early depth testing rejects hidden terrain.
+  std::sort(mSelection.begin(), mSelection.end(), [](const Selection& a, const Selection& b)
+  {
+    return a.distance < b.distance;
+  });
+
+  mProgram.Bind();
+  mProgram.SetMatrix("M", M);
+  mProgram.SetMatrix("V", V);
+  mProgram.SetMatrix("P", P);
+  mProgram.SetMatrix("N", glm::transpose(glm::inverse(M)));
+  mProgram.SetVec3("camera_pos", cameraPos);
+  mProgram.SetVec3("sun_dir", mSunDirection);
+  mProgram.SetFloat("grid_size", static_cast<GLfloat>(kGridSize));
+  mProgram.SetVec4("terrain_rect", glm::vec4(mOrigin[0], mOrigin[1], mExtent[0], mExtent[1]));
+
+  const glm::vec2& range = mMinMax[mNumLevels - 1][0];
+  mProgram.SetVec2("height_range", range[0], range[1]);
+
+  if (HasTexture() && mTexture->Valid())
+  {
+    glActiveTexture(GL_TEXTURE0);
+    mTexture->Bind(mProgram.GetHandle());
+    mProgram.SetInt("tex", 0);
+    mProgram.SetInt("tex_on", 1);
+  }
+  else
+  {
+    mProgram.SetInt("tex_on", 0);
+  }
+
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, mTileArray);
+  mProgram.SetInt("heights", 1);
+
+  int quadrantIndices = 6 * (kGridSize / 2) * (kGridSize / 2);
+  int quadrantTriangles = quadrantIndices / 3;
+
+  for (const Selection& selection : mSelection)
+  {
+    int layer = ChunkedTerrain::AcquireTile(selection.level, selection.x, selection.z);
+    if (layer < 0)
+      continue;  // Not resident yet, or the cache is full this frame.
+
+    float nodeSize = mSpacing * (kGridSize << selection.level);
+    mProgram.SetVec4("node", glm::vec4(mOrigin[0] + selection.x * nodeSize,
+                                       mOrigin[1] + selection.z * nodeSize,
+                                       nodeSize, static_cast<float>(layer)));
+    const glm::vec2& morph = mMorphs[selection.level];
+    mProgram.SetVec2("morph", morph[0], morph[1]);
+
+    if (selection.quadrants == 0xF)
+    {
+      mGridMesh->RenderRange(0, 4 * quadrantIndices);
+    }
+    else
+    {
+      for (int k = 0; k < 4; k++)
+      {
+        if (selection.quadrants & (1 << k))
+          mGridMesh->RenderRange(k * quadrantIndices, quadrantIndices);
+      }
+    }
+
+    mStats.numNodes++;
+    mStats.numTriangles += PopCount(selection.quadrants) * quadrantTriangles;
+  }
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  glActiveTexture(GL_TEXTURE0);
+
+  // Keep the triangle count within budget (takes effect next frame).
+  if (mTriangleBudget > 0)
+  {
+    if (mStats.numTriangles > mTriangleBudget)
+    {
+      mScreenError = mStats.screenError * kRelaxFactor;
+    }
+    else if (mStats.numTriangles < kTightenBelow * mTriangleBudget && mScreenError > mMaxScreenError)
+    {
+      mScreenError = std::max(mMaxScreenError, mScreenError / kTightenFactor);
+    }
+  }
+
+  mPipelineProgram->Bind();
+}
+
+AABB ChunkedTerrain::GetWorldBounds() const
+{
+  if (!ChunkedTerrain::IsLoaded())
+  {
+    return AABB();
+  }
+
+  return SceneObject::TransformBounds(ChunkedTerrain::NodeBounds(mNumLevels - 1, 0, 0));
+}
+
+bool ChunkedTerrain::IntersectRay(const Ray& ray, RayHit& hit) const
+{
+  return mHeightfield.IsValid() && mHeightfield.IntersectWorldRay(mWorldToModel, ray, hit);
+}
+
+bool ChunkedTerrain::GetGroundHeight(const glm::vec3& point, float& height) const
+{
+  return mHeightfield.IsValid() &&
+         mHeightfield.GetWorldHeight(mModelMatrix.GetGLMatrix(), mWorldToModel, point, height);
+}
+
+ChunkedTerrain::~ChunkedTerrain()
+{
+  mStreamer.Stop();
+  delete mGridMesh;
+  glDeleteTextures(1, &mTileArray);
+}
+
+}  // namespace gloo.
@@ -0,0 +1,181 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "scene_object.h"
+#include "camera.h"
+#include "frustum.h"
+#include "heightmap.h"
+#include "heightfield.h"
+#include "tiled_heightmap.h"
+#include "terrain_streamer.h"
+#include "shader_program.h"
+
+//  +-------------------------------------------------+
+//  |  Continuous distance-dependent LOD (CDLOD)      |
+//  |  terrain for large heightmaps.                  |
+//  |                                                 |
+//  |  The map is covered by a quadtree of nodes, all |
+//  |  drawn with the same kGridSize^2 grid mesh. A   |
+//  |  node of level l spans kGridSize * 2^l samples. |
+//  |  Each frame, nodes are selected by distance     |
+//  |  ranges derived from a screen-space error bound |
+//  |  and culled against the view frustum. Vertices  |
+//  |  morph towards the parent grid near the end of  |
+//  |  their range, so there are no cracks or pops.   |
+//  |                                                 |
+//  |  Heights live on the GPU as one small tile per  |
+//  |  visible node in a texture array (LRU cache),   |
+//  |  fetched by the vertex shader.                  |
+//  |                                                 |
+//  |  Maps larger than memory are streamed from a    |
+//  |  TiledHeightmap: a node is only refined once    |
+//  |  the tiles of its children are resident, so     |
+//  |  missing data shows as coarser terrain.         |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class ChunkedTerrain : public SceneObject
+{
+public:
+  struct Stats
+  {
+    int numNodes       { 0 };  // Nodes drawn (fully or partially).
+    int numCulled      { 0 };  // Nodes rejected by the frustum.
+    int numTriangles   { 0 };  // Triangles submitted.
+    int numTileUploads { 0 };  // Height tiles sent to the GPU this frame.
+    int numStreamMisses { 0 }; // Nodes left coarser because their children weren't resident.
+    float screenError  { 0.0f };  // Screen-space error bound used (pixels).
+  };
+
+  ChunkedTerrain(BasicPipelineProgram* pipelineProgram, GLuint programHandle)
+  : SceneObject(pipelineProgram, programHandle)
+  { }
+
+  // Samples are spacing model units apart and heights are heightScale * value (values of
+  // integer heightmaps are normalized to [0, 1]). The terrain is centered at the origin.
+  bool Load(const std::string& heightmapFileName, float spacing = 1.0f, float heightScale = 1.0f,
+            const std::string& shaderPath = "./shaders/terrain_cdlod");
+  bool Load(Heightmap&& heightmap, float spacing = 1.0f, float heightScale = 1.0f,
+            const std::string& shaderPath = "./shaders/terrain_cdlod");
+
+  // Streams a converted map (see TiledHeightmap) within a memory budget for resident tiles.
+  // Its block size must be kGridSize and its tile size a multiple of it.
+  bool LoadTiled(const std::string& fileName, float spacing = 1.0f, float heightScale = 1.0f,
+                 size_t memoryBudget = 256 << 20,
+                 const std::string& shaderPath = "./shaders/terrain_cdlod");
+
+  virtual void Render() const;
+  virtual bool HasCustomRender() const { return true; }
+  virtual AABB GetWorldBounds() const;
+
+  // Full resolution queries (in memory heightmaps only - streamed maps have no CPU copy).
+  virtual bool IntersectRay(const Ray& ray, RayHit& hit) const;
+  virtual bool GetGroundHeight(const glm::vec3& point, float& height) const;
+  inline const Heightfield& GetHeightfield() const { return mHeightfield; }
+
+  // The camera used for LOD selection and culling (the terrain can't render without it).
+  inline void SetCamera(Camera* camera) { mCamera = camera; }
+
+  // Target screen-space error in pixels (default 2).
+  inline void SetMaxScreenError(float pixels) { mMaxScreenError = pixels; mScreenError = pixels; }
+
+  // When more triangles than the budget are selected, the error bound is relaxed over the next
+  // frames (and tightened back towards SetMaxScreenError when below). 0 means no budget.
+  inline void SetTriangleBudget(int numTriangles) { mTriangleBudget = numTriangles; }
+
+  inline void SetSunDirection(const glm::vec3& direction) { mSunDirection = glm::normalize(direction); }
+
+  inline bool IsLoaded() const { return (mNumLevels > 0); }
+  inline const Stats& GetStats() const { return mStats; }
+  inline bool IsStreaming() const { return mTiledHeightmap.IsOpen(); }
+  inline TerrainStreamer::Stats GetStreamingStats() const { return mStreamer.GetStats(); }
+
+  virtual ~ChunkedTerrain();
+
+private:
+  enum SelectResult { kCulled, kOutOfRange, kSelected };
+
+  struct Selection
+  {
+    int level, x, z;
+    int quadrants;     // Bit mask of the quadrants drawn at this level.
+    float distance;    // To the camera (for front to back order).
+  };
+
+  SelectResult SelectNode(int level, int x, int z, const Frustum& frustum,
+                          const glm::vec3& cameraPos) const;
+
+  AABB NodeBounds(int level, int x, int z) const;
+  bool NodeExists(int level, int x, int z) const;
+
+  bool Init(int w, int h, float spacing, float heightScale, const std::string& shaderPath);
+  void BuildMinMax();
+
+  // Tiles of the existing children are resident (loads are queued otherwise).
+  bool ChildrenResident(int level, int x, int z, float priority) const;
+  const uint16_t* AcquireSourceTile(int level, int x, int z, int& offsetX, int& offsetZ,
+                                    float priority) const;
+
+  bool BuildTile(int level, int x, int z, float* texels) const;
+  int AcquireTile(int level, int x, int z) const;  // Texture array layer, or -1.
+
+  void ComputeRanges(float viewportHeight) const;
+
+  static const int kGridSize = 64;             // Cells per node side.
+  static const int kTileSize = kGridSize + 3;  // Texels per tile side (1 texel apron).
+  static const int kMaxTiles = 1024;           // Texture array layers.
+
+  Heightmap mHeightmap;                // In memory source...
+  TiledHeightmap mTiledHeightmap;      // ...or streamed source.
+  mutable TerrainStreamer mStreamer;
+  Heightfield mHeightfield;            // Queries over mHeightmap.
+  int mWidth  { 0 };
+  int mHeight { 0 };
+  float mSpacing     { 1.0f };
+  float mHeightScale { 1.0f };
+  int mNumLevels     { 0 };
+  glm::vec2 mOrigin  { 0.0f };  // Model (x, z) of sample (0, 0).
+  glm::vec2 mExtent  { 0.0f };  // Model (x, z) of the last sample.
+
+  // Per level node (min, max) heights, row major with GetNodesPerSide(l) columns.
+  std::vector<std::vector<glm::vec2>> mMinMax;
+  inline int GetNodesPerSide(int level) const { return 1 << (mNumLevels - 1 - level); }
+
+  // GPU resources: shared grid (quadrant ordered indices), height tiles and shaders.
+  Mesh* mGridMesh { nullptr };
+  GLuint mTileArray { 0 };
+  ShaderProgram mProgram;
+
+  // Tile cache (LRU by frame of last use).
+  mutable std::unordered_map<uint64_t, int> mTileLayers;
+  mutable std::vector<uint64_t> mLayerKeys;
+  mutable std::vector<unsigned> mLayerFrames;
+  mutable std::vector<float> mTileScratch;
+  mutable unsigned mFrame { 0 };
+
+  // LOD selection state.
+  Camera* mCamera { nullptr };
+  float mMaxScreenError { 2.0f };
+  mutable float mScreenError { 2.0f };
+  int mTriangleBudget { 0 };
+  mutable std::vector<float> mRanges;       // Per level, in model units.
+  mutable std::vector<glm::vec2> mMorphs;   // Per level (start, 1 / length).
+  mutable std::vector<Selection> mSelection;
+  mutable Stats mStats;
+
+  glm::vec3 mSunDirection { glm::normalize(glm::vec3(0.3f, 1.0f, 0.2f)) };
+};
+
+}  // namespace gloo.
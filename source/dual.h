@@ -0,0 +1,173 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+//  +-------------------------------------------------+
+//  |  Forward-mode automatic differentiation in two  |
+//  |  variables, for parametric surfaces.            |
+//  |                                                 |
+//  |  A Dual carries a value and its derivatives     |
+//  |  with respect to u and v. Writing a surface in  |
+//  |  terms of Dual (the usual operators and sin,    |
+//  |  cos, sqrt, ... are overloaded) gives S, dS/du  |
+//  |  and dS/dv exactly in one evaluation, hence     |
+//  |  normals and tangents with no extra lambda and  |
+//  |  no finite differences:                         |
+//  |                                                 |
+//  |    auto surf = [](Dual u, Dual v)               |
+//  |    { return DualVec3(cos(u), sin(u), v); };     |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+struct Dual
+{
+  Dual() { }
+  Dual(float value_) : value(value_) { }  // Constant.
+  Dual(float value_, float du_, float dv_) : value(value_), du(du_), dv(dv_) { }
+
+  float value { 0.0f };
+  float du { 0.0f };  // d/du.
+  float dv { 0.0f };  // d/dv.
+};
+
+struct DualVec3
+{
+  DualVec3() { }
+  DualVec3(const Dual& x_, const Dual& y_, const Dual& z_) : x(x_), y(y_), z(z_) { }
+
+  inline glm::vec3 Value() const { return glm::vec3(x.value, y.value, z.value); }
+  inline glm::vec3 DerivativeU() const { return glm::vec3(x.du, y.du, z.du); }
+  inline glm::vec3 DerivativeV() const { return glm::vec3(x.dv, y.dv, z.dv); }
+
+  Dual x, y, z;
+};
+
+// ================= Arithmetic ================= //
+
+inline Dual operator+(const Dual& a, const Dual& b) { return Dual(a.value + b.value, a.du + b.du, a.dv + b.dv); }
+inline Dual operator-(const Dual& a, const Dual& b) { return Dual(a.value - b.value, a.du - b.du, a.dv - b.dv); }
+inline Dual operator-(const Dual& a) { return Dual(-a.value, -a.du, -a.dv); }
+
+inline Dual operator*(const Dual& a, const Dual& b)
+{
+  return Dual(a.value * b.value, a.du * b.value + a.value * b.du, a.dv * b.value + a.value * b.dv);
+}
+
+inline Dual operator/(const Dual& a, const Dual& b)
+{
+  float inv = 1.0f / b.value;
+  float q = a.value * inv;
+  return Dual(q, (a.du - q * b.du) * inv, (a.dv - q * b.dv) * inv);
+}
+
+// Constants on either side (no derivative terms to carry).
+inline Dual operator+(const Dual& a, float b) { return Dual(a.value + b, a.du, a.dv); }
+inline Dual operator+(float a, const Dual& b) { return Dual(a + b.value, b.du, b.dv); }
+inline Dual operator-(const Dual& a, float b) { return Dual(a.value - b, a.du, a.dv); }
+inline Dual operator-(float a, const Dual& b) { return Dual(a - b.value, -b.du, -b.dv); }
+inline Dual operator*(const Dual& a, float b) { return Dual(a.value * b, a.du * b, a.dv * b); }
+inline Dual operator*(float a, const Dual& b) { return Dual(a * b.value, a * b.du, a * b.dv); }
+inline Dual operator/(const Dual& a, float b) { return a * (1.0f / b); }
+inline Dual operator/(float a, const Dual& b)
+{
+  float inv = 1.0f / b.value;
+  float scale = -a * inv * inv;
+  return Dual(a * inv, scale * b.du, scale * b.dv);
+}
+
+inline Dual& operator+=(Dual& a, const Dual& b) { return (a = a + b); }
+inline Dual& operator-=(Dual& a, const Dual& b) { return (a = a - b); }
+inline Dual& operator*=(Dual& a, const Dual& b) { return (a = a * b); }
+inline Dual& operator/=(Dual& a, const Dual& b) { return (a = a / b); }
+
+// ================= Functions ================= //
+// Chain rule: f(a) carries f'(a) * (du, dv).
+
+inline Dual Chain(const Dual& a, float value, float derivative)
+{
+  return Dual(value, derivative * a.du, derivative * a.dv);
+}
+
+inline Dual sin(const Dual& a)  { return Chain(a, std::sin(a.value),  std::cos(a.value)); }
+inline Dual cos(const Dual& a)  { return Chain(a, std::cos(a.value), -std::sin(a.value)); }
+inline Dual exp(const Dual& a)  { float e = std::exp(a.value); return Chain(a, e, e); }
+inline Dual log(const Dual& a)  { return Chain(a, std::log(a.value), 1.0f / a.value); }
+inline Dual sqrt(const Dual& a) { float s = std::sqrt(a.value); return Chain(a, s, 0.5f / s); }
+inline Dual fabs(const Dual& a) { return (a.value < 0.0f) ? -a : a; }
+inline Dual abs(const Dual& a)  { return fabs(a); }
+
+inline Dual tan(const Dual& a)
+{
+  float t = std::tan(a.value);
+  return Chain(a, t, 1.0f + t * t);
+}
+
+inline Dual atan(const Dual& a) { return Chain(a, std::atan(a.value), 1.0f / (1.0f + a.value * a.value)); }
+
+inline Dual sinh(const Dual& a) { return Chain(a, std::sinh(a.value), std::cosh(a.value)); }
+inline Dual cosh(const Dual& a) { return Chain(a, std::cosh(a.value), std::sinh(a.value)); }
+
+inline Dual pow(const Dual& a, float p)
+{
+  float ap = std::pow(a.value, p);
+  return Chain(a, ap, (a.value != 0.0f) ? p * ap / a.value : 0.0f);
+}
+
+inline Dual atan2(const Dual& y, const Dual& x)
+{
+  float inv = 1.0f / (x.value * x.value + y.value * y.value);
+  return Dual(std::atan2(y.value, x.value), (x.value * y.du - y.value * x.du) * inv,
+              (x.value * y.dv - y.value * x.dv) * inv);
+}
+
+// ================= Surfaces ================= //
+
+// Evaluates surf(u, v) -> DualVec3 with u and v seeded as the variables.
+template <typename SurfFunc>
+inline DualVec3 EvaluateDual(SurfFunc& surf, float u, float v)
+{
+  return surf(Dual(u, 1.0f, 0.0f), Dual(v, 0.0f, 1.0f));
+}
+
+// Position, unit normal (along dS/du x dS/dv) and unit tangent (along dS/du) at (u, v).
+// Where the derivatives vanish or are parallel (e.g. the poles of a sphere), the frame is
+// taken a tiny step towards the middle of the domain - the limit of the neighboring normals.
+template <typename SurfFunc>
+inline void EvaluateSurfaceFrame(SurfFunc& surf, float u, float v, glm::vec3& position,
+                                 glm::vec3& normal, glm::vec3& tangent)
+{
+  const float kSingularStep = 1e-3f;
+
+  DualVec3 s = EvaluateDual(surf, u, v);
+  position = s.Value();
+
+  glm::vec3 du = s.DerivativeU(), dv = s.DerivativeV();
+  glm::vec3 n = glm::cross(du, dv);
+  float scale = glm::dot(du, du) + glm::dot(dv, dv);
+
+  if (glm::dot(n, n) <= 1e-12f * scale * scale)
+  {
+    DualVec3 nudged = EvaluateDual(surf, u + ((u < 0.5f) ? kSingularStep : -kSingularStep),
+                                         v + ((v < 0.5f) ? kSingularStep : -kSingularStep));
+    du = nudged.DerivativeU();
+    dv = nudged.DerivativeV();
+    n = glm::cross(du, dv);
+  }
+
+  float length = std::sqrt(glm::dot(n, n));
+  normal  = (length > 0.0f) ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+  tangent = (glm::dot(du, du) > 0.0f) ? glm::normalize(du) : glm::normalize(dv);
+}
+
+}  // namespace gloo.
@@ -0,0 +1,220 @@
+#include "dynamic_parametric_surface.h"
+#include "primitive_cache.h"
+
+#include <vector>
+#include <iostream>
+
+namespace gloo
+{
+
+namespace
+{
+
+const GLuint64 kFenceTimeout = 100000000;  // 100 ms, in ns.
+
+}  // namespace.
+
+bool DynamicParametricSurface::Create(RowsFunc evaluateRows, int w, int h)
+{
+  if (w < 2 || h < 2)
+  {
+    std::cerr << "ERROR Dynamic parametric surfaces need at least 2 x 2 samples.\n";
+    return false;
+  }
+
+  DynamicParametricSurface::Release();
+  mEvaluateRows = evaluateRows;
+  mWidth  = w;
+  mHeight = h;
+
+  // Triangle strip over the rows, with two degenerate triangles between rows.
+  std::vector<GLuint> indices(PrimitiveCache::NumStripIndices(w, h));
+  PrimitiveCache::BuildStripIndices(w, h, indices.data());
+  mNumIndices = static_cast<int>(indices.size());
+
+  GLuint locPositionAttrib = glGetAttribLocation(mProgramHandle, "in_position");
+  GLuint locNormalAttrib   = glGetAttribLocation(mProgramHandle, "in_normal");
+  GLuint locColorAttrib    = glGetAttribLocation(mProgramHandle, "in_color");
+  GLuint locTexCoordAttrib = glGetAttribLocation(mProgramHandle, "in_tex_coord");
+
+  glGenBuffers(1, &mVbo);
+  glGenBuffers(1, &mEab);
+  glGenVertexArrays(kNumBuffers, mVaos);
+
+  size_t regionSize = sizeof(GLfloat) * 6 * w * h;
+  glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+  glBufferData(GL_ARRAY_BUFFER, kNumBuffers * regionSize, nullptr, GL_STREAM_DRAW);
+
+  // One vertex array per region, all sharing the index buffer.
+  for (int k = 0; k < kNumBuffers; k++)
+  {
+    glBindVertexArray(mVaos[k]);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEab);
+    if (k == 0)
+    {
+      glBufferData(GL_ELEMENT_ARRAY_BUFFER, mNumIndices * sizeof(GLuint), indices.data(),
+                   GL_STATIC_DRAW);
+    }
+
+    GLsizei stride = sizeof(GLfloat) * 6;
+    glEnableVertexAttribArray(locPositionAttrib);
+    glEnableVertexAttribArray(locNormalAttrib);
+    glDisableVertexAttribArray(locColorAttrib);
+    glDisableVertexAttribArray(locTexCoordAttrib);
+    glVertexAttribPointer(locPositionAttrib, 3, GL_FLOAT, GL_FALSE, stride,
+      (void*)(k * regionSize));
+    glVertexAttribPointer(locNormalAttrib, 3, GL_FLOAT, GL_FALSE, stride,
+      (void*)(k * regionSize + sizeof(GLfloat) * 3));
+  }
+  glBindVertexArray(0);
+
+  mStartTime = std::chrono::steady_clock::now();
+  mCurrent = kNumBuffers - 1;
+  DynamicParametricSurface::Update(0.0f);
+
+  return true;
+}
+
+void DynamicParametricSurface::Update(float t)
+{
+  if (!IsLoaded())
+  {
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  // The region written now was last drawn kNumBuffers - 1 frames ago.
+  int next = (mCurrent + 1) % kNumBuffers;
+  GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+  if (mFences[next])
+  {
+    GLenum status = glClientWaitSync(mFences[next], GL_SYNC_FLUSH_COMMANDS_BIT, kFenceTimeout);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+      // Still being drawn: keep showing the current region and try again next frame.
+      return;
+    }
+
+    if (status == GL_WAIT_FAILED)
+    {
+      access &= ~GL_MAP_UNSYNCHRONIZED_BIT;  // Let the driver synchronize the map instead.
+    }
+
+    glDeleteSync(mFences[next]);
+    mFences[next] = 0;
+  }
+
+  size_t regionSize = sizeof(GLfloat) * 6 * mWidth * mHeight;
+  glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+  GLfloat* out = static_cast<GLfloat*>(glMapBufferRange(GL_ARRAY_BUFFER, next * regionSize,
+      regionSize, access));
+
+  if (!out)
+  {
+    std::cerr << "ERROR Could not map the vertex buffer of a dynamic parametric surface.\n";
+    return;
+  }
+
+  auto evaluate = [this, t, out](int first, int last) { mEvaluateRows(first, last, t, out); };
+  mWorkers.ParallelFor(0, mHeight, kMinRows, evaluate);
+
+  // The contents are lost if the buffer was corrupted meanwhile (keep drawing the old ones).
+  if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE)
+  {
+    mCurrent = next;
+  }
+
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  mUpdateTime = std::chrono::duration<float, std::milli>(elapsed).count();
+}
+
+void DynamicParametricSurface::Animate()
+{
+  SceneObject::Animate();
+
+  if (mPlaying && IsLoaded())
+  {
+    auto elapsed = std::chrono::steady_clock::now() - mStartTime;
+    float seconds = std::chrono::duration<float>(elapsed).count();
+    DynamicParametricSurface::Update(mSpeed * seconds);
+  }
+}
+
+void DynamicParametricSurface::Render() const
+{
+  if (!IsLoaded())
+  {
+    return;
+  }
+
+  mPipelineProgram->SetModelMatrix(mModelMatrix);
+
+  GLuint matLoc = glGetUniformLocation(mProgramHandle, "material_on");
+  if (HasMaterial())
+  {
+    mMaterial->Bind(mProgramHandle);
+    glUniform1i(matLoc, 1);
+  }
+  else
+  {
+    glUniform1i(matLoc, 0);
+  }
+
+  GLuint texLoc = glGetUniformLocation(mProgramHandle, "tex_on");
+  glUniform1i(texLoc, 0);
+
+  GLuint lightOnLoc = glGetUniformLocation(mProgramHandle, "light_on");
+  glUniform1i(lightOnLoc, mUsingLighting);
+
+  DynamicParametricSurface::Draw();
+}
+
+bool DynamicParametricSurface::RenderId() const
+{
+  if (IsLoaded())
+  {
+    DynamicParametricSurface::Draw();
+  }
+  return true;
+}
+
+void DynamicParametricSurface::Draw() const
+{
+  glBindVertexArray(mVaos[mCurrent]);
+  glDrawElements(GL_TRIANGLE_STRIP, mNumIndices, GL_UNSIGNED_INT, (void*)0);
+
+  // Drawn again (e.g. by another pass): the newest fence covers both draws.
+  if (mFences[mCurrent])
+  {
+    glDeleteSync(mFences[mCurrent]);
+  }
+  mFences[mCurrent] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void DynamicParametricSurface::Release()
+{
+  for (int k = 0; k < kNumBuffers; k++)
+  {
+    if (mFences[k])
+    {
+      glDeleteSync(mFences[k]);
+      mFences[k] = 0;
+    }
+  }
+
+  if (mVbo != 0)
+  {
+    glDeleteVertexArrays(kNumBuffers, mVaos);
+    glDeleteBuffers(1, &mVbo);
+    glDeleteBuffers(1, &mEab);
+    mVbo = mEab = 0;
+  }
+}
+
+DynamicParametricSurface::~DynamicParametricSurface()
+{
+  DynamicParametricSurface::Release();
+}
+
+}  // namespace gloo.
@@ -0,0 +1,140 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+
+#include "scene_object.h"
+#include "parallel.h"
+#include "dual.h"
+
+//  +-------------------------------------------------+
+//  |  Animated parametric surface S(u, v, t).        |
+//  |                                                 |
+//  |  The (u, v) grid is re-evaluated every frame by |
+//  |  a pool of threads, straight into a mapped      |
+//  |  region of the vertex buffer. The buffer holds  |
+//  |  kNumBuffers copies of the grid, used in turn:  |
+//  |  the CPU writes one while the GPU still draws   |
+//  |  the others (a fence guards each copy). The     |
+//  |  index buffer is built once, and nothing is     |
+//  |  allocated after Load.                          |
+//  |                                                 |
+//  |  The surface is written on dual numbers, like   |
+//  |  in Object::LoadParametricSurfSolid, so normals |
+//  |  are exact:                                     |
+//  |                                                 |
+//  |    [](Dual u, Dual v, float t) -> DualVec3      |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class DynamicParametricSurface : public SceneObject
+{
+public:
+  DynamicParametricSurface(BasicPipelineProgram* pipelineProgram, GLuint programHandle)
+  : SceneObject(pipelineProgram, programHandle)
+  {
+    mUsingLighting = true;
+  }
+
+  // Builds the index buffer and the vertex buffers of a numSampleU x numSampleV grid over
+  // [0, 1]^2 and evaluates it at t = 0. surf must be safe to call concurrently.
+  template <typename SurfFunc>
+  bool Load(SurfFunc surf, int numSampleU, int numSampleV);
+
+  virtual void Render() const;
+  virtual bool HasCustomRender() const { return true; }
+  virtual bool RenderId() const;
+
+  // Advances the clock (seconds since Load, times the speed) and re-evaluates the surface.
+  virtual void Animate();
+
+  // Re-evaluates the surface at time t into the next vertex buffer.
+  void Update(float t);
+
+  inline void SetSpeed(float speed) { mSpeed = speed; }
+  inline void SetPlaying(bool playing) { mPlaying = playing; }
+
+  inline bool IsLoaded() const { return (mVbo != 0); }
+  inline float GetUpdateTime() const { return mUpdateTime; }  // Last Update, in ms.
+
+  virtual ~DynamicParametricSurface();
+
+  static const int kNumBuffers = 3;  // Frames in flight.
+
+private:
+  // Writes rows [first, last) of the grid at time t, as (x, y, z, nx, ny, nz) vertices.
+  typedef std::function<void (int first, int last, float t, GLfloat* out)> RowsFunc;
+
+  bool Create(RowsFunc evaluateRows, int w, int h);
+  void Release();
+
+  // Draws the current region and fences it.
+  void Draw() const;
+
+  static const int kMinRows = 8;  // Rows per thread.
+
+  RowsFunc mEvaluateRows;
+  int mWidth  { 0 };
+  int mHeight { 0 };
+  int mNumIndices { 0 };
+
+  GLuint mVbo { 0 };  // kNumBuffers regions of mWidth * mHeight vertices.
+  GLuint mEab { 0 };
+  GLuint mVaos[kNumBuffers] { };
+  mutable GLsync mFences[kNumBuffers] { };
+  int mCurrent { 0 };  // Region drawn by Render.
+
+  tool::WorkerPool mWorkers;
+
+  std::chrono::steady_clock::time_point mStartTime;
+  float mSpeed { 1.0f };
+  bool mPlaying { true };
+  float mUpdateTime { 0.0f };
+};
+
+// ================= Templates ================= //
+
+template <typename SurfFunc>
+bool DynamicParametricSurface::Load(SurfFunc surf, int numSampleU, int numSampleV)
+{
+  int w = numSampleU;
+  int h = numSampleV;
+
+  auto evaluateRows = [surf, w, h](int first, int last, float t, GLfloat* out)
+  {
+    auto surfAtTime = [&surf, t](Dual u, Dual v) { return surf(u, v, t); };
+    glm::vec3 position, normal, tangent;
+
+    for (int y = first; y < last; y++)
+    {
+      float v = static_cast<float>(y)/(h-1);
+      GLfloat* vertex = out + static_cast<size_t>(6) * w * y;
+
+      for (int x = 0; x < w; x++, vertex += 6)
+      {
+        float u = static_cast<float>(x)/(w-1);
+        EvaluateSurfaceFrame(surfAtTime, u, v, position, normal, tangent);
+
+        vertex[0] = position[0];
+        vertex[1] = position[1];
+        vertex[2] = position[2];
+        vertex[3] = normal[0];
+        vertex[4] = normal[1];
+        vertex[5] = normal[2];
+      }
+    }
+  };
+
+  return DynamicParametricSurface::Create(evaluateRows, w, h);
+}
+
+}  // namespace gloo.
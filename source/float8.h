@@ -0,0 +1,93 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+
+//  +-------------------------------------------------+
+//  |  Eight floats operated on lane by lane.         |
+//  |                                                 |
+//  |  Evaluating an expression on Float8 runs it on  |
+//  |  8 points at once, one loop over the lanes per  |
+//  |  operator (transcendentals call libm per lane). |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+struct Float8
+{
+  static const int kSize = 8;
+
+  Float8() { }
+  Float8(float value)  // Broadcast.
+  {
+    for (int k = 0; k < kSize; k++) v[k] = value;
+  }
+
+  inline float& operator[](int k) { return v[k]; }
+  inline float  operator[](int k) const { return v[k]; }
+
+  float v[kSize] { };
+};
+
+// Lane-wise op(a, b).
+#define GLOO_FLOAT8_BINARY_OP(OP)                                                                \
+  inline Float8 operator OP(const Float8& a, const Float8& b)                                    \
+  {                                                                                              \
+    Float8 r;                                                                                    \
+    for (int k = 0; k < Float8::kSize; k++) r.v[k] = a.v[k] OP b.v[k];                           \
+    return r;                                                                                    \
+  }                                                                                              \
+  inline Float8 operator OP(const Float8& a, float b) { return a OP Float8(b); }                 \
+  inline Float8 operator OP(float a, const Float8& b) { return Float8(a) OP b; }                 \
+  inline Float8& operator OP##=(Float8& a, const Float8& b) { return (a = a OP b); }
+
+GLOO_FLOAT8_BINARY_OP(+)
+GLOO_FLOAT8_BINARY_OP(-)
+GLOO_FLOAT8_BINARY_OP(*)
+GLOO_FLOAT8_BINARY_OP(/)
+
+#undef GLOO_FLOAT8_BINARY_OP
+
+// Lane-wise f(a).
+#define GLOO_FLOAT8_FUNCTION(NAME, EXPRESSION)                                                   \
+  inline Float8 NAME(const Float8& a)                                                            \
+  {                                                                                              \
+    Float8 r;                                                                                    \
+    for (int k = 0; k < Float8::kSize; k++) { float x = a.v[k]; r.v[k] = (EXPRESSION); }         \
+    return r;                                                                                    \
+  }
+
+GLOO_FLOAT8_FUNCTION(operator-, -x)
+GLOO_FLOAT8_FUNCTION(fabs, std::fabs(x))
+GLOO_FLOAT8_FUNCTION(abs, std::fabs(x))
+GLOO_FLOAT8_FUNCTION(square, x * x)
+GLOO_FLOAT8_FUNCTION(sqrt, std::sqrt(x))
+GLOO_FLOAT8_FUNCTION(exp, std::exp(x))
+GLOO_FLOAT8_FUNCTION(sin, std::sin(x))
+GLOO_FLOAT8_FUNCTION(cos, std::cos(x))
+
+#undef GLOO_FLOAT8_FUNCTION
+
+inline Float8 min(const Float8& a, const Float8& b)
+{
+  Float8 r;
+  for (int k = 0; k < Float8::kSize; k++) r.v[k] = std::min(a.v[k], b.v[k]);
+  return r;
+}
+
+inline Float8 max(const Float8& a, const Float8& b)
+{
+  Float8 r;
+  for (int k = 0; k < Float8::kSize; k++) r.v[k] = std::max(a.v[k], b.v[k]);
+  return r;
+}
+
+}  // namespace gloo.
@@ -0,0 +1,82 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "ray.h"
+
+//  +-------------------------------------------------+
+//  |  View frustum as 6 inward facing planes,        |
+//  |  extracted from a projection * view (* model)   |
+//  |  matrix, so the tests happen in the space the   |
+//  |  matrix maps from. Box and sphere tests are     |
+//  |  conservative: false means fully outside.       |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+struct Frustum
+{
+  enum Plane { kLeft, kRight, kBottom, kTop, kNear, kFar };
+
+  Frustum() { }
+  explicit Frustum(const glm::mat4& clipMatrix) { Extract(clipMatrix); }
+
+  // Gribb-Hartmann extraction from the rows of the clip matrix.
+  void Extract(const glm::mat4& m)
+  {
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    planes[kLeft]   = row3 + row0;
+    planes[kRight]  = row3 - row0;
+    planes[kBottom] = row3 + row1;
+    planes[kTop]    = row3 - row1;
+    planes[kNear]   = row3 + row2;
+    planes[kFar]    = row3 - row2;
+
+    // Normalized, so that sphere tests use true distances.
+    for (auto& plane : planes)
+    {
+      plane /= glm::length(glm::vec3(plane));
+    }
+  }
+
+  // Tests the box corner furthest along each plane normal.
+  inline bool Intersects(const AABB& box) const
+  {
+    for (const auto& plane : planes)
+    {
+      glm::vec3 p((plane[0] >= 0.0f) ? box.max[0] : box.min[0],
+                  (plane[1] >= 0.0f) ? box.max[1] : box.min[1],
+                  (plane[2] >= 0.0f) ? box.max[2] : box.min[2]);
+
+      if (glm::dot(glm::vec3(plane), p) + plane[3] < 0.0f)
+        return false;
+    }
+    return true;
+  }
+
+  inline bool Intersects(const glm::vec3& center, float radius) const
+  {
+    for (const auto& plane : planes)
+    {
+      if (glm::dot(glm::vec3(plane), center) + plane[3] < -radius)
+        return false;
+    }
+    return true;
+  }
+
+  glm::vec4 planes[6];  // (n, d): inside when dot(n, p) + d >= 0.
+};
+
+}  // namespace gloo.
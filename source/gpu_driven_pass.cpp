@@ -0,0 +1,341 @@
+#include "gpu_driven_pass.h"
+#include "frustum.h"
+
+#include <unordered_map>
+#include <iostream>
+#include <numeric>
+
+namespace gloo
+{
+
+namespace
+{
+
+const int kGroupSize = 64;     // local_size_x of the culling shader.
+const int kVertexSize = 9;     // Packed vertex floats.
+
+}  // namespace.
+
+bool GpuDrivenPass::Init(const std::string& shaderPath)
+{
+  GLint major = 0, minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  if (major < 4 || (major == 4 && minor < 3))
+  {
+    std::cerr << "ERROR GPU-driven rendering needs OpenGL 4.3 (context is " << major << "."
+              << minor << ").\n";
+    return false;
+  }
+
+  if (!mCullProgram.LoadCompute(shaderPath) || !mDrawProgram.Load(shaderPath))
+  {
+    std::cerr << "ERROR Couldn't load GPU-driven shaders at " << shaderPath << ".\n";
+    return false;
+  }
+
+  return true;
+}
+
+bool GpuDrivenPass::Draws(SceneObject* object)
+{
+  if (!object->IsGpuDriven() || !object->IsInitialized() || object->IsWireframe() ||
+      object->HasTexture())
+  {
+    return false;
+  }
+
+  GLenum mode = object->GetMesh()->GetDrawMode();
+  return (mode == GL_TRIANGLES || mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN);
+}
+
+// ================= Packing ================= //
+
+void GpuDrivenPass::Pack(const std::vector<SceneObject*>& objects)
+{
+  GpuDrivenPass::DeleteBuffers();
+  mPacked = objects;
+
+  // Meshes shared by several objects (e.g. primitives) are packed once.
+  std::unordered_map<Mesh*, Range> ranges;
+  std::vector<GLfloat> vertices;
+  std::vector<GLuint> indices, triangles;
+  std::vector<ObjectInfo> infos(objects.size());
+
+  for (int i = 0; i < static_cast<int>(objects.size()); i++)
+  {
+    Mesh* mesh = objects[i]->GetMesh();
+    auto found = ranges.find(mesh);
+    if (found == ranges.end())
+    {
+      Range range;
+      range.firstIndex = static_cast<GLuint>(indices.size());
+      range.baseVertex = static_cast<GLint>(vertices.size() / kVertexSize);
+      range.count = 3 * mesh->GetTriangles(triangles);
+      indices.insert(indices.end(), triangles.begin(), triangles.end());
+
+      // Missing attributes are zero, as disabled arrays read in the main pipeline.
+      bool packed = (mesh->GetStorageType() == Mesh::kTightlyPacked);
+      glm::vec3 lo(1e30f), hi(-1e30f);
+      for (int v = 0; v < mesh->GetNumVertices(); v++)
+      {
+        glm::vec3 p = mesh->GetPosition(v);
+        const GLfloat* n = mesh->HasNormals() ? (packed ? mesh->NormalAt(v) : mesh->SBNormalAt(v))
+                                              : nullptr;
+        const GLfloat* c = mesh->HasColors() ? (packed ? mesh->ColorAt(v) : mesh->SBColorAt(v))
+                                             : nullptr;
+        GLfloat vertex[kVertexSize] = { p[0], p[1], p[2],
+                                        n ? n[0] : 0.0f, n ? n[1] : 0.0f, n ? n[2] : 0.0f,
+                                        c ? c[0] : 0.0f, c ? c[1] : 0.0f, c ? c[2] : 0.0f };
+        vertices.insert(vertices.end(), vertex, vertex + kVertexSize);
+
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+      }
+
+      // Bounding sphere around the box.
+      glm::vec3 center = 0.5f * (lo + hi);
+      float radius = 0.0f;
+      for (int v = 0; v < mesh->GetNumVertices(); v++)
+      {
+        radius = std::max(radius, glm::length(mesh->GetPosition(v) - center));
+      }
+      range.sphere[0] = center[0];
+      range.sphere[1] = center[1];
+      range.sphere[2] = center[2];
+      range.sphere[3] = radius;
+
+      found = ranges.emplace(mesh, range).first;
+    }
+
+    // Same defaults as the main pipeline when there is no material (see phong_no_shadow).
+    const Range& range = found->second;
+    const Material* material = objects[i]->GetMaterial();
+    glm::vec3 Ka = material ? material->mKa : glm::vec3(0.0f);
+    glm::vec3 Kd = material ? material->mKd : glm::vec3(1.0f);
+    glm::vec3 Ks = material ? material->mKs : glm::vec3(0.0f);
+
+    ObjectInfo& info = infos[i];
+    std::copy(range.sphere, range.sphere + 4, info.sphere);
+    info.Ka[0] = Ka[0];  info.Ka[1] = Ka[1];  info.Ka[2] = Ka[2];
+    info.Kd[0] = Kd[0];  info.Kd[1] = Kd[1];  info.Kd[2] = Kd[2];
+    info.Ks[0] = Ks[0];  info.Ks[1] = Ks[1];  info.Ks[2] = Ks[2];
+    info.Ka[3] = objects[i]->IsLighting() ? 1.0f : 0.0f;
+    info.Kd[3] = material ? 1.0f : 0.0f;
+    info.Ks[3] = 0.0f;
+    info.count = range.count;
+    info.firstIndex = range.firstIndex;
+    info.baseVertex = range.baseVertex;
+    info.padding = 0;
+  }
+
+  int n = static_cast<int>(objects.size());
+  if (n == 0)
+  {
+    return;
+  }
+
+  std::vector<GLuint> drawIds(n);
+  std::iota(drawIds.begin(), drawIds.end(), 0);
+
+  GLuint locPosition = glGetAttribLocation(mDrawProgram.GetHandle(), "in_position");
+  GLuint locNormal   = glGetAttribLocation(mDrawProgram.GetHandle(), "in_normal");
+  GLuint locColor    = glGetAttribLocation(mDrawProgram.GetHandle(), "in_color");
+  GLuint locDrawId   = glGetAttribLocation(mDrawProgram.GetHandle(), "in_draw_id");
+
+  glGenVertexArrays(1, &mVao);
+  glBindVertexArray(mVao);
+
+  glGenBuffers(1, &mEab);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEab);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+  glGenBuffers(1, &mVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+
+  GLsizei stride = sizeof(GLfloat) * kVertexSize;
+  glEnableVertexAttribArray(locPosition);
+  glEnableVertexAttribArray(locNormal);
+  glEnableVertexAttribArray(locColor);
+  glVertexAttribPointer(locPosition, 3, GL_FLOAT, GL_FALSE, stride, 0);
+  glVertexAttribPointer(locNormal,   3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(GLfloat) * 3));
+  glVertexAttribPointer(locColor,    3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(GLfloat) * 6));
+
+  // Draw i reads drawIds[baseInstance = i]: the object index, in every vertex.
+  glGenBuffers(1, &mDrawIdBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, mDrawIdBuffer);
+  glBufferData(GL_ARRAY_BUFFER, n * sizeof(GLuint), drawIds.data(), GL_STATIC_DRAW);
+  glEnableVertexAttribArray(locDrawId);
+  glVertexAttribIPointer(locDrawId, 1, GL_UNSIGNED_INT, 0, 0);
+  glVertexAttribDivisor(locDrawId, 1);
+
+  glGenBuffers(1, &mObjectBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, mObjectBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, n * sizeof(ObjectInfo), infos.data(), GL_STATIC_DRAW);
+
+  glGenBuffers(1, &mTransformBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, mTransformBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, n * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+
+  // Written by the culling shader, read by the draw.
+  glGenBuffers(1, &mCommandBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, mCommandBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, n * sizeof(DrawCommand), nullptr, GL_DYNAMIC_COPY);
+
+  glGenBuffers(1, &mCounterBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, mCounterBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  glBindVertexArray(0);
+
+  mStats = Stats();
+  mStats.numObjects = n;
+}
+
+void GpuDrivenPass::DeleteBuffers()
+{
+  if (mCounterFence)
+  {
+    glDeleteSync(mCounterFence);
+    mCounterFence = 0;
+  }
+
+  GLuint buffers[] = { mVbo, mEab, mDrawIdBuffer, mObjectBuffer, mTransformBuffer,
+                       mCommandBuffer, mCounterBuffer };
+  glDeleteBuffers(7, buffers);
+  glDeleteVertexArrays(1, &mVao);
+
+  mVao = mVbo = mEab = mDrawIdBuffer = mObjectBuffer = mTransformBuffer = 0;
+  mCommandBuffer = mCounterBuffer = 0;
+  mPacked.clear();
+}
+
+// ================= Rendering ================= //
+
+void GpuDrivenPass::Render(const std::vector<SceneObject*>& objects,
+                           const std::vector<Light*>& lights, Camera* camera)
+{
+  if (!IsInitialized())
+  {
+    return;
+  }
+
+  mDrawn.clear();
+  for (SceneObject* object : objects)
+  {
+    if (GpuDrivenPass::Draws(object))
+      mDrawn.push_back(object);
+  }
+
+  if (mDrawn != mPacked)
+  {
+    GpuDrivenPass::Pack(mDrawn);
+  }
+
+  int n = static_cast<int>(mPacked.size());
+  if (n == 0)
+  {
+    return;
+  }
+
+  GpuDrivenPass::PollStats();
+
+  // Model matrices: one upload for all objects.
+  mTransforms.resize(n);
+  for (int i = 0; i < n; i++)
+  {
+    mTransforms[i] = mPacked[i]->GetModelMatrix().GetGLMatrix();
+  }
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, mTransformBuffer);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, n * sizeof(glm::mat4), mTransforms.data());
+
+  // Counters are only reset (and read back later) when the previous readback is done.
+  bool counting = (mCounterFence == 0);
+  if (counting)
+  {
+    const GLuint zeros[2] = { 0, 0 };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mCounterBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zeros), zeros);
+  }
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+  // Culling: one thread per object, in world space.
+  const glm::mat4& V = camera->GetViewMatrix().GetGLMatrix();
+  const glm::mat4& P = camera->GetProjMatrix().GetGLMatrix();
+  Frustum frustum(P * V);
+
+  mCullProgram.Bind();
+  glUniform4fv(glGetUniformLocation(mCullProgram.GetHandle(), "planes"), 6,
+               &frustum.planes[0][0]);
+  mCullProgram.SetUInt("num_objects", static_cast<GLuint>(n));
+  mCullProgram.SetInt("count_on", counting);
+
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mObjectBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mTransformBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mCommandBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, mCounterBuffer);
+  glDispatchCompute((n + kGroupSize - 1) / kGroupSize, 1, 1);
+
+  // The commands are consumed as indirect arguments, objects and transforms in the shaders,
+  // and the counters read back by PollStats (glGetBufferSubData).
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT |
+                  GL_BUFFER_UPDATE_BARRIER_BIT);
+
+  // After the barrier, so that a signaled fence means the counters are readable.
+  if (counting)
+  {
+    mCounterFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+
+  mDrawProgram.Bind();
+  mDrawProgram.SetMatrix("V", camera->GetViewMatrix());
+  mDrawProgram.SetMatrix("P", camera->GetProjMatrix());
+  mDrawProgram.SetInt("numLights", static_cast<GLint>(lights.size()));
+  for (int i = 0; i < static_cast<int>(lights.size()); i++)
+  {
+    lights[i]->Position(camera->GetViewMatrix(), i, mDrawProgram.GetHandle());
+  }
+
+  glBindVertexArray(mVao);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+  glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, n, 0);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void GpuDrivenPass::PollStats()
+{
+  if (mCounterFence == 0)
+  {
+    return;
+  }
+
+  // Zero timeout: never wait for the GPU.
+  GLenum status = glClientWaitSync(mCounterFence, 0, 0);
+  if (status == GL_TIMEOUT_EXPIRED)
+  {
+    return;
+  }
+
+  glDeleteSync(mCounterFence);
+  mCounterFence = 0;
+
+  if (status != GL_WAIT_FAILED)
+  {
+    GLuint counters[2] = { 0, 0 };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mCounterBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counters), counters);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    mStats.numVisible   = static_cast<int>(counters[0]);
+    mStats.numTriangles = static_cast<int>(counters[1]);
+  }
+}
+
+GpuDrivenPass::~GpuDrivenPass()
+{
+  GpuDrivenPass::DeleteBuffers();
+}
+
+}  // namespace gloo.
@@ -0,0 +1,133 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "shader_program.h"
+#include "scene_object.h"
+#include "camera.h"
+#include "light.h"
+
+//  +-------------------------------------------------+
+//  |  GPU-driven rendering of static objects         |
+//  |  (requires OpenGL 4.3).                         |
+//  |                                                 |
+//  |  The meshes of the objects are packed into one  |
+//  |  vertex and one element buffer. Per object      |
+//  |  bounds, materials and draw ranges live in a    |
+//  |  shader storage buffer, and the model matrices  |
+//  |  in another one (uploaded once per frame).      |
+//  |                                                 |
+//  |  A compute shader culls every object against    |
+//  |  the view frustum and writes its indirect draw  |
+//  |  command (zero instances when culled), then all |
+//  |  of them are drawn by a single                  |
+//  |  glMultiDrawElementsIndirect: a handful of API  |
+//  |  calls per frame, whatever the object count.    |
+//  |                                                 |
+//  |  Objects marked with SceneObject::SetGpuDriven  |
+//  |  are drawn by this pass instead of the main     |
+//  |  pipeline. Their meshes are copied when packed, |
+//  |  so edits need Invalidate() to show up.         |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class GpuDrivenPass
+{
+public:
+  struct Stats  // Of a recent frame - read back without stalls, so a frame or two late.
+  {
+    int numObjects   { 0 };  // Objects packed.
+    int numVisible   { 0 };  // Objects that passed culling.
+    int numTriangles { 0 };  // Triangles submitted.
+  };
+
+  GpuDrivenPass() { }
+
+  // Loads the culling and drawing shaders. Fails on contexts older than 4.3.
+  bool Init(const std::string& shaderPath = "./shaders/gpu_driven");
+
+  // The objects this pass draws (the main loop should skip them): marked, with a triangle
+  // mesh, no texture and not in wireframe.
+  static bool Draws(SceneObject* object);
+
+  // Culls and draws the objects among the given ones that this pass draws. Their geometry is
+  // packed again whenever that set changes. The caller's program is not restored - bind it
+  // again afterwards.
+  void Render(const std::vector<SceneObject*>& objects, const std::vector<Light*>& lights,
+              Camera* camera);
+
+  // Packs the geometry again on the next Render (e.g. after editing a mesh).
+  inline void Invalidate() { mPacked.clear(); }
+
+  inline const Stats& GetStats() const { return mStats; }
+  inline bool IsInitialized() const { return mDrawProgram.IsLoaded(); }
+
+  ~GpuDrivenPass();
+
+private:
+  // Shader storage layouts (std430) - see shaders/gpu_driven.
+  struct ObjectInfo
+  {
+    GLfloat sphere[4];  // Model space center and radius.
+    GLfloat Ka[4];      // w = lighting on.
+    GLfloat Kd[4];      // w = material on.
+    GLfloat Ks[4];
+    GLuint count;       // Draw range in the packed buffers.
+    GLuint firstIndex;
+    GLint  baseVertex;
+    GLuint padding;
+  };
+
+  struct DrawCommand  // DrawElementsIndirectCommand.
+  {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint  baseVertex;
+    GLuint baseInstance;
+  };
+
+  struct Range
+  {
+    GLuint count, firstIndex;
+    GLint baseVertex;
+    GLfloat sphere[4];
+  };
+
+  // Copies the meshes of objects (each distinct mesh once) to the packed buffers.
+  void Pack(const std::vector<SceneObject*>& objects);
+  void DeleteBuffers();
+
+  // Reads the counters of a finished frame, if any.
+  void PollStats();
+
+  ShaderProgram mCullProgram;
+  ShaderProgram mDrawProgram;
+
+  std::vector<SceneObject*> mPacked;  // Objects in the buffers (command i draws mPacked[i]).
+  std::vector<SceneObject*> mDrawn;   // This frame's objects (compared with mPacked).
+  std::vector<glm::mat4> mTransforms;
+
+  GLuint mVao { 0 };
+  GLuint mVbo { 0 };            // Packed vertices: (x y z) (nx ny nz) (r g b).
+  GLuint mEab { 0 };            // Packed triangle lists.
+  GLuint mDrawIdBuffer { 0 };   // 0, 1, 2, ... - per instance, offset by baseInstance.
+  GLuint mObjectBuffer { 0 };
+  GLuint mTransformBuffer { 0 };
+  GLuint mCommandBuffer { 0 };
+  GLuint mCounterBuffer { 0 };  // Visible objects and triangles.
+  GLsync mCounterFence { 0 };
+
+  Stats mStats;
+};
+
+}  // namespace gloo.
@@ -0,0 +1,72 @@
+#include "ground_grid.h"
+
+#include <iostream>
+
+namespace gloo
+{
+
+bool GroundGrid::Load(const std::string& shaderPath)
+{
+  if (!mProgram.Load(shaderPath))
+  {
+    std::cerr << "ERROR Couldn't load ground grid shaders at " << shaderPath << ".\n";
+    return false;
+  }
+
+  if (mVao == 0)
+  {
+    glGenVertexArrays(1, &mVao);
+  }
+
+  return true;
+}
+
+void GroundGrid::Render() const
+{
+  if (!GroundGrid::IsLoaded() || !mCamera)
+  {
+    return;
+  }
+
+  const glm::mat4& M = mModelMatrix.GetGLMatrix();
+  const glm::mat4& V = mCamera->GetViewMatrix().GetGLMatrix();
+  const glm::mat4& P = mCamera->GetProjMatrix().GetGLMatrix();
+  glm::mat4 VM = V * M;
+  glm::mat4 MVP = P * VM;
+  glm::vec3 cameraPos = glm::vec3(glm::inverse(VM) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+  mProgram.Bind();
+  mProgram.SetMatrix("mvp", MVP);
+  mProgram.SetMatrix("inv_mvp", glm::inverse(MVP));
+  mProgram.SetVec3("camera_pos", cameraPos);
+  mProgram.SetVec3("line_color", mColor);
+  mProgram.SetFloat("cell_size", mCellSize);
+  mProgram.SetFloat("min_cell_pixels", mMinCellPixels);
+  mProgram.SetFloat("line_width", mLineWidth);
+  mProgram.SetFloat("fade_distance", mFadeDistance);
+
+  // Blended over the scene, depth tested but not written.
+  GLboolean blendWasOn = glIsEnabled(GL_BLEND);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glDepthMask(GL_FALSE);
+
+  glBindVertexArray(mVao);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindVertexArray(0);
+
+  glDepthMask(GL_TRUE);
+  if (!blendWasOn)
+  {
+    glDisable(GL_BLEND);
+  }
+
+  mPipelineProgram->Bind();
+}
+
+GroundGrid::~GroundGrid()
+{
+  glDeleteVertexArrays(1, &mVao);
+}
+
+}  // namespace gloo.
@@ -0,0 +1,72 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include "shader_program.h"
+#include "scene_object.h"
+#include "camera.h"
+
+//  +-------------------------------------------------+
+//  |  Unbounded ground grid on the plane y = 0       |
+//  |  (model space), drawn entirely in the shader.   |
+//  |                                                 |
+//  |  One full-screen triangle without vertex data:  |
+//  |  each pixel intersects its view ray with the    |
+//  |  plane and computes the line coverage           |
+//  |  analytically (anti-aliased, any extent, same   |
+//  |  cost). The spacing grows 10x at a time as      |
+//  |  cells get small on screen, and lines fade out  |
+//  |  with distance. Replaces GridObject.            |
+//  |                                                 |
+//  |  It blends over what is already drawn without   |
+//  |  writing depth, so the scene draws it last.     |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class GroundGrid : public SceneObject
+{
+public:
+  GroundGrid(BasicPipelineProgram* pipelineProgram, GLuint programHandle)
+  : SceneObject(pipelineProgram, programHandle)
+  { }
+
+  bool Load(const std::string& shaderPath = "./shaders/ground_grid");
+
+  virtual void Render() const;
+  virtual bool HasCustomRender() const { return true; }
+  virtual bool IsBlended() const { return true; }
+  virtual bool RenderId() const { return true; }  // Never picked, hides nothing.
+
+  // The grid can't render without a camera (the pixel rays come from it).
+  inline void SetCamera(Camera* camera) { mCamera = camera; }
+
+  inline void SetCellSize(float cellSize)       { mCellSize = cellSize; }      // Finest spacing.
+  inline void SetMinCellPixels(float pixels)    { mMinCellPixels = pixels; }   // Before 10x spacing.
+  inline void SetLineWidth(float pixels)        { mLineWidth = pixels; }
+  inline void SetFadeDistance(float distance)   { mFadeDistance = distance; }  // Grows with height.
+  inline void SetColor(const glm::vec3& color)  { mColor = color; }
+
+  inline bool IsLoaded() const { return mProgram.IsLoaded(); }
+
+  virtual ~GroundGrid();
+
+private:
+  ShaderProgram mProgram;
+  GLuint mVao { 0 };  // Empty (core profiles draw nothing without a bound VAO).
+  Camera* mCamera { nullptr };
+
+  float mCellSize { 1.0f };
+  float mMinCellPixels { 8.0f };
+  float mLineWidth { 1.0f };
+  float mFadeDistance { 100.0f };
+  glm::vec3 mColor { 0.6f, 0.6f, 0.6f };
+};
+
+}  // namespace gloo.
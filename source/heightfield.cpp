@@ -0,0 +1,342 @@
+#include "heightfield.h"
+#include "parallel.h"
+
+#include <algorithm>
+
+namespace gloo
+{
+
+namespace
+{
+
+const int kStackSize = 128;         // 3 nodes per level + 1 (at most 32 levels).
+const int kBatchSize = 64;          // Points per structure of arrays batch.
+const int kMinPointsPerThread = 4096;
+const int kMinRowsPerThread = 32;
+
+}  // namespace.
+
+// ================= Setup ================= //
+
+void Heightfield::Set(const float* heights, int w, int h, const glm::vec3& origin, float spacingX,
+                      float spacingZ, float heightScale, Diagonal diagonal)
+{
+  mMinMax.clear();
+  mLevelWidths.clear();
+  mLevelHeights.clear();
+
+  if (!heights || w < 2 || h < 2)
+  {
+    mHeights = nullptr;
+    return;
+  }
+
+  mHeights  = heights;
+  mWidth    = w;
+  mHeight   = h;
+  mOrigin   = origin;
+  mSpacingX = spacingX;
+  mSpacingZ = spacingZ;
+  mInvSpacingX = 1.0f / spacingX;
+  mInvSpacingZ = 1.0f / spacingZ;
+  mScale    = heightScale;
+  mDiagonal = diagonal;
+
+  // Levels down to a single node.
+  int lw = w - 1, lh = h - 1;
+  while (true)
+  {
+    mLevelWidths.push_back(lw);
+    mLevelHeights.push_back(lh);
+    mMinMax.push_back(std::vector<glm::vec2>(static_cast<size_t>(lw) * lh));
+
+    if (lw == 1 && lh == 1)
+      break;
+
+    lw = (lw + 1) / 2;
+    lh = (lh + 1) / 2;
+  }
+
+  for (int level = 0; level < static_cast<int>(mMinMax.size()); level++)
+  {
+    Heightfield::UpdateNodes(level, 0, 0, mLevelWidths[level] - 1, mLevelHeights[level] - 1);
+  }
+}
+
+void Heightfield::Update(int x0, int z0, int x1, int z1)
+{
+  if (!IsValid())
+  {
+    return;
+  }
+
+  // Cells touching the samples, then their ancestors.
+  x0 = std::max(x0 - 1, 0);
+  z0 = std::max(z0 - 1, 0);
+  x1 = std::min(x1, mWidth  - 2);
+  z1 = std::min(z1, mHeight - 2);
+
+  for (int level = 0; level < static_cast<int>(mMinMax.size()); level++)
+  {
+    Heightfield::UpdateNodes(level, x0, z0, x1, z1);
+    x0 >>= 1;
+    z0 >>= 1;
+    x1 >>= 1;
+    z1 >>= 1;
+  }
+}
+
+void Heightfield::UpdateNodes(int level, int x0, int z0, int x1, int z1)
+{
+  if (x0 > x1 || z0 > z1)
+  {
+    return;
+  }
+
+  int lw = mLevelWidths[level];
+  std::vector<glm::vec2>& nodes = mMinMax[level];
+
+  if (level == 0)
+  {
+    tool::ParallelFor(z0, z1 + 1, kMinRowsPerThread, [&](int first, int last)
+    {
+      for (int z = first; z < last; z++)
+      {
+        const float* row0 = mHeights + static_cast<size_t>(mWidth) * z;
+        const float* row1 = row0 + mWidth;
+
+        for (int x = x0; x <= x1; x++)
+        {
+          float lo = std::min(std::min(row0[x], row0[x+1]), std::min(row1[x], row1[x+1]));
+          float hi = std::max(std::max(row0[x], row0[x+1]), std::max(row1[x], row1[x+1]));
+          float a = mScale * lo, b = mScale * hi;
+          nodes[static_cast<size_t>(lw) * z + x] = glm::vec2(std::min(a, b), std::max(a, b));
+        }
+      }
+    });
+    return;
+  }
+
+  int cw = mLevelWidths[level - 1];
+  int ch = mLevelHeights[level - 1];
+  const std::vector<glm::vec2>& children = mMinMax[level - 1];
+
+  for (int z = z0; z <= z1; z++)
+  {
+    for (int x = x0; x <= x1; x++)
+    {
+      glm::vec2 range = children[(2*z) * cw + 2*x];
+      for (int k = 1; k < 4; k++)
+      {
+        int cx = 2*x + (k & 1), cz = 2*z + (k >> 1);
+        if (cx < cw && cz < ch)
+        {
+          range[0] = std::min(range[0], children[cz * cw + cx][0]);
+          range[1] = std::max(range[1], children[cz * cw + cx][1]);
+        }
+      }
+      nodes[z * lw + x] = range;
+    }
+  }
+}
+
+// ================= Point queries ================= //
+
+bool Heightfield::Contains(float x, float z) const
+{
+  float gx = (x - mOrigin[0]) * mInvSpacingX;
+  float gz = (z - mOrigin[2]) * mInvSpacingZ;
+  return IsValid() && (gx >= 0.0f && gx <= mWidth - 1) && (gz >= 0.0f && gz <= mHeight - 1);
+}
+
+float Heightfield::GetHeight(float x, float z) const
+{
+  float gx = std::min(std::max((x - mOrigin[0]) * mInvSpacingX, 0.0f), mWidth  - 1.0f);
+  float gz = std::min(std::max((z - mOrigin[2]) * mInvSpacingZ, 0.0f), mHeight - 1.0f);
+  int ix = std::min(static_cast<int>(gx), mWidth  - 2);
+  int iz = std::min(static_cast<int>(gz), mHeight - 2);
+  float fx = gx - ix, fz = gz - iz;
+
+  const float* p = mHeights + static_cast<size_t>(mWidth) * iz + ix;
+  float top    = p[0] + fx * (p[1] - p[0]);
+  float bottom = p[mWidth] + fx * (p[mWidth + 1] - p[mWidth]);
+  return mOrigin[1] + mScale * (top + fz * (bottom - top));
+}
+
+glm::vec3 Heightfield::GetNormal(float x, float z) const
+{
+  float gx = std::min(std::max((x - mOrigin[0]) * mInvSpacingX, 0.0f), mWidth  - 1.0f);
+  float gz = std::min(std::max((z - mOrigin[2]) * mInvSpacingZ, 0.0f), mHeight - 1.0f);
+  int ix = std::min(static_cast<int>(gx), mWidth  - 2);
+  int iz = std::min(static_cast<int>(gz), mHeight - 2);
+  float fx = gx - ix, fz = gz - iz;
+
+  // Gradient of the bilinear patch.
+  const float* p = mHeights + static_cast<size_t>(mWidth) * iz + ix;
+  float h00 = p[0], h10 = p[1], h01 = p[mWidth], h11 = p[mWidth + 1];
+  float dhdx = ((1.0f - fz) * (h10 - h00) + fz * (h11 - h01)) * mScale * mInvSpacingX;
+  float dhdz = ((1.0f - fx) * (h01 - h00) + fx * (h11 - h10)) * mScale * mInvSpacingZ;
+
+  return glm::normalize(glm::vec3(-dhdx, 1.0f, -dhdz));
+}
+
+void Heightfield::GetHeights(const float* x, const float* z, int count, float* heights) const
+{
+  tool::ParallelFor(0, count, kMinPointsPerThread, [=](int first, int last)
+  {
+    int cells[kBatchSize];
+    float fx[kBatchSize], fz[kBatchSize];
+    float maxX = mWidth - 1.0f, maxZ = mHeight - 1.0f;
+
+    for (int begin = first; begin < last; begin += kBatchSize)
+    {
+      int n = std::min(kBatchSize, last - begin);
+      const float* bx = x + begin;
+      const float* bz = z + begin;
+      float* out = heights + begin;
+
+      // Cells and weights: branch-free, vectorized.
+      for (int i = 0; i < n; i++)
+      {
+        float gx = std::min(std::max((bx[i] - mOrigin[0]) * mInvSpacingX, 0.0f), maxX);
+        float gz = std::min(std::max((bz[i] - mOrigin[2]) * mInvSpacingZ, 0.0f), maxZ);
+        int ix = std::min(static_cast<int>(gx), mWidth  - 2);
+        int iz = std::min(static_cast<int>(gz), mHeight - 2);
+        fx[i] = gx - ix;
+        fz[i] = gz - iz;
+        cells[i] = iz * mWidth + ix;
+      }
+
+      // Gathers and blends.
+      for (int i = 0; i < n; i++)
+      {
+        const float* p = mHeights + cells[i];
+        float top    = p[0] + fx[i] * (p[1] - p[0]);
+        float bottom = p[mWidth] + fx[i] * (p[mWidth + 1] - p[mWidth]);
+        out[i] = mOrigin[1] + mScale * (top + fz[i] * (bottom - top));
+      }
+    }
+  });
+}
+
+// ================= Ray queries ================= //
+
+bool Heightfield::IntersectRay(const glm::vec3& origin, const glm::vec3& dir, float tMin,
+                               float tMax, RayHit& hit) const
+{
+  if (!IsValid())
+  {
+    return false;
+  }
+
+  // Grid space (x and z in cells, y relative to the origin) - t is unchanged.
+  glm::vec3 o((origin[0] - mOrigin[0]) * mInvSpacingX, origin[1] - mOrigin[1],
+              (origin[2] - mOrigin[2]) * mInvSpacingZ);
+  glm::vec3 d(dir[0] * mInvSpacingX, dir[1], dir[2] * mInvSpacingZ);
+  glm::vec3 invD(1.0f / d[0], 1.0f / d[1], 1.0f / d[2]);
+
+  // Children are visited near to far: the ray crosses at most 3 of them, in this order.
+  int flipX = (d[0] < 0.0f) ? 1 : 0;
+  int flipZ = (d[2] < 0.0f) ? 1 : 0;
+
+  struct Node { int level, x, z; };
+  Node stack[kStackSize];
+  int top = 0;
+  stack[top++] = { static_cast<int>(mMinMax.size()) - 1, 0, 0 };
+
+  auto vertex = [this](int x, int z)
+  {
+    return glm::vec3(x, mScale * mHeights[static_cast<size_t>(mWidth) * z + x], z);
+  };
+
+  bool found = false;
+  while (top > 0)
+  {
+    Node node = stack[--top];
+    int size = 1 << node.level;
+    const glm::vec2& range = NodeRange(node.level, node.x, node.z);
+
+    AABB box(glm::vec3(node.x * size, range[0], node.z * size),
+             glm::vec3(std::min((node.x + 1) * size, mWidth - 1), range[1],
+                       std::min((node.z + 1) * size, mHeight - 1)));
+
+    if (!box.Intersect(o, invD, tMin, tMax))
+      continue;
+
+    if (node.level > 0)
+    {
+      int level = node.level - 1;
+      for (int k = 3; k >= 0; k--)  // Far to near on the stack.
+      {
+        int x = 2*node.x + ((k & 1) ^ flipX);
+        int z = 2*node.z + ((k >> 1) ^ flipZ);
+        if (x < mLevelWidths[level] && z < mLevelHeights[level])
+        {
+          stack[top++] = { level, x, z };
+        }
+      }
+      continue;
+    }
+
+    // Leaf: the two triangles of the cell.
+    glm::vec3 v00 = vertex(node.x, node.z),     v10 = vertex(node.x + 1, node.z);
+    glm::vec3 v01 = vertex(node.x, node.z + 1), v11 = vertex(node.x + 1, node.z + 1);
+    float t, u, v;
+    int triangle = -1;
+
+    if (mDiagonal == kMainDiagonal)
+    {
+      if (IntersectTriangle(v00, v11 - v00, v10 - v00, o, d, tMin, tMax, t, u, v))
+      {
+        tMax = t; triangle = 0; hit.u = u; hit.v = v;
+      }
+      if (IntersectTriangle(v00, v01 - v00, v11 - v00, o, d, tMin, tMax, t, u, v))
+      {
+        tMax = t; triangle = 1; hit.u = u; hit.v = v;
+      }
+    }
+    else
+    {
+      if (IntersectTriangle(v00, v01 - v00, v10 - v00, o, d, tMin, tMax, t, u, v))
+      {
+        tMax = t; triangle = 0; hit.u = u; hit.v = v;
+      }
+      if (IntersectTriangle(v01, v10 - v01, v11 - v01, o, d, tMin, tMax, t, u, v))
+      {
+        tMax = t; triangle = 1; hit.u = u; hit.v = v;
+      }
+    }
+
+    if (triangle >= 0)
+    {
+      hit.t = tMax;
+      hit.triangle = 2 * ((mWidth - 1) * node.z + node.x) + triangle;
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+bool Heightfield::GetWorldHeight(const glm::mat4& modelToWorld, const glm::mat4& worldToModel,
+                                 const glm::vec3& point, float& height) const
+{
+  glm::vec4 p = worldToModel * glm::vec4(point, 1.0f);
+  if (!Heightfield::Contains(p[0], p[2]))
+  {
+    return false;
+  }
+
+  float y = Heightfield::GetHeight(p[0], p[2]);
+  height = (modelToWorld * glm::vec4(p[0], y, p[2], 1.0f))[1];
+  return true;
+}
+
+bool Heightfield::IntersectWorldRay(const glm::mat4& worldToModel, const Ray& ray, RayHit& hit) const
+{
+  glm::vec3 o = glm::vec3(worldToModel * glm::vec4(ray.origin, 1.0f));
+  glm::vec3 d = glm::vec3(worldToModel * glm::vec4(ray.dir, 0.0f));
+  return Heightfield::IntersectRay(o, d, ray.tMin, std::min(ray.tMax, hit.t), hit);
+}
+
+}  // namespace gloo.
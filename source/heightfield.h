@@ -0,0 +1,106 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ray.h"
+
+//  +-------------------------------------------------+
+//  |  Queries against a regular grid of heights      |
+//  |  (terrain collision, placement and picking).    |
+//  |                                                 |
+//  |  - GetHeight: O(1) bilinear interpolation.      |
+//  |  - GetHeights: many points at once, in          |
+//  |    structure of arrays form (split across       |
+//  |    threads when large).                         |
+//  |  - IntersectRay: front to back descent of a     |
+//  |    min/max mip quadtree over the cells, so      |
+//  |    empty space is skipped a whole node at a     |
+//  |    time. Leaves test the two triangles of a     |
+//  |    cell, split like the rendered mesh.          |
+//  |                                                 |
+//  |  The heights aren't copied: the owner keeps     |
+//  |  them alive and calls Update after edits.       |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class Heightfield
+{
+public:
+  enum Diagonal
+  {
+    kMainDiagonal,  // Cells split along (x, z) - (x+1, z+1).
+    kAntiDiagonal,  // Cells split along (x+1, z) - (x, z+1).
+  };
+
+  Heightfield() { }
+
+  // Vertex (x, z) of the row major w x h grid is at
+  // origin + (x * spacingX, heightScale * heights[z*w + x], z * spacingZ).
+  void Set(const float* heights, int w, int h, const glm::vec3& origin, float spacingX,
+           float spacingZ, float heightScale = 1.0f, Diagonal diagonal = kMainDiagonal);
+
+  // Refreshes the quadtree over the samples [x0, x1] x [z0, z1] after they changed.
+  void Update(int x0, int z0, int x1, int z1);
+
+  // Point queries (coordinates clamped to the grid).
+  bool Contains(float x, float z) const;
+  float GetHeight(float x, float z) const;
+  glm::vec3 GetNormal(float x, float z) const;
+
+  // heights[i] = GetHeight(x[i], z[i]) for count points.
+  void GetHeights(const float* x, const float* z, int count, float* heights) const;
+
+  // Closest triangle hit in (tMin, tMax). hit.triangle is 2 * (z * (w-1) + x) + k for
+  // triangle k of cell (x, z).
+  bool IntersectRay(const glm::vec3& origin, const glm::vec3& dir, float tMin, float tMax,
+                    RayHit& hit) const;
+
+  // World space versions through the transform of the owner (y must stay vertical).
+  bool GetWorldHeight(const glm::mat4& modelToWorld, const glm::mat4& worldToModel,
+                      const glm::vec3& point, float& height) const;
+  bool IntersectWorldRay(const glm::mat4& worldToModel, const Ray& ray, RayHit& hit) const;
+
+  // Getters.
+  inline bool IsValid() const { return (mHeights != nullptr); }
+  inline int GetWidth()  const { return mWidth;  }
+  inline int GetHeight() const { return mHeight; }
+  inline float GetMinHeight() const { return mOrigin[1] + (mMinMax.empty() ? 0.0f : mMinMax.back()[0][0]); }
+  inline float GetMaxHeight() const { return mOrigin[1] + (mMinMax.empty() ? 0.0f : mMinMax.back()[0][1]); }
+
+private:
+  // Recomputes nodes [x0, x1] x [z0, z1] of a level (from the samples, or the level below).
+  void UpdateNodes(int level, int x0, int z0, int x1, int z1);
+
+  // Scaled (min, max) of a node of level l covering cells [x * 2^l, (x+1) * 2^l).
+  inline const glm::vec2& NodeRange(int level, int x, int z) const
+  {
+    return mMinMax[level][z * mLevelWidths[level] + x];
+  }
+
+  const float* mHeights { nullptr };
+  int mWidth  { 0 };
+  int mHeight { 0 };
+  glm::vec3 mOrigin { 0.0f };
+  float mSpacingX { 1.0f }, mSpacingZ { 1.0f };
+  float mInvSpacingX { 1.0f }, mInvSpacingZ { 1.0f };
+  float mScale { 1.0f };
+  Diagonal mDiagonal { kMainDiagonal };
+
+  // Level 0 has one node per cell, level l + 1 combines 2x2 nodes of level l.
+  std::vector<std::vector<glm::vec2>> mMinMax;
+  std::vector<int> mLevelWidths;
+  std::vector<int> mLevelHeights;
+};
+
+}  // namespace gloo.
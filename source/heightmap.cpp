@@ -0,0 +1,370 @@
+#include "heightmap.h"
+#include "parallel.h"
+#include "imageIO.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <utility>
+
+namespace gloo
+{
+
+namespace
+{
+
+const int kMinRowsPerThread = 32;
+const int kMinSamplesPerThread = 1 << 16;
+
+}  // namespace.
+
+// ================= Loading ================= //
+
+bool Heightmap::Load(const std::string& fileName)
+{
+  std::string extension = fileName.substr(fileName.find_last_of('.') + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+  if (extension == "jpg" || extension == "jpeg")
+  {
+    ImageIO image;
+    if (image.loadJPEG(fileName.c_str()) != ImageIO::OK)
+    {
+      std::cerr << "ERROR Couldn't load heightmap " << fileName << ".\n";
+      return false;
+    }
+
+    // Only the first channel is used.
+    Heightmap::Set(image.getPixels(), image.getWidth(), image.getHeight(), image.getBytesPerPixel());
+    return true;
+  }
+
+  Format format;
+  if (!Heightmap::GetRawFormat(fileName, format))
+  {
+    std::cerr << "ERROR Unknown heightmap format " << fileName << ".\n";
+    return false;
+  }
+
+  // Square raw file: the side comes from the file size.
+  std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+  if (!file.is_open())
+  {
+    std::cerr << "ERROR Couldn't open heightmap " << fileName << ".\n";
+    return false;
+  }
+
+  long long numSamples = static_cast<long long>(file.tellg()) / Heightmap::GetBytesPerSample(format);
+  int side = static_cast<int>(std::sqrt(static_cast<double>(numSamples)) + 0.5);
+
+  if (static_cast<long long>(side) * side != numSamples)
+  {
+    std::cerr << "ERROR Raw heightmap " << fileName << " isn't square - use LoadRaw.\n";
+    return false;
+  }
+
+  return Heightmap::LoadRaw(fileName, side, side, format);
+}
+
+bool Heightmap::LoadRaw(const std::string& fileName, int w, int h, Format format)
+{
+  std::ifstream file(fileName, std::ios::binary);
+  if (!file.is_open())
+  {
+    std::cerr << "ERROR Couldn't open heightmap " << fileName << ".\n";
+    return false;
+  }
+
+  std::vector<unsigned char> bytes(static_cast<size_t>(w) * h * Heightmap::GetBytesPerSample(format));
+  if (!file.read(reinterpret_cast<char*>(bytes.data()), bytes.size()))
+  {
+    std::cerr << "ERROR Heightmap " << fileName << " is smaller than " << w << "x" << h << ".\n";
+    return false;
+  }
+
+  mWidth  = w;
+  mHeight = h;
+  mFormat = format;
+  mData.resize(static_cast<size_t>(w) * h);
+  Heightmap::Decode(bytes.data(), mData.size(), format, mData.data());
+
+  return true;
+}
+
+bool Heightmap::GetRawFormat(const std::string& fileName, Format& format)
+{
+  std::string extension = fileName.substr(fileName.find_last_of('.') + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+  if (extension == "r8" || extension == "raw")
+    format = kUInt8;
+  else if (extension == "r16")
+    format = kUInt16;
+  else if (extension == "r32" || extension == "f32")
+    format = kFloat32;
+  else
+    return false;
+
+  return true;
+}
+
+int Heightmap::GetBytesPerSample(Format format)
+{
+  return (format == kUInt8) ? 1 : ((format == kUInt16) ? 2 : 4);
+}
+
+void Heightmap::Decode(const unsigned char* bytes, size_t count, Format format, float* out)
+{
+  tool::ParallelFor(0, static_cast<int>(count), kMinSamplesPerThread, [=](int first, int last)
+  {
+    switch (format)
+    {
+      case kUInt8:
+        for (int i = first; i < last; i++)
+        {
+          out[i] = bytes[i] * (1.0f / 255.0f);
+        }
+      break;
+
+      case kUInt16:
+        // Little endian on disk, regardless of the host.
+        for (int i = first; i < last; i++)
+        {
+          out[i] = static_cast<unsigned short>(bytes[2*i] | (bytes[2*i + 1] << 8)) * (1.0f / 65535.0f);
+        }
+      break;
+
+      case kFloat32:
+        // Little endian IEEE floats, also regardless of the host.
+        for (int i = first; i < last; i++)
+        {
+          const unsigned char* b = bytes + 4*i;
+          uint32_t bits = b[0] | (b[1] << 8) | (b[2] << 16) | (static_cast<uint32_t>(b[3]) << 24);
+          std::memcpy(out + i, &bits, sizeof(float));
+        }
+      break;
+    }
+  });
+}
+
+void Heightmap::Set(const unsigned char* data, int w, int h, int stride)
+{
+  mWidth  = w;
+  mHeight = h;
+  mFormat = kUInt8;
+  mData.resize(static_cast<size_t>(w) * h);
+
+  float* out = mData.data();
+  tool::ParallelFor(0, h, kMinRowsPerThread, [=](int first, int last)
+  {
+    for (size_t i = static_cast<size_t>(first) * w; i < static_cast<size_t>(last) * w; i++)
+    {
+      out[i] = data[stride * i] * (1.0f / 255.0f);
+    }
+  });
+}
+
+void Heightmap::Set(const unsigned short* data, int w, int h)
+{
+  mWidth  = w;
+  mHeight = h;
+  mFormat = kUInt16;
+  mData.resize(static_cast<size_t>(w) * h);
+
+  float* out = mData.data();
+  tool::ParallelFor(0, h, kMinRowsPerThread, [=](int first, int last)
+  {
+    for (size_t i = static_cast<size_t>(first) * w; i < static_cast<size_t>(last) * w; i++)
+    {
+      out[i] = data[i] * (1.0f / 65535.0f);
+    }
+  });
+}
+
+void Heightmap::Set(const float* data, int w, int h)
+{
+  mWidth  = w;
+  mHeight = h;
+  mFormat = kFloat32;
+  mData.assign(data, data + static_cast<size_t>(w) * h);
+}
+
+void Heightmap::Set(std::vector<float>&& data, int w, int h)
+{
+  mWidth  = w;
+  mHeight = h;
+  mFormat = kFloat32;
+  mData = std::move(data);
+}
+
+// ================= Processing ================= //
+
+void Heightmap::Resample(int w, int h, float scale, float offset, float* out) const
+{
+  if (!IsLoaded() || w <= 0 || h <= 0)
+  {
+    return;
+  }
+
+  // Same size: just scale.
+  if (w == mWidth && h == mHeight)
+  {
+    const float* data = mData.data();
+    tool::ParallelFor(0, h, kMinRowsPerThread, [=](int first, int last)
+    {
+      for (size_t i = static_cast<size_t>(first) * w; i < static_cast<size_t>(last) * w; i++)
+      {
+        out[i] = scale * data[i] + offset;
+      }
+    });
+    return;
+  }
+
+  // Source coordinates of each column are the same for every row.
+  std::vector<int> columns(w);
+  std::vector<float> weights(w);
+  for (int x = 0; x < w; x++)
+  {
+    float sx = (w > 1) ? static_cast<float>(x) * (mWidth - 1) / (w - 1) : 0.0f;
+    columns[x] = std::min(static_cast<int>(sx), std::max(mWidth - 2, 0));
+    weights[x] = std::min(sx - columns[x], 1.0f);
+  }
+
+  tool::ParallelFor(0, h, kMinRowsPerThread, [&](int first, int last)
+  {
+    for (int y = first; y < last; y++)
+    {
+      float sy = (h > 1) ? static_cast<float>(y) * (mHeight - 1) / (h - 1) : 0.0f;
+      int y0 = std::min(static_cast<int>(sy), std::max(mHeight - 2, 0));
+      int y1 = std::min(y0 + 1, mHeight - 1);
+      float ty = std::min(sy - y0, 1.0f);
+
+      const float* row0 = &mData[static_cast<size_t>(mWidth) * y0];
+      const float* row1 = &mData[static_cast<size_t>(mWidth) * y1];
+      float* dst = out + static_cast<size_t>(w) * y;
+      int step = std::min(1, mWidth - 1);
+
+      for (int x = 0; x < w; x++)
+      {
+        int c = columns[x];
+        float tx = weights[x];
+        float top    = row0[c] + tx * (row0[c + step] - row0[c]);
+        float bottom = row1[c] + tx * (row1[c + step] - row1[c]);
+        dst[x] = scale * (top + ty * (bottom - top)) + offset;
+      }
+    }
+  });
+}
+
+void Heightmap::ComputeNormals(const float* heights, int w, int h, float spacingX, float spacingZ,
+                               float* normals, int stride, NormalFilter filter)
+{
+  Heightmap::ComputeNormals(heights, w, h, spacingX, spacingZ, normals, stride,
+                            0, 0, w-1, h-1, filter);
+}
+
+void Heightmap::ComputeNormals(const float* heights, int w, int h, float spacingX, float spacingZ,
+                               float* normals, int stride, int x0, int y0, int x1, int y1,
+                               NormalFilter filter)
+{
+  x0 = std::max(x0, 0);
+  y0 = std::max(y0, 0);
+  x1 = std::min(x1, w-1);
+  y1 = std::min(y1, h-1);
+
+  if (x0 > x1 || y0 > y1)
+  {
+    return;
+  }
+
+  bool sobel = (filter == kSobel);
+
+  tool::ParallelFor(y0, y1 + 1, kMinRowsPerThread, [=](int first, int last)
+  {
+    int n = x1 - x0 + 1;
+    std::vector<float> gx(n), gz(n), ny(n);  // Row in structure of arrays form.
+
+    for (int y = first; y < last; y++)
+    {
+      int yu = std::max(y-1, 0), yd = std::min(y+1, h-1);
+      const float* up   = heights + static_cast<size_t>(w) * yu;
+      const float* row  = heights + static_cast<size_t>(w) * y;
+      const float* down = heights + static_cast<size_t>(w) * yd;
+
+      float invX = 1.0f / (2.0f * spacingX);
+      float invZ = 1.0f / (std::max(yd - yu, 1) * spacingZ);
+      if (sobel)
+      {
+        invX *= 0.25f;
+        invZ *= 0.25f;
+      }
+
+      // Slopes at a column with clamped neighbors (borders).
+      auto slopes = [&](int x, float& dhdx, float& dhdz)
+      {
+        int xl = std::max(x-1, 0), xr = std::min(x+1, w-1);
+        float sx = 2.0f / std::max(xr - xl, 1);
+        if (sobel)
+        {
+          dhdx = ((up[xr] + 2.0f*row[xr] + down[xr]) - (up[xl] + 2.0f*row[xl] + down[xl])) * invX * sx;
+          dhdz = ((down[xl] + 2.0f*down[x] + down[xr]) - (up[xl] + 2.0f*up[x] + up[xr])) * invZ;
+        }
+        else
+        {
+          dhdx = (row[xr] - row[xl]) * invX * sx;
+          dhdz = (down[x] - up[x]) * invZ;
+        }
+      };
+
+      // Interior columns: no clamping, branch-free.
+      int begin = std::max(x0, 1);
+      int end   = std::min(x1, w-2);
+
+      if (sobel)
+      {
+        for (int x = begin; x <= end; x++)
+        {
+          gx[x - x0] = ((up[x+1] + 2.0f*row[x+1] + down[x+1]) -
+                        (up[x-1] + 2.0f*row[x-1] + down[x-1])) * invX;
+          gz[x - x0] = ((down[x-1] + 2.0f*down[x] + down[x+1]) -
+                        (up[x-1]   + 2.0f*up[x]   + up[x+1])) * invZ;
+        }
+      }
+      else
+      {
+        for (int x = begin; x <= end; x++)
+        {
+          gx[x - x0] = (row[x+1] - row[x-1]) * invX;
+          gz[x - x0] = (down[x] - up[x]) * invZ;
+        }
+      }
+
+      if (x0 == 0)
+        slopes(0, gx[0], gz[0]);
+      if (x1 == w-1 && w > 1)
+        slopes(w-1, gx[n-1], gz[n-1]);
+
+      // n = normalize(-dh/dx, 1, -dh/dz).
+      for (int i = 0; i < n; i++)
+      {
+        float inv = 1.0f / std::sqrt(gx[i]*gx[i] + gz[i]*gz[i] + 1.0f);
+        gx[i] = -gx[i] * inv;
+        gz[i] = -gz[i] * inv;
+        ny[i] = inv;
+      }
+
+      float* out = normals + static_cast<size_t>(stride) * (static_cast<size_t>(w) * y + x0);
+      for (int i = 0; i < n; i++)
+      {
+        out[stride*i + 0] = gx[i];
+        out[stride*i + 1] = ny[i];
+        out[stride*i + 2] = gz[i];
+      }
+    }
+  });
+}
+
+}  // namespace gloo.
@@ -0,0 +1,92 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+//  +-------------------------------------------------+
+//  |  Heightmap loading and processing for terrain.  |
+//  |                                                 |
+//  |  Sources: 8-bit images (JPEG via ImageIO) and   |
+//  |  raw 8-bit, 16-bit or float grids. Values are   |
+//  |  stored as floats, integer formats normalized   |
+//  |  to [0, 1].                                     |
+//  |                                                 |
+//  |  Normals are computed per row in structure of   |
+//  |  arrays form, rows split across threads.        |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class Heightmap
+{
+public:
+  enum Format
+  {
+    kUInt8,    // .jpg, .jpeg, .r8, .raw - normalized by 255.
+    kUInt16,   // .r16 (little endian) - normalized by 65535.
+    kFloat32,  // .r32, .f32 (little endian) - kept as is.
+  };
+
+  enum NormalFilter
+  {
+    kCentralDifferences,  // 4 neighbors - sharpest.
+    kSobel,               // 8 neighbors - smoother on noisy data.
+  };
+
+  Heightmap() { }
+
+  // Loads by extension (see Format). Raw files without dimensions must be square.
+  bool Load(const std::string& fileName);
+  bool LoadRaw(const std::string& fileName, int w, int h, Format format);
+
+  // Copies data (stride in elements between consecutive samples, e.g. bytes per pixel).
+  void Set(const unsigned char* data, int w, int h, int stride = 1);
+  void Set(const unsigned short* data, int w, int h);
+  void Set(const float* data, int w, int h);
+  void Set(std::vector<float>&& data, int w, int h);  // Takes w * h floats without copying.
+
+  // Raw sample formats: extension to format, and decoding to floats (as stored by Load).
+  static bool GetRawFormat(const std::string& fileName, Format& format);
+  static int GetBytesPerSample(Format format);
+  static void Decode(const unsigned char* bytes, size_t count, Format format, float* out);
+
+  // Bilinearly resamples the whole map into a w x h grid: out[y*w + x] = scale * value + offset.
+  void Resample(int w, int h, float scale, float offset, float* out) const;
+
+  // Getters.
+  inline bool IsLoaded() const { return !mData.empty(); }
+  inline int GetWidth()  const { return mWidth;  }
+  inline int GetHeight() const { return mHeight; }
+  inline Format GetFormat() const { return mFormat; }
+  inline const float* GetData() const { return mData.data(); }
+  inline float At(int x, int y) const { return mData[mWidth * y + x]; }
+
+  // Computes unit normals of the height field (x * spacingX, heights[y*w + x], y * spacingZ).
+  // The normal of vertex (x, y) is written to normals + stride * (y*w + x) as (nx, ny, nz),
+  // so it can go directly into an interleaved vertex array. Only [x0, x1] x [y0, y1] is
+  // updated; borders use one-sided differences.
+  static void ComputeNormals(const float* heights, int w, int h, float spacingX, float spacingZ,
+                             float* normals, int stride, int x0, int y0, int x1, int y1,
+                             NormalFilter filter = kCentralDifferences);
+
+  static void ComputeNormals(const float* heights, int w, int h, float spacingX, float spacingZ,
+                             float* normals, int stride, NormalFilter filter = kCentralDifferences);
+
+private:
+  std::vector<float> mData;
+  int mWidth  { 0 };
+  int mHeight { 0 };
+  Format mFormat { kUInt8 };
+};
+
+}  // namespace gloo.
@@ -0,0 +1,352 @@
+#include "implicit_polygonizer.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "parallel.h"
+
+namespace gloo
+{
+
+namespace
+{
+
+const int kNumCorners = ImplicitPolygonizer::kBlockSize + 1;  // Corners per block side.
+const float kGradientStep = 0.1f;  // Central differences step, in cells.
+
+inline int CornerIndex(int x, int y, int z) { return (z * kNumCorners + y) * kNumCorners + x; }
+
+}  // namespace.
+
+// ================= Polygonization ================= //
+
+void ImplicitPolygonizer::Polygonize(const BatchFunc& batchFunc, const IntervalFunc& intervalFunc,
+                                     const Params& params)
+{
+  const int B = kBlockSize;
+
+  mField = &batchFunc;
+  mIsoValue = params.isoValue;
+  mCellSize = std::max(params.cellSize, 1e-6f);
+  mOrigin   = params.bounds.min;
+
+  glm::vec3 extent = params.bounds.Extent();
+  for (int a = 0; a < 3; a++)
+  {
+    mNumCells[a]  = std::max(1, static_cast<int>(std::ceil(extent[a] / mCellSize)));
+    mNumBlocks[a] = (mNumCells[a] + B - 1) / B;
+  }
+
+  mBlocks.clear();
+  mVertices.clear();
+  mIndices.clear();
+  mStats = Stats();
+
+  int numBlocks = mNumBlocks.x * mNumBlocks.y * mNumBlocks.z;
+  mStats.numBlocks = numBlocks;
+
+  // Skip the blocks where f can't take the iso value (a NaN bound keeps the block).
+  std::vector<char> active(numBlocks, 1);
+  if (intervalFunc)
+  {
+    tool::ParallelFor(0, numBlocks, 64, [&](int first, int last)
+    {
+      for (int id = first; id < last; id++)
+      {
+        glm::ivec3 block(id % mNumBlocks.x, (id / mNumBlocks.x) % mNumBlocks.y,
+                         id / (mNumBlocks.x * mNumBlocks.y));
+        glm::vec3 lo = Corner(block.x * B, block.y * B, block.z * B);
+        glm::vec3 hi = Corner(std::min((block.x + 1) * B, mNumCells.x),
+                              std::min((block.y + 1) * B, mNumCells.y),
+                              std::min((block.z + 1) * B, mNumCells.z));
+
+        Interval range = intervalFunc(Interval(lo.x, hi.x), Interval(lo.y, hi.y),
+                                      Interval(lo.z, hi.z));
+        active[id] = !(range.lo > mIsoValue || range.hi < mIsoValue);
+      }
+    });
+  }
+
+  mBlockIndex.assign(numBlocks, -1);
+  for (int id = 0; id < numBlocks; id++)
+  {
+    if (active[id])
+    {
+      mBlockIndex[id] = static_cast<int>(mBlocks.size());
+      mBlocks.emplace_back();
+      mBlocks.back().x = id % mNumBlocks.x;
+      mBlocks.back().y = (id / mNumBlocks.x) % mNumBlocks.y;
+      mBlocks.back().z = id / (mNumBlocks.x * mNumBlocks.y);
+    }
+  }
+
+  int numActive = static_cast<int>(mBlocks.size());
+  mStats.numActive = numActive;
+
+  tool::ParallelFor(0, numActive, 1, [this](int first, int last)
+  {
+    for (int b = first; b < last; b++)
+    {
+      ImplicitPolygonizer::SampleBlock(mBlocks[b]);
+      ImplicitPolygonizer::PlaceVertices(mBlocks[b]);
+    }
+  });
+
+  // Global vertex numbering, block after block.
+  GLuint numVertices = 0;
+  for (Block& block : mBlocks)
+  {
+    block.firstVertex = numVertices;
+    numVertices += static_cast<GLuint>(block.vertices.size() / 6);
+  }
+
+  tool::ParallelFor(0, numActive, 1, [this](int first, int last)
+  {
+    for (int b = first; b < last; b++)
+    {
+      ImplicitPolygonizer::ConnectVertices(mBlocks[b]);
+    }
+  });
+
+  size_t numIndices = 0;
+  for (const Block& block : mBlocks)
+  {
+    numIndices += block.indices.size();
+  }
+
+  mVertices.reserve(6 * static_cast<size_t>(numVertices));
+  mIndices.reserve(numIndices);
+  for (const Block& block : mBlocks)
+  {
+    mVertices.insert(mVertices.end(), block.vertices.begin(), block.vertices.end());
+    mIndices.insert(mIndices.end(), block.indices.begin(), block.indices.end());
+  }
+
+  // Corners of every active block, and two batches per vertex (projection and normal).
+  mStats.numEvaluations = static_cast<long long>(numActive) * kNumCorners * kNumCorners * kNumCorners +
+                          2LL * Float8::kSize * numVertices;
+
+  mBlocks.clear();
+  mBlockIndex.clear();
+  mField = nullptr;
+}
+
+void ImplicitPolygonizer::SampleBlock(Block& block) const
+{
+  const int kCount = kNumCorners * kNumCorners * kNumCorners;
+  block.values.resize(kCount);
+
+  glm::ivec3 base(block.x * kBlockSize, block.y * kBlockSize, block.z * kBlockSize);
+
+  // The corners in memory order, 8 at a time (the last batch repeats the last corner).
+  for (int first = 0; first < kCount; first += Float8::kSize)
+  {
+    Float8 x, y, z;
+    for (int lane = 0; lane < Float8::kSize; lane++)
+    {
+      int index = std::min(first + lane, kCount - 1);
+      glm::vec3 p = Corner(base.x + index % kNumCorners, base.y + (index / kNumCorners) % kNumCorners,
+                           base.z + index / (kNumCorners * kNumCorners));
+      x[lane] = p.x;
+      y[lane] = p.y;
+      z[lane] = p.z;
+    }
+
+    Float8 f = (*mField)(x, y, z);
+    for (int lane = 0; lane < Float8::kSize && first + lane < kCount; lane++)
+    {
+      block.values[first + lane] = f[lane];
+    }
+  }
+}
+
+void ImplicitPolygonizer::PlaceVertices(Block& block) const
+{
+  const int B = kBlockSize;
+  block.cells.assign(B * B * B, kNoVertex);
+
+  glm::ivec3 base(block.x * B, block.y * B, block.z * B);
+  glm::ivec3 end = glm::min(glm::ivec3(B), mNumCells - base);
+  float h = kGradientStep * mCellSize;
+
+  for (int k = 0; k < end.z; k++)
+  {
+    for (int j = 0; j < end.y; j++)
+    {
+      for (int i = 0; i < end.x; i++)
+      {
+        // Corner c of the cell is at (i, j, k) + (c & 1, (c >> 1) & 1, c >> 2).
+        float values[8];
+        int numInside = 0;
+        for (int c = 0; c < 8; c++)
+        {
+          values[c] = block.values[CornerIndex(i + (c & 1), j + ((c >> 1) & 1), k + (c >> 2))];
+          numInside += (values[c] < mIsoValue);
+        }
+
+        if (numInside == 0 || numInside == 8)
+        {
+          continue;
+        }
+
+        // Mean of the crossings of the 12 edges (in cell units).
+        glm::vec3 mean(0.0f);
+        int numCrossings = 0;
+        for (int c = 0; c < 8; c++)
+        {
+          for (int bit = 1; bit < 8; bit <<= 1)
+          {
+            int d = c | bit;
+            if ((c & bit) || (values[c] < mIsoValue) == (values[d] < mIsoValue))
+            {
+              continue;
+            }
+
+            float t = (mIsoValue - values[c]) / (values[d] - values[c]);
+            glm::vec3 p0(c & 1, (c >> 1) & 1, c >> 2);
+            glm::vec3 p1(d & 1, (d >> 1) & 1, d >> 2);
+            mean += p0 + t * (p1 - p0);
+            numCrossings++;
+          }
+        }
+
+        glm::vec3 cellMin = Corner(base.x + i, base.y + j, base.z + k);
+        glm::vec3 position = cellMin + mCellSize * (mean / static_cast<float>(numCrossings));
+
+        // One Newton step towards the surface (staying in the cell), then the normal there.
+        // Each batch holds the 6 central difference points and the center.
+        glm::vec3 gradient;
+        float value = 0.0f;
+        for (int pass = 0; pass < 2; pass++)
+        {
+          Float8 x(position.x), y(position.y), z(position.z);
+          x[0] += h; x[1] -= h;
+          y[2] += h; y[3] -= h;
+          z[4] += h; z[5] -= h;
+
+          Float8 f = (*mField)(x, y, z);
+          glm::vec3 g((f[0] - f[1]) / (2*h), (f[2] - f[3]) / (2*h), (f[4] - f[5]) / (2*h));
+          value = f[6] - mIsoValue;
+
+          if (glm::dot(g, g) > 0.0f)
+          {
+            gradient = g;
+          }
+
+          if (pass == 0 && glm::dot(gradient, gradient) > 0.0f)
+          {
+            position -= (value / glm::dot(gradient, gradient)) * gradient;
+            position = glm::clamp(position, cellMin, cellMin + glm::vec3(mCellSize));
+          }
+        }
+
+        float length = glm::length(gradient);
+        glm::vec3 normal = (length > 0.0f) ? gradient / length : glm::vec3(0.0f, 0.0f, 1.0f);
+
+        block.cells[(k * B + j) * B + i] = static_cast<GLuint>(block.vertices.size() / 6);
+        block.vertices.insert(block.vertices.end(), { position.x, position.y, position.z,
+                                                      normal.x, normal.y, normal.z });
+      }
+    }
+  }
+}
+
+void ImplicitPolygonizer::ConnectVertices(Block& block) const
+{
+  const int B = kBlockSize;
+  glm::ivec3 base(block.x * B, block.y * B, block.z * B);
+
+  // Cells around an edge along axis a, counterclockwise seen from +a (offsets along the
+  // other two axes, u = a + 1 and v = a + 2).
+  const int around[4][2] = { { -1, -1 }, { 0, -1 }, { 0, 0 }, { -1, 0 } };
+
+  for (int k = 0; k < B; k++)
+  {
+    for (int j = 0; j < B; j++)
+    {
+      for (int i = 0; i < B; i++)
+      {
+        glm::ivec3 corner = base + glm::ivec3(i, j, k);
+        float v0 = block.values[CornerIndex(i, j, k)];
+
+        for (int a = 0; a < 3; a++)
+        {
+          int u = (a + 1) % 3, v = (a + 2) % 3;
+          if (corner[a] >= mNumCells[a] || corner[u] < 1 || corner[u] >= mNumCells[u] ||
+              corner[v] < 1 || corner[v] >= mNumCells[v])
+          {
+            continue;  // The edge doesn't have 4 cells around it (domain border).
+          }
+
+          glm::ivec3 next(i, j, k);
+          next[a]++;
+          float v1 = block.values[CornerIndex(next.x, next.y, next.z)];
+          if ((v0 < mIsoValue) == (v1 < mIsoValue))
+          {
+            continue;
+          }
+
+          GLuint quad[4];
+          glm::vec3 positions[4];
+          bool complete = true;
+          for (int c = 0; c < 4 && complete; c++)
+          {
+            glm::ivec3 cell = corner;
+            cell[u] += around[c][0];
+            cell[v] += around[c][1];
+            complete = ImplicitPolygonizer::FindCellVertex(cell, quad[c], positions[c]);
+          }
+
+          if (!complete)
+          {
+            continue;
+          }
+
+          // Front faces point outside (along the gradient).
+          if (v0 >= mIsoValue)
+          {
+            std::swap(quad[1], quad[3]);
+            std::swap(positions[1], positions[3]);
+          }
+
+          // Split along the shorter diagonal.
+          if (glm::length(positions[2] - positions[0]) <= glm::length(positions[3] - positions[1]))
+          {
+            block.indices.insert(block.indices.end(), { quad[0], quad[1], quad[2],
+                                                        quad[0], quad[2], quad[3] });
+          }
+          else
+          {
+            block.indices.insert(block.indices.end(), { quad[0], quad[1], quad[3],
+                                                        quad[1], quad[2], quad[3] });
+          }
+        }
+      }
+    }
+  }
+}
+
+bool ImplicitPolygonizer::FindCellVertex(const glm::ivec3& cell, GLuint& index,
+                                         glm::vec3& position) const
+{
+  const int B = kBlockSize;
+  int id = ((cell.z / B) * mNumBlocks.y + (cell.y / B)) * mNumBlocks.x + (cell.x / B);
+  if (mBlockIndex[id] < 0)
+  {
+    return false;
+  }
+
+  const Block& block = mBlocks[mBlockIndex[id]];
+  GLuint local = block.cells[((cell.z % B) * B + (cell.y % B)) * B + (cell.x % B)];
+  if (local == kNoVertex)
+  {
+    return false;
+  }
+
+  index = block.firstVertex + local;
+  position = glm::vec3(block.vertices[6*local], block.vertices[6*local + 1],
+                       block.vertices[6*local + 2]);
+  return true;
+}
+
+}  // namespace gloo.
@@ -0,0 +1,148 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include <glm/glm.hpp>
+
+#include "openGLHeader.h"
+#include "ray.h"
+#include "interval.h"
+#include "float8.h"
+
+//  +-------------------------------------------------+
+//  |  Polygonizes the surface f(x, y, z) = iso       |
+//  |  inside a box (dual contouring).                |
+//  |                                                 |
+//  |  The box is a grid of cells, grouped in blocks  |
+//  |  of kBlockSize^3 cells. Blocks where f can't    |
+//  |  reach the iso value (by interval arithmetic)   |
+//  |  are skipped. The others sample f at their      |
+//  |  corners in batches of 8 (Float8), on several   |
+//  |  threads, and put one vertex in every cell the  |
+//  |  surface crosses: the mean of the edge          |
+//  |  crossings, projected on the surface along the  |
+//  |  gradient. Each crossed edge gives a quad over  |
+//  |  its 4 cells - across block seams too, so the   |
+//  |  mesh is welded. Normals are the gradient of f. |
+//  |                                                 |
+//  |  f is negative inside. It is a functor whose    |
+//  |  operator() is a template, so the same code is  |
+//  |  run on Float8 and Interval:                    |
+//  |                                                 |
+//  |    struct Sphere                                |
+//  |    {                                            |
+//  |      template <typename T>                      |
+//  |      T operator()(const T& x, const T& y,       |
+//  |                   const T& z) const             |
+//  |      { return sqrt(x*x + y*y + z*z) - 1.0f; }   |
+//  |    };                                           |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class ImplicitPolygonizer
+{
+public:
+  struct Params
+  {
+    AABB bounds { glm::vec3(-1.0f), glm::vec3(1.0f) };
+    float cellSize { 1.0f / 64 };
+    float isoValue { 0.0f };
+  };
+
+  struct Stats
+  {
+    int numBlocks  { 0 };  // Blocks in the grid.
+    int numActive  { 0 };  // Blocks polygonized (the others were skipped).
+    long long numEvaluations { 0 };  // Points where f was evaluated.
+  };
+
+  typedef std::function<Float8 (const Float8& x, const Float8& y, const Float8& z)> BatchFunc;
+  typedef std::function<Interval (const Interval& x, const Interval& y, const Interval& z)> IntervalFunc;
+
+  ImplicitPolygonizer() { }
+
+  template <typename Field>
+  void Polygonize(const Field& field, const Params& params);
+
+  // Same, with the field given for each number type (intervalFunc may be empty: no skipping).
+  void Polygonize(const BatchFunc& batchFunc, const IntervalFunc& intervalFunc,
+                  const Params& params);
+
+  // Output: interleaved (x, y, z, nx, ny, nz) vertices and triangle indices.
+  inline const std::vector<GLfloat>& GetVertices() const { return mVertices; }
+  inline const std::vector<GLuint>&  GetIndices()  const { return mIndices;  }
+  inline int GetNumVertices()  const { return static_cast<int>(mVertices.size() / 6); }
+  inline int GetNumTriangles() const { return static_cast<int>(mIndices.size() / 3); }
+  inline const Stats& GetStats() const { return mStats; }
+
+  static const int kBlockSize = 16;  // Cells per block side.
+
+private:
+  struct Block
+  {
+    int x, y, z;                   // Block coordinates.
+    std::vector<float> values;     // f at the (kBlockSize + 1)^3 corners.
+    std::vector<GLuint> cells;     // Vertex of each cell (local index), or kNoVertex.
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint> indices;
+    GLuint firstVertex { 0 };
+  };
+
+  void SampleBlock(Block& block) const;
+  void PlaceVertices(Block& block) const;
+  void ConnectVertices(Block& block) const;
+
+  // Global index and position of the vertex of a cell (false if the cell has none).
+  bool FindCellVertex(const glm::ivec3& cell, GLuint& index, glm::vec3& position) const;
+
+  inline glm::vec3 Corner(int x, int y, int z) const
+  {
+    return mOrigin + mCellSize * glm::vec3(x, y, z);
+  }
+
+  static const GLuint kNoVertex = 0xFFFFFFFF;
+
+  const BatchFunc* mField { nullptr };
+  float mIsoValue { 0.0f };
+  glm::vec3 mOrigin;
+  float mCellSize { 1.0f };
+  glm::ivec3 mNumCells;
+  glm::ivec3 mNumBlocks;
+
+  std::vector<Block> mBlocks;       // Active blocks.
+  std::vector<int> mBlockIndex;     // Block coordinates to mBlocks index, or -1 (skipped).
+
+  std::vector<GLfloat> mVertices;
+  std::vector<GLuint> mIndices;
+  Stats mStats;
+};
+
+// ================= Templates ================= //
+
+template <typename Field>
+void ImplicitPolygonizer::Polygonize(const Field& field, const Params& params)
+{
+  BatchFunc batchFunc = [&field](const Float8& x, const Float8& y, const Float8& z)
+  {
+    return field(x, y, z);
+  };
+
+  IntervalFunc intervalFunc = [&field](const Interval& x, const Interval& y, const Interval& z)
+  {
+    return field(x, y, z);
+  };
+
+  ImplicitPolygonizer::Polygonize(batchFunc, intervalFunc, params);
+}
+
+}  // namespace gloo.
@@ -0,0 +1,139 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+
+//  +-------------------------------------------------+
+//  |  Interval arithmetic: an Interval holds every   |
+//  |  value an expression can take while its inputs  |
+//  |  range over their intervals (conservatively -   |
+//  |  the bounds may be wider than the true range).  |
+//  |                                                 |
+//  |  Evaluating an implicit field on the intervals  |
+//  |  of a box tells whether the box may contain the |
+//  |  surface: if 0 is outside the result, it can't. |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+struct Interval
+{
+  Interval() { }
+  Interval(float value) : lo(value), hi(value) { }  // Constant.
+  Interval(float lo_, float hi_) : lo(lo_), hi(hi_) { }
+
+  inline bool Contains(float value) const { return (lo <= value && value <= hi); }
+
+  float lo { 0.0f };
+  float hi { 0.0f };
+};
+
+// ================= Arithmetic ================= //
+
+inline Interval operator+(const Interval& a, const Interval& b) { return Interval(a.lo + b.lo, a.hi + b.hi); }
+inline Interval operator-(const Interval& a, const Interval& b) { return Interval(a.lo - b.hi, a.hi - b.lo); }
+inline Interval operator-(const Interval& a) { return Interval(-a.hi, -a.lo); }
+
+inline Interval operator*(const Interval& a, const Interval& b)
+{
+  float p0 = a.lo * b.lo, p1 = a.lo * b.hi, p2 = a.hi * b.lo, p3 = a.hi * b.hi;
+  return Interval(std::min(std::min(p0, p1), std::min(p2, p3)),
+                  std::max(std::max(p0, p1), std::max(p2, p3)));
+}
+
+// Division by an interval containing 0 is unbounded.
+inline Interval operator/(const Interval& a, const Interval& b)
+{
+  if (b.Contains(0.0f))
+  {
+    return Interval(-INFINITY, INFINITY);
+  }
+  return a * Interval(1.0f / b.hi, 1.0f / b.lo);
+}
+
+inline Interval operator+(const Interval& a, float b) { return Interval(a.lo + b, a.hi + b); }
+inline Interval operator+(float a, const Interval& b) { return Interval(a + b.lo, a + b.hi); }
+inline Interval operator-(const Interval& a, float b) { return Interval(a.lo - b, a.hi - b); }
+inline Interval operator-(float a, const Interval& b) { return Interval(a - b.hi, a - b.lo); }
+
+inline Interval operator*(const Interval& a, float b)
+{
+  return (b >= 0.0f) ? Interval(a.lo * b, a.hi * b) : Interval(a.hi * b, a.lo * b);
+}
+
+inline Interval operator*(float a, const Interval& b) { return b * a; }
+inline Interval operator/(const Interval& a, float b) { return a * (1.0f / b); }
+inline Interval operator/(float a, const Interval& b) { return Interval(a) / b; }
+
+inline Interval& operator+=(Interval& a, const Interval& b) { return (a = a + b); }
+inline Interval& operator-=(Interval& a, const Interval& b) { return (a = a - b); }
+inline Interval& operator*=(Interval& a, const Interval& b) { return (a = a * b); }
+
+// ================= Functions ================= //
+
+inline Interval fabs(const Interval& a)
+{
+  if (a.lo >= 0.0f) return a;
+  if (a.hi <= 0.0f) return -a;
+  return Interval(0.0f, std::max(-a.lo, a.hi));
+}
+
+inline Interval abs(const Interval& a) { return fabs(a); }
+
+// Tighter than a * a (both factors take the same value).
+inline Interval square(const Interval& a)
+{
+  Interval b = fabs(a);
+  return Interval(b.lo * b.lo, b.hi * b.hi);
+}
+
+inline Interval sqrt(const Interval& a)
+{
+  return Interval(std::sqrt(std::max(a.lo, 0.0f)), std::sqrt(std::max(a.hi, 0.0f)));
+}
+
+inline Interval exp(const Interval& a) { return Interval(std::exp(a.lo), std::exp(a.hi)); }
+
+inline Interval min(const Interval& a, const Interval& b)
+{
+  return Interval(std::min(a.lo, b.lo), std::min(a.hi, b.hi));
+}
+
+inline Interval max(const Interval& a, const Interval& b)
+{
+  return Interval(std::max(a.lo, b.lo), std::max(a.hi, b.hi));
+}
+
+// cos over [lo, hi]: the end values, plus 1 (-1) if a multiple of 2 pi (pi + 2 k pi) is inside.
+inline Interval cos(const Interval& a)
+{
+  const float kTwoPi = 6.28318531f;
+  if (a.hi - a.lo >= kTwoPi)
+  {
+    return Interval(-1.0f, 1.0f);
+  }
+
+  float c0 = std::cos(a.lo), c1 = std::cos(a.hi);
+  Interval result(std::min(c0, c1), std::max(c0, c1));
+  if (std::ceil(a.lo / kTwoPi) <= std::floor(a.hi / kTwoPi))
+  {
+    result.hi = 1.0f;
+  }
+  if (std::ceil(a.lo / kTwoPi - 0.5f) <= std::floor(a.hi / kTwoPi - 0.5f))
+  {
+    result.lo = -1.0f;
+  }
+  return result;
+}
+
+inline Interval sin(const Interval& a) { return cos(a - 1.57079633f); }
+
+}  // namespace gloo.
@@ -4,6 +4,11 @@ namespace gloo
 {
 
 void Light::Position(OpenGLMatrix& viewMatrix, int id) 
+{
+  Light::Position(viewMatrix, id, mProgramHandle);
+}
+
+void Light::Position(OpenGLMatrix& viewMatrix, int id, GLuint programHandle)
 {
   // In order to compute specular component, the light position
   // and fragment position are in camera coordinates.
@@ -20,23 +25,23 @@ void Light::Position(OpenGLMatrix& viewMatrix, int id)
   GLuint location;
 
   // Postion.
-  location = glGetUniformLocation(mProgramHandle, std::string("light[" + std::to_string(id) + "].position").c_str());
+  location = glGetUniformLocation(programHandle, std::string("light[" + std::to_string(id) + "].position").c_str());
   glUniform3f(location, p[0], p[1], p[2]);
 
   // Normal (orientation).
-  location = glGetUniformLocation(mProgramHandle, std::string("light[" + std::to_string(id) + "].normal").c_str());
+  location = glGetUniformLocation(programHandle, std::string("light[" + std::to_string(id) + "].normal").c_str());
   glUniform3f(location, n[0], n[1], n[2]);
 
   // Ambient component.
-  location = glGetUniformLocation(mProgramHandle, std::string("light[" + std::to_string(id) + "].La").c_str());
+  location = glGetUniformLocation(programHandle, std::string("light[" + std::to_string(id) + "].La").c_str());
   glUniform1f(location, mLa);
 
   // Specular component.
-  location = glGetUniformLocation(mProgramHandle, std::string("light[" + std::to_string(id) + "].Ld").c_str());
+  location = glGetUniformLocation(programHandle, std::string("light[" + std::to_string(id) + "].Ld").c_str());
   glUniform1f(location, mLd);
 
   // Specular component.
-  location = glGetUniformLocation(mProgramHandle, std::string("light[" + std::to_string(id) + "].Ls").c_str());
+  location = glGetUniformLocation(programHandle, std::string("light[" + std::to_string(id) + "].Ls").c_str());
   glUniform1f(location, mLs);
 }
 
@@ -28,6 +28,9 @@ public:
   // Sets the light in the environment in camera coordinates (sends to shader uniform).
   void Position(OpenGLMatrix& viewMatrix, int id);
 
+  // Same, on another program with the same light uniforms (it must be bound).
+  void Position(OpenGLMatrix& viewMatrix, int id, GLuint programHandle);
+
   // Updates (for an animation).
   void Animate();
 
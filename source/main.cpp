@@ -7,6 +7,11 @@
 
 #include "sample_program.h"
 #include "utilities.h"
+#include "tiled_heightmap.h"
+#include "terrain_generator.h"
+
+#include <cstdlib>
+#include <cstring>
 
 GlutProgram* program = nullptr;
 
@@ -49,6 +54,33 @@ void KeyboardFunc(unsigned char key, int x, int y)
 
 int main(int argc, char *argv[])
 {
+  // Offline conversion to the streamed terrain format: --convert-heightmap <input> <output.gth>
+  if (argc == 4 && std::strcmp(argv[1], "--convert-heightmap") == 0)
+  {
+    return gloo::TiledHeightmap::Convert(argv[2], argv[3]) ? 0 : 1;
+  }
+
+  // Procedural terrain (eroded ridged noise), straight to the streamed format:
+  // --generate-terrain <size> <output.gth>
+  if (argc == 4 && std::strcmp(argv[1], "--generate-terrain") == 0)
+  {
+    int size = std::atoi(argv[2]);
+    gloo::TerrainGenerator::Params params;
+    params.type = gloo::TerrainGenerator::kRidged;
+    params.frequency = 2.0f / size;
+    params.octaves = 10;
+    params.gain = 0.45f;
+    params.thermalIterations = 8;
+    params.droplets = 0.25f;
+
+    gloo::Heightmap heightmap;
+    if (!gloo::TerrainGenerator::Generate(size, size, params, heightmap))
+    {
+      return 1;
+    }
+    return gloo::TiledHeightmap::Convert(heightmap, argv[3]) ? 0 : 1;
+  }
+
   program = new SampleProgram();
   program->Init(&argc, argv, "Sample gl-oo-interface program");
 
@@ -1,25 +1,58 @@
 #include "mesh.h"
+#include "bvh.h"
+#include "vertex_index.h"
 
 #include <fstream>
 #include <sstream>
 #include <cstdio>
+#include <algorithm>
 
 namespace gloo
 {
 
 void Mesh::Render() const
+{
+  if (IsInitialized()) 
+  {
+    Mesh::Bind();
+    Mesh::Draw();
+  }
+}
+
+void Mesh::Bind() const
+{
+  glBindVertexArray(mVao);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEab);
+}
+
+void Mesh::Draw() const
+{
+  glDrawElements(
+   mDrawMode,         // mode.
+   mNumIndices,       // number of vertices.
+   GL_UNSIGNED_INT,   // type.
+   (void*)0           // element array buffer offset.
+  );
+}
+
+void Mesh::RenderRange(int firstIndex, int numIndices) const
 {
   if (IsInitialized()) 
   {
     glBindVertexArray(mVao);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEab);
+    glDrawElements(mDrawMode, numIndices, GL_UNSIGNED_INT, (void*)(sizeof(GLuint) * firstIndex));
+  }
+}
 
-    glDrawElements(
-     mDrawMode,         // mode.
-     mNumIndices,       // number of vertices.
-     GL_UNSIGNED_INT,   // type.
-     (void*)0           // element array buffer offset.
-    );
+void Mesh::RenderRanges(const GLsizei* numIndices, const GLvoid* const* offsets, 
+                        int numRanges) const
+{
+  if (IsInitialized() && numRanges > 0) 
+  {
+    glBindVertexArray(mVao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEab);
+    glMultiDrawElements(mDrawMode, numIndices, GL_UNSIGNED_INT, offsets, numRanges);
   }
 }
 
@@ -113,6 +146,7 @@ bool Mesh::Load(const GLfloat* positions,
   }
 
   mInitialized = true;
+  Mesh::InvalidateBVH();
   Mesh::Upload();
   return true;
 }
@@ -158,6 +192,7 @@ bool Mesh::Load(const GLfloat* vertices, const GLuint* indices,
   }
 
   mInitialized = true;
+  Mesh::InvalidateBVH();
   Mesh::Upload();
   return true;
 }
@@ -227,6 +262,11 @@ void Mesh::Reload(const GLfloat* positions,
     }
   }
 
+  if (positions)
+  {
+    Mesh::MarkPositionsDirty();
+  }
+
   Mesh::Upload();
 }
 
@@ -236,6 +276,7 @@ void Mesh::Reload(const GLfloat* vertices)
   if (vertices)
   {
     memcpy(mVertices, vertices, sizeof(GLfloat) * mVertexSize * mNumVertices);
+    Mesh::MarkPositionsDirty();
     Mesh::Upload();
   }
 }
@@ -361,6 +402,188 @@ void Mesh::Update()
   glBufferData(GL_ARRAY_BUFFER, mVertexSize * mNumVertices * sizeof(GLfloat), mVertices, GL_STATIC_DRAW);
 }
 
+const BVH* Mesh::GetBVH() const
+{
+  if (!mInitialized)
+  {
+    return nullptr;
+  }
+
+  if (!mBVH)
+  {
+    mBVH = new DynamicBVH();
+  }
+
+  mBVH->Update(*this, mPositionsRevision);
+  return mBVH->Get();
+}
+
+void Mesh::ReloadIndices(const GLuint* indices, int numIndices, GLenum drawMode)
+{
+  if (numIndices != mNumIndices)
+  {
+    delete [] mIndices;
+    mIndices = new GLuint [numIndices];
+    mNumIndices = numIndices;
+  }
+  std::copy(indices, indices + numIndices, mIndices);
+  mDrawMode = drawMode;
+
+  // Triangle ids changed.
+  Mesh::InvalidateBVH();
+
+  if (mEab != 0)
+  {
+    glBindVertexArray(mVao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEab);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mNumIndices * sizeof(GLuint), mIndices, GL_STATIC_DRAW);
+  }
+}
+
+void Mesh::InvalidateBVH()
+{
+  delete mBVH;
+  mBVH = nullptr;
+
+  delete mVertexIndex;
+  mVertexIndex = nullptr;
+}
+
+void Mesh::MarkPositionsDirty()
+{
+  mPositionsRevision++;
+}
+
+const VertexIndex* Mesh::GetVertexIndex() const
+{
+  if (!mInitialized)
+  {
+    return nullptr;
+  }
+
+  if (!mVertexIndex)
+  {
+    mVertexIndex = new VertexIndex();
+    mVertexIndex->Build(*this);
+  }
+  else if (mVertexIndexRevision != mPositionsRevision)
+  {
+    mVertexIndex->Refit(*this);
+  }
+
+  mVertexIndexRevision = mPositionsRevision;
+  return mVertexIndex;
+}
+
+void Mesh::SetPosition(int index, const glm::vec3& position)
+{
+  GLfloat* p = (mStorageType == kTightlyPacked) ? Mesh::PositionAt(index) 
+                                                : Mesh::SBPositionAt(index);
+  p[0] = position[0];
+  p[1] = position[1];
+  p[2] = position[2];
+
+  // Incremental update if the index was up to date, otherwise it is refit on next use.
+  bool indexUpToDate = (mVertexIndex && mVertexIndexRevision == mPositionsRevision);
+  Mesh::MarkPositionsDirty();
+
+  if (indexUpToDate)
+  {
+    mVertexIndex->Update(index, position);
+    mVertexIndexRevision = mPositionsRevision;
+  }
+}
+
+void Mesh::UpdateVertices(int first, int count)
+{
+  first = std::max(first, 0);
+  count = std::min(count, mNumVertices - first);
+  if (count <= 0)
+  {
+    return;
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, mVbo);
+
+  if (mStorageType == kTightlyPacked)  // A single contiguous range.
+  {
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(GLfloat) * mVertexSize * first, 
+                    sizeof(GLfloat) * mVertexSize * count, &mVertices[mVertexSize * first]);
+  }
+  else  // One range per attribute sub buffer.
+  {
+    const int sizes[] = { 3, 3*mHasColors, 3*mHasNormals, 2*mHasTexCoord };
+    int offset = 0;
+
+    for (int size : sizes)
+    {
+      if (size > 0)
+      {
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(GLfloat) * (offset + size * first),
+                        sizeof(GLfloat) * size * count, &mVertices[offset + size * first]);
+      }
+      offset += size * mNumVertices;
+    }
+  }
+}
+
+int Mesh::GetTriangles(std::vector<GLuint>& triangles) const
+{
+  triangles.clear();
+
+  if (!mInitialized || mIndices == nullptr)
+  {
+    return 0;
+  }
+
+  auto addTriangle = [&triangles](GLuint i0, GLuint i1, GLuint i2)
+  {
+    // Repeated indices are used to stitch strips together - they don't produce any fragment.
+    if (i0 != i1 && i1 != i2 && i0 != i2)
+    {
+      triangles.push_back(i0);
+      triangles.push_back(i1);
+      triangles.push_back(i2);
+    }
+  };
+
+  switch (mDrawMode)
+  {
+    case GL_TRIANGLES:
+      triangles.reserve(mNumIndices);
+      for (int i = 0; i + 2 < mNumIndices; i += 3)
+      {
+        addTriangle(mIndices[i], mIndices[i+1], mIndices[i+2]);
+      }
+    break;
+
+    case GL_TRIANGLE_STRIP:
+      triangles.reserve(3 * mNumIndices);
+      for (int i = 0; i + 2 < mNumIndices; i++)
+      {
+        // Odd triangles have their winding flipped.
+        if (i % 2 == 0)
+          addTriangle(mIndices[i], mIndices[i+1], mIndices[i+2]);
+        else
+          addTriangle(mIndices[i+1], mIndices[i], mIndices[i+2]);
+      }
+    break;
+
+    case GL_TRIANGLE_FAN:
+      triangles.reserve(3 * mNumIndices);
+      for (int i = 1; i + 1 < mNumIndices; i++)
+      {
+        addTriangle(mIndices[0], mIndices[i], mIndices[i+1]);
+      }
+    break;
+
+    default:  // Lines and points have no surface.
+    break;
+  }
+
+  return triangles.size() / 3;
+}
+
 // ============================================================================================= //
 
 Mesh::~Mesh()
@@ -374,6 +597,8 @@ Mesh::~Mesh()
 
   delete [] mVertices;
   delete [] mIndices;
+  delete mBVH;
+  delete mVertexIndex;
 }
 
 } // namespace gloo.
\ No newline at end of file
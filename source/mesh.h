@@ -39,6 +39,10 @@
 namespace gloo 
 {
 
+class BVH;
+class DynamicBVH;
+class VertexIndex;
+
 class Mesh
 {
 public:
@@ -55,6 +59,16 @@ public:
 
   // TODO: COMMENT!!
   void Render() const;   // Renders the geometry at the current origin.
+  void RenderRange(int firstIndex, int numIndices) const;  // Renders a range of the element array.
+
+  // Renders several ranges of the element array in one call (glMultiDrawElements). offsets are
+  // in bytes into the element array.
+  void RenderRanges(const GLsizei* numIndices, const GLvoid* const* offsets, int numRanges) const;
+
+  // Render() split in two, so that consecutive draws of the same mesh bind it once
+  // (see RenderState). Draw() assumes the mesh is bound.
+  void Bind() const;
+  void Draw() const;
 
   // Loads from different buffers - not provided data array must be set as nullptr.
   // positions must be non-null. 
@@ -113,6 +127,38 @@ public:
   inline int GetNumVertices() const { return mNumVertices; }
   inline int GetNumIndices()  const { return mNumIndices;  }
   inline int GetVertexSize()  const { return mVertexSize;  } 
+  inline GLenum GetDrawMode() const { return mDrawMode;    }
+  inline const GLuint* GetIndices() const { return mIndices; }
+
+  // Reads vertex[index] 3D position regardless of the storage type.
+  glm::vec3 GetPosition(int index) const;
+
+  // Converts the element array into a triangle list { i0, i1, i2, ... }.
+  // Strips and fans are unrolled and degenerate triangles are skipped.
+  // Returns the number of triangles (0 for lines and points).
+  int GetTriangles(std::vector<GLuint>& triangles) const;
+
+  // Acceleration structure for ray queries over the triangles - built on first use and
+  // refit (or rebuilt in background) after positions change. 
+  // Returns nullptr if the mesh has no triangles.
+  const BVH* GetBVH() const;
+  void InvalidateBVH();       // Drops the BVH and the vertex index - the topology changed.
+  void MarkPositionsDirty();  // Must be called after editing positions through PositionAt/SBPositionAt.
+
+  // Spatial index over the vertices (edit mode picking/snapping) - built on first use and
+  // refit after positions change. Returns nullptr if the mesh isn't initialized.
+  const VertexIndex* GetVertexIndex() const;
+
+  // Moves vertex[index] (any storage type), keeping the vertex index up to date in O(log n).
+  // Call UpdateVertices to send the change to the graphics card.
+  void SetPosition(int index, const glm::vec3& position);
+
+  // Resends vertices [first, first + count) to the graphics card (glBufferSubData).
+  void UpdateVertices(int first, int count);
+
+  // Replaces the element array (any size and draw mode) and resends it to the graphics card.
+  // Vertices are kept, e.g. to reorder or convert the triangles.
+  void ReloadIndices(const GLuint* indices, int numIndices, GLenum drawMode);
 
   inline void SetDrawMode(GLenum mode) { mDrawMode = mode; };
   inline void SetProgramHandle(GLuint programHandle) { mProgramHandle = programHandle; }
@@ -160,6 +206,14 @@ protected:
   GLuint mEab { 0 };
   GLuint mVao { 0 };  
   GLuint mVbo { 0 };
+
+  // Ray query acceleration structure (lazily built, refit when mPositionsRevision changes).
+  mutable DynamicBVH* mBVH { nullptr };
+  unsigned mPositionsRevision { 0 };
+
+  // Vertex index for edit mode (lazily built, updated by SetPosition).
+  mutable VertexIndex* mVertexIndex { nullptr };
+  mutable unsigned mVertexIndexRevision { 0 };
 }; // Mesh.
 
 /* Tightly packed access to vertices array */
@@ -194,6 +248,14 @@ GLuint* Mesh::IndexAt(int index)
   return &mIndices[index];
 }
 
+inline
+glm::vec3 Mesh::GetPosition(int index) const
+{
+  const GLfloat* position = (mStorageType == kTightlyPacked) ? &mVertices[mVertexSize * index] 
+                                                             : &mVertices[3 * index];
+  return glm::vec3(position[0], position[1], position[2]);
+}
+
 /* Sub-buffered access to vertices array */
 
 inline 
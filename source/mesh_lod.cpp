@@ -0,0 +1,194 @@
+#include "mesh_lod.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace gloo
+{
+
+namespace
+{
+
+// Going coarser needs the projected error this much below the limit.
+const float kHysteresis = 0.25f;
+
+// A level must drop at least this fraction of the triangles of the previous one.
+const float kMinReduction = 0.1f;
+
+}  // namespace.
+
+void MeshLOD::Prepare(Mesh* mesh, const Params& params)
+{
+  MeshLOD::Clear();
+
+  mLevels.emplace_back();
+  mLevels[0].mesh = mesh;
+
+  std::vector<GLuint> triangles;
+  int numTriangles = mesh->GetTriangles(triangles);
+  mLevels[0].numTriangles = numTriangles;
+
+  int n = mesh->GetNumVertices();
+  if (numTriangles == 0 || n == 0)
+  {
+    return;
+  }
+
+  // Attributes as separate arrays, whatever the storage type.
+  bool packed = (mesh->GetStorageType() == Mesh::kTightlyPacked);
+  std::vector<GLfloat> positions(3 * n), colors, normals, texCoords;
+  if (mesh->HasColors())   colors.resize(3 * n);
+  if (mesh->HasNormals())  normals.resize(3 * n);
+  if (mesh->HasTexCoord()) texCoords.resize(2 * n);
+
+  glm::vec3 lo(1e30f), hi(-1e30f);
+  for (int i = 0; i < n; i++)
+  {
+    glm::vec3 p = mesh->GetPosition(i);
+    lo = glm::min(lo, p);
+    hi = glm::max(hi, p);
+    std::copy(&p[0], &p[0] + 3, &positions[3*i]);
+
+    if (!colors.empty())
+      std::copy_n(packed ? mesh->ColorAt(i) : mesh->SBColorAt(i), 3, &colors[3*i]);
+    if (!normals.empty())
+      std::copy_n(packed ? mesh->NormalAt(i) : mesh->SBNormalAt(i), 3, &normals[3*i]);
+    if (!texCoords.empty())
+      std::copy_n(packed ? mesh->TexCoordAt(i) : mesh->SBTexCoordAt(i), 2, &texCoords[2*i]);
+  }
+
+  mCenter = 0.5f * (lo + hi);
+  mRadius = 0.5f * glm::length(hi - lo);
+
+  MeshSimplifier simplifier;
+  simplifier.SetMesh(&positions[0], colors.empty() ? nullptr : &colors[0],
+                     normals.empty() ? nullptr : &normals[0],
+                     texCoords.empty() ? nullptr : &texCoords[0], n, &triangles[0], numTriangles);
+
+  std::vector<int> remap(n);
+  for (int level = 1; level < params.maxLevels; level++)
+  {
+    int previous = mLevels.back().numTriangles;
+    int target = static_cast<int>(params.ratio * previous);
+    if (target < params.minTriangles)
+      break;
+
+    float error = simplifier.Simplify(target);
+    if (simplifier.GetNumTriangles() > (1.0f - kMinReduction) * previous)
+      break;  // Stuck (locked seams, boundaries, ...).
+
+    mLevels.emplace_back();
+    Level& current = mLevels.back();
+    current.error = error;
+    current.numTriangles = simplifier.GetNumTriangles();
+    simplifier.GetTriangles(current.indices);
+
+    // Only the vertices still in use.
+    std::fill(remap.begin(), remap.end(), -1);
+    int numUsed = 0;
+    for (GLuint& index : current.indices)
+    {
+      if (remap[index] < 0)
+      {
+        remap[index] = numUsed++;
+        current.positions.insert(current.positions.end(), &positions[3*index], &positions[3*index] + 3);
+        if (!colors.empty())
+          current.colors.insert(current.colors.end(), &colors[3*index], &colors[3*index] + 3);
+        if (!normals.empty())
+          current.normals.insert(current.normals.end(), &normals[3*index], &normals[3*index] + 3);
+        if (!texCoords.empty())
+          current.texCoords.insert(current.texCoords.end(), &texCoords[2*index], &texCoords[2*index] + 2);
+      }
+      index = remap[index];
+    }
+  }
+}
+
+void MeshLOD::Upload(GLuint programHandle)
+{
+  for (int level = 1; level < MeshLOD::GetNumLevels(); level++)
+  {
+    Level& current = mLevels[level];
+    if (current.mesh || current.positions.empty())
+      continue;
+
+    current.mesh = new Mesh(programHandle);
+    current.mesh->Load(&current.positions[0],
+                       current.colors.empty()    ? nullptr : &current.colors[0],
+                       current.normals.empty()   ? nullptr : &current.normals[0],
+                       current.texCoords.empty() ? nullptr : &current.texCoords[0],
+                       &current.indices[0], static_cast<int>(current.positions.size() / 3),
+                       static_cast<int>(current.indices.size()), GL_TRIANGLES,
+                       mLevels[0].mesh->GetStorageType());
+
+    // The mesh keeps its own copy.
+    std::vector<GLfloat>().swap(current.positions);
+    std::vector<GLfloat>().swap(current.colors);
+    std::vector<GLfloat>().swap(current.normals);
+    std::vector<GLfloat>().swap(current.texCoords);
+    std::vector<GLuint>().swap(current.indices);
+  }
+}
+
+int MeshLOD::SelectLevel(const glm::mat4& modelView, float pixelsPerUnit, float maxPixelError) const
+{
+  int numLevels = MeshLOD::GetNumLevels();
+  if (numLevels <= 1)
+  {
+    return 0;
+  }
+
+  // Model to view scale (the view is rigid), and the distance to the bounding sphere.
+  float scale = std::max(glm::length(glm::vec3(modelView[0])),
+                         std::max(glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))));
+  glm::vec3 center = glm::vec3(modelView * glm::vec4(mCenter, 1.0f));
+  float distance = glm::length(center) - scale * mRadius;
+  if (distance <= 0.0f)
+  {
+    mCurrentLevel = 0;
+    return 0;
+  }
+
+  float pixelsPerError = scale * pixelsPerUnit / distance;
+
+  // Coarsest levels within the limit, and within the limit minus the margin.
+  int fine = 0, coarse = 0;
+  for (int level = 1; level < numLevels; level++)
+  {
+    if (!mLevels[level].mesh)
+      break;
+
+    float pixels = mLevels[level].error * pixelsPerError;
+    fine   = (pixels <= maxPixelError) ? level : fine;
+    coarse = (pixels <= (1.0f - kHysteresis) * maxPixelError) ? level : coarse;
+  }
+
+  if (mCurrentLevel > fine)
+  {
+    mCurrentLevel = fine;
+  }
+  else if (coarse > mCurrentLevel)
+  {
+    mCurrentLevel = coarse;
+  }
+
+  return mCurrentLevel;
+}
+
+void MeshLOD::Clear()
+{
+  for (int level = 1; level < MeshLOD::GetNumLevels(); level++)
+  {
+    delete mLevels[level].mesh;
+  }
+
+  mLevels.clear();
+  mCurrentLevel = 0;
+}
+
+MeshLOD::~MeshLOD()
+{
+  MeshLOD::Clear();
+}
+
+}  // namespace gloo.
@@ -0,0 +1,91 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "mesh.h"
+#include "mesh_simplifier.h"
+
+//  +-------------------------------------------------+
+//  |  Chain of simplified versions of a triangle     |
+//  |  mesh (levels of detail).                       |
+//  |                                                 |
+//  |  Level 0 is the mesh itself. Each next level    |
+//  |  has about ratio times its triangles (see       |
+//  |  MeshSimplifier) and knows how far it deviates  |
+//  |  from the original. Every frame, the coarsest   |
+//  |  level whose deviation projects to less than a  |
+//  |  pixel error is drawn. Going coarser needs some |
+//  |  margin below that error (hysteresis), so a     |
+//  |  model sitting at a threshold doesn't pop back  |
+//  |  and forth.                                     |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class MeshLOD
+{
+public:
+  struct Params
+  {
+    int maxLevels { 5 };       // Including the original.
+    float ratio { 0.5f };      // Triangles of a level over the previous one.
+    int minTriangles { 64 };   // No levels below this.
+  };
+
+  MeshLOD() { }
+
+  // Simplifies the triangles of mesh (CPU only, so meshes can be prepared on several threads).
+  // The mesh must outlive the chain and isn't owned.
+  void Prepare(Mesh* mesh, const Params& params);
+
+  // Creates the meshes of the prepared levels (GL thread).
+  void Upload(GLuint programHandle);
+
+  inline void Build(Mesh* mesh, const Params& params, GLuint programHandle)
+  {
+    MeshLOD::Prepare(mesh, params);
+    MeshLOD::Upload(programHandle);
+  }
+
+  // Level to draw with the given model view matrix. pixelsPerUnit is the size in pixels of one
+  // unit at distance 1 in front of the camera (viewport height * P[1][1] / 2).
+  int SelectLevel(const glm::mat4& modelView, float pixelsPerUnit, float maxPixelError) const;
+
+  inline int GetNumLevels() const { return static_cast<int>(mLevels.size()); }
+  inline Mesh* GetLevel(int level) const { return mLevels[level].mesh; }
+  inline float GetError(int level) const { return mLevels[level].error; }
+  inline int GetNumTriangles(int level) const { return mLevels[level].numTriangles; }
+  inline int GetCurrentLevel() const { return mCurrentLevel; }
+
+  ~MeshLOD();
+
+private:
+  struct Level
+  {
+    Mesh* mesh { nullptr };  // Owned, except for level 0.
+    float error { 0.0f };    // Model units.
+    int numTriangles { 0 };
+
+    // Compacted vertices and triangles, until uploaded.
+    std::vector<GLfloat> positions, colors, normals, texCoords;
+    std::vector<GLuint> indices;
+  };
+
+  void Clear();
+
+  std::vector<Level> mLevels;
+  glm::vec3 mCenter;      // Bounding sphere of the mesh (model space).
+  float mRadius { 0.0f };
+
+  mutable int mCurrentLevel { 0 };
+};
+
+}  // namespace gloo.
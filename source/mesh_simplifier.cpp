@@ -0,0 +1,559 @@
+#include "mesh_simplifier.h"
+
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+
+namespace gloo
+{
+
+namespace
+{
+
+// Weight of the planes that keep boundaries and seams in place (relative to area).
+const double kBoundaryWeight = 10.0;
+
+// A collapse can't turn a triangle by more than ~75 degrees.
+const double kMinFlipCos = 0.25;
+
+// Orders vertices lexicographically by count floats starting at stride * vertex.
+struct AttributeLess
+{
+  const GLfloat* data;
+  int stride, count;
+
+  bool operator()(GLuint a, GLuint b) const
+  {
+    const GLfloat* pa = data + stride * a;
+    const GLfloat* pb = data + stride * b;
+    return std::lexicographical_compare(pa, pa + count, pb, pb + count);
+  }
+
+  bool Equal(GLuint a, GLuint b) const
+  {
+    return std::equal(data + stride * a, data + stride * a + count, data + stride * b);
+  }
+};
+
+void Neighbors(const std::vector<GLuint>& triangles, const std::vector<int>& around,
+               const std::vector<int>& positionIndex, int p, std::vector<int>& neighbors)
+{
+  neighbors.clear();
+  for (int t : around)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      int q = positionIndex[triangles[3*t + k]];
+      if (q != p)
+        neighbors.push_back(q);
+    }
+  }
+
+  std::sort(neighbors.begin(), neighbors.end());
+  neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+}
+
+}  // namespace.
+
+// ================= Quadrics ================= //
+
+void MeshSimplifier::Quadric::AddPlane(const glm::dvec3& n, double d, double w)
+{
+  a[0] += w * n.x * n.x;  a[1] += w * n.x * n.y;  a[2] += w * n.x * n.z;  a[3] += w * n.x * d;
+  a[4] += w * n.y * n.y;  a[5] += w * n.y * n.z;  a[6] += w * n.y * d;
+  a[7] += w * n.z * n.z;  a[8] += w * n.z * d;
+  a[9] += w * d * d;
+}
+
+void MeshSimplifier::Quadric::Add(const Quadric& q)
+{
+  for (int k = 0; k < 10; k++)
+    a[k] += q.a[k];
+  weight += q.weight;
+}
+
+double MeshSimplifier::Quadric::Evaluate(const glm::dvec3& p) const
+{
+  return p.x * (a[0] * p.x + 2.0 * (a[1] * p.y + a[2] * p.z + a[3])) +
+         p.y * (a[4] * p.y + 2.0 * (a[5] * p.z + a[6])) +
+         p.z * (a[7] * p.z + 2.0 * a[8]) + a[9];
+}
+
+// ================= Setup ================= //
+
+void MeshSimplifier::SetMesh(const GLfloat* positions, const GLfloat* colors, const GLfloat* normals,
+                             const GLfloat* texCoords, int numVertices, const GLuint* triangles,
+                             int numTriangles)
+{
+  mError = 0.0f;
+  mHeap.clear();
+
+  // Weld vertices equal in every attribute (loaders often emit one vertex per corner).
+  std::vector<GLuint> order(numVertices);
+  std::iota(order.begin(), order.end(), 0);
+
+  AttributeLess attributes[4] = { { positions, 3, 3 }, { colors, 3, 3 }, { normals, 3, 3 },
+                                  { texCoords, 2, 2 } };
+  std::sort(order.begin(), order.end(), [&](GLuint a, GLuint b)
+  {
+    for (const AttributeLess& attribute : attributes)
+    {
+      if (!attribute.data)
+        continue;
+      if (attribute(a, b))
+        return true;
+      if (attribute(b, a))
+        return false;
+    }
+    return a < b;
+  });
+
+  mVertexIndex.assign(numVertices, 0);
+  mPositionIndex.assign(numVertices, -1);
+  mPoints.clear();
+
+  for (int k = 0; k < numVertices; k++)
+  {
+    GLuint v = order[k];
+    bool sameVertex = (k > 0);
+    bool samePosition = (k > 0) && attributes[0].Equal(v, order[k - 1]);
+    for (const AttributeLess& attribute : attributes)
+    {
+      sameVertex = sameVertex && (!attribute.data || attribute.Equal(v, order[k - 1]));
+    }
+
+    // Sorted by position first, so equal positions are consecutive.
+    mVertexIndex[v] = sameVertex ? mVertexIndex[order[k - 1]] : v;
+    if (!samePosition)
+    {
+      mPoints.push_back(glm::dvec3(positions[3*v], positions[3*v + 1], positions[3*v + 2]));
+    }
+    mPositionIndex[v] = static_cast<int>(mPoints.size()) - 1;
+  }
+
+  int numPoints = static_cast<int>(mPoints.size());
+  mQuadrics.assign(numPoints, Quadric());
+  mStamps.assign(numPoints, 0);
+  mKinds.assign(numPoints, kInterior);
+  mRemoved.assign(numPoints, 0);
+  mTrianglesAround.assign(numPoints, std::vector<int>());
+
+  // Triangles over welded vertices (degenerate ones are dropped).
+  mTriangles.clear();
+  mTriangles.reserve(3 * numTriangles);
+  for (int t = 0; t < numTriangles; t++)
+  {
+    GLuint v[3];
+    int p[3];
+    for (int k = 0; k < 3; k++)
+    {
+      v[k] = mVertexIndex[triangles[3*t + k]];
+      p[k] = MeshSimplifier::PositionOf(v[k]);
+    }
+
+    if (p[0] == p[1] || p[1] == p[2] || p[2] == p[0])
+      continue;
+
+    int id = static_cast<int>(mTriangles.size() / 3);
+    mTriangles.insert(mTriangles.end(), { v[0], v[1], v[2] });
+    for (int k = 0; k < 3; k++)
+    {
+      mTrianglesAround[p[k]].push_back(id);
+    }
+
+    // Triangle plane, weighted by area.
+    glm::dvec3 n = glm::cross(mPoints[p[1]] - mPoints[p[0]], mPoints[p[2]] - mPoints[p[0]]);
+    double length = glm::length(n);
+    if (length > 0.0)
+    {
+      n /= length;
+      for (int k = 0; k < 3; k++)
+      {
+        mQuadrics[p[k]].AddPlane(n, -glm::dot(n, mPoints[p[0]]), 0.5 * length);
+        mQuadrics[p[k]].weight += 0.5 * length;
+      }
+    }
+  }
+
+  mNumLiveTriangles = static_cast<int>(mTriangles.size() / 3);
+  mDeadTriangles.assign(mNumLiveTriangles, 0);
+
+  for (int p = 0; p < numPoints; p++)
+  {
+    MeshSimplifier::UpdateKind(p);
+  }
+
+  // Boundaries and seams keep their shape: planes through their edges, perpendicular to the
+  // triangle.
+  for (int t = 0; t < mNumLiveTriangles; t++)
+  {
+    int p[3];
+    for (int k = 0; k < 3; k++)
+      p[k] = MeshSimplifier::PositionOf(mTriangles[3*t + k]);
+
+    glm::dvec3 n = glm::cross(mPoints[p[1]] - mPoints[p[0]], mPoints[p[2]] - mPoints[p[0]]);
+    if (glm::dot(n, n) == 0.0)
+      continue;
+
+    for (int k = 0; k < 3; k++)
+    {
+      int a = p[k], b = p[(k + 1) % 3];
+      int count;
+      bool seam;
+      MeshSimplifier::ClassifyEdge(a, b, count, seam);
+      if (count != 1 && !seam)
+        continue;
+
+      glm::dvec3 edge = mPoints[b] - mPoints[a];
+      glm::dvec3 m = glm::cross(edge, n);
+      double length = glm::length(m);
+      if (length == 0.0)
+        continue;
+
+      m /= length;
+      double w = kBoundaryWeight * glm::dot(edge, edge);
+      mQuadrics[a].AddPlane(m, -glm::dot(m, mPoints[a]), w);
+      mQuadrics[b].AddPlane(m, -glm::dot(m, mPoints[a]), w);
+    }
+  }
+
+  for (int p = 0; p < numPoints; p++)
+  {
+    MeshSimplifier::PushCollapses(p);
+  }
+}
+
+// ================= Topology ================= //
+
+const std::vector<int>& MeshSimplifier::LiveTriangles(int p)
+{
+  std::vector<int>& around = mTrianglesAround[p];
+  around.erase(std::remove_if(around.begin(), around.end(), [this](int t)
+  {
+    return mDeadTriangles[t] != 0;
+  }), around.end());
+
+  return around;
+}
+
+void MeshSimplifier::ClassifyEdge(int p, int q, int& numTriangles, bool& seam)
+{
+  numTriangles = 0;
+  seam = false;
+
+  GLuint copyP = 0, copyQ = 0;
+  for (int t : MeshSimplifier::LiveTriangles(p))
+  {
+    GLuint vp = 0, vq = 0;
+    bool hasQ = false;
+    for (int k = 0; k < 3; k++)
+    {
+      GLuint v = mTriangles[3*t + k];
+      int position = MeshSimplifier::PositionOf(v);
+      if (position == p)
+        vp = v;
+      if (position == q)
+      {
+        vq = v;
+        hasQ = true;
+      }
+    }
+
+    if (!hasQ)
+      continue;
+
+    if (numTriangles > 0 && (vp != copyP || vq != copyQ))
+      seam = true;
+
+    copyP = vp;
+    copyQ = vq;
+    numTriangles++;
+  }
+}
+
+void MeshSimplifier::UpdateKind(int p)
+{
+  const std::vector<int>& around = MeshSimplifier::LiveTriangles(p);
+  if (around.empty())
+  {
+    mKinds[p] = kLocked;
+    return;
+  }
+
+  std::vector<GLuint> copies;
+  for (int t : around)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      if (MeshSimplifier::PositionOf(mTriangles[3*t + k]) == p)
+        copies.push_back(mTriangles[3*t + k]);
+    }
+  }
+  std::sort(copies.begin(), copies.end());
+  int numCopies = static_cast<int>(std::unique(copies.begin(), copies.end()) - copies.begin());
+
+  std::vector<int> neighbors;
+  Neighbors(mTriangles, around, mPositionIndex, p, neighbors);
+
+  int numBorders = 0, numSeams = 0;
+  for (int q : neighbors)
+  {
+    int count;
+    bool seam;
+    MeshSimplifier::ClassifyEdge(p, q, count, seam);
+    if (count > 2)
+    {
+      mKinds[p] = kLocked;  // Non-manifold.
+      return;
+    }
+
+    numBorders += (count == 1);
+    numSeams += seam;
+  }
+
+  if (numBorders == 0 && numSeams == 0 && numCopies == 1)
+    mKinds[p] = kInterior;
+  else if (numBorders == 2 && numSeams == 0 && numCopies == 1)
+    mKinds[p] = kBorder;
+  else if (numBorders == 0 && numSeams == 2 && numCopies == 2)
+    mKinds[p] = kSeam;
+  else
+    mKinds[p] = kLocked;  // Corners, seams meeting boundaries or each other, ...
+}
+
+// ================= Collapses ================= //
+
+bool MeshSimplifier::CanCollapse(int from, int to)
+{
+  if (mRemoved[from] || mRemoved[to] || mKinds[from] == kLocked)
+  {
+    return false;
+  }
+
+  int count;
+  bool seam;
+  MeshSimplifier::ClassifyEdge(from, to, count, seam);
+
+  // Boundary and seam vertices only slide along their own edges.
+  bool allowed = (mKinds[from] == kInterior && count == 2 && !seam) ||
+                 (mKinds[from] == kBorder && count == 1) ||
+                 (mKinds[from] == kSeam && count == 2 && seam);
+  if (!allowed)
+  {
+    return false;
+  }
+
+  // Link condition: the two vertices share exactly the neighbors across their triangles,
+  // otherwise the collapse pinches the surface.
+  std::vector<int> neighborsFrom, neighborsTo, common;
+  Neighbors(mTriangles, MeshSimplifier::LiveTriangles(from), mPositionIndex, from, neighborsFrom);
+  Neighbors(mTriangles, MeshSimplifier::LiveTriangles(to), mPositionIndex, to, neighborsTo);
+  std::set_intersection(neighborsFrom.begin(), neighborsFrom.end(), neighborsTo.begin(),
+                        neighborsTo.end(), std::back_inserter(common));
+  if (static_cast<int>(common.size()) != count)
+  {
+    return false;
+  }
+
+  // No flipped (or collapsed) triangles, and every copy of from has a copy of to to go to.
+  for (int t : mTrianglesAround[from])
+  {
+    int p[3];
+    int corner = 0;
+    bool hasTo = false;
+    for (int k = 0; k < 3; k++)
+    {
+      p[k] = MeshSimplifier::PositionOf(mTriangles[3*t + k]);
+      corner = (p[k] == from) ? k : corner;
+      hasTo = hasTo || (p[k] == to);
+    }
+
+    if (hasTo)
+      continue;
+
+    const glm::dvec3& a = mPoints[p[(corner + 1) % 3]];
+    const glm::dvec3& b = mPoints[p[(corner + 2) % 3]];
+    glm::dvec3 before = glm::cross(a - mPoints[from], b - mPoints[from]);
+    glm::dvec3 after  = glm::cross(a - mPoints[to], b - mPoints[to]);
+
+    double lengths = glm::length(before) * glm::length(after);
+    if (lengths <= 0.0 || glm::dot(before, after) < kMinFlipCos * lengths)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+float MeshSimplifier::CollapseCost(int from, int to)
+{
+  if (!MeshSimplifier::CanCollapse(from, to))
+  {
+    return -1.0f;
+  }
+
+  // RMS distance to the planes around from, once moved to to.
+  const Quadric& q = mQuadrics[from];
+  double error = std::max(q.Evaluate(mPoints[to]), 0.0) / std::max(q.weight, 1e-30);
+  return static_cast<float>(std::sqrt(error));
+}
+
+void MeshSimplifier::PushCollapses(int p)
+{
+  if (mRemoved[p] || mKinds[p] == kLocked)
+  {
+    return;
+  }
+
+  std::vector<int> neighbors;
+  Neighbors(mTriangles, MeshSimplifier::LiveTriangles(p), mPositionIndex, p, neighbors);
+  for (int q : neighbors)
+  {
+    float cost = MeshSimplifier::CollapseCost(p, q);
+    if (cost >= 0.0f)
+    {
+      mHeap.push_back({ cost, p, q, mStamps[p] });
+      std::push_heap(mHeap.begin(), mHeap.end());
+    }
+  }
+}
+
+void MeshSimplifier::ApplyCollapse(int from, int to)
+{
+  // Copy of to taking the place of each copy of from: the one sharing a triangle with it.
+  std::vector<std::pair<GLuint, GLuint>> copies;
+  std::vector<int> around = MeshSimplifier::LiveTriangles(from);
+  for (int t : around)
+  {
+    GLuint vFrom = 0, vTo = 0;
+    bool hasTo = false;
+    for (int k = 0; k < 3; k++)
+    {
+      GLuint v = mTriangles[3*t + k];
+      if (MeshSimplifier::PositionOf(v) == from)
+        vFrom = v;
+      if (MeshSimplifier::PositionOf(v) == to)
+      {
+        vTo = v;
+        hasTo = true;
+      }
+    }
+
+    if (hasTo)
+      copies.push_back(std::make_pair(vFrom, vTo));
+  }
+
+  for (int t : around)
+  {
+    bool hasTo = false;
+    for (int k = 0; k < 3; k++)
+      hasTo = hasTo || (MeshSimplifier::PositionOf(mTriangles[3*t + k]) == to);
+
+    if (hasTo)  // Degenerates.
+    {
+      mDeadTriangles[t] = 1;
+      mNumLiveTriangles--;
+      continue;
+    }
+
+    for (int k = 0; k < 3; k++)
+    {
+      GLuint& v = mTriangles[3*t + k];
+      if (MeshSimplifier::PositionOf(v) != from)
+        continue;
+
+      for (const auto& copy : copies)
+      {
+        if (copy.first == v)
+        {
+          v = copy.second;
+          break;
+        }
+      }
+
+      // A copy without a match (a wedge not touching the edge) takes the first one.
+      if (MeshSimplifier::PositionOf(v) == from && !copies.empty())
+      {
+        v = copies[0].second;
+      }
+    }
+
+    mTrianglesAround[to].push_back(t);
+  }
+
+  mQuadrics[to].Add(mQuadrics[from]);
+  mStamps[to]++;
+  mRemoved[from] = 1;
+  mTrianglesAround[from].clear();
+
+  // Neighborhood changed: kinds and costs around to.
+  std::vector<int> neighbors;
+  Neighbors(mTriangles, MeshSimplifier::LiveTriangles(to), mPositionIndex, to, neighbors);
+
+  MeshSimplifier::UpdateKind(to);
+  for (int q : neighbors)
+  {
+    MeshSimplifier::UpdateKind(q);
+  }
+
+  MeshSimplifier::PushCollapses(to);
+  for (int q : neighbors)
+  {
+    float cost = MeshSimplifier::CollapseCost(q, to);
+    if (cost >= 0.0f)
+    {
+      mHeap.push_back({ cost, q, to, mStamps[q] });
+      std::push_heap(mHeap.begin(), mHeap.end());
+    }
+  }
+}
+
+// ================= Simplification ================= //
+
+float MeshSimplifier::Simplify(int targetTriangles, float maxError)
+{
+  while (mNumLiveTriangles > targetTriangles && !mHeap.empty())
+  {
+    std::pop_heap(mHeap.begin(), mHeap.end());
+    Collapse collapse = mHeap.back();
+    mHeap.pop_back();
+
+    if (mRemoved[collapse.from] || mRemoved[collapse.to] || collapse.stamp != mStamps[collapse.from])
+    {
+      continue;  // Outdated - a newer entry was pushed.
+    }
+
+    if (collapse.cost > maxError)
+    {
+      mHeap.push_back(collapse);  // Still valid for a later call with a larger error.
+      std::push_heap(mHeap.begin(), mHeap.end());
+      break;
+    }
+
+    if (!MeshSimplifier::CanCollapse(collapse.from, collapse.to))
+    {
+      continue;
+    }
+
+    MeshSimplifier::ApplyCollapse(collapse.from, collapse.to);
+    mError = std::max(mError, collapse.cost);
+  }
+
+  return mError;
+}
+
+void MeshSimplifier::GetTriangles(std::vector<GLuint>& triangles) const
+{
+  triangles.clear();
+  triangles.reserve(3 * mNumLiveTriangles);
+  for (int t = 0; t < static_cast<int>(mDeadTriangles.size()); t++)
+  {
+    if (!mDeadTriangles[t])
+    {
+      triangles.insert(triangles.end(), { mTriangles[3*t], mTriangles[3*t + 1], mTriangles[3*t + 2] });
+    }
+  }
+}
+
+}  // namespace gloo.
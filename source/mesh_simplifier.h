@@ -0,0 +1,120 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "openGLHeader.h"
+
+//  +-------------------------------------------------+
+//  |  Triangle mesh simplification by quadric error  |
+//  |  metrics (Garland and Heckbert).                |
+//  |                                                 |
+//  |  Edges are collapsed cheapest first. A collapse |
+//  |  moves one vertex onto the other (half-edge     |
+//  |  collapse), so the result indexes a subset of   |
+//  |  the original vertices and keeps their          |
+//  |  attributes untouched.                          |
+//  |                                                 |
+//  |  Vertices equal in every attribute are welded   |
+//  |  first. Vertices sharing a position but not the |
+//  |  attributes form seams (uv or normal            |
+//  |  discontinuities): they only slide along the    |
+//  |  seam, all copies together. Boundary vertices   |
+//  |  only slide along the boundary, and corners are |
+//  |  locked. Collapses that would flip a triangle   |
+//  |  or pinch the surface are rejected.             |
+//  |                                                 |
+//  |  Simplify can be called with smaller and        |
+//  |  smaller targets to get an LOD chain, each      |
+//  |  level starting from the previous one.          |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class MeshSimplifier
+{
+public:
+  MeshSimplifier() { }
+
+  // Triangle list over numVertices vertices. positions is required, the other attributes
+  // (3, 3 and 2 floats per vertex) may be nullptr. The arrays must outlive the simplifier.
+  void SetMesh(const GLfloat* positions, const GLfloat* colors, const GLfloat* normals,
+               const GLfloat* texCoords, int numVertices, const GLuint* triangles,
+               int numTriangles);
+
+  // Collapses edges until at most targetTriangles are left, or until the next collapse would
+  // move the surface by more than maxError (model units). Returns the error reached so far.
+  float Simplify(int targetTriangles, float maxError = 1e30f);
+
+  // Current triangles, in original vertex indices.
+  void GetTriangles(std::vector<GLuint>& triangles) const;
+
+  inline int GetNumTriangles() const { return mNumLiveTriangles; }
+  inline float GetError() const { return mError; }
+
+private:
+  // Symmetric 4x4 matrix: sum of w * (n.p + d)^2 over planes (n, d).
+  struct Quadric
+  {
+    double a[10] { };
+    double weight { 0.0 };  // Area of the triangle planes (boundary planes don't count).
+
+    void AddPlane(const glm::dvec3& n, double d, double w);
+    void Add(const Quadric& q);
+    double Evaluate(const glm::dvec3& p) const;
+  };
+
+  enum Kind { kInterior, kBorder, kSeam, kLocked };
+
+  struct Collapse
+  {
+    float cost;
+    int from, to;      // Positions.
+    unsigned stamp;    // Revision of from's quadric when computed.
+
+    bool operator<(const Collapse& other) const { return cost > other.cost; }  // Min-heap.
+  };
+
+  // Triangles around p that are still alive (drops the dead ones from the list).
+  const std::vector<int>& LiveTriangles(int p);
+
+  // Edge (p, q): number of triangles on it, and whether its two triangles disagree on the
+  // vertex copies (attribute seam).
+  void ClassifyEdge(int p, int q, int& numTriangles, bool& seam);
+  void UpdateKind(int p);
+
+  // Error of moving p onto q, or a negative value if the collapse isn't allowed.
+  float CollapseCost(int from, int to);
+  bool CanCollapse(int from, int to);
+  void ApplyCollapse(int from, int to);
+  void PushCollapses(int p);
+
+  inline int PositionOf(GLuint vertex) const { return mPositionIndex[vertex]; }
+
+  std::vector<GLuint> mVertexIndex;    // Original vertex to its welded representative.
+  std::vector<int> mPositionIndex;     // Welded vertex to its position.
+  std::vector<glm::dvec3> mPoints;     // Position coordinates.
+  std::vector<Quadric> mQuadrics;
+  std::vector<unsigned> mStamps;
+  std::vector<char> mKinds;
+  std::vector<char> mRemoved;
+  std::vector<std::vector<int>> mTrianglesAround;  // Triangles of each position.
+
+  std::vector<GLuint> mTriangles;      // Welded vertices, 3 per triangle.
+  std::vector<char> mDeadTriangles;
+  int mNumLiveTriangles { 0 };
+
+  std::vector<Collapse> mHeap;
+  float mError { 0.0f };
+};
+
+}  // namespace gloo.
@@ -0,0 +1,326 @@
+#include "meshlets.h"
+
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+
+namespace gloo
+{
+
+namespace
+{
+
+// How much a triangle turned away from the meshlet normal counts against it when growing
+// (tighter cones cull more often, tighter spheres too).
+const float kConeWeight = 0.5f;
+
+// Same for each unassigned triangle around its corners (enclosed triangles go first).
+const float kLiveWeight = 0.1f;
+
+// Cones wider than this (cosine between the axis and the furthest normal) are never culled.
+const float kMinConeCos = 0.1f;
+
+}  // namespace.
+
+bool Meshlets::Prepare(Mesh* mesh)
+{
+  mMesh = mesh;
+  mMeshlets.clear();
+  mIndices.clear();
+
+  std::vector<GLuint> triangles;
+  int numTriangles = mesh->GetTriangles(triangles);
+  int n = mesh->GetNumVertices();
+  if (numTriangles == 0)
+  {
+    return false;
+  }
+
+  std::vector<glm::vec3> points(n);
+  for (int i = 0; i < n; i++)
+  {
+    points[i] = mesh->GetPosition(i);
+  }
+
+  // Neighbours are found through positions rather than vertices, so triangles split by uv or
+  // normal seams (or loaded with one vertex per corner) are still adjacent.
+  std::vector<int> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&points](int a, int b)
+  {
+    const glm::vec3& p = points[a];
+    const glm::vec3& q = points[b];
+    return std::lexicographical_compare(&p[0], &p[0] + 3, &q[0], &q[0] + 3);
+  });
+
+  std::vector<int> positionIndex(n);
+  int numPositions = 0;
+  for (int k = 0; k < n; k++)
+  {
+    if (k > 0 && points[order[k]] != points[order[k - 1]])
+      numPositions++;
+    positionIndex[order[k]] = numPositions;
+  }
+  numPositions++;
+
+  // Triangles around each position (offsets into one array).
+  std::vector<int> aroundOffsets(numPositions + 1, 0);
+  for (GLuint v : triangles)
+  {
+    aroundOffsets[positionIndex[v] + 1]++;
+  }
+  std::partial_sum(aroundOffsets.begin(), aroundOffsets.end(), aroundOffsets.begin());
+
+  std::vector<int> around(3 * numTriangles);
+  std::vector<int> fill(aroundOffsets.begin(), aroundOffsets.end() - 1);
+  for (int k = 0; k < 3 * numTriangles; k++)
+  {
+    around[fill[positionIndex[triangles[k]]]++] = k / 3;
+  }
+
+  std::vector<glm::vec3> centroids(numTriangles), normals(numTriangles);
+  for (int t = 0; t < numTriangles; t++)
+  {
+    const glm::vec3& a = points[triangles[3*t]];
+    const glm::vec3& b = points[triangles[3*t + 1]];
+    const glm::vec3& c = points[triangles[3*t + 2]];
+    glm::vec3 normal = glm::cross(b - a, c - a);
+    float length = glm::length(normal);
+
+    centroids[t] = (a + b + c) / 3.0f;
+    normals[t] = (length > 0.0f) ? normal / length : glm::vec3(0.0f);  // Zero if degenerate.
+  }
+
+  // Unassigned triangles around each position. Triangles with few of them left are in gaps
+  // between meshlets, and are taken first so that no tiny leftovers remain.
+  std::vector<int> numLive(numPositions);
+  for (int p = 0; p < numPositions; p++)
+  {
+    numLive[p] = aroundOffsets[p + 1] - aroundOffsets[p];
+  }
+
+  auto liveAround = [&](int t)
+  {
+    return numLive[positionIndex[triangles[3*t]]] + numLive[positionIndex[triangles[3*t + 1]]] +
+           numLive[positionIndex[triangles[3*t + 2]]];
+  };
+
+  // Greedy growth: each meshlet takes the neighbouring triangle closest to its center and
+  // normal (triangles adding no vertex first), until a limit is hit.
+  std::vector<char> assigned(numTriangles, 0);
+  std::vector<int> vertexMeshlet(n, -1);         // Last meshlet a vertex went into.
+  std::vector<int> candidateMeshlet(numTriangles, -1);
+  std::vector<int> candidates;
+  std::vector<GLuint> vertices;
+  std::vector<int> members;
+  int nextSeed = 0;
+
+  mIndices.reserve(3 * numTriangles);
+  while (true)
+  {
+    // Start next to the previous meshlet when possible, in its most enclosed gap, so the
+    // partition walks over the surface.
+    int t = -1;
+    int fewestLive = 0;
+    for (int c : candidates)
+    {
+      if (!assigned[c] && (t < 0 || liveAround(c) < fewestLive))
+      {
+        t = c;
+        fewestLive = liveAround(c);
+      }
+    }
+
+    if (t < 0)
+    {
+      while (nextSeed < numTriangles && assigned[nextSeed])
+        nextSeed++;
+
+      if (nextSeed == numTriangles)
+        break;
+
+      t = nextSeed;
+    }
+
+    int id = static_cast<int>(mMeshlets.size());
+    Meshlet meshlet;
+    meshlet.firstIndex = static_cast<int>(mIndices.size());
+    glm::vec3 centroidSum(0.0f), normalSum(0.0f);
+    candidates.clear();
+    vertices.clear();
+    members.clear();
+
+    while (t >= 0)
+    {
+      assigned[t] = 1;
+      members.push_back(t);
+      for (int k = 0; k < 3; k++)
+      {
+        numLive[positionIndex[triangles[3*t + k]]]--;
+      }
+      meshlet.numTriangles++;
+      centroidSum += centroids[t];
+      normalSum += normals[t];
+
+      for (int k = 0; k < 3; k++)
+      {
+        GLuint v = triangles[3*t + k];
+        mIndices.push_back(v);
+        if (vertexMeshlet[v] != id)
+        {
+          vertexMeshlet[v] = id;
+          vertices.push_back(v);
+        }
+
+        int p = positionIndex[v];
+        for (int j = aroundOffsets[p]; j < aroundOffsets[p + 1]; j++)
+        {
+          int c = around[j];
+          if (!assigned[c] && candidateMeshlet[c] != id)
+          {
+            candidateMeshlet[c] = id;
+            candidates.push_back(c);
+          }
+        }
+      }
+
+      if (meshlet.numTriangles == kMaxTriangles)
+        break;
+
+      glm::vec3 center = centroidSum / static_cast<float>(meshlet.numTriangles);
+      float normalLength = glm::length(normalSum);
+      glm::vec3 axis = (normalLength > 0.0f) ? normalSum / normalLength : glm::vec3(0.0f);
+
+      // Pick the next triangle (and drop the assigned candidates).
+      t = -1;
+      bool bestShared = false;  // Adds no vertex.
+      float bestCost = 0.0f;
+      size_t numLeft = 0;
+      for (int c : candidates)
+      {
+        if (assigned[c])
+          continue;
+        candidates[numLeft++] = c;
+
+        int numNew = 0;
+        for (int k = 0; k < 3; k++)
+        {
+          numNew += (vertexMeshlet[triangles[3*c + k]] != id);
+        }
+
+        if (static_cast<int>(vertices.size()) + numNew > kMaxVertices)
+          continue;
+
+        bool shared = (numNew == 0);
+        float cost = glm::length(centroids[c] - center) *
+                     (1.0f + kConeWeight * (1.0f - glm::dot(normals[c], axis))) *
+                     (1.0f + kLiveWeight * liveAround(c));
+        if (t < 0 || shared > bestShared || (shared == bestShared && cost < bestCost))
+        {
+          t = c;
+          bestShared = shared;
+          bestCost = cost;
+        }
+      }
+      candidates.resize(numLeft);
+    }
+
+    meshlet.numVertices = static_cast<int>(vertices.size());
+
+    // Bounding sphere around the box of the vertices.
+    glm::vec3 lo(1e30f), hi(-1e30f);
+    for (GLuint v : vertices)
+    {
+      lo = glm::min(lo, points[v]);
+      hi = glm::max(hi, points[v]);
+    }
+    meshlet.center = 0.5f * (lo + hi);
+    for (GLuint v : vertices)
+    {
+      meshlet.radius = std::max(meshlet.radius, glm::length(points[v] - meshlet.center));
+    }
+
+    // Normal cone: the faces are all backfacing for cameras behind the cone (see Render).
+    float normalLength = glm::length(normalSum);
+    float minCos = -1.0f;
+    if (normalLength > 0.0f)
+    {
+      meshlet.coneAxis = normalSum / normalLength;
+      minCos = 1.0f;
+      for (int m : members)
+      {
+        if (normals[m] != glm::vec3(0.0f))
+          minCos = std::min(minCos, glm::dot(normals[m], meshlet.coneAxis));
+      }
+    }
+    meshlet.coneCutoff = (minCos > kMinConeCos) ? std::sqrt(1.0f - minCos * minCos) : 1.0f;
+
+    mMeshlets.push_back(meshlet);
+  }
+
+  return true;
+}
+
+void Meshlets::Upload()
+{
+  if (mMesh && !mIndices.empty())
+  {
+    mMesh->ReloadIndices(&mIndices[0], static_cast<int>(mIndices.size()), GL_TRIANGLES);
+    std::vector<GLuint>().swap(mIndices);
+  }
+}
+
+void Meshlets::Render(const Frustum& frustum, const glm::vec3& cameraPos,
+                      bool cullBackfaces) const
+{
+  mStats = Stats();
+  mCounts.clear();
+  mOffsets.clear();
+
+  int end = -1;  // End of the last range.
+  for (const Meshlet& meshlet : mMeshlets)
+  {
+    if (!frustum.Intersects(meshlet.center, meshlet.radius))
+    {
+      mStats.numFrustumCulled++;
+      continue;
+    }
+
+    // Every face normal is within the cone, so if the whole sphere is seen from behind the
+    // cone (view direction closer to the axis than 90 degrees minus the half-angle), all
+    // triangles face away.
+    if (cullBackfaces && meshlet.coneCutoff < 1.0f)
+    {
+      glm::vec3 view = meshlet.center - cameraPos;
+      if (glm::dot(view, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(view) + meshlet.radius)
+      {
+        mStats.numBackfaceCulled++;
+        continue;
+      }
+    }
+
+    mStats.numMeshlets++;
+    mStats.numTriangles += meshlet.numTriangles;
+    mStats.numVertices  += meshlet.numVertices;
+
+    int numIndices = 3 * meshlet.numTriangles;
+    if (meshlet.firstIndex == end)
+    {
+      mCounts.back() += numIndices;
+    }
+    else
+    {
+      mCounts.push_back(numIndices);
+      mOffsets.push_back((const GLvoid*)(sizeof(GLuint) * meshlet.firstIndex));
+    }
+    end = meshlet.firstIndex + numIndices;
+  }
+
+  mStats.numRanges = static_cast<int>(mCounts.size());
+  if (!mCounts.empty())
+  {
+    mMesh->RenderRanges(&mCounts[0], &mOffsets[0], mStats.numRanges);
+  }
+}
+
+}  // namespace gloo.
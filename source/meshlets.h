@@ -0,0 +1,100 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "frustum.h"
+
+//  +-------------------------------------------------+
+//  |  Partition of a triangle mesh into meshlets:    |
+//  |  small clusters of neighbouring triangles (up   |
+//  |  to kMaxVertices vertices and kMaxTriangles     |
+//  |  triangles), each with a bounding sphere and a  |
+//  |  cone bounding its face normals.                |
+//  |                                                 |
+//  |  The element array of the mesh is rewritten so  |
+//  |  that every meshlet is a contiguous range. Each |
+//  |  frame, meshlets outside the view frustum, or   |
+//  |  whose faces all point away from the camera,    |
+//  |  are skipped, and the visible ranges (adjacent  |
+//  |  ones merged) go out in a single multi-draw.    |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class Meshlets
+{
+public:
+  static const int kMaxVertices  = 64;
+  static const int kMaxTriangles = 124;
+
+  struct Meshlet
+  {
+    glm::vec3 center;            // Bounding sphere (model space).
+    float radius { 0.0f };
+    glm::vec3 coneAxis;          // Average face normal.
+    float coneCutoff { 1.0f };   // Sine of the cone half-angle (1 when it never culls).
+    int firstIndex { 0 };        // Range in the element array.
+    int numTriangles { 0 };
+    int numVertices  { 0 };
+  };
+
+  struct Stats
+  {
+    int numMeshlets       { 0 };  // Meshlets drawn.
+    int numFrustumCulled  { 0 };
+    int numBackfaceCulled { 0 };
+    int numTriangles      { 0 };  // Triangles submitted.
+    int numVertices       { 0 };  // Meshlet vertices submitted (shared ones count per meshlet).
+    int numRanges         { 0 };  // Ranges in the multi-draw.
+  };
+
+  Meshlets() { }
+
+  // Clusters the triangles of mesh (CPU only, so meshes can be prepared on several threads).
+  // The mesh must outlive the meshlets and isn't owned. Returns false if it has no triangles.
+  bool Prepare(Mesh* mesh);
+
+  // Sends the reordered element array to the mesh (GL thread). The mesh is drawn as a
+  // triangle list from then on.
+  void Upload();
+
+  inline bool Build(Mesh* mesh)
+  {
+    if (!Meshlets::Prepare(mesh))
+      return false;
+
+    Meshlets::Upload();
+    return true;
+  }
+
+  // Draws the meshlets that intersect frustum. If cullBackfaces, meshlets facing away from
+  // cameraPos are skipped too (only correct when GL_CULL_FACE is on). Both in model space.
+  void Render(const Frustum& frustum, const glm::vec3& cameraPos, bool cullBackfaces) const;
+
+  inline int GetNumMeshlets() const { return static_cast<int>(mMeshlets.size()); }
+  inline const Meshlet& GetMeshlet(int i) const { return mMeshlets[i]; }
+  inline const Stats& GetStats() const { return mStats; }
+
+private:
+  Mesh* mMesh { nullptr };
+  std::vector<Meshlet> mMeshlets;
+  std::vector<GLuint> mIndices;  // Reordered triangles, until uploaded.
+
+  // Visible ranges of the last frame.
+  mutable std::vector<GLsizei> mCounts;
+  mutable std::vector<const GLvoid*> mOffsets;
+  mutable Stats mStats;
+};
+
+}  // namespace gloo.
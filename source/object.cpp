@@ -1,5 +1,7 @@
 #include "object.h"
 #include "utilities.h"
+#include "primitive_cache.h"
+#include "camera.h"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <sstream>
@@ -9,7 +11,6 @@
 #include "assimp/scene.h"           // Output data structure.
 #include "assimp/postprocess.h"     // Post processing flags.
 
-#define INDEX(a, b) (((w) * (b)) + a)
 
 namespace gloo
 {
@@ -44,10 +45,115 @@ void Object::Render() const
 
   mPipelineProgram->SetModelMatrix(mModelMatrix);
 
+  // Level of detail selection and meshlet culling need the view (see GenerateLODs and
+  // GenerateMeshlets). Culling happens in model space.
+  glm::mat4 modelView;
+  float pixelsPerUnit = 0.0f;
+  Frustum frustum;
+  glm::vec3 cameraPos;
+  if (mCamera)
+  {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const glm::mat4& P = mCamera->GetProjMatrix().GetGLMatrix();
+    modelView = mCamera->GetViewMatrix().GetGLMatrix() * mModelMatrix.GetGLMatrix();
+    pixelsPerUnit = 0.5f * viewport[3] * P[1][1];
+
+    frustum.Extract(P * modelView);
+    cameraPos = glm::vec3(glm::inverse(modelView) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+  }
+
+  if (mBackfaceCulling)
+  {
+    glEnable(GL_CULL_FACE);
+  }
+
+  mNumDrawnTriangles = 0;
+  mMeshletStats = Meshlets::Stats();
   for (auto& group : mGroups)
   {
     // TODO: set material per group.
-    group.mesh->Render();
+    int level = (group.lod && mCamera) ? 
+                group.lod->SelectLevel(modelView, pixelsPerUnit, mMaxPixelError) : 0;
+
+    if (level > 0)
+    {
+      group.lod->GetLevel(level)->Render();
+      mNumDrawnTriangles += group.lod->GetNumTriangles(level);
+    }
+    else if (group.meshlets && mCamera)
+    {
+      group.meshlets->Render(frustum, cameraPos, mBackfaceCulling);
+      const Meshlets::Stats& stats = group.meshlets->GetStats();
+      mNumDrawnTriangles += stats.numTriangles;
+
+      mMeshletStats.numMeshlets       += stats.numMeshlets;
+      mMeshletStats.numFrustumCulled  += stats.numFrustumCulled;
+      mMeshletStats.numBackfaceCulled += stats.numBackfaceCulled;
+      mMeshletStats.numTriangles      += stats.numTriangles;
+      mMeshletStats.numVertices       += stats.numVertices;
+      mMeshletStats.numRanges         += stats.numRanges;
+    }
+    else
+    {
+      group.mesh->Render();
+      int numIndices = group.mesh->GetNumIndices();
+      GLenum mode = group.mesh->GetDrawMode();
+      mNumDrawnTriangles += (mode == GL_TRIANGLES) ? numIndices / 3 :
+                            (mode == GL_TRIANGLE_STRIP) ? std::max(numIndices - 2, 0) : 0;
+    }
+  }
+
+  if (mBackfaceCulling)
+  {
+    glDisable(GL_CULL_FACE);
+  }
+}
+
+void Object::GenerateLODs(const MeshLOD::Params& params)
+{
+  // Simplification runs on the CPU (one group per task), uploads on this thread.
+  std::vector<MeshLOD*> chains(mGroups.size(), nullptr);
+  tool::ParallelFor(0, static_cast<int>(mGroups.size()), 1, [&](int first, int last)
+  {
+    for (int i = first; i < last; i++)
+    {
+      chains[i] = new MeshLOD();
+      chains[i]->Prepare(mGroups[i].mesh, params);
+    }
+  });
+
+  for (int i = 0; i < static_cast<int>(mGroups.size()); i++)
+  {
+    delete mGroups[i].lod;
+    chains[i]->Upload(mProgramHandle);
+    mGroups[i].lod = chains[i];
+  }
+}
+
+void Object::GenerateMeshlets()
+{
+  // Clustering runs on the CPU (one group per task), the reordered elements are sent from
+  // this thread.
+  std::vector<Meshlets*> partitions(mGroups.size(), nullptr);
+  tool::ParallelFor(0, static_cast<int>(mGroups.size()), 1, [&](int first, int last)
+  {
+    for (int i = first; i < last; i++)
+    {
+      Meshlets* meshlets = new Meshlets();
+      if (meshlets->Prepare(mGroups[i].mesh))
+        partitions[i] = meshlets;
+      else
+        delete meshlets;  // Lines or points.
+    }
+  });
+
+  for (int i = 0; i < static_cast<int>(mGroups.size()); i++)
+  {
+    delete mGroups[i].meshlets;
+    mGroups[i].meshlets = partitions[i];
+    if (partitions[i])
+      partitions[i]->Upload();
   }
 }
 
@@ -155,12 +261,8 @@ bool Object::LoadParametricSurf(std::function<glm::vec3 (float, float)> surf,
   int w = numSampleU;
   int h = numSampleV;
   int numVertices = (w * h);
-  int numIndices = 0;
-  GLenum drawMode = GL_LINE_STRIP;
 
   std::vector<GLfloat> vertices;
-  std::vector<GLuint> indices;
-
   vertices.reserve(numVertices * 6);
 
   // Initialize vertices.
@@ -186,71 +288,7 @@ bool Object::LoadParametricSurf(std::function<glm::vec3 (float, float)> surf,
     }
   }
 
-  
-  // Initialize indices.
-  if (!solid)  // WIREFRAME.
-  {
-    numIndices  = (2 * w * h);
-    indices.reserve(numIndices);
-    
-    // Wire frame Element array - indices are written in a zig-zag pattern,
-    // first horizontally and then vertically. It uses GL_LINE_STRIP. 
-    int index = 0;
-    int x = 0, y = 0;
-    int dx = 1, dy = -1;
-
-    for (y = 0; y < h; y++)  // Horizontally.
-    {
-      x = ((dx == 1) ? 0 : w-1);
-      for (int k = 0; k < w; k++, x += dx)
-        indices.push_back(INDEX(x, y));
-      dx *= -1;
-    }
-
-    // Start from the last point to allow continuity in GL_LINE_STRIP.
-    x = ((dx == 1) ? 0 : w-1);
-    y = h-1;  
-    dy = -1;
-    for (int i = 0; i < w; i++, x += dx)  // Vertically.
-    {
-      y = ((dy == 1) ? 0 : h-1);
-      for (int j = 0; j < h; j++, y += dy)
-        indices.push_back(INDEX(x, y));
-      dy *= -1;
-    }
-  }
-  else  // SOLID.
-  {
-    numIndices  = 2*(h-2)*w + 2*w + 2*(h-2);
-    indices.reserve(numIndices);
-    drawMode = GL_TRIANGLE_STRIP;
-
-    for (int v = 0; v < h-1; v++)
-    {
-      // Zig-zag pattern: alternate between top and bottom.
-      for (int u = 0; u < w; u++)
-      {
-        indices.push_back((v+0)*w + u);
-        indices.push_back((v+1)*w + u);
-      }
-
-      // Triangle row transition: handle discontinuity.
-      if (v < h-2)
-      {
-        // Repeat last vertex and the next row first vertex to generate 
-        // two invalid triangles and get continuity in the mesh.
-        indices.push_back((v+1)*w + (w-1)); //INDEX(this->width-1, y+1);
-        indices.push_back((v+1)*w + 0);     //INDEX(0, y+1);
-      }
-    }
-  }
-
-  Mesh* mesh = new Mesh(mProgramHandle);
-  mesh->Load(&vertices[0], &indices[0], numVertices, numIndices, true, false, false, drawMode);
-  mUsingLighting = false;
-  mGroups.emplace_back(mesh, 0, "Main surface");
-
-  return true;
+  return Object::BuildUpParametricGroup(vertices, w, h, true, solid);
 }
 
 bool Object::LoadParametricSurfSolid( std::function<glm::vec3 (float, float)> surf, 
@@ -260,14 +298,9 @@ bool Object::LoadParametricSurfSolid( std::function<glm::vec3 (float, float)> su
   int w = numSampleU;
   int h = numSampleV;
   int numVertices = (w * h);
-  int numIndices  = 2*(h-2)*w + 2*w + 2*(h-2);
-  GLenum drawMode = GL_TRIANGLE_STRIP;
 
   std::vector<GLfloat> vertices;
-  std::vector<GLuint> indices;
-
   vertices.reserve(numVertices * 6);
-  indices.reserve(numIndices);
 
   // Initialize vertices.
   for (int y = 0; y < h; y++)
@@ -290,29 +323,48 @@ bool Object::LoadParametricSurfSolid( std::function<glm::vec3 (float, float)> su
       vertices.push_back(nor[2]);
     }
   }
-  
-  // Initialize indices.
-  for (int v = 0; v < h-1; v++)
+
+  return Object::BuildUpParametricGroup(vertices, w, h, false, true);
+}
+
+bool Object::BuildUpParametricGroup(const std::vector<GLfloat>& vertices, int w, int h,
+                                    bool hasColors, bool solid)
+{
+  int numVertices = (w * h);
+  int numIndices  = solid ? PrimitiveCache::NumStripIndices(w, h)
+                          : PrimitiveCache::NumWireGridIndices(w, h);
+  GLenum drawMode = solid ? GL_TRIANGLE_STRIP : GL_LINE_STRIP;
+
+  std::vector<GLuint> indices(numIndices);
+  if (solid)
   {
-    // Zig-zag pattern: alternate between top and bottom.
-    for (int u = 0; u < w; u++)
-    {
-      indices.push_back((v+0)*w + u);
-      indices.push_back((v+1)*w + u);
-    }
+    PrimitiveCache::BuildStripIndices(w, h, indices.data());
+  }
+  else  // WIREFRAME - zig-zag horizontally, then vertically from the last point.
+  {
+    PrimitiveCache::BuildWireGridIndices(w, h, indices.data());
+  }
 
-    // Triangle row transition: handle discontinuity.
-    if (v < h-2)
-    {
-      // Repeat last vertex and the next row first vertex to generate 
-      // two invalid triangles and get continuity in the mesh.
-      indices.push_back((v+1)*w + (w-1)); //INDEX(this->width-1, y+1);
-      indices.push_back((v+1)*w + 0);     //INDEX(0, y+1);
-    }
+  Mesh* mesh = new Mesh(mProgramHandle);
+  mesh->Load(vertices.data(), indices.data(), numVertices, numIndices, hasColors, !hasColors, false,
+             drawMode);
+  mUsingLighting = !hasColors;
+  mGroups.emplace_back(mesh, 0, "Main surface");
+
+  return true;
+}
+
+bool Object::BuildUpTriangleGroup(const std::vector<GLfloat>& vertices,
+                                  const std::vector<GLuint>& indices)
+{
+  if (indices.empty())
+  {
+    return false;
   }
 
   Mesh* mesh = new Mesh(mProgramHandle);
-  mesh->Load(&vertices[0], &indices[0], numVertices, numIndices, false, true, false, drawMode);
+  mesh->Load(vertices.data(), indices.data(), static_cast<int>(vertices.size() / 6),
+             static_cast<int>(indices.size()), false, true, false, GL_TRIANGLES);
   mUsingLighting = true;
   mGroups.emplace_back(mesh, 0, "Main surface");
 
@@ -335,6 +387,8 @@ Object::~Object()
   {
     for (auto& group : mGroups)
     {
+      delete group.lod;
+      delete group.meshlets;
       delete group.mesh;
     }
 
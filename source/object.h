@@ -13,9 +13,18 @@
 
 #include "imageIO.h"
 #include "mesh.h"
+#include "parallel.h"
+#include "dual.h"
+#include "adaptive_tessellator.h"
+#include "implicit_polygonizer.h"
+#include "mesh_lod.h"
+#include "meshlets.h"
 
 namespace gloo
 {
+
+class Camera;
+
 namespace obj
 {
 
@@ -96,6 +105,8 @@ public:
     Mesh* mesh;         // Geometry data.
     std::string name;   // Group name - if written in the .obj file.
     int materialIndex;  // Index for the list of materials.
+    MeshLOD* lod { nullptr };  // Simplified versions of mesh, if generated.
+    Meshlets* meshlets { nullptr };  // Clusters of mesh for culling, if generated.
   };
 
   // 
@@ -127,8 +138,59 @@ public:
                                std::function<glm::vec3 (float, float)> normal,
                                int numSampleU, int numSampleV);
 
+  // Same as above, but the callables are taken by type, so they can be inlined. The (u, v)
+  // grid is evaluated by several threads (in bands of rows) directly into the vertex buffer,
+  // so the callables must be safe to call concurrently.
+  template <typename SurfFunc, typename ColorFunc>
+  bool LoadParametricSurf(SurfFunc surf, ColorFunc rgbFunc, 
+                          int numSampleU, int numSampleV, bool solid);
+
+  template <typename SurfFunc, typename NormalFunc>
+  bool LoadParametricSurfSolid(SurfFunc surf, NormalFunc normal,
+                               int numSampleU, int numSampleV);
+
+  // SOLID with exact normals: surf is written on dual numbers, (Dual u, Dual v) -> DualVec3
+  // (see dual.h), so dS/du and dS/dv come out of the same evaluation as the position.
+  template <typename SurfFunc>
+  bool LoadParametricSurfSolid(SurfFunc surf, int numSampleU, int numSampleV);
+
+  // SOLID, curvature-adaptive: the (u, v) domain is refined only where the surface bends, until
+  // it deviates from its triangles by less than params.chordTolerance (see AdaptiveTessellator).
+  // surf is written on dual numbers like above.
+  template <typename SurfFunc>
+  bool LoadParametricSurfAdaptive(SurfFunc surf, const AdaptiveTessellator::Params& params);
+
+  // SOLID, implicit: the surface field(x, y, z) = params.isoValue inside params.bounds, with
+  // the field negative inside (see ImplicitPolygonizer for how to write it).
+  template <typename Field>
+  bool LoadImplicitSurface(const Field& field, const ImplicitPolygonizer::Params& params);
+
   // TODO: Add primitive loading method here.
 
+  // Builds a chain of simplified meshes for every triangle group (see MeshLOD), on several
+  // threads. Once a camera is set, each group is drawn at the coarsest level whose error
+  // stays under SetMaxPixelError pixels on screen.
+  void GenerateLODs(const MeshLOD::Params& params);
+  inline void GenerateLODs() { Object::GenerateLODs(MeshLOD::Params()); }
+
+  inline void SetCamera(Camera* camera) { mCamera = camera; }
+  inline void SetMaxPixelError(float pixels) { mMaxPixelError = pixels; }  // Default 1.
+
+  // Splits every triangle group into meshlets (see Meshlets), on several threads. Once a
+  // camera is set, only the meshlets in view are drawn (at level 0 - coarser levels are
+  // drawn whole).
+  void GenerateMeshlets();
+
+  // Enables GL_CULL_FACE while rendering the object, and lets meshlets facing away from the
+  // camera be skipped. Only for closed, consistently wound models. Default off.
+  inline void SetBackfaceCulling(bool state) { mBackfaceCulling = state; }
+
+  // Triangles submitted by the last Render (over all groups, at their levels).
+  inline int GetNumDrawnTriangles() const { return mNumDrawnTriangles; }
+
+  // Meshlet culling of the last Render, summed over groups.
+  inline const Meshlets::Stats& GetMeshletStats() const { return mMeshletStats; }
+
   // Computes intersection of C + t*Ray with geometry.
   bool RayIntersection(const glm::vec3& ray, const glm::vec3& C) const;       // TODO.
   bool FastRayIntersection(const glm::vec3& ray, const glm::vec3& C) const;   // TODO.
@@ -149,6 +211,15 @@ public:
   inline glm::vec3& GetPosition() { return mPos; }
   inline glm::vec3& GetRotation() { return mRot; }
 
+  // Vertices over all groups.
+  inline int GetNumVertices() const
+  {
+    int numVertices = 0;
+    for (const Group& group : mGroups)
+      numVertices += group.mesh->GetNumVertices();
+    return numVertices;
+  }
+
   void SetPipelineProgramParam(BasicPipelineProgram *pipelineProgram, GLuint programHandle);
 
   ~Object();
@@ -160,6 +231,16 @@ private:
                     std::vector<GLuint>& groupIndices,
                     const char* name, int materialIndex = -1);
 
+  // Adds the mesh of a w x h grid of interleaved vertices - (x, y, z) then (r, g, b) or
+  // (nx, ny, nz) - as a wireframe or a solid triangle strip.
+  bool BuildUpParametricGroup(const std::vector<GLfloat>& vertices, int w, int h,
+                              bool hasColors, bool solid);
+
+  // Adds a triangle mesh of interleaved (x, y, z, nx, ny, nz) vertices.
+  bool BuildUpTriangleGroup(const std::vector<GLfloat>& vertices, const std::vector<GLuint>& indices);
+
+  static const int kMinParametricRows = 8;  // Rows per thread when evaluating surfaces.
+
   BasicPipelineProgram* mPipelineProgram { nullptr };
   GLuint mProgramHandle { 0 };
 
@@ -174,6 +255,12 @@ private:
   glm::vec3 mPos    {0.0f, 0.0f, 0.0f};    // Center    (x, y, z).
   glm::vec3 mRot    {0.0f, 0.0f, 0.0f};    // Rotations (x, y, z).
   glm::vec3 mScale  {1.0f, 1.0f, 1.0f};    // Scaling parameters.
+
+  Camera* mCamera { nullptr };  // For LOD selection.
+  float mMaxPixelError { 1.0f };
+  mutable int mNumDrawnTriangles { 0 };
+  mutable Meshlets::Stats mMeshletStats;
+  bool mBackfaceCulling { false };
   
 };  // class Object
 
@@ -230,6 +317,150 @@ void Object::SetScale(const glm::vec3& scale)
   mScale = scale;
 }
 
+// ================= Parametric Surface Templates ================= //
+
+template <typename SurfFunc, typename ColorFunc>
+bool Object::LoadParametricSurf(SurfFunc surf, ColorFunc rgbFunc, 
+                                int numSampleU, int numSampleV, bool solid)
+{
+  int w = numSampleU;
+  int h = numSampleV;
+  if (w < 2 || h < 2)
+  {
+    return false;
+  }
+
+  std::vector<GLfloat> vertices(static_cast<size_t>(w) * h * 6);
+  GLfloat* out = vertices.data();
+
+  tool::ParallelFor(0, h, kMinParametricRows, [&surf, &rgbFunc, out, w, h](int first, int last)
+  {
+    for (int y = first; y < last; y++)
+    {
+      float v = static_cast<float>(y)/(h-1);
+      GLfloat* vertex = out + static_cast<size_t>(6) * w * y;
+
+      for (int x = 0; x < w; x++, vertex += 6)
+      {
+        float u = static_cast<float>(x)/(w-1);
+        const glm::vec3 surf_uv = surf(u, v);
+        const glm::vec3 rgb = rgbFunc(u, v);
+
+        vertex[0] = surf_uv[0];
+        vertex[1] = surf_uv[1];
+        vertex[2] = surf_uv[2];
+        vertex[3] = rgb[0];
+        vertex[4] = rgb[1];
+        vertex[5] = rgb[2];
+      }
+    }
+  });
+
+  return Object::BuildUpParametricGroup(vertices, w, h, true, solid);
+}
+
+template <typename SurfFunc, typename NormalFunc>
+bool Object::LoadParametricSurfSolid(SurfFunc surf, NormalFunc normal,
+                                     int numSampleU, int numSampleV)
+{
+  int w = numSampleU;
+  int h = numSampleV;
+  if (w < 2 || h < 2)
+  {
+    return false;
+  }
+
+  std::vector<GLfloat> vertices(static_cast<size_t>(w) * h * 6);
+  GLfloat* out = vertices.data();
+
+  tool::ParallelFor(0, h, kMinParametricRows, [&surf, &normal, out, w, h](int first, int last)
+  {
+    for (int y = first; y < last; y++)
+    {
+      float v = static_cast<float>(y)/(h-1);
+      GLfloat* vertex = out + static_cast<size_t>(6) * w * y;
+
+      for (int x = 0; x < w; x++, vertex += 6)
+      {
+        float u = static_cast<float>(x)/(w-1);
+        const glm::vec3 surf_uv = surf(u, v);
+        const glm::vec3 nor = normal(u, v);
+
+        vertex[0] = surf_uv[0];
+        vertex[1] = surf_uv[1];
+        vertex[2] = surf_uv[2];
+        vertex[3] = nor[0];
+        vertex[4] = nor[1];
+        vertex[5] = nor[2];
+      }
+    }
+  });
+
+  return Object::BuildUpParametricGroup(vertices, w, h, false, true);
+}
+
+template <typename SurfFunc>
+bool Object::LoadParametricSurfSolid(SurfFunc surf, int numSampleU, int numSampleV)
+{
+  int w = numSampleU;
+  int h = numSampleV;
+  if (w < 2 || h < 2)
+  {
+    return false;
+  }
+
+  std::vector<GLfloat> vertices(static_cast<size_t>(w) * h * 6);
+  GLfloat* out = vertices.data();
+
+  tool::ParallelFor(0, h, kMinParametricRows, [&surf, out, w, h](int first, int last)
+  {
+    glm::vec3 position, normal, tangent;
+
+    for (int y = first; y < last; y++)
+    {
+      float v = static_cast<float>(y)/(h-1);
+      GLfloat* vertex = out + static_cast<size_t>(6) * w * y;
+
+      for (int x = 0; x < w; x++, vertex += 6)
+      {
+        float u = static_cast<float>(x)/(w-1);
+        EvaluateSurfaceFrame(surf, u, v, position, normal, tangent);
+
+        vertex[0] = position[0];
+        vertex[1] = position[1];
+        vertex[2] = position[2];
+        vertex[3] = normal[0];
+        vertex[4] = normal[1];
+        vertex[5] = normal[2];
+      }
+    }
+  });
+
+  return Object::BuildUpParametricGroup(vertices, w, h, false, true);
+}
+
+template <typename SurfFunc>
+bool Object::LoadParametricSurfAdaptive(SurfFunc surf, const AdaptiveTessellator::Params& params)
+{
+  AdaptiveTessellator tessellator;
+  tessellator.Tessellate([&surf](float u, float v, glm::vec3& position, glm::vec3& normal)
+  {
+    glm::vec3 tangent;
+    EvaluateSurfaceFrame(surf, u, v, position, normal, tangent);
+  }, params);
+
+  return Object::BuildUpTriangleGroup(tessellator.GetVertices(), tessellator.GetIndices());
+}
+
+template <typename Field>
+bool Object::LoadImplicitSurface(const Field& field, const ImplicitPolygonizer::Params& params)
+{
+  ImplicitPolygonizer polygonizer;
+  polygonizer.Polygonize(field, params);
+
+  return Object::BuildUpTriangleGroup(polygonizer.GetVertices(), polygonizer.GetIndices());
+}
+
 }  // namespace obj
 }  // namespace gloo
 
@@ -0,0 +1,387 @@
+#include "occlusion_culler.h"
+
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+namespace gloo
+{
+
+namespace
+{
+
+// Rows per band - each band is rasterized by one thread, so no pixel is shared.
+const int kBandRows = 16;
+
+// Boxes are tested on the first pyramid level where they span at most this many texels
+// across (coarser levels are cheaper but hide less).
+const int kTestTexels = 4;
+
+// Triangles drawn by a mesh, as counted for the occlusion statistics.
+int NumTriangles(const Mesh* mesh)
+{
+  switch (mesh->GetDrawMode())
+  {
+    case GL_TRIANGLES:      return mesh->GetNumIndices() / 3;
+    case GL_TRIANGLE_STRIP:
+    case GL_TRIANGLE_FAN:   return std::max(mesh->GetNumIndices() - 2, 0);
+    default:                return 0;
+  }
+}
+
+}  // namespace.
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+: mWidth(width), mHeight(height)
+{
+  int w = width, h = height;
+  while (true)
+  {
+    mLevels.emplace_back(w * h, 1.0f);
+    mLevelWidths.push_back(w);
+    mLevelHeights.push_back(h);
+
+    if (w == 1 && h == 1)
+      break;
+
+    w = (w + 1) / 2;
+    h = (h + 1) / 2;
+  }
+}
+
+// ==== Scene interface ==== //
+
+void OcclusionCuller::Cull(const std::vector<SceneObject*>& objects, const SceneBVH* bvh,
+                           Camera* camera, std::vector<char>& occluded, bool gpuDriven)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  const glm::mat4& V = camera->GetViewMatrix().GetGLMatrix();
+  const glm::mat4& P = camera->GetProjMatrix().GetGLMatrix();
+  OcclusionCuller::Begin(P * V);
+
+  for (auto object : objects)
+  {
+    if (object->IsOccluder() && object->IsInitialized())
+    {
+      OcclusionCuller::AddOccluder(object->GetMesh(), object->GetModelMatrix().GetGLMatrix());
+    }
+  }
+  OcclusionCuller::Finish();
+
+  auto rasterized = std::chrono::steady_clock::now();
+  mStats.rasterTime = std::chrono::duration<float, std::milli>(rasterized - start).count();
+
+  auto test = [this](const AABB& bounds)
+  {
+    mStats.numTested++;
+    return !OcclusionCuller::IsOccluded(bounds);
+  };
+
+  // Everything is hidden unless reached through visible nodes of the scene BVH.
+  std::vector<int> visible;
+  if (bvh && bvh->GetNumInstances() == static_cast<int>(objects.size()))
+  {
+    bvh->Collect(test, visible);
+    occluded.assign(objects.size(), 1);
+  }
+  else
+  {
+    occluded.assign(objects.size(), 0);
+    for (int i = 0; i < static_cast<int>(objects.size()); i++)
+    {
+      if (!objects[i]->IsOccluder() && !test(objects[i]->GetWorldBounds()))
+      {
+        occluded[i] = 1;
+      }
+    }
+  }
+
+  for (int i : visible)
+  {
+    occluded[i] = 0;
+  }
+
+  for (int i = 0; i < static_cast<int>(objects.size()); i++)
+  {
+    // Drawn anyway: not counted as savings.
+    if (occluded[i] && (objects[i]->IsOccluder() ||
+                        (gpuDriven && GpuDrivenPass::Draws(objects[i]))))
+    {
+      occluded[i] = 0;
+    }
+    else if (occluded[i])
+    {
+      mStats.numOccluded++;
+      if (objects[i]->IsInitialized())
+        mStats.numOccludedTriangles += NumTriangles(objects[i]->GetMesh());
+    }
+  }
+
+  auto elapsed = std::chrono::steady_clock::now() - rasterized;
+  mStats.testTime = std::chrono::duration<float, std::milli>(elapsed).count();
+}
+
+// ==== Low level interface ==== //
+
+void OcclusionCuller::Begin(const glm::mat4& viewProj)
+{
+  mViewProj = viewProj;
+  mTriangles.clear();
+  mStats = Stats();
+  std::fill(mLevels[0].begin(), mLevels[0].end(), 1.0f);
+}
+
+int OcclusionCuller::AddOccluder(const Mesh* mesh, const glm::mat4& model)
+{
+  mIndices.clear();
+  if (mesh->GetTriangles(mIndices) == 0)
+  {
+    return 0;
+  }
+
+  glm::mat4 MVP = mViewProj * model;
+  int n = mesh->GetNumVertices();
+  mClip.resize(n);
+  for (int i = 0; i < n; i++)
+  {
+    mClip[i] = MVP * glm::vec4(mesh->GetPosition(i), 1.0f);
+  }
+
+  int numAdded = 0;
+  for (size_t t = 0; t + 2 < mIndices.size(); t += 3)
+  {
+    const glm::vec4* corners[3] = { &mClip[mIndices[t]], &mClip[mIndices[t + 1]],
+                                    &mClip[mIndices[t + 2]] };
+
+    // Clip by the near plane (z = -w): at most 4 corners are left.
+    glm::vec4 polygon[4];
+    int numCorners = 0;
+    for (int k = 0; k < 3; k++)
+    {
+      const glm::vec4& p = *corners[k];
+      const glm::vec4& q = *corners[(k + 1) % 3];
+      float dp = p[2] + p[3];
+      float dq = q[2] + q[3];
+
+      if (dp >= 0.0f)
+        polygon[numCorners++] = p;
+
+      if ((dp >= 0.0f) != (dq >= 0.0f))
+        polygon[numCorners++] = p + (dp / (dp - dq)) * (q - p);
+    }
+
+    for (int k = 2; k < numCorners; k++)
+    {
+      numAdded += OcclusionCuller::AddTriangle(polygon[0], polygon[k - 1], polygon[k]);
+    }
+  }
+
+  mStats.numOccluders++;
+  mStats.numOccluderTriangles += numAdded;
+  return numAdded;
+}
+
+bool OcclusionCuller::AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+  ScreenTriangle triangle;
+  const glm::vec4* corners[3] = { &a, &b, &c };
+  for (int k = 0; k < 3; k++)
+  {
+    const glm::vec4& p = *corners[k];
+    triangle.v[k] = glm::vec3((0.5f * p[0] / p[3] + 0.5f) * mWidth,
+                              (0.5f * p[1] / p[3] + 0.5f) * mHeight,
+                               0.5f * p[2] / p[3] + 0.5f);
+  }
+
+  glm::vec3* v = triangle.v;
+  float area = (v[1][0] - v[0][0]) * (v[2][1] - v[0][1]) - (v[2][0] - v[0][0]) * (v[1][1] - v[0][1]);
+  if (std::abs(area) < 1e-6f)
+  {
+    return false;
+  }
+
+  // Occluders hide from both sides.
+  if (area < 0.0f)
+  {
+    std::swap(v[1], v[2]);
+  }
+
+  // Pixels whose centers may be inside.
+  float minX = std::min(v[0][0], std::min(v[1][0], v[2][0]));
+  float maxX = std::max(v[0][0], std::max(v[1][0], v[2][0]));
+  float minY = std::min(v[0][1], std::min(v[1][1], v[2][1]));
+  float maxY = std::max(v[0][1], std::max(v[1][1], v[2][1]));
+
+  triangle.minX = std::max(static_cast<int>(std::ceil(minX - 0.5f)), 0);
+  triangle.maxX = std::min(static_cast<int>(std::floor(maxX - 0.5f)), mWidth - 1);
+  triangle.minY = std::max(static_cast<int>(std::ceil(minY - 0.5f)), 0);
+  triangle.maxY = std::min(static_cast<int>(std::floor(maxY - 0.5f)), mHeight - 1);
+
+  if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+  {
+    return false;
+  }
+
+  mTriangles.push_back(triangle);
+  return true;
+}
+
+void OcclusionCuller::Finish()
+{
+  // Each band goes through every triangle, and draws the rows it shares with it.
+  int numBands = (mHeight + kBandRows - 1) / kBandRows;
+  auto rasterize = [this](int first, int last)
+  {
+    for (int band = first; band < last; band++)
+    {
+      int firstRow = band * kBandRows;
+      int lastRow  = std::min(firstRow + kBandRows, mHeight) - 1;
+      for (const ScreenTriangle& triangle : mTriangles)
+      {
+        if (triangle.minY <= lastRow && triangle.maxY >= firstRow)
+          OcclusionCuller::RasterizeRows(triangle, firstRow, lastRow);
+      }
+    }
+  };
+  mWorkers.ParallelFor(0, numBands, 1, rasterize);
+
+  // Each texel keeps the farthest of the (up to) 4 below it.
+  for (size_t level = 1; level < mLevels.size(); level++)
+  {
+    const std::vector<float>& fine = mLevels[level - 1];
+    std::vector<float>& coarse = mLevels[level];
+    int fineW = mLevelWidths[level - 1];
+    int fineH = mLevelHeights[level - 1];
+    int w = mLevelWidths[level];
+    int h = mLevelHeights[level];
+
+    for (int y = 0; y < h; y++)
+    {
+      const float* row0 = &fine[(2 * y) * fineW];
+      const float* row1 = &fine[std::min(2 * y + 1, fineH - 1) * fineW];
+      float* out = &coarse[y * w];
+      for (int x = 0; x < w; x++)
+      {
+        int x0 = 2 * x;
+        int x1 = std::min(2 * x + 1, fineW - 1);
+        out[x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+      }
+    }
+  }
+}
+
+void OcclusionCuller::RasterizeRows(const ScreenTriangle& triangle, int firstRow, int lastRow)
+{
+  const glm::vec3* v = triangle.v;
+
+  // Edge functions e = A x + B y + C, positive inside (the corners are counter-clockwise).
+  // The coefficients of a shared edge are exactly negated in the neighbour triangle, so no
+  // pixel center on it falls through the gap.
+  float A[3], B[3], C[3];
+  for (int k = 0; k < 3; k++)
+  {
+    const glm::vec3& p = v[k];
+    const glm::vec3& q = v[(k + 1) % 3];
+    A[k] = p[1] - q[1];
+    B[k] = q[0] - p[0];
+    C[k] = p[0] * q[1] - p[1] * q[0];
+  }
+
+  // Depth plane z = zx x + zy y + z0 (z / w is linear in screen space).
+  float area = A[0] * (v[2][0] - v[0][0]) + B[0] * (v[2][1] - v[0][1]);
+  float zx = ((v[1][2] - v[0][2]) * (v[2][1] - v[0][1]) - (v[2][2] - v[0][2]) * (v[1][1] - v[0][1])) / area;
+  float zy = ((v[2][2] - v[0][2]) * (v[1][0] - v[0][0]) - (v[1][2] - v[0][2]) * (v[2][0] - v[0][0])) / area;
+  float z0 = v[0][2] - zx * v[0][0] - zy * v[0][1];
+
+  std::vector<float>& depth = mLevels[0];
+  int y0 = std::max(firstRow, triangle.minY);
+  int y1 = std::min(lastRow, triangle.maxY);
+  int x0 = triangle.minX;
+  int x1 = triangle.maxX;
+
+  for (int y = y0; y <= y1; y++)
+  {
+    float py = y + 0.5f;
+    float c0 = B[0] * py + C[0];
+    float c1 = B[1] * py + C[1];
+    float c2 = B[2] * py + C[2];
+    float cz = zy * py + z0;
+    float* row = &depth[y * mWidth];
+
+    // Branchless, so it vectorizes.
+    for (int x = x0; x <= x1; x++)
+    {
+      float px = x + 0.5f;
+      float z = zx * px + cz;
+      bool inside = (A[0] * px + c0 >= 0.0f) & (A[1] * px + c1 >= 0.0f) &
+                    (A[2] * px + c2 >= 0.0f) & (z < row[x]);
+      row[x] = inside ? z : row[x];
+    }
+  }
+}
+
+bool OcclusionCuller::IsOccluded(const AABB& bounds) const
+{
+  if (!bounds.Valid())
+  {
+    return false;
+  }
+
+  // Screen rectangle and nearest depth of the corners.
+  float minX =  1e30f, minY =  1e30f;
+  float maxX = -1e30f, maxY = -1e30f;
+  float nearest = 1.0f;
+  for (int i = 0; i < 8; i++)
+  {
+    glm::vec3 corner((i & 1) ? bounds.max[0] : bounds.min[0],
+                     (i & 2) ? bounds.max[1] : bounds.min[1],
+                     (i & 4) ? bounds.max[2] : bounds.min[2]);
+    glm::vec4 p = mViewProj * glm::vec4(corner, 1.0f);
+
+    // Crosses the near plane: its projection is unbounded.
+    if (p[2] < -p[3])
+      return false;
+
+    float x = (0.5f * p[0] / p[3] + 0.5f) * mWidth;
+    float y = (0.5f * p[1] / p[3] + 0.5f) * mHeight;
+    minX = std::min(minX, x);
+    maxX = std::max(maxX, x);
+    minY = std::min(minY, y);
+    maxY = std::max(maxY, y);
+    nearest = std::min(nearest, 0.5f * p[2] / p[3] + 0.5f);
+  }
+
+  // Every pixel the box touches (off screen boxes are left to frustum culling).
+  int x0 = std::max(static_cast<int>(std::floor(minX)), 0);
+  int x1 = std::min(static_cast<int>(std::floor(maxX)), mWidth - 1);
+  int y0 = std::max(static_cast<int>(std::floor(minY)), 0);
+  int y1 = std::min(static_cast<int>(std::floor(maxY)), mHeight - 1);
+  if (x0 > x1 || y0 > y1)
+  {
+    return false;
+  }
+
+  int level = 0;
+  int last = static_cast<int>(mLevels.size()) - 1;
+  while (level < last && ((x1 >> level) - (x0 >> level) >= kTestTexels ||
+                          (y1 >> level) - (y0 >> level) >= kTestTexels))
+  {
+    level++;
+  }
+
+  const std::vector<float>& depth = mLevels[level];
+  int w = mLevelWidths[level];
+  for (int y = y0 >> level; y <= (y1 >> level); y++)
+  {
+    for (int x = x0 >> level; x <= (x1 >> level); x++)
+    {
+      if (depth[y * w + x] >= nearest)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace gloo.
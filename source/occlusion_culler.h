@@ -0,0 +1,124 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "ray.h"
+#include "parallel.h"
+#include "scene_object.h"
+#include "scene_bvh.h"
+#include "gpu_driven_pass.h"
+#include "camera.h"
+
+//  +-------------------------------------------------+
+//  |  Software occlusion culling on the CPU.         |
+//  |                                                 |
+//  |  The triangles of a few large occluders (walls, |
+//  |  buildings, terrain) are rasterized into a      |
+//  |  small depth buffer, split in bands of rows     |
+//  |  over worker threads. A pyramid of maximum      |
+//  |  depths (each texel the farthest occluder depth |
+//  |  below it) is built on top, and a box is hidden |
+//  |  when its nearest point lies behind the         |
+//  |  farthest depth over the pixels it covers -     |
+//  |  a few pyramid texels per test.                 |
+//  |                                                 |
+//  |  The test is conservative: anything crossing    |
+//  |  the near plane, or not covered by occluders    |
+//  |  everywhere, is visible.                        |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class OcclusionCuller
+{
+public:
+  struct Stats  // Of the last Cull.
+  {
+    int numOccluders         { 0 };  // Objects rasterized.
+    int numOccluderTriangles { 0 };  // Triangles rasterized (in front of the near plane).
+    int numTested            { 0 };  // Boxes tested - scene BVH nodes and objects.
+    int numOccluded          { 0 };  // Objects culled (whole groups count each object).
+    int numOccludedTriangles { 0 };  // Triangles those objects would have drawn.
+    float rasterTime { 0.0f };       // Rasterization and pyramid build, in ms.
+    float testTime   { 0.0f };       // Box tests, in ms.
+  };
+
+  explicit OcclusionCuller(int width = 256, int height = 128);
+
+  // ==== Scene interface ==== //
+
+  // Rasterizes the objects marked with SceneObject::SetOccluder as seen from camera, then
+  // sets occluded[i] for the hidden objects[i]. Whole groups are tested at once by walking
+  // bvh (built over the same objects); without it, objects are tested one by one.
+  // Occluders themselves are never culled, and neither are the objects GpuDrivenPass draws
+  // when gpuDriven is set (that pass culls them on its own).
+  void Cull(const std::vector<SceneObject*>& objects, const SceneBVH* bvh, Camera* camera,
+            std::vector<char>& occluded, bool gpuDriven = false);
+
+  // ==== Low level interface ==== //
+
+  // Clears the depth buffer for a new view (world to clip space).
+  void Begin(const glm::mat4& viewProj);
+
+  // Queues the triangles of mesh (a triangle list or strip) with the given model matrix,
+  // clipped by the near plane. Returns how many were queued.
+  int AddOccluder(const Mesh* mesh, const glm::mat4& model);
+
+  // Rasterizes the queued triangles and builds the depth pyramid - call after the last
+  // AddOccluder, before testing.
+  void Finish();
+
+  // True if the world space box is certainly hidden by the occluders.
+  bool IsOccluded(const AABB& bounds) const;
+
+  inline int GetWidth()  const { return mWidth;  }
+  inline int GetHeight() const { return mHeight; }
+
+  // Depth of the nearest occluder at pixel (x, y): 0 at the near plane, 1 at the far one.
+  inline float GetDepth(int x, int y) const { return mLevels[0][y * mWidth + x]; }
+
+  inline const Stats& GetStats() const { return mStats; }
+
+private:
+  struct ScreenTriangle
+  {
+    glm::vec3 v[3];      // Pixel coordinates and depth, counter-clockwise.
+    int minX, maxX;      // Pixels it may cover (clamped to the buffer).
+    int minY, maxY;
+  };
+
+  // Queues a triangle given in clip space (in front of the near plane). Returns false if it
+  // covers no pixel centers for sure (degenerate or off screen).
+  bool AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+
+  // Draws the part of triangle within rows [firstRow, lastRow] into the depth buffer.
+  void RasterizeRows(const ScreenTriangle& triangle, int firstRow, int lastRow);
+
+  int mWidth, mHeight;
+  glm::mat4 mViewProj;
+
+  // Level 0 is the depth buffer, and each next level half its size (rounded up).
+  std::vector<std::vector<float>> mLevels;
+  std::vector<int> mLevelWidths;
+  std::vector<int> mLevelHeights;
+
+  std::vector<ScreenTriangle> mTriangles;  // Set up by AddOccluder, drawn by Finish.
+  std::vector<GLuint> mIndices;
+  std::vector<glm::vec4> mClip;
+
+  tool::WorkerPool mWorkers;
+  Stats mStats;
+};
+
+}  // namespace gloo.
@@ -0,0 +1,196 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <condition_variable>
+
+//  +-------------------------------------------------+
+//  |  Minimal fork-join helpers: a range is split    |
+//  |  into contiguous chunks, one per hardware       |
+//  |  thread, and the caller waits for all of them.  |
+//  |  Meant for coarse CPU work (terrain, meshing,   |
+//  |  tessellation), not for tiny loops.             |
+//  |                                                 |
+//  |  WorkerPool does the same with threads that     |
+//  |  are kept alive between calls, for work done    |
+//  |  every frame (no thread creation, no heap).     |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+namespace tool
+{
+
+// Number of threads used by ParallelFor (at least 1).
+inline int NumThreads()
+{
+  static const int numThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  return numThreads;
+}
+
+// Calls func(first, last) over disjoint chunks covering [begin, end). Chunks are never smaller
+// than minChunk items, so small ranges run entirely on the calling thread.
+template <typename Func>
+void ParallelFor(int begin, int end, int minChunk, Func func)
+{
+  int count = end - begin;
+  if (count <= 0)
+  {
+    return;
+  }
+
+  int numChunks = std::min(NumThreads(), std::max(1, count / std::max(minChunk, 1)));
+  if (numChunks == 1)
+  {
+    func(begin, end);
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  workers.reserve(numChunks - 1);
+
+  // The calling thread takes the first chunk.
+  for (int k = 1; k < numChunks; k++)
+  {
+    int first = begin + static_cast<int>(static_cast<long long>(count) * k / numChunks);
+    int last  = begin + static_cast<int>(static_cast<long long>(count) * (k+1) / numChunks);
+    workers.emplace_back(func, first, last);
+  }
+
+  func(begin, begin + count / numChunks);
+
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+}
+
+class WorkerPool
+{
+public:
+  // The calling thread works too, so numThreads - 1 threads are started.
+  explicit WorkerPool(int numThreads = NumThreads())
+  {
+    for (int k = 1; k < numThreads; k++)
+    {
+      mWorkers.emplace_back(&WorkerPool::WorkerLoop, this, k);
+    }
+  }
+
+  ~WorkerPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mQuit = true;
+    }
+    mStart.notify_all();
+
+    for (auto& worker : mWorkers)
+    {
+      worker.join();
+    }
+  }
+
+  inline int GetNumThreads() const { return static_cast<int>(mWorkers.size()) + 1; }
+
+  // Same contract as tool::ParallelFor. func must outlive the call (it isn't copied).
+  template <typename Func>
+  void ParallelFor(int begin, int end, int minChunk, Func& func)
+  {
+    int count = end - begin;
+    if (count <= 0)
+    {
+      return;
+    }
+
+    int numChunks = std::min(GetNumThreads(), std::max(1, count / std::max(minChunk, 1)));
+    if (numChunks == 1)
+    {
+      func(begin, end);
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mBegin = begin;
+      mCount = count;
+      mNumChunks = numChunks;
+      mInvoke = &WorkerPool::Invoke<Func>;
+      mContext = &func;
+      mPending = numChunks - 1;
+      mGeneration++;
+    }
+    mStart.notify_all();
+
+    // The calling thread takes the first chunk.
+    func(begin, begin + count / numChunks);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDone.wait(lock, [this] { return mPending == 0; });
+  }
+
+private:
+  template <typename Func>
+  static void Invoke(void* context, int first, int last)
+  {
+    (*static_cast<Func*>(context))(first, last);
+  }
+
+  void WorkerLoop(int chunk)
+  {
+    unsigned generation = 0;
+    while (true)
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mStart.wait(lock, [this, generation] { return mQuit || mGeneration != generation; });
+      if (mQuit)
+      {
+        return;
+      }
+
+      generation = mGeneration;
+      if (chunk >= mNumChunks)
+      {
+        continue;  // Not needed for this range.
+      }
+
+      int first = mBegin + static_cast<int>(static_cast<long long>(mCount) * chunk / mNumChunks);
+      int last  = mBegin + static_cast<int>(static_cast<long long>(mCount) * (chunk+1) / mNumChunks);
+      void (*invoke)(void*, int, int) = mInvoke;
+      void* context = mContext;
+      lock.unlock();
+
+      invoke(context, first, last);
+
+      lock.lock();
+      if (--mPending == 0)
+      {
+        mDone.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> mWorkers;
+  std::mutex mMutex;
+  std::condition_variable mStart, mDone;
+  bool mQuit { false };
+
+  // Current range.
+  unsigned mGeneration { 0 };
+  int mBegin { 0 }, mCount { 0 }, mNumChunks { 0 }, mPending { 0 };
+  void (*mInvoke)(void*, int, int) { nullptr };
+  void* mContext { nullptr };
+};
+
+}  // namespace tool.
+}  // namespace gloo.
@@ -0,0 +1,237 @@
+#include "picking_pass.h"
+
+#include <iostream>
+#include <algorithm>
+#include <climits>
+
+namespace gloo
+{
+
+bool PickingPass::Init(int w, int h, GLuint mainProgramHandle, const std::string& shaderPath)
+{
+  if (!mProgram.Load(shaderPath, mainProgramHandle))
+  {
+    std::cerr << "ERROR Couldn't load picking shaders at " << shaderPath << ".\n";
+    return false;
+  }
+
+  // Readback buffers: (2r + 1)^2 pixels with two unsigned ints each.
+  int side = 2*kRadius + 1;
+  for (auto& readback : mReadbacks)
+  {
+    glGenBuffers(1, &readback.pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, side * side * 2 * sizeof(GLuint), nullptr, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  PickingPass::CreateTargets(w, h);
+  return IsInitialized();
+}
+
+void PickingPass::Resize(int w, int h)
+{
+  if (IsInitialized() && (w != mWidth || h != mHeight))
+  {
+    PickingPass::Invalidate();
+    PickingPass::DeleteTargets();
+    PickingPass::CreateTargets(w, h);
+  }
+}
+
+void PickingPass::CreateTargets(int w, int h)
+{
+  mWidth  = w;
+  mHeight = h;
+
+  // Color attachment: (object id + 1, primitive id).
+  glGenTextures(1, &mIdTexture);
+  glBindTexture(GL_TEXTURE_2D, mIdTexture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32UI, w, h, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, nullptr);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glGenRenderbuffers(1, &mDepthBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, mDepthBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &mFbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, mFbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mIdTexture, 0);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepthBuffer);
+
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+  {
+    std::cerr << "ERROR Picking framebuffer is incomplete.\n";
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    PickingPass::DeleteTargets();
+    return;
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void PickingPass::DeleteTargets()
+{
+  glDeleteFramebuffers(1, &mFbo);
+  glDeleteTextures(1, &mIdTexture);
+  glDeleteRenderbuffers(1, &mDepthBuffer);
+  mFbo = mIdTexture = mDepthBuffer = 0;
+}
+
+void PickingPass::Render(const std::vector<SceneObject*>& objects, Camera* camera)
+{
+  if (!mRequested || !IsInitialized())
+  {
+    return;
+  }
+
+  Readback& readback = mReadbacks[mNextReadback];
+  if (readback.fence != 0)  // All buffers in flight - try again next frame.
+  {
+    return;
+  }
+  mRequested = false;
+
+  // Region around the cursor, clipped to the framebuffer (GL origin is at the bottom).
+  readback.requestX = mRequestX;
+  readback.requestY = mRequestY;
+  readback.x  = std::min(std::max(mRequestX, 0), mWidth - 1);
+  readback.y  = std::min(std::max(mHeight - 1 - mRequestY, 0), mHeight - 1);
+  readback.x0 = std::max(readback.x - kRadius, 0);
+  readback.y0 = std::max(readback.y - kRadius, 0);
+  readback.w  = std::min(readback.x + kRadius + 1, mWidth)  - readback.x0;
+  readback.h  = std::min(readback.y + kRadius + 1, mHeight) - readback.y0;
+
+  glBindFramebuffer(GL_FRAMEBUFFER, mFbo);
+
+  // Only the pixels around the cursor are needed - scissor everything else away.
+  glEnable(GL_SCISSOR_TEST);
+  glScissor(readback.x0, readback.y0, readback.w, readback.h);
+
+  const GLuint background[4] = { 0, 0, 0, 0 };
+  glClearBufferuiv(GL_COLOR, 0, background);
+  glClear(GL_DEPTH_BUFFER_BIT);
+
+  mProgram.Bind();
+  mProgram.SetMatrix("V", camera->GetViewMatrix());
+  mProgram.SetMatrix("P", camera->GetProjMatrix());
+
+  readback.complete = true;
+  for (int i = 0; i < static_cast<int>(objects.size()); i++)
+  {
+    SceneObject* object = objects[i];
+    mProgram.SetMatrix("M", object->GetModelMatrix());
+    mProgram.SetUInt("object_id", i + 1);
+    if (!object->RenderId())
+    {
+      readback.complete = false;
+    }
+  }
+
+  glDisable(GL_SCISSOR_TEST);
+
+  // Asynchronous copy to the pixel buffer object - glReadPixels returns immediately.
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+  glReadPixels(readback.x0, readback.y0, readback.w, readback.h, GL_RG_INTEGER, GL_UNSIGNED_INT, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  mNextReadback = (mNextReadback + 1) % kNumReadbacks;
+}
+
+bool PickingPass::Poll()
+{
+  bool newResult = false;
+
+  // Visit readbacks from the oldest to the newest.
+  for (int k = 0; k < kNumReadbacks; k++)
+  {
+    Readback& readback = mReadbacks[(mNextReadback + k) % kNumReadbacks];
+    if (readback.fence == 0)
+      continue;
+
+    // Zero timeout: never wait for the GPU.
+    GLenum status = glClientWaitSync(readback.fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+      break;  // Newer readbacks can't be done either.
+
+    glDeleteSync(readback.fence);
+    readback.fence = 0;
+
+    if (status == GL_WAIT_FAILED)
+      continue;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    const GLuint* ids = static_cast<const GLuint*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+        readback.w * readback.h * 2 * sizeof(GLuint), GL_MAP_READ_BIT));
+
+    if (ids)
+    {
+      // Pick the non-background pixel closest to the cursor.
+      Result result;
+      int bestDistance = INT_MAX;
+
+      for (int py = 0; py < readback.h; py++)
+      {
+        for (int px = 0; px < readback.w; px++)
+        {
+          const GLuint* id = &ids[2 * (py * readback.w + px)];
+          int dx = readback.x0 + px - readback.x;
+          int dy = readback.y0 + py - readback.y;
+          int distance = dx*dx + dy*dy;
+
+          if (id[0] != 0 && distance < bestDistance)
+          {
+            bestDistance = distance;
+            result.object = id[0] - 1;
+            result.primitive = id[1];
+          }
+        }
+      }
+
+      result.x = readback.requestX;
+      result.y = readback.requestY;
+      result.complete = readback.complete;
+      mResult = result;
+      mHasResult = true;
+      newResult = true;
+
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  }
+
+  return newResult;
+}
+
+void PickingPass::Invalidate()
+{
+  for (auto& readback : mReadbacks)
+  {
+    if (readback.fence != 0)
+    {
+      glDeleteSync(readback.fence);
+      readback.fence = 0;
+    }
+  }
+
+  mHasResult = false;
+}
+
+PickingPass::~PickingPass()
+{
+  PickingPass::Invalidate();
+  PickingPass::DeleteTargets();
+
+  for (auto& readback : mReadbacks)
+  {
+    glDeleteBuffers(1, &readback.pbo);
+  }
+}
+
+}  // namespace gloo.
@@ -0,0 +1,105 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "shader_program.h"
+#include "scene_object.h"
+#include "camera.h"
+
+//  +-------------------------------------------------+
+//  |  GPU picking: objects are rendered into an      |
+//  |  integer framebuffer (RG32UI) storing           |
+//  |  (object id + 1, primitive id) per pixel.       |
+//  |                                                 |
+//  |  A small window around the cursor is copied to  |
+//  |  a pixel buffer object and guarded by a fence.  |
+//  |  Poll() maps it only once the fence signaled,   |
+//  |  so hover picking never stalls the pipeline -   |
+//  |  results arrive one or two frames later.        |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class PickingPass
+{
+public:
+  struct Result
+  {
+    int object    { -1 };  // Index in the rendered object list (-1 means background).
+    int primitive { -1 };  // Primitive index in the object's draw call (triangle in strip/list).
+    bool complete { false };  // Every object was drawn (see SceneObject::RenderId).
+    int x { 0 };           // Requested window coordinates.
+    int y { 0 };
+  };
+
+  PickingPass() { }
+
+  // Creates the framebuffer, the readback buffers and loads the shaders.
+  // mainProgramHandle provides the vertex attribute locations used by the meshes.
+  bool Init(int w, int h, GLuint mainProgramHandle, const std::string& shaderPath = "./shaders/picking");
+  void Resize(int w, int h);
+
+  // Asks for the object under window coordinates (x, y) (origin at the top left corner).
+  inline void RequestPick(int x, int y) { mRequestX = x; mRequestY = y; mRequested = true; }
+
+  // Renders the id buffer and starts an asynchronous readback, if a pick was requested.
+  // The caller's program is not restored - bind it again afterwards.
+  void Render(const std::vector<SceneObject*>& objects, Camera* camera);
+
+  // Collects finished readbacks without waiting. Returns true if a new result arrived.
+  bool Poll();
+
+  // Drops pending readbacks (e.g. after objects were removed, ids are no longer valid).
+  void Invalidate();
+
+  inline const Result& GetResult() const { return mResult; }
+  inline bool HasResult() const { return mHasResult; }
+  inline bool IsInitialized() const { return mFbo != 0; }
+
+  ~PickingPass();
+
+private:
+  struct Readback
+  {
+    GLuint pbo { 0 };
+    GLsync fence { 0 };
+    int x { 0 }, y { 0 };          // Requested pixel (GL coordinates).
+    int x0 { 0 }, y0 { 0 };        // Region origin (GL coordinates).
+    int w { 0 }, h { 0 };          // Region size.
+    int requestX { 0 }, requestY { 0 };
+    bool complete { false };
+  };
+
+  void CreateTargets(int w, int h);
+  void DeleteTargets();
+
+  static const int kNumReadbacks = 3;  // Ring of in-flight readbacks.
+  static const int kRadius = 3;        // Pixels read around the cursor: (2r + 1)^2.
+
+  ShaderProgram mProgram;
+  GLuint mFbo { 0 };
+  GLuint mIdTexture { 0 };
+  GLuint mDepthBuffer { 0 };
+  int mWidth  { 0 };
+  int mHeight { 0 };
+
+  Readback mReadbacks[kNumReadbacks];
+  int mNextReadback { 0 };
+
+  bool mRequested { false };
+  int mRequestX { 0 };
+  int mRequestY { 0 };
+
+  Result mResult;
+  bool mHasResult { false };
+};
+
+}  // namespace gloo.
@@ -0,0 +1,590 @@
+#include "planet.h"
+#include "parallel.h"
+
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+
+namespace gloo
+{
+
+namespace
+{
+
+const float kPi = 3.14159265f;
+
+// Chunk meshes built per frame. Nodes whose chunks aren't ready stay coarser until they are.
+const int kMaxBuildsPerFrame = 16;
+
+// Skirts hang this many times the node error below the edges.
+const float kSkirtDepth = 2.0f;
+
+// Share of the elevation range a node of level l misses, divided by 2^l (unknown detail).
+const float kReliefError = 0.5f;
+
+// Triangle budget controller: relax fast, tighten slowly (same as ChunkedTerrain).
+const float kRelaxFactor   = 1.25f;
+const float kTightenFactor = 1.1f;
+const float kTightenBelow  = 0.7f;
+
+// Cube faces: outward normal, then the axes of face coordinates a and b (right x up = normal).
+const float kFaceAxes[6][3][3] =
+{
+  { { +1, 0, 0 }, { 0, 0, -1 }, { 0, 1,  0 } },
+  { { -1, 0, 0 }, { 0, 0, +1 }, { 0, 1,  0 } },
+  { { 0, +1, 0 }, { 1, 0,  0 }, { 0, 0, -1 } },
+  { { 0, -1, 0 }, { 1, 0,  0 }, { 0, 0, +1 } },
+  { { 0, 0, +1 }, { +1, 0, 0 }, { 0, 1,  0 } },
+  { { 0, 0, -1 }, { -1, 0, 0 }, { 0, 1,  0 } },
+};
+
+// Equirectangular coordinates of a unit direction (the mapping of TexturedSphere).
+inline void SphereToTexCoord(const glm::vec3& d, float& s, float& t)
+{
+  float longitude = std::atan2(d[2], d[0]);
+  if (longitude < 0.0f)
+  {
+    longitude += 2.0f * kPi;
+  }
+  s = 1.0f - longitude / (2.0f * kPi);
+  t = 1.0f - std::acos(std::min(std::max(d[1], -1.0f), 1.0f)) / kPi;
+}
+
+inline float AngleBetween(const glm::vec3& a, const glm::vec3& b)
+{
+  return std::acos(std::min(std::max(glm::dot(a, b), -1.0f), 1.0f));
+}
+
+}  // namespace.
+
+// ================= Loading ================= //
+
+bool Planet::Load(const std::string& textureFileName, const std::string& heightmapFileName,
+                  float heightScale)
+{
+  for (auto& entry : mChunks)
+  {
+    delete entry.second.mesh;
+  }
+  mChunks.clear();
+
+  mHeightScale = 0.0f;
+  mMinRadius = mMaxRadius = 1.0f;
+  if (!heightmapFileName.empty())
+  {
+    if (!mHeightmap.Load(heightmapFileName))
+    {
+      return false;
+    }
+
+    const float* data = mHeightmap.GetData();
+    auto range = std::minmax_element(data, data + mHeightmap.GetWidth() * mHeightmap.GetHeight());
+    mHeightScale = heightScale;
+    mMinRadius = 1.0f + heightScale * ((heightScale >= 0.0f) ? *range.first : *range.second);
+    mMaxRadius = 1.0f + heightScale * ((heightScale >= 0.0f) ? *range.second : *range.first);
+  }
+
+  // Grid triangles, then two per skirt segment.
+  const int n = kGridSize + 1;
+  mIndices.clear();
+  mIndices.reserve(6 * kGridSize * kGridSize + 24 * kGridSize);
+  for (int j = 0; j < kGridSize; j++)
+  {
+    for (int i = 0; i < kGridSize; i++)
+    {
+      GLuint v00 = j * n + i, v10 = v00 + 1, v01 = v00 + n, v11 = v01 + 1;
+      mIndices.insert(mIndices.end(), { v00, v10, v11, v00, v11, v01 });
+    }
+  }
+
+  // Skirt vertex k of edge e follows the grid; edges are bottom, top, left, right.
+  auto edgeVertex = [n](int e, int k) -> GLuint
+  {
+    switch (e)
+    {
+      case 0:  return k;
+      case 1:  return (n - 1) * n + k;
+      case 2:  return k * n;
+      default: return k * n + (n - 1);
+    }
+  };
+
+  for (int e = 0; e < 4; e++)
+  {
+    for (int k = 0; k < kGridSize; k++)
+    {
+      GLuint a = edgeVertex(e, k), b = edgeVertex(e, k + 1);
+      GLuint sa = n * n + e * n + k, sb = sa + 1;
+      mIndices.insert(mIndices.end(), { a, b, sb, a, sb, sa });
+    }
+  }
+
+  // The roots are always resident.
+  for (int face = 0; face < 6; face++)
+  {
+    ChunkData data;
+    data.key = Planet::Key(face, 0, 0, 0);
+    Planet::BuildChunk(data);
+    Planet::UploadChunk(data);
+  }
+
+  mTexture = new Texture();
+  mTexture->Load(textureFileName);
+  mMaterial = new Material( glm::vec3(0.18),
+                            glm::vec3(0.8),
+                            glm::vec3(0.02) );
+
+  mUsingLighting = true;
+  return true;
+}
+
+// ================= Geometry ================= //
+
+glm::vec3 Planet::FaceToSphere(int face, float a, float b)
+{
+  const float (*axes)[3] = kFaceAxes[face];
+  glm::vec3 p(axes[0][0] + a * axes[1][0] + b * axes[2][0],
+              axes[0][1] + a * axes[1][1] + b * axes[2][1],
+              axes[0][2] + a * axes[1][2] + b * axes[2][2]);
+
+  // Cube to sphere mapping with nearly uniform cell areas (better than normalizing p).
+  float x2 = p[0] * p[0], y2 = p[1] * p[1], z2 = p[2] * p[2];
+  glm::vec3 s(p[0] * std::sqrt(std::max(1.0f - 0.5f * (y2 + z2) + y2 * z2 / 3.0f, 0.0f)),
+              p[1] * std::sqrt(std::max(1.0f - 0.5f * (z2 + x2) + z2 * x2 / 3.0f, 0.0f)),
+              p[2] * std::sqrt(std::max(1.0f - 0.5f * (x2 + y2) + x2 * y2 / 3.0f, 0.0f)));
+
+  return glm::normalize(s);  // Exact on the face, keeps slightly outside points usable.
+}
+
+float Planet::Elevation(const glm::vec3& direction) const
+{
+  if (!mHeightmap.IsLoaded())
+  {
+    return 0.0f;
+  }
+
+  float s, t;
+  SphereToTexCoord(direction, s, t);
+
+  int w = mHeightmap.GetWidth(), h = mHeightmap.GetHeight();
+  float fx = std::min(std::max(s, 0.0f), 1.0f) * (w - 1);
+  float fy = std::min(std::max(t, 0.0f), 1.0f) * (h - 1);
+  int x0 = std::min(static_cast<int>(fx), w - 2), y0 = std::min(static_cast<int>(fy), h - 2);
+  float u = fx - x0, v = fy - y0;
+
+  return (mHeightmap.At(x0, y0)   * (1.0f - u) + mHeightmap.At(x0+1, y0)   * u) * (1.0f - v) +
+         (mHeightmap.At(x0, y0+1) * (1.0f - u) + mHeightmap.At(x0+1, y0+1) * u) * v;
+}
+
+float Planet::SurfaceRadius(const glm::vec3& direction) const
+{
+  return 1.0f + mHeightScale * Planet::Elevation(direction);
+}
+
+void Planet::BuildChunk(ChunkData& data) const
+{
+  int face  = static_cast<int>(data.key >> 61);
+  int level = static_cast<int>((data.key >> 56) & 0x1F);
+  int y = static_cast<int>((data.key >> 28) & 0xFFFFFFF);
+  int x = static_cast<int>(data.key & 0xFFFFFFF);
+
+  const int n = kGridSize + 1;
+  const int ring = n + 2;  // One extra vertex around the grid for normals.
+  const float step = 2.0f / (kGridSize << level);
+  const float a0 = -1.0f + x * kGridSize * step;
+  const float b0 = -1.0f + y * kGridSize * step;
+
+  std::vector<glm::vec3> points(ring * ring);
+  for (int j = 0; j < ring; j++)
+  {
+    for (int i = 0; i < ring; i++)
+    {
+      glm::vec3 direction = Planet::FaceToSphere(face, a0 + (i - 1) * step, b0 + (j - 1) * step);
+      points[j * ring + i] = Planet::SurfaceRadius(direction) * direction;
+    }
+  }
+
+  // Texture coordinates are unwrapped around the center, so chunks across the date line don't
+  // interpolate over the whole texture.
+  float centerS, centerT;
+  SphereToTexCoord(Planet::FaceToSphere(face, a0 + 0.5f * kGridSize * step,
+                                        b0 + 0.5f * kGridSize * step), centerS, centerT);
+
+  int numVertices = n * n + 4 * n;
+  data.positions.resize(3 * numVertices);
+  data.normals.resize(3 * numVertices);
+  data.texCoords.resize(2 * numVertices);
+
+  for (int j = 0; j < n; j++)
+  {
+    for (int i = 0; i < n; i++)
+    {
+      const glm::vec3* p = &points[(j + 1) * ring + (i + 1)];
+      glm::vec3 direction = glm::normalize(*p);
+      glm::vec3 normal = direction;
+      if (mHeightScale != 0.0f)
+      {
+        normal = glm::normalize(glm::cross(p[1] - p[-1], p[ring] - p[-ring]));
+      }
+
+      float s, t;
+      SphereToTexCoord(direction, s, t);
+      s += (s - centerS > 0.5f) ? -1.0f : ((s - centerS < -0.5f) ? 1.0f : 0.0f);
+
+      int index = j * n + i;
+      for (int c = 0; c < 3; c++)
+      {
+        data.positions[3 * index + c] = (*p)[c];
+        data.normals[3 * index + c] = normal[c];
+      }
+      data.texCoords[2 * index + 0] = s;
+      data.texCoords[2 * index + 1] = t;
+    }
+  }
+
+  // Skirts: copies of the edge vertices, lowered towards the center.
+  float skirtScale = 1.0f - kSkirtDepth * Planet::NodeError(level);
+  for (int e = 0; e < 4; e++)
+  {
+    for (int k = 0; k < n; k++)
+    {
+      int edge = (e == 0) ? k : ((e == 1) ? (n - 1) * n + k : ((e == 2) ? k * n : k * n + n - 1));
+      int index = n * n + e * n + k;
+      for (int c = 0; c < 3; c++)
+      {
+        data.positions[3 * index + c] = skirtScale * data.positions[3 * edge + c];
+        data.normals[3 * index + c] = data.normals[3 * edge + c];
+      }
+      data.texCoords[2 * index + 0] = data.texCoords[2 * edge + 0];
+      data.texCoords[2 * index + 1] = data.texCoords[2 * edge + 1];
+    }
+  }
+}
+
+void Planet::UploadChunk(const ChunkData& data) const
+{
+  Mesh* mesh = new Mesh();
+  mesh->SetProgramHandle(mProgramHandle);
+  mesh->Load(data.positions.data(),
+             nullptr,
+             data.normals.data(),
+             data.texCoords.data(),
+             mIndices.data(),
+             static_cast<int>(data.positions.size() / 3),
+             static_cast<int>(mIndices.size()),
+             GL_TRIANGLES,
+             Mesh::kSubBuffered
+            );
+
+  Chunk& chunk = mChunks[data.key];
+  delete chunk.mesh;
+  chunk.mesh = mesh;
+  chunk.lastFrame = mFrame;
+}
+
+// ================= LOD selection ================= //
+
+void Planet::NodeBounds(int face, int level, int x, int y, glm::vec3& center, float& radius,
+                        glm::vec3& axis, float& halfAngle) const
+{
+  const float size = 2.0f / (1 << level);
+  const float a0 = -1.0f + x * size, b0 = -1.0f + y * size;
+
+  axis = Planet::FaceToSphere(face, a0 + 0.5f * size, b0 + 0.5f * size);
+
+  // Corners are the directions furthest from the axis (patches are smaller than a hemisphere).
+  halfAngle = 0.0f;
+  for (int k = 0; k < 4; k++)
+  {
+    glm::vec3 corner = Planet::FaceToSphere(face, a0 + (k & 1) * size, b0 + (k >> 1) * size);
+    halfAngle = std::max(halfAngle, AngleBetween(axis, corner));
+  }
+
+  // Sphere around the cylinder that holds the patch between the lowest and highest surface.
+  float low = mMinRadius * std::cos(halfAngle), high = mMaxRadius;
+  float lateral = mMaxRadius * std::sin(halfAngle);
+  center = (0.5f * (low + high)) * axis;
+  radius = std::sqrt(0.25f * (high - low) * (high - low) + lateral * lateral);
+}
+
+bool Planet::BehindHorizon(const glm::vec3& axis, float halfAngle, const glm::vec3& cameraPos) const
+{
+  // Points at radius R are visible within an angle of acos(r/d) + acos(r/R) from the camera
+  // direction, for the lowest surface r and a camera at distance d from the center.
+  float d = glm::length(cameraPos);
+  if (d <= mMinRadius)
+  {
+    return false;
+  }
+
+  float horizon = std::acos(mMinRadius / d) + std::acos(mMinRadius / mMaxRadius);
+  return (AngleBetween(axis, cameraPos / d) - halfAngle > horizon);
+}
+
+float Planet::NodeError(int level) const
+{
+  // Sagitta of a cell (the face spans about a quarter of a great circle) plus unknown detail.
+  float cell = 0.5f * kPi / (kGridSize << level);
+  return 0.125f * cell * cell + kReliefError * (mMaxRadius - mMinRadius) / (1 << level);
+}
+
+bool Planet::RequestChunk(uint64_t key) const
+{
+  auto it = mChunks.find(key);
+  if (it != mChunks.end())
+  {
+    it->second.lastFrame = mFrame;
+    return true;
+  }
+
+  if (static_cast<int>(mPendingChunks.size()) >= kMaxBuildsPerFrame)
+  {
+    return false;
+  }
+
+  mChunks[key].lastFrame = mFrame;
+  mPendingChunks.emplace_back();
+  mPendingChunks.back().key = key;
+  return true;
+}
+
+bool Planet::ChildrenAvailable(int face, int level, int x, int y) const
+{
+  int missing = 0;
+  for (int k = 0; k < 4; k++)
+  {
+    missing += (mChunks.count(Planet::Key(face, level + 1, 2*x + (k & 1), 2*y + (k >> 1))) == 0);
+  }
+
+  if (static_cast<int>(mPendingChunks.size()) + missing > kMaxBuildsPerFrame)
+  {
+    return false;
+  }
+
+  for (int k = 0; k < 4; k++)
+  {
+    Planet::RequestChunk(Planet::Key(face, level + 1, 2*x + (k & 1), 2*y + (k >> 1)));
+  }
+  return true;
+}
+
+void Planet::SelectNode(int face, int level, int x, int y, const Frustum& frustum,
+                        const glm::vec3& cameraPos) const
+{
+  glm::vec3 center, axis;
+  float radius, halfAngle;
+  Planet::NodeBounds(face, level, x, y, center, radius, axis, halfAngle);
+
+  if (!frustum.Intersects(center, radius))
+  {
+    mStats.numFrustumCulled++;
+    return;
+  }
+
+  if (Planet::BehindHorizon(axis, halfAngle, cameraPos))
+  {
+    mStats.numHorizonCulled++;
+    return;
+  }
+
+  float distance = std::max(glm::length(center - cameraPos) - radius, 1e-6f);
+  bool refine = (level < kMaxLevel) &&
+                (Planet::NodeError(level) * mErrorScale > mScreenError * distance);
+
+  uint64_t key = Planet::Key(face, level, x, y);
+  if (refine && Planet::ChildrenAvailable(face, level, x, y))
+  {
+    for (int k = 0; k < 4; k++)
+    {
+      Planet::SelectNode(face, level + 1, 2*x + (k & 1), 2*y + (k >> 1), frustum, cameraPos);
+    }
+    return;
+  }
+
+  if (!Planet::RequestChunk(key))
+  {
+    // Evicted and no builds left this frame: the children may still be resident.
+    if (level < kMaxLevel && Planet::ChildrenAvailable(face, level, x, y))
+    {
+      for (int k = 0; k < 4; k++)
+      {
+        Planet::SelectNode(face, level + 1, 2*x + (k & 1), 2*y + (k >> 1), frustum, cameraPos);
+      }
+    }
+    return;
+  }
+
+  mSelection.push_back({ key, distance });
+}
+
+void Planet::EvictChunks() const
+{
+  int excess = static_cast<int>(mChunks.size()) - mMaxCachedChunks;
+  if (excess <= 0)
+  {
+    return;
+  }
+
+  // Least recently used first; roots and chunks used in this frame stay.
+  std::vector<std::pair<unsigned, uint64_t>> candidates;
+  for (const auto& entry : mChunks)
+  {
+    int level = static_cast<int>((entry.first >> 56) & 0x1F);
+    if (level > 0 && entry.second.lastFrame < mFrame)
+    {
+      candidates.emplace_back(entry.second.lastFrame, entry.first);
+    }
+  }
+
+  excess = std::min(excess, static_cast<int>(candidates.size()));
+  std::nth_element(candidates.begin(), candidates.begin() + excess, candidates.end());
+
+  for (int i = 0; i < excess; i++)
+  {
+    auto it = mChunks.find(candidates[i].second);
+    delete it->second.mesh;
+    mChunks.erase(it);
+  }
+}
+
+// ================= Rendering ================= //
+
+void Planet::Render() const
+{
+  if (!Planet::IsLoaded())
+  {
+    return;
+  }
+
+  mFrame++;
+  mStats = Stats();
+  mStats.screenError = mScreenError;
+  mSelection.clear();
+
+  if (mCamera)
+  {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    mErrorScale = std::max(viewport[3], 1) / (2.0f * std::tan(0.5f * mCamera->GetFovy()));
+
+    // Selection and culling happen in model space.
+    const glm::mat4& M = mModelMatrix.GetGLMatrix();
+    const glm::mat4& V = mCamera->GetViewMatrix().GetGLMatrix();
+    const glm::mat4& P = mCamera->GetProjMatrix().GetGLMatrix();
+    glm::mat4 VM = V * M;
+
+    Frustum frustum(P * VM);
+    glm::vec3 cameraPos = glm::vec3(glm::inverse(VM) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+    for (int face = 0; face < 6; face++)
+    {
+      Planet::SelectNode(face, 0, 0, 0, frustum, cameraPos);
+    }
+  }
+  else
+  {
+    for (int face = 0; face < 6; face++)
+    {
+      mSelection.push_back({ Planet::Key(face, 0, 0, 0), 0.0f });
+    }
+  }
+
+  // New chunks are built in parallel, then sent to the graphics card.
+  tool::ParallelFor(0, static_cast<int>(mPendingChunks.size()), 1, [this](int first, int last)
+  {
+    for (int i = first; i < last; i++)
+    {
+      Planet::BuildChunk(mPendingChunks[i]);
+    }
+  });
+
+  for (const ChunkData& data : mPendingChunks)
+  {
+    Planet::UploadChunk(data);
+  }
+  mStats.numBuilt = static_cast<int>(mPendingChunks.size());
+  mPendingChunks.clear();
+
+  // Front to back, so that early depth testing rejects hidden chunks.
+  std::sort(mSelection.begin(), mSelection.end(), [](const Selection& a, const Selection& b)
+  {
+    return a.distance < b.distance;
+  });
+
+  // Same state as SceneObject::Render, once for all chunks.
+  mPipelineProgram->SetModelMatrix(mModelMatrix);
+
+  GLuint matLoc = glGetUniformLocation(mProgramHandle, "material_on");
+  if (HasMaterial())
+  {
+    mMaterial->Bind(mProgramHandle);
+    glUniform1i(matLoc, 1);
+  }
+  else
+  {
+    glUniform1i(matLoc, 0);
+  }
+
+  GLuint texLoc = glGetUniformLocation(mProgramHandle, "tex_on");
+  if (HasTexture() && mTexture->Valid())
+  {
+    glEnable(GL_TEXTURE_2D);
+    mTexture->Bind(mProgramHandle);
+    glUniform1i(texLoc, 1);
+  }
+  else
+  {
+    glDisable(GL_TEXTURE_2D);
+    glUniform1i(texLoc, 0);
+  }
+
+  GLuint lightOnLoc = glGetUniformLocation(mProgramHandle, "light_on");
+  glUniform1i(lightOnLoc, mUsingLighting);
+
+  const int chunkTriangles = static_cast<int>(mIndices.size()) / 3;
+  for (const Selection& selection : mSelection)
+  {
+    mChunks[selection.key].mesh->Render();
+    mStats.numChunks++;
+    mStats.numTriangles += chunkTriangles;
+  }
+
+  // Keep the triangle count within budget (takes effect next frame).
+  if (mTriangleBudget > 0)
+  {
+    if (mStats.numTriangles > mTriangleBudget)
+    {
+      mScreenError = mStats.screenError * kRelaxFactor;
+    }
+    else if (mStats.numTriangles < kTightenBelow * mTriangleBudget && mScreenError > mMaxScreenError)
+    {
+      mScreenError = std::max(mMaxScreenError, mScreenError / kTightenFactor);
+    }
+  }
+
+  Planet::EvictChunks();
+  mStats.numCached = static_cast<int>(mChunks.size());
+}
+
+AABB Planet::GetWorldBounds() const
+{
+  if (!Planet::IsLoaded())
+  {
+    return AABB();
+  }
+
+  return SceneObject::TransformBounds(AABB(glm::vec3(-mMaxRadius), glm::vec3(mMaxRadius)));
+}
+
+Planet::~Planet()
+{
+  for (auto& entry : mChunks)
+  {
+    delete entry.second.mesh;
+  }
+
+  delete mTexture;
+  delete mMaterial;
+}
+
+}  // namespace gloo.
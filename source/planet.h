@@ -0,0 +1,156 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include "scene_object.h"
+#include "camera.h"
+#include "frustum.h"
+#include "heightmap.h"
+
+//  +-------------------------------------------------+
+//  |  Planet on a cube-sphere with quadtree LOD.     |
+//  |                                                 |
+//  |  Each of the 6 cube faces is the root of a      |
+//  |  quadtree of chunks (kGridSize^2 cells, evenly  |
+//  |  spread over the sphere - no crowded poles).    |
+//  |  Every frame, chunks are refined while their    |
+//  |  screen-space error is too large, and dropped   |
+//  |  when they are outside the view frustum or      |
+//  |  behind the horizon. Chunk meshes are built in  |
+//  |  parallel (a few per frame) and kept in an LRU  |
+//  |  cache; skirts hide cracks between levels.      |
+//  |                                                 |
+//  |  The texture and the optional elevation map     |
+//  |  are equirectangular, mapped like in            |
+//  |  TexturedSphere. The radius is 1 (use SetScale).|
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class Planet : public SceneObject
+{
+public:
+  struct Stats
+  {
+    int numChunks       { 0 };  // Chunks drawn.
+    int numFrustumCulled { 0 };
+    int numHorizonCulled { 0 };
+    int numTriangles    { 0 };
+    int numBuilt        { 0 };  // Chunk meshes built this frame.
+    int numCached       { 0 };  // Chunk meshes in memory.
+    float screenError   { 0.0f };  // Screen-space error bound used (pixels).
+  };
+
+  Planet(BasicPipelineProgram* pipelineProgram, GLuint programHandle)
+  : SceneObject(pipelineProgram, programHandle)
+  { }
+
+  // The surface is at radius 1 + heightScale * elevation (elevations of integer heightmaps are
+  // normalized to [0, 1]). No heightmap gives a smooth sphere.
+  bool Load(const std::string& textureFileName, const std::string& heightmapFileName = "",
+            float heightScale = 0.0f);
+
+  virtual void Render() const;
+  virtual bool HasCustomRender() const { return true; }
+  virtual AABB GetWorldBounds() const;
+
+  // The camera used for LOD selection and culling (only the roots are drawn without it).
+  inline void SetCamera(Camera* camera) { mCamera = camera; }
+
+  // Target screen-space error in pixels (default 2).
+  inline void SetMaxScreenError(float pixels) { mMaxScreenError = pixels; mScreenError = pixels; }
+
+  // Relaxes the error bound while more triangles than the budget are selected (0 = no budget).
+  inline void SetTriangleBudget(int numTriangles) { mTriangleBudget = numTriangles; }
+
+  // Chunk meshes kept in memory (chunks drawn in the current frame are never evicted).
+  inline void SetMaxCachedChunks(int numChunks) { mMaxCachedChunks = numChunks; }
+
+  inline bool IsLoaded() const { return !mChunks.empty(); }
+  inline const Stats& GetStats() const { return mStats; }
+
+  virtual ~Planet();
+
+private:
+  struct Chunk
+  {
+    Mesh* mesh { nullptr };  // nullptr while waiting to be built.
+    unsigned lastFrame { 0 };
+  };
+
+  struct Selection
+  {
+    uint64_t key;
+    float distance;
+  };
+
+  // Vertex data of a chunk, built off the GL thread.
+  struct ChunkData
+  {
+    uint64_t key;
+    std::vector<GLfloat> positions, normals, texCoords;
+  };
+
+  void SelectNode(int face, int level, int x, int y, const Frustum& frustum,
+                  const glm::vec3& cameraPos) const;
+
+  // Bounding sphere, and the cone of directions from the planet center (axis and half angle).
+  void NodeBounds(int face, int level, int x, int y, glm::vec3& center, float& radius,
+                  glm::vec3& axis, float& halfAngle) const;
+  bool BehindHorizon(const glm::vec3& axis, float halfAngle, const glm::vec3& cameraPos) const;
+  float NodeError(int level) const;
+
+  // The chunk is built, or can still be built this frame (then it is scheduled).
+  bool RequestChunk(uint64_t key) const;
+  bool ChildrenAvailable(int face, int level, int x, int y) const;
+
+  void BuildChunk(ChunkData& data) const;
+  void UploadChunk(const ChunkData& data) const;
+  void EvictChunks() const;
+
+  // Unit sphere direction of face coordinates (a, b) in [-1, 1]^2.
+  static glm::vec3 FaceToSphere(int face, float a, float b);
+  float Elevation(const glm::vec3& direction) const;
+  float SurfaceRadius(const glm::vec3& direction) const;
+
+  static inline uint64_t Key(int face, int level, int x, int y)
+  {
+    return (static_cast<uint64_t>(face) << 61) | (static_cast<uint64_t>(level) << 56) |
+           (static_cast<uint64_t>(y) << 28) | static_cast<uint64_t>(x);
+  }
+
+  static const int kGridSize = 32;   // Cells per chunk side.
+  static const int kMaxLevel = 14;   // About 20 m cells on an Earth sized planet (float limit).
+
+  Heightmap mHeightmap;
+  std::vector<GLuint> mIndices;  // Shared by all chunks (grid, then skirts).
+  float mHeightScale { 0.0f };
+  float mMinRadius { 1.0f };
+  float mMaxRadius { 1.0f };
+
+  mutable std::unordered_map<uint64_t, Chunk> mChunks;
+  mutable std::vector<ChunkData> mPendingChunks;
+  mutable unsigned mFrame { 0 };
+  int mMaxCachedChunks { 1024 };
+
+  // LOD selection state.
+  Camera* mCamera { nullptr };
+  float mMaxScreenError { 2.0f };
+  mutable float mScreenError { 2.0f };
+  mutable float mErrorScale { 1.0f };  // Viewport height / (2 tan(fovy / 2)).
+  int mTriangleBudget { 0 };
+  mutable std::vector<Selection> mSelection;
+  mutable Stats mStats;
+};
+
+}  // namespace gloo.
@@ -0,0 +1,388 @@
+#include "primitive_cache.h"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace gloo
+{
+
+namespace
+{
+
+// Appends a flat shaded triangle list face: (position, normal, uv) per vertex.
+void AddFace(const glm::vec3* corners, const glm::vec2* texCoords, int numCorners,
+             std::vector<GLfloat>& vertices, std::vector<GLuint>& indices)
+{
+  GLuint first = static_cast<GLuint>(vertices.size() / 8);
+  glm::vec3 normal = glm::normalize(glm::cross(corners[1] - corners[0], corners[2] - corners[0]));
+
+  for (int k = 0; k < numCorners; k++)
+  {
+    vertices.insert(vertices.end(), { corners[k].x, corners[k].y, corners[k].z,
+                                      normal.x, normal.y, normal.z,
+                                      texCoords[k].x, texCoords[k].y });
+  }
+
+  // Fan (the faces are convex).
+  for (int k = 1; k + 1 < numCorners; k++)
+  {
+    indices.insert(indices.end(), { first, first + k, first + k + 1 });
+  }
+}
+
+}  // namespace.
+
+PrimitiveCache& PrimitiveCache::Instance()
+{
+  static PrimitiveCache instance;
+  return instance;
+}
+
+// ================= Shared Meshes ================= //
+
+Mesh* PrimitiveCache::GetSphere(GLuint programHandle, int detailLevel, bool completeDome)
+{
+  Key key(kSphere, programHandle, detailLevel, completeDome);
+  Mesh* mesh = PrimitiveCache::Find(key);
+  return mesh ? mesh : PrimitiveCache::Insert(key, BuildSphere(programHandle, detailLevel, completeDome));
+}
+
+Mesh* PrimitiveCache::GetGrid(GLuint programHandle, int w, int h)
+{
+  Key key(kGrid, programHandle, w, h);
+  Mesh* mesh = PrimitiveCache::Find(key);
+  return mesh ? mesh : PrimitiveCache::Insert(key, BuildGrid(programHandle, w, h));
+}
+
+Mesh* PrimitiveCache::GetCube(GLuint programHandle)
+{
+  Key key(kCube, programHandle, 0, 0);
+  Mesh* mesh = PrimitiveCache::Find(key);
+  return mesh ? mesh : PrimitiveCache::Insert(key, BuildCube(programHandle));
+}
+
+Mesh* PrimitiveCache::GetTetrahedron(GLuint programHandle)
+{
+  Key key(kTetrahedron, programHandle, 0, 0);
+  Mesh* mesh = PrimitiveCache::Find(key);
+  return mesh ? mesh : PrimitiveCache::Insert(key, BuildTetrahedron(programHandle));
+}
+
+Mesh* PrimitiveCache::GetQuad(GLuint programHandle)
+{
+  Key key(kQuad, programHandle, 0, 0);
+  Mesh* mesh = PrimitiveCache::Find(key);
+  return mesh ? mesh : PrimitiveCache::Insert(key, BuildQuad(programHandle));
+}
+
+Mesh* PrimitiveCache::GetIcosphere(GLuint programHandle, int subdivisions)
+{
+  subdivisions = std::min(std::max(subdivisions, 0), 7);
+
+  Key key(kIcosphere, programHandle, subdivisions, 0);
+  Mesh* mesh = PrimitiveCache::Find(key);
+  return mesh ? mesh : PrimitiveCache::Insert(key, BuildIcosphere(programHandle, subdivisions));
+}
+
+void PrimitiveCache::Clear()
+{
+  for (auto& entry : mMeshes)
+  {
+    delete entry.second;
+  }
+  mMeshes.clear();
+}
+
+Mesh* PrimitiveCache::Find(const Key& key) const
+{
+  auto it = mMeshes.find(key);
+  return (it != mMeshes.end()) ? it->second : nullptr;
+}
+
+Mesh* PrimitiveCache::Insert(const Key& key, Mesh* mesh)
+{
+  mMeshes[key] = mesh;
+  return mesh;
+}
+
+// ================= Element Layouts ================= //
+
+void PrimitiveCache::BuildStripIndices(int w, int h, GLuint* indices)
+{
+  for (int v = 0; v < h-1; v++)
+  {
+    // Zig-zag pattern: alternate between top and bottom.
+    for (int u = 0; u < w; u++)
+    {
+      *indices++ = (v+0)*w + u;
+      *indices++ = (v+1)*w + u;
+    }
+
+    // Triangle row transition: repeat the last vertex and the next row first vertex to
+    // generate two invalid triangles and get continuity in the mesh.
+    if (v < h-2)
+    {
+      *indices++ = (v+1)*w + (w-1);
+      *indices++ = (v+1)*w + 0;
+    }
+  }
+}
+
+void PrimitiveCache::BuildWireGridIndices(int w, int h, GLuint* indices)
+{
+  // Horizontally, alternating directions.
+  for (int y = 0; y < h; y++)
+  {
+    for (int k = 0; k < w; k++)
+      *indices++ = w*y + ((y % 2 == 0) ? k : w-1-k);
+  }
+
+  // Then vertically, starting from the last point to allow continuity in GL_LINE_STRIP.
+  bool leftToRight = (h % 2 == 0);  // The horizontal pass ended at x = 0.
+  for (int k = 0; k < w; k++)
+  {
+    int x = leftToRight ? k : w-1-k;
+    for (int j = 0; j < h; j++)
+      *indices++ = w*((k % 2 == 0) ? h-1-j : j) + x;
+  }
+}
+
+// ================= Builders ================= //
+
+Mesh* PrimitiveCache::BuildSphere(GLuint programHandle, int detailLevel, bool completeDome) const
+{
+  int n = detailLevel + 1;
+  int h = detailLevel + 1;
+  int numVertices = (n * h);
+  int numIndices  = NumStripIndices(n, h);
+
+  std::vector<GLfloat> positions;
+  std::vector<GLfloat> texCoords;
+  std::vector<GLfloat> normals;
+  std::vector<GLuint> indices(numIndices);
+
+  positions.reserve(3 * numVertices);
+  texCoords.reserve(2 * numVertices);
+  normals.reserve(3 * numVertices);
+
+  GLfloat position[3];
+
+  // Initialize vertices.
+  for (int v = 0; v < h; v++)
+  {
+    for (int u = 0; u < n; u++)
+    {
+      GLfloat theta_u = (2*M_PI * u) / (n-1);
+      GLfloat theta_v = (M_PI * v) / (h-1);
+
+      position[0] = cos(theta_u) * sin(theta_v);
+      position[2] = sin(theta_u) * sin(theta_v);
+      position[1] = cos(theta_v);
+
+      // Positions.
+      positions.push_back(position[0]);
+      positions.push_back(position[1]);
+      positions.push_back(position[2]);
+
+      // Normals.
+      normals.push_back(2*position[0]);
+      normals.push_back(2*position[1]);
+      normals.push_back(2*position[2]);
+
+      // Texture UV.
+      texCoords.push_back(1 - static_cast<float>(u) / (n-1));
+      if (completeDome)
+      {
+        texCoords.push_back(1 - static_cast<float>(v) / (h-1));
+      }
+      else
+      {
+        texCoords.push_back(2 - 2*static_cast<float>(v) / (h-1));
+      }
+    }
+  }
+
+  BuildStripIndices(n, h, indices.data());
+
+  Mesh* mesh = new Mesh(programHandle);
+  mesh->Load(&positions[0], nullptr, &normals[0], &texCoords[0], &indices[0],
+             numVertices, numIndices, GL_TRIANGLE_STRIP, Mesh::kSubBuffered);
+  return mesh;
+}
+
+Mesh* PrimitiveCache::BuildGrid(GLuint programHandle, int w, int h) const
+{
+  int numVertices = (w * h);
+  int numIndices  = NumWireGridIndices(w, h);
+
+  std::vector<GLfloat> vertices;
+  std::vector<GLuint> indices(numIndices);
+  vertices.reserve(numVertices * 6);
+
+  for (int y = 0; y < h; y++)
+  {
+    for (int x = 0; x < w; x++)
+    {
+      // Positions x, y, z, then colors RGB.
+      vertices.insert(vertices.end(), { static_cast<float>(x - w/2)/w, 0.0f,
+                                        static_cast<float>(y - h/2)/h, 0.45f, 0.45f, 0.45f });
+    }
+  }
+
+  BuildWireGridIndices(w, h, indices.data());
+
+  Mesh* mesh = new Mesh(programHandle);
+  mesh->Load(&vertices[0], &indices[0], numVertices, numIndices, true, false, false, GL_LINE_STRIP);
+  return mesh;
+}
+
+Mesh* PrimitiveCache::BuildCube(GLuint programHandle) const
+{
+  // Normal and the face's (right, up) axes, right x up = normal.
+  const glm::vec3 axes[6][3] =
+  {
+    { glm::vec3(+1, 0, 0), glm::vec3( 0, 0, -1), glm::vec3(0, 1,  0) },
+    { glm::vec3(-1, 0, 0), glm::vec3( 0, 0, +1), glm::vec3(0, 1,  0) },
+    { glm::vec3( 0, 0, +1), glm::vec3(+1, 0, 0), glm::vec3(0, 1,  0) },
+    { glm::vec3( 0, 0, -1), glm::vec3(-1, 0, 0), glm::vec3(0, 1,  0) },
+    { glm::vec3( 0, +1, 0), glm::vec3(+1, 0, 0), glm::vec3(0, 0, -1) },
+    { glm::vec3( 0, -1, 0), glm::vec3(+1, 0, 0), glm::vec3(0, 0, +1) },
+  };
+  const glm::vec2 texCoords[4] = { glm::vec2(0, 0), glm::vec2(1, 0), glm::vec2(1, 1), glm::vec2(0, 1) };
+
+  std::vector<GLfloat> vertices;
+  std::vector<GLuint> indices;
+
+  for (int f = 0; f < 6; f++)
+  {
+    glm::vec3 corners[4];
+    for (int k = 0; k < 4; k++)
+    {
+      corners[k] = 0.5f * (axes[f][0] + (2*texCoords[k].x - 1) * axes[f][1] +
+                                        (2*texCoords[k].y - 1) * axes[f][2]);
+    }
+    AddFace(corners, texCoords, 4, vertices, indices);
+  }
+
+  Mesh* mesh = new Mesh(programHandle);
+  mesh->Load(&vertices[0], &indices[0], vertices.size() / 8, indices.size(), false, true, true,
+             GL_TRIANGLES);
+  return mesh;
+}
+
+Mesh* PrimitiveCache::BuildTetrahedron(GLuint programHandle) const
+{
+  const float s = 1.0f / std::sqrt(3.0f);
+  const glm::vec3 corners[4] = { glm::vec3(s, s, s), glm::vec3(s, -s, -s),
+                                 glm::vec3(-s, s, -s), glm::vec3(-s, -s, s) };
+  const glm::vec2 texCoords[3] = { glm::vec2(0, 0), glm::vec2(1, 0), glm::vec2(0.5f, 1) };
+
+  std::vector<GLfloat> vertices;
+  std::vector<GLuint> indices;
+
+  // Each face leaves one corner out, and is wound to face away from it.
+  for (int f = 0; f < 4; f++)
+  {
+    glm::vec3 face[3];
+    for (int k = 0, c = 0; c < 4; c++)
+    {
+      if (c != f)
+        face[k++] = corners[c];
+    }
+
+    if (glm::dot(glm::cross(face[1] - face[0], face[2] - face[0]), face[0] - corners[f]) < 0.0f)
+    {
+      std::swap(face[1], face[2]);
+    }
+    AddFace(face, texCoords, 3, vertices, indices);
+  }
+
+  Mesh* mesh = new Mesh(programHandle);
+  mesh->Load(&vertices[0], &indices[0], vertices.size() / 8, indices.size(), false, true, true,
+             GL_TRIANGLES);
+  return mesh;
+}
+
+Mesh* PrimitiveCache::BuildQuad(GLuint programHandle) const
+{
+  const glm::vec3 corners[4] = { glm::vec3(-0.5f, -0.5f, 0), glm::vec3(0.5f, -0.5f, 0),
+                                 glm::vec3(0.5f, 0.5f, 0), glm::vec3(-0.5f, 0.5f, 0) };
+  const glm::vec2 texCoords[4] = { glm::vec2(0, 0), glm::vec2(1, 0), glm::vec2(1, 1), glm::vec2(0, 1) };
+
+  std::vector<GLfloat> vertices;
+  std::vector<GLuint> indices;
+  AddFace(corners, texCoords, 4, vertices, indices);
+
+  Mesh* mesh = new Mesh(programHandle);
+  mesh->Load(&vertices[0], &indices[0], 4, 6, false, true, true, GL_TRIANGLES);
+  return mesh;
+}
+
+Mesh* PrimitiveCache::BuildIcosphere(GLuint programHandle, int subdivisions) const
+{
+  const float t = (1.0f + std::sqrt(5.0f)) / 2;
+  std::vector<glm::vec3> positions =
+  {
+    glm::vec3(-1, t, 0), glm::vec3(1, t, 0), glm::vec3(-1, -t, 0), glm::vec3(1, -t, 0),
+    glm::vec3(0, -1, t), glm::vec3(0, 1, t), glm::vec3(0, -1, -t), glm::vec3(0, 1, -t),
+    glm::vec3(t, 0, -1), glm::vec3(t, 0, 1), glm::vec3(-t, 0, -1), glm::vec3(-t, 0, 1),
+  };
+  std::vector<GLuint> triangles =
+  {
+    0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+    1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+    3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+    4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1,
+  };
+
+  for (glm::vec3& p : positions)
+  {
+    p = glm::normalize(p);
+  }
+
+  // Each subdivision splits every triangle in 4 at its edge midpoints (shared by the two
+  // triangles of the edge), pushed to the sphere.
+  for (int s = 0; s < subdivisions; s++)
+  {
+    std::map<std::pair<GLuint, GLuint>, GLuint> midpoints;
+    auto midpoint = [&](GLuint a, GLuint b)
+    {
+      std::pair<GLuint, GLuint> edge(std::min(a, b), std::max(a, b));
+      auto it = midpoints.find(edge);
+      if (it != midpoints.end())
+      {
+        return it->second;
+      }
+
+      GLuint index = static_cast<GLuint>(positions.size());
+      positions.push_back(glm::normalize(positions[a] + positions[b]));
+      midpoints[edge] = index;
+      return index;
+    };
+
+    std::vector<GLuint> refined;
+    refined.reserve(4 * triangles.size());
+    for (size_t k = 0; k < triangles.size(); k += 3)
+    {
+      GLuint a = triangles[k], b = triangles[k+1], c = triangles[k+2];
+      GLuint ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+      refined.insert(refined.end(), { a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca });
+    }
+    triangles.swap(refined);
+  }
+
+  std::vector<GLfloat> vertices;
+  vertices.reserve(6 * positions.size());
+  for (const glm::vec3& p : positions)
+  {
+    vertices.insert(vertices.end(), { p.x, p.y, p.z, p.x, p.y, p.z });
+  }
+
+  Mesh* mesh = new Mesh(programHandle);
+  mesh->Load(&vertices[0], &triangles[0], positions.size(), triangles.size(), false, true, false,
+             GL_TRIANGLES);
+  return mesh;
+}
+
+}  // namespace gloo.
@@ -0,0 +1,93 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <map>
+#include <tuple>
+
+#include "mesh.h"
+
+//  +-------------------------------------------------+
+//  |  Shared meshes of the built-in primitives.      |
+//  |                                                 |
+//  |  A mesh is built the first time a primitive is  |
+//  |  asked for (per shader program, type and        |
+//  |  parameters) and handed out to every object     |
+//  |  that asks for the same one afterwards: ten     |
+//  |  spheres share one vertex and one index buffer. |
+//  |  The cache owns the meshes, so objects must not |
+//  |  delete (or edit) them.                         |
+//  |                                                 |
+//  |  It also writes the element layouts shared by   |
+//  |  every w x h grid of vertices (strips, wires).  |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class PrimitiveCache
+{
+public:
+  static PrimitiveCache& Instance();
+
+  // Unit sphere - (position, normal, uv), sub-buffered triangle strip. A dome only differs in
+  // its texture coordinates (the texture covers the upper half).
+  Mesh* GetSphere(GLuint programHandle, int detailLevel, bool completeDome);
+
+  // Wireframe grid of w x h vertices on y = 0, spanning [-0.5, 0.5) - (position, color).
+  Mesh* GetGrid(GLuint programHandle, int w, int h);
+
+  // Flat shaded solids centered at the origin - (position, normal, uv) triangles.
+  Mesh* GetCube(GLuint programHandle);         // Side 1, one texture per face.
+  Mesh* GetTetrahedron(GLuint programHandle);  // Inscribed in the unit sphere.
+  Mesh* GetQuad(GLuint programHandle);         // [-0.5, 0.5]^2 on z = 0, facing +z.
+
+  // Smooth unit sphere from a subdivided icosahedron (even triangles, no poles) -
+  // (position, normal) triangles. 20 * 4^subdivisions triangles.
+  Mesh* GetIcosphere(GLuint programHandle, int subdivisions);
+
+  // Deletes every mesh (objects still using them must be deleted first).
+  void Clear();
+
+  inline int GetNumMeshes() const { return static_cast<int>(mMeshes.size()); }
+
+  // Element layouts of a w x h grid of vertices (row major).
+  // Triangle strip, rows joined by two degenerate triangles.
+  static int NumStripIndices(int w, int h) { return 2*(h-1)*w + 2*(h-2); }
+  static void BuildStripIndices(int w, int h, GLuint* indices);
+
+  // Line strip: zig-zag through the rows, then back through the columns.
+  static int NumWireGridIndices(int w, int h) { return 2*w*h; }
+  static void BuildWireGridIndices(int w, int h, GLuint* indices);
+
+  ~PrimitiveCache() { PrimitiveCache::Clear(); }
+
+private:
+  enum Type { kSphere, kGrid, kCube, kTetrahedron, kQuad, kIcosphere };
+
+  // Type, program handle and up to two parameters.
+  typedef std::tuple<int, GLuint, int, int> Key;
+
+  PrimitiveCache() { }
+  PrimitiveCache(const PrimitiveCache&) = delete;
+  PrimitiveCache& operator=(const PrimitiveCache&) = delete;
+
+  Mesh* Find(const Key& key) const;
+  Mesh* Insert(const Key& key, Mesh* mesh);
+
+  Mesh* BuildSphere(GLuint programHandle, int detailLevel, bool completeDome) const;
+  Mesh* BuildGrid(GLuint programHandle, int w, int h) const;
+  Mesh* BuildCube(GLuint programHandle) const;
+  Mesh* BuildTetrahedron(GLuint programHandle) const;
+  Mesh* BuildQuad(GLuint programHandle) const;
+  Mesh* BuildIcosphere(GLuint programHandle, int subdivisions) const;
+
+  std::map<Key, Mesh*> mMeshes;
+};
+
+}  // namespace gloo.
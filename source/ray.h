@@ -0,0 +1,191 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+//  +-------------------------------------------------+
+//  |  Basic types shared by every ray query:         |
+//  |  single rays, hit records, bounding boxes and   |
+//  |  SIMD-friendly ray packets.                     |
+//  |                                                 |
+//  |  RayPacket<N> stores N rays as a structure of   |
+//  |  arrays, so that slab and triangle tests run    |
+//  |  over N lanes in tight loops.                   |
+//  |                                                 |
+//  |  On SIMD: gloo has no intrinsics. Data that is  |
+//  |  processed in bulk (ray packets here, heights,  |
+//  |  noise lanes and depth rows elsewhere) is laid  |
+//  |  out as plain float arrays and walked by        |
+//  |  branch-free loops, which -O3 turns into vector |
+//  |  code on any target.                            |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+const float kRayInfinity = std::numeric_limits<float>::infinity();
+
+struct Ray
+{
+  Ray() { }
+  Ray(const glm::vec3& origin_, const glm::vec3& dir_, float tMax_ = kRayInfinity)
+  : origin(origin_), dir(dir_), tMax(tMax_)
+  { }
+
+  inline glm::vec3 At(float t) const { return origin + t * dir; }
+
+  glm::vec3 origin {0.0f, 0.0f, 0.0f};  // Starting point C.
+  glm::vec3 dir    {0.0f, 0.0f, 1.0f};  // Direction (doesn't need to be normalized).
+  float tMin { 0.0f };                  // Valid interval along C + t*dir.
+  float tMax { kRayInfinity };
+};
+
+struct RayHit
+{
+  inline bool Valid() const { return (triangle >= 0); }
+
+  float t { kRayInfinity };  // Ray parameter at the hit point.
+  float u { 0.0f };          // Barycentric coordinates inside the triangle.
+  float v { 0.0f };
+  int triangle { -1 };       // Triangle index in the mesh triangle list (-1 means no hit).
+  int object   { -1 };       // Object index in the scene (filled by scene queries).
+};
+
+struct AABB
+{
+  AABB() { }
+  AABB(const glm::vec3& min_, const glm::vec3& max_) : min(min_), max(max_) { }
+
+  inline bool Valid() const { return (min[0] <= max[0]) && (min[1] <= max[1]) && (min[2] <= max[2]); }
+  inline glm::vec3 Center() const { return 0.5f * (min + max); }
+  inline glm::vec3 Extent() const { return max - min; }
+
+  inline void Expand(const glm::vec3& p)
+  {
+    min = glm::min(min, p);
+    max = glm::max(max, p);
+  }
+
+  inline void Expand(const AABB& box)
+  {
+    min = glm::min(min, box.min);
+    max = glm::max(max, box.max);
+  }
+
+  inline float SurfaceArea() const
+  {
+    if (!Valid())
+      return 0.0f;
+
+    glm::vec3 d = max - min;
+    return 2.0f * (d[0]*d[1] + d[1]*d[2] + d[2]*d[0]);
+  }
+
+  // Returns the largest axis (0 = x, 1 = y, 2 = z).
+  inline int MaxAxis() const
+  {
+    glm::vec3 d = max - min;
+    return (d[0] > d[1] && d[0] > d[2]) ? 0 : ((d[1] > d[2]) ? 1 : 2);
+  }
+
+  // Slab test against a single ray. invDir must be 1/ray.dir.
+  inline bool Intersect(const glm::vec3& origin, const glm::vec3& invDir,
+                        float tMin, float tMax, float* tEntry = nullptr) const
+  {
+    for (int a = 0; a < 3; a++)
+    {
+      float t0 = (min[a] - origin[a]) * invDir[a];
+      float t1 = (max[a] - origin[a]) * invDir[a];
+      tMin = std::max(tMin, std::min(t0, t1));
+      tMax = std::min(tMax, std::max(t0, t1));
+    }
+
+    if (tEntry)
+      *tEntry = tMin;
+
+    return (tMin <= tMax);
+  }
+
+  glm::vec3 min { +kRayInfinity, +kRayInfinity, +kRayInfinity };  // Empty box by default.
+  glm::vec3 max { -kRayInfinity, -kRayInfinity, -kRayInfinity };
+};
+
+// Moller-Trumbore ray/triangle test with v0, e1 = v1 - v0, e2 = v2 - v0.
+// Returns true if hit in (tMin, tMax).
+inline bool IntersectTriangle(const glm::vec3& v0, const glm::vec3& e1, const glm::vec3& e2,
+                              const glm::vec3& o, const glm::vec3& d, float tMin, float tMax,
+                              float& t, float& u, float& v)
+{
+  glm::vec3 pvec = glm::cross(d, e2);
+  float det = glm::dot(e1, pvec);
+
+  if (std::abs(det) < 1e-12f)  // Parallel to the triangle plane.
+    return false;
+
+  float invDet = 1.0f / det;
+  glm::vec3 tvec = o - v0;
+  u = glm::dot(tvec, pvec) * invDet;
+  if (u < 0.0f || u > 1.0f)
+    return false;
+
+  glm::vec3 qvec = glm::cross(tvec, e1);
+  v = glm::dot(d, qvec) * invDet;
+  if (v < 0.0f || u + v > 1.0f)
+    return false;
+
+  t = glm::dot(e2, qvec) * invDet;
+  return (t > tMin && t < tMax);
+}
+
+// Packet of N rays in structure-of-arrays layout. N is 4, 8 or 16.
+template <int N>
+struct RayPacket
+{
+  static const int kWidth = N;
+
+  // Loads rays[first, first + count) in lanes [0, count). Unused lanes are disabled.
+  void Load(const Ray* rays, int count)
+  {
+    numActive = std::min(count, N);
+    for (int i = 0; i < N; i++)
+    {
+      const Ray& ray = rays[std::min(i, numActive-1)];
+      ox[i] = ray.origin[0];   oy[i] = ray.origin[1];   oz[i] = ray.origin[2];
+      dx[i] = ray.dir[0];      dy[i] = ray.dir[1];      dz[i] = ray.dir[2];
+      idx[i] = 1.0f / dx[i];   idy[i] = 1.0f / dy[i];   idz[i] = 1.0f / dz[i];
+      tMin[i] = ray.tMin;
+      tMax[i] = (i < numActive) ? ray.tMax : -kRayInfinity;  // Disabled lanes never hit.
+    }
+  }
+
+  alignas(64) float ox[N], oy[N], oz[N];     // Origins.
+  alignas(64) float dx[N], dy[N], dz[N];     // Directions.
+  alignas(64) float idx[N], idy[N], idz[N];  // Inverse directions (for slab tests).
+  alignas(64) float tMin[N], tMax[N];        // tMax shrinks as closer hits are found.
+  int numActive { 0 };
+};
+
+// Throughput report for ray batches.
+struct RayQueryStats
+{
+  inline double MRaysPerSecond() const
+  {
+    return (seconds > 0.0) ? (numRays / seconds) * 1e-6 : 0.0;
+  }
+
+  long long numRays { 0 };
+  long long numHits { 0 };
+  double seconds    { 0.0 };
+};
+
+}  // namespace gloo.
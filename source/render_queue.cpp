@@ -0,0 +1,118 @@
+#include "render_queue.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace gloo
+{
+
+namespace
+{
+
+const int kProgramBits  = 4;
+const int kTextureBits  = 12;
+const int kMaterialBits = 12;
+const int kLightingBits = 1;
+const int kMeshBits     = 12;
+const int kDepthBits    = 23;
+
+// Radix sort digits.
+const int kDigitBits = 8;
+const int kNumBuckets = 1 << kDigitBits;
+
+// Non-negative floats order like their bit patterns, so the top bits of the distance make a
+// depth key without knowing the depth range.
+inline uint64_t DepthKey(float distance)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &distance, sizeof(bits));
+  return bits >> (32 - kDepthBits);
+}
+
+}  // namespace.
+
+void RenderQueue::Begin(const glm::vec3& cameraPos)
+{
+  mCameraPos = cameraPos;
+  mItems.clear();
+  mPrograms.clear();
+  mTextures.clear();
+  mMaterials.clear();
+  mMeshes.clear();
+}
+
+void RenderQueue::Add(SceneObject* object)
+{
+  Texture* texture = object->GetTexture();
+  if (texture && !texture->Valid())
+  {
+    texture = nullptr;
+  }
+
+  glm::vec3 origin(object->GetModelMatrix().GetGLMatrix()[3]);
+  float distance = glm::length(origin - mCameraPos);
+
+  uint64_t key = RenderQueue::Number(mPrograms, object->GetPipelineProgram(), kProgramBits);
+  key = (key << kTextureBits)  | RenderQueue::Number(mTextures, texture, kTextureBits);
+  key = (key << kMaterialBits) | RenderQueue::Number(mMaterials, object->GetMaterial(), kMaterialBits);
+  key = (key << kLightingBits) | (object->IsLighting() ? 1 : 0);
+  key = (key << kMeshBits)     | RenderQueue::Number(mMeshes, object->GetMesh(), kMeshBits);
+  key = (key << kDepthBits)    | DepthKey(distance);
+
+  mItems.push_back({ key, object });
+}
+
+void RenderQueue::Submit(RenderState& state)
+{
+  RenderQueue::Sort();
+
+  for (const Item& item : mItems)
+  {
+    item.object->Submit(state);
+  }
+}
+
+int RenderQueue::Number(std::unordered_map<const void*, int>& numbers, const void* state, int bits)
+{
+  auto inserted = numbers.insert(std::make_pair(state, static_cast<int>(numbers.size())));
+
+  // Past the field width, states share the last number: still drawn, just less grouped.
+  return std::min(inserted.first->second, (1 << bits) - 1);
+}
+
+void RenderQueue::Sort()
+{
+  // Least significant digit first - each pass is stable, so the order of the previous ones
+  // is kept among equal digits.
+  int n = static_cast<int>(mItems.size());
+  mScratch.resize(n);
+
+  for (int shift = 0; shift < 64; shift += kDigitBits)
+  {
+    int counts[kNumBuckets] = { 0 };
+    for (const Item& item : mItems)
+    {
+      counts[(item.key >> shift) & (kNumBuckets - 1)]++;
+    }
+
+    // All keys share this digit (e.g. a single program): nothing to do.
+    if (n == 0 || counts[(mItems[0].key >> shift) & (kNumBuckets - 1)] == n)
+      continue;
+
+    int offset = 0;
+    for (int b = 0; b < kNumBuckets; b++)
+    {
+      int count = counts[b];
+      counts[b] = offset;
+      offset += count;
+    }
+
+    for (const Item& item : mItems)
+    {
+      mScratch[counts[(item.key >> shift) & (kNumBuckets - 1)]++] = item;
+    }
+    mItems.swap(mScratch);
+  }
+}
+
+}  // namespace gloo.
@@ -0,0 +1,78 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "scene_object.h"
+#include "render_state.h"
+
+//  +-------------------------------------------------+
+//  |  Per-frame queue of objects drawn by the main   |
+//  |  pipeline, sorted by a 64-bit key:              |
+//  |                                                 |
+//  |  program texture material lighting mesh depth   |
+//  |     4      12      12        1      12    23    |
+//  |                                                 |
+//  |  so that objects sharing a state are drawn      |
+//  |  together (fewer changes through RenderState),  |
+//  |  front to back within a state (fewer shaded     |
+//  |  fragments). Programs, textures, materials and  |
+//  |  meshes are numbered in order of appearance     |
+//  |  each frame. The keys are radix sorted - linear |
+//  |  in the number of objects.                      |
+//  |                                                 |
+//  |  Only opaque objects drawn by the default       |
+//  |  SceneObject path belong here.                  |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class RenderQueue
+{
+public:
+  RenderQueue() { }
+
+  // Empties the queue for a frame seen from cameraPos (world space).
+  void Begin(const glm::vec3& cameraPos);
+
+  void Add(SceneObject* object);
+
+  // Sorts by key, then draws each object through state.
+  void Submit(RenderState& state);
+
+  inline int GetNumObjects() const { return static_cast<int>(mItems.size()); }
+
+private:
+  struct Item
+  {
+    uint64_t key;
+    SceneObject* object;
+  };
+
+  // Order of appearance of a state this frame (clamped to the field width).
+  int Number(std::unordered_map<const void*, int>& numbers, const void* state, int bits);
+
+  void Sort();
+
+  glm::vec3 mCameraPos;
+  std::vector<Item> mItems;
+  std::vector<Item> mScratch;
+
+  std::unordered_map<const void*, int> mPrograms;
+  std::unordered_map<const void*, int> mTextures;
+  std::unordered_map<const void*, int> mMaterials;
+  std::unordered_map<const void*, int> mMeshes;
+};
+
+}  // namespace gloo.
@@ -0,0 +1,151 @@
+#include "render_state.h"
+
+namespace gloo
+{
+
+void RenderState::BeginFrame()
+{
+  mStats = Stats();
+  RenderState::Invalidate();
+}
+
+void RenderState::Invalidate()
+{
+  mProgram = nullptr;
+  mProgramHandle = 0;
+  mMaterialOn = -1;
+  mTexOn      = -1;
+  mLightOn    = -1;
+  mTexturing  = -1;
+  mTexture    = -1;
+  mMaterial = nullptr;
+  mMesh     = nullptr;
+}
+
+void RenderState::UseProgram(BasicPipelineProgram* program, GLuint programHandle)
+{
+  if (program == mProgram && programHandle == mProgramHandle)
+  {
+    mStats.numFiltered++;
+    return;
+  }
+
+  program->Bind();
+  mStats.numProgramBinds++;
+
+  if (programHandle != mProgramHandle)
+  {
+    mMaterialOnLoc = glGetUniformLocation(programHandle, "material_on");
+    mTexOnLoc      = glGetUniformLocation(programHandle, "tex_on");
+    mLightOnLoc    = glGetUniformLocation(programHandle, "light_on");
+    mKaLoc = glGetUniformLocation(programHandle, "material.Ka");
+    mKdLoc = glGetUniformLocation(programHandle, "material.Kd");
+    mKsLoc = glGetUniformLocation(programHandle, "material.Ks");
+  }
+
+  // Uniforms belong to the program.
+  mProgram = program;
+  mProgramHandle = programHandle;
+  mMaterialOn = -1;
+  mTexOn      = -1;
+  mLightOn    = -1;
+  mMaterial = nullptr;
+}
+
+void RenderState::SetModelMatrix(OpenGLMatrix& modelMatrix)
+{
+  mProgram->SetModelMatrix(modelMatrix);
+  mStats.numUniformSets++;
+}
+
+void RenderState::SetMaterial(const Material* material)
+{
+  if (material && material != mMaterial)
+  {
+    glUniform3f(mKaLoc, material->mKa[0], material->mKa[1], material->mKa[2]);
+    glUniform3f(mKdLoc, material->mKd[0], material->mKd[1], material->mKd[2]);
+    glUniform3f(mKsLoc, material->mKs[0], material->mKs[1], material->mKs[2]);
+    mMaterial = material;
+    mStats.numMaterialBinds++;
+  }
+  else if (material)
+  {
+    mStats.numFiltered++;
+  }
+
+  RenderState::SetSwitch(mMaterialOnLoc, mMaterialOn, material != nullptr);
+}
+
+void RenderState::SetTexture(Texture* texture)
+{
+  bool texturing = (texture && texture->Valid());
+  if (texturing != mTexturing)
+  {
+    if (texturing)
+      glEnable(GL_TEXTURE_2D);
+    else
+      glDisable(GL_TEXTURE_2D);
+
+    mTexturing = texturing;
+    mStats.numTextureBinds++;
+  }
+  else
+  {
+    mStats.numFiltered++;
+  }
+
+  if (texturing && static_cast<GLint>(texture->mBuffer) != mTexture)
+  {
+    texture->Bind(mProgramHandle);
+    mTexture = texture->mBuffer;
+    mStats.numTextureBinds++;
+  }
+  else if (texturing)
+  {
+    mStats.numFiltered++;
+  }
+
+  RenderState::SetSwitch(mTexOnLoc, mTexOn, texturing);
+}
+
+void RenderState::SetLighting(bool lighting)
+{
+  RenderState::SetSwitch(mLightOnLoc, mLightOn, lighting);
+}
+
+void RenderState::Draw(const Mesh* mesh)
+{
+  if (!mesh->IsInitialized())
+  {
+    return;
+  }
+
+  if (mesh != mMesh)
+  {
+    mesh->Bind();
+    mMesh = mesh;
+    mStats.numMeshBinds++;
+  }
+  else
+  {
+    mStats.numFiltered++;
+  }
+
+  mesh->Draw();
+  mStats.numDraws++;
+}
+
+void RenderState::SetSwitch(GLint location, int& value, int newValue)
+{
+  if (newValue == value)
+  {
+    mStats.numFiltered++;
+    return;
+  }
+
+  glUniform1i(location, newValue);
+  value = newValue;
+  mStats.numUniformSets++;
+}
+
+}  // namespace gloo.
@@ -0,0 +1,98 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include "mesh.h"
+#include "scene_object.h"
+
+//  +-------------------------------------------------+
+//  |  Cache of the GL state set by the main          |
+//  |  pipeline: program, texture (and whether        |
+//  |  texturing is on), material, the material_on /  |
+//  |  tex_on / light_on switches and the bound mesh. |
+//  |                                                 |
+//  |  Setting a value equal to the current one does  |
+//  |  nothing, and uniform locations are looked up   |
+//  |  once per program. Draws sorted by state (see   |
+//  |  RenderQueue) thus only pay for what changes.   |
+//  |                                                 |
+//  |  Code that changes any of these behind the      |
+//  |  cache's back must be followed by Invalidate(). |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class RenderState
+{
+public:
+  struct Stats  // Since BeginFrame.
+  {
+    int numDraws         { 0 };
+    int numProgramBinds  { 0 };
+    int numTextureBinds  { 0 };  // Texture binds and texturing switched on or off.
+    int numMaterialBinds { 0 };
+    int numUniformSets   { 0 };  // Switches and model matrices.
+    int numMeshBinds     { 0 };
+    int numFiltered      { 0 };  // Redundant changes dropped.
+
+    inline int GetNumStateChanges() const
+    {
+      return numProgramBinds + numTextureBinds + numMaterialBinds + numUniformSets + numMeshBinds;
+    }
+  };
+
+  RenderState() { }
+
+  // Resets the statistics and forgets the state.
+  void BeginFrame();
+
+  // Forgets the state: everything is set again on next use.
+  void Invalidate();
+
+  void UseProgram(BasicPipelineProgram* program, GLuint programHandle);
+
+  // The calls below need a program in use.
+  void SetModelMatrix(OpenGLMatrix& modelMatrix);
+  void SetMaterial(const Material* material);  // nullptr turns materials off.
+  void SetTexture(Texture* texture);           // nullptr (or invalid) turns texturing off.
+  void SetLighting(bool lighting);
+
+  // Binds mesh if it isn't already, and draws it.
+  void Draw(const Mesh* mesh);
+
+  inline const Stats& GetStats() const { return mStats; }
+
+private:
+  // Sets an int uniform through the cache (value holds the current one, -1 if unknown).
+  void SetSwitch(GLint location, int& value, int newValue);
+
+  BasicPipelineProgram* mProgram { nullptr };
+  GLuint mProgramHandle { 0 };
+
+  // Uniform locations in mProgramHandle.
+  GLint mMaterialOnLoc { -1 };
+  GLint mTexOnLoc      { -1 };
+  GLint mLightOnLoc    { -1 };
+  GLint mKaLoc { -1 };
+  GLint mKdLoc { -1 };
+  GLint mKsLoc { -1 };
+
+  // Current values (-1 or nullptr when unknown).
+  int mMaterialOn { -1 };
+  int mTexOn      { -1 };
+  int mLightOn    { -1 };
+  int mTexturing  { -1 };  // GL_TEXTURE_2D enabled.
+  GLint mTexture  { -1 };
+  const Material* mMaterial { nullptr };
+  const Mesh* mMesh { nullptr };
+
+  Stats mStats;
+};
+
+}  // namespace gloo.
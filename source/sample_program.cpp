@@ -39,19 +39,25 @@ void SampleProgram::InitScene(int argc, char *argv[])
   glHint(GL_LINE_SMOOTH_HINT,  GL_NICEST);
   
   mScene->Init(mPipelineProgram, mProgramHandle);
-
-  blah = new obj::Object(mPipelineProgram, mProgramHandle);
-  //blah->SetRotation(-M_PI/2, 0, 0);
-  //blah->SetScale(0.01, 0.01, 0.01);
-  blah->LoadFile("./objs/FarmhouseOBJ.obj", true);
-  //blah->LoadObjFile("./objs/dragon-77k.obj");
-  //blah->LoadParametricSurf(mobius, mobiusColor, 50, 50, false);
+  mScene->EnableGPUPicking(mWindowWidth, mWindowHeight);
+  mScene->EnableWireframe();
+
+  mModel = new obj::Object(mPipelineProgram, mProgramHandle);
+  //mModel->SetRotation(-M_PI/2, 0, 0);
+  //mModel->SetScale(0.01, 0.01, 0.01);
+  mModel->LoadFile("./objs/FarmhouseOBJ.obj", true);
+  mModel->GenerateLODs();
+  mModel->GenerateMeshlets();
+  mModel->SetCamera(mScene->GetCurrentCamera());
+  //mModel->LoadObjFile("./objs/dragon-77k.obj");
+  //mModel->LoadParametricSurf(mobius, mobiusColor, 50, 50, false);
 
   // Insert new objects here!!
   AxisObject* originAxis = new AxisObject(mPipelineProgram, mProgramHandle);
   GridObject* originGrid = new GridObject(mPipelineProgram, mProgramHandle);
   TexturedSphere* sphere = new TexturedSphere(mPipelineProgram, mProgramHandle);
   TexturedTerrain* terrain = new TexturedTerrain(mPipelineProgram, mProgramHandle);
+  Planet* planet = new Planet(mPipelineProgram, mProgramHandle);
   Light* l1 = new Light(mPipelineProgram, mProgramHandle);
   Light* l2 = new Light(mPipelineProgram, mProgramHandle);
   Light* l3 = new Light(mPipelineProgram, mProgramHandle);
@@ -65,14 +71,88 @@ void SampleProgram::InitScene(int argc, char *argv[])
   originAxis->Load();
   //originGrid->Load(11, 11);
   //sphere->Load("textures/earth.jpg");
-  //terrain->Load("", "textures/plaster_tile.jpg");
+  //planet->Load("textures/earth.jpg");
+  planet->SetScale(50, 50, 50);
+  planet->SetCamera(mScene->GetCurrentCamera());
+  planet->SetTriangleBudget(1000000);
+  mPlanet = planet;
+  terrain->Load(Heightmap(), "textures/plaster_tile.jpg", 101, 101);  // Flat, to sculpt.
   terrain->SetLighting(false);
   terrain->SetScale(100, 1, 100);
+  mTerrain = terrain;
 
   mScene->Add(sphere);
+  mScene->Add(planet);
   mScene->Add(originAxis);
   mScene->Add(originGrid);
   mScene->Add(terrain);
+
+  // A field of cubes culled and drawn on the GPU, in one call (needs OpenGL 4.3).
+  if (mScene->EnableGpuDriven())
+  {
+    for (int i = 0; i < 32; i++)
+    {
+      for (int j = 0; j < 32; j++)
+      {
+        CubeObject* cube = new CubeObject(mPipelineProgram, mProgramHandle);
+        cube->Load();
+        cube->SetPosition(4.0f * i - 62.0f, 0.5f, 4.0f * j - 62.0f);
+        cube->SetGpuDriven(true);
+        mScene->Add(cube);
+      }
+    }
+  }
+
+  // A wall hiding a block of cubes: the cubes behind it are skipped on the CPU.
+  if (mScene->EnableOcclusionCulling())
+  {
+    CubeObject* wall = new CubeObject(mPipelineProgram, mProgramHandle);
+    wall->Load();
+    wall->SetPosition(0.0f, 5.0f, -80.0f);
+    wall->SetScale(40.0f, 10.0f, 1.0f);
+    wall->SetOccluder(true);
+    mScene->Add(wall);
+
+    for (int i = 0; i < 8; i++)
+    {
+      for (int j = 0; j < 8; j++)
+      {
+        CubeObject* cube = new CubeObject(mPipelineProgram, mProgramHandle);
+        cube->Load();
+        cube->SetPosition(2.0f * i - 7.0f, 0.5f + j, -90.0f);
+        mScene->Add(cube);
+      }
+    }
+  }
+
+  // Large heightmap (e.g. 16k x 16k .r16) given on the command line. Converted .gth maps
+  // are streamed from disk.
+  if (argc > 1)
+  {
+    std::string fileName = argv[1];
+    bool tiled = (fileName.size() > 4 && fileName.compare(fileName.size() - 4, 4, ".gth") == 0);
+
+    ChunkedTerrain* largeTerrain = new ChunkedTerrain(mPipelineProgram, mProgramHandle);
+    if (tiled ? largeTerrain->LoadTiled(fileName, 0.1f, 40.0f) : largeTerrain->Load(fileName, 0.1f, 40.0f))
+    {
+      largeTerrain->SetCamera(mScene->GetCurrentCamera());
+      largeTerrain->SetTriangleBudget(2000000);
+      mScene->GetCurrentCamera()->SetGround(largeTerrain);
+      mScene->Add(largeTerrain);
+      mLargeTerrain = largeTerrain;
+    }
+    else
+    {
+      delete largeTerrain;
+    }
+  }
+
+  // Drawn over the opaque objects above.
+  GroundGrid* groundGrid = new GroundGrid(mPipelineProgram, mProgramHandle);
+  groundGrid->Load();
+  groundGrid->SetCamera(mScene->GetCurrentCamera());
+  mScene->Add(groundGrid);
+  mGroundGrid = groundGrid;
   
   mScene->Add(l1);
   mScene->Add(l2);
@@ -86,7 +166,7 @@ void SampleProgram::DisplayFunc()
 {
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   mScene->Render();
-  blah->Render();
+  mModel->Render();
   glutSwapBuffers();
   mVideoRecorder->Update();
 }
@@ -108,12 +188,21 @@ void SampleProgram::ReshapeFunc(int w, int h)
 void SampleProgram::PassiveMotionFunc(int x, int y)
 {
   GlutProgram::PassiveMotionFunc(x, y);
+
+  // Hover picking - the result is available through Scene::GetHoveredObject.
+  mScene->RequestPick(x, y);
 }
 
 void SampleProgram::MouseFunc(int button, int state, int x, int y)
 {
   GlutProgram::MouseFunc(button, state, x, y);
 
+  if (state == GLUT_UP)
+  {
+    mEditVertex = VertexHit();
+    mSculpting = false;
+  }
+
   // NOTE: The following code was provided by the starter code.
   // keep track of whether CTRL and SHIFT keys are pressed
   switch (glutGetModifiers())
@@ -121,6 +210,23 @@ void SampleProgram::MouseFunc(int button, int state, int x, int y)
     case GLUT_ACTIVE_ALT:
         mControlState = kEDIT;
 
+        // Sculpt when clicking the terrain, otherwise grab the vertex under the cursor 
+        // (snaps within a few pixels).
+        if ((mMouse.mLftButton || mMouse.mRgtButton) && state == GLUT_DOWN)
+        {
+          mSculpting = (mTerrain && mTerrain->IsInitialized() && 
+                        mScene->SelectObject(x, y, mWindowWidth, mWindowHeight) == mTerrain);
+
+          if (mSculpting)
+          {
+            SampleProgram::Sculpt(x, y, true);
+          }
+          else if (mMouse.mLftButton)
+          {
+            mEditVertex = mScene->SelectVertex(x, y, mWindowWidth, mWindowHeight);
+          }
+        }
+
         // if (mMouse.mLftButton)
         // {
         //   mScene->SelectObject(x, y, mWindowWidth, mWindowHeight);
@@ -162,8 +268,25 @@ void SampleProgram::MotionFunc(int x, int y)
 
   switch (mControlState)
   {
-    // deform landscape
+    // deform landscape or drag the selected vertex, keeping its distance to the camera
     case kEDIT:
+      if (mSculpting)
+      {
+        SampleProgram::Sculpt(x, y, false);
+      }
+      else if (mMouse.mLftButton && mEditVertex.Valid())
+      {
+        SceneObject* object = mScene->GetSceneObject(mEditVertex.object);
+        if (object)
+        {
+          Ray ray = camera->ComputeRay(x, y, mWindowWidth, mWindowHeight);
+          glm::mat4 worldToModel = glm::inverse(object->GetModelMatrix().GetGLMatrix());
+          glm::vec3 position = glm::vec3(worldToModel * glm::vec4(ray.At(mEditVertex.t), 1.0f));
+
+          object->GetMesh()->SetPosition(mEditVertex.vertex, position);
+          object->GetMesh()->UpdateVertices(mEditVertex.vertex, 1);
+        }
+      }
       break;
 
     // translate the landscape
@@ -223,16 +346,153 @@ void SampleProgram::KeyboardFunc(unsigned char key, int x, int y)
 
     case 'c':
       mScene->ChangeCamera();
+      mPlanet->SetCamera(mScene->GetCurrentCamera());
+      mGroundGrid->SetCamera(mScene->GetCurrentCamera());
+      mModel->SetCamera(mScene->GetCurrentCamera());
+      if (mLargeTerrain)
+      {
+        mLargeTerrain->SetCamera(mScene->GetCurrentCamera());
+        mScene->GetCurrentCamera()->SetGround(mLargeTerrain);
+      }
     break;
 
     case 'f':
       glutFullScreen();
     break;
 
+    case 'b':
+      // Compare single ray and packet throughput.
+      mScene->BenchmarkRays(1 << 18, mWindowWidth, mWindowHeight);
+    break;
+
     case 'x':
       // take a screenshot
       mVideoRecorder->TakeScreenshot();
     break;
+
+    // terrain brushes (edit mode)
+    case '1':
+      mBrush.mode = TexturedTerrain::kRaise;
+      mBrush.strength = 0.5f;
+      std::cout << "Brush: raise (right button lowers)." << std::endl;
+    break;
+
+    case '2':
+      mBrush.mode = TexturedTerrain::kSmooth;
+      mBrush.strength = 0.5f;
+      std::cout << "Brush: smooth." << std::endl;
+    break;
+
+    case '3':
+      mBrush.mode = TexturedTerrain::kFlatten;
+      mBrush.strength = 0.3f;
+      std::cout << "Brush: flatten." << std::endl;
+    break;
+
+    case '[':
+      mBrush.radius *= 0.8f;
+    break;
+
+    case ']':
+      mBrush.radius *= 1.25f;
+    break;
+
+    case 'w':
+      // Cycle: solid, solid + wireframe, wireframe only.
+      if (WireframePass* wireframe = mScene->GetWireframePass())
+      {
+        mWireframeMode = (mWireframeMode + 1) % 3;
+        wireframe->SetFill(mWireframeMode == 1);
+        for (int i = 0; SceneObject* object = mScene->GetSceneObject(i); i++)
+        {
+          object->SetWireframe(mWireframeMode != 0);
+        }
+      }
+    break;
+
+    case 't':
+      std::cout << "Model: " << mModel->GetNumDrawnTriangles() << " triangles drawn." << std::endl;
+      std::cout << "Model: " << mModel->GetMeshletStats().numMeshlets << " meshlets drawn, "
+                << mModel->GetMeshletStats().numFrustumCulled << " frustum culled, "
+                << mModel->GetMeshletStats().numBackfaceCulled << " backface culled." << std::endl;
+
+      {
+        const RenderState::Stats& stats = mScene->GetRenderStats();
+        std::cout << "Sorted: " << stats.numDraws << " draws, " << stats.GetNumStateChanges()
+                  << " state changes (" << stats.numMeshBinds << " mesh binds, "
+                  << stats.numMaterialBinds << " materials, " << stats.numTextureBinds
+                  << " texture switches), " << stats.numFiltered << " redundant ones dropped." << std::endl;
+      }
+
+      if (mScene->GetGpuDrivenPass())
+      {
+        const GpuDrivenPass::Stats& stats = mScene->GetGpuDrivenPass()->GetStats();
+        std::cout << "GPU-driven: " << stats.numVisible << " of " << stats.numObjects
+                  << " objects drawn, " << stats.numTriangles << " triangles." << std::endl;
+      }
+
+      if (mScene->GetOcclusionCuller())
+      {
+        const OcclusionCuller::Stats& stats = mScene->GetOcclusionCuller()->GetStats();
+        std::cout << "Occlusion: " << stats.numOccluders << " occluders ("
+                  << stats.numOccluderTriangles << " triangles) in " << stats.rasterTime
+                  << " ms, " << stats.numOccluded << " objects (" << stats.numOccludedTriangles
+                  << " triangles) hidden, " << stats.numTested << " boxes tested in "
+                  << stats.testTime << " ms." << std::endl;
+      }
+
+      if (mPlanet->IsLoaded())
+      {
+        const Planet::Stats& stats = mPlanet->GetStats();
+        std::cout << "Planet: " << stats.numChunks << " chunks, " << stats.numFrustumCulled
+                  << " outside the view, " << stats.numHorizonCulled << " behind the horizon, "
+                  << stats.numTriangles << " triangles, " << stats.numBuilt << " built, "
+                  << stats.numCached << " cached, error " << stats.screenError << " px."
+                  << std::endl;
+      }
+
+      if (mLargeTerrain)
+      {
+        const ChunkedTerrain::Stats& stats = mLargeTerrain->GetStats();
+        std::cout << "Terrain: " << stats.numNodes << " nodes, " << stats.numCulled << " culled, "
+                  << stats.numTriangles << " triangles, " << stats.numTileUploads
+                  << " tile uploads, error " << stats.screenError << " px." << std::endl;
+
+        if (mLargeTerrain->IsStreaming())
+        {
+          TerrainStreamer::Stats streaming = mLargeTerrain->GetStreamingStats();
+          std::cout << "Streaming: " << streaming.numResident << " tiles ("
+                    << (streaming.residentBytes >> 20) << "/" << (streaming.budgetBytes >> 20)
+                    << " MB), " << streaming.numPending << " pending, " << streaming.numHits
+                    << " hits, " << streaming.numMisses << " misses, " << streaming.numEvictions
+                    << " evictions, " << stats.numStreamMisses << " nodes waiting." << std::endl;
+        }
+      }
+    break;
+  }
+}
+
+void SampleProgram::Sculpt(int x, int y, bool beginStroke)
+{
+  Camera* camera = mScene->GetCurrentCamera();
+  Ray ray = camera->ComputeRay(x, y, mWindowWidth, mWindowHeight);
+  glm::vec3 point;
+
+  if (mTerrain->PickPoint(ray, point))
+  {
+    // Flatten towards the height where the stroke started.
+    if (beginStroke)
+    {
+      mBrush.target = point[1];
+    }
+
+    TexturedTerrain::Brush brush = mBrush;
+    if (mMouse.mRgtButton && brush.mode == TexturedTerrain::kRaise)
+    {
+      brush.mode = TexturedTerrain::kLower;
+    }
+
+    mTerrain->ApplyBrush(point, brush);
   }
 }
 
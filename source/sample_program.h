@@ -11,6 +11,9 @@
 #include "video_recorder.h"
 
 #include "object.h"
+#include "chunked_terrain.h"
+#include "planet.h"
+#include "ground_grid.h"
 
 using namespace gloo;
 
@@ -26,6 +29,7 @@ class SampleProgram : public GlutProgram
     delete mScene;
 
     delete testObject;
+    delete mModel;
   }
 
   void Init(int* argc, char* argv[], const char *windowTitle);
@@ -42,11 +46,26 @@ class SampleProgram : public GlutProgram
   void MotionFunc(int x, int y);                        // Mouse drag callback.
   void KeyboardFunc(unsigned char key, int x, int y);   // Key pressed.
 
+  // Applies the terrain brush under the mouse (edit mode).
+  void Sculpt(int x, int y, bool beginStroke);
+
  private:
   Scene* mScene                 { nullptr };
   VideoRecorder *mVideoRecorder { nullptr };
 
   ControlState mControlState {kROTATE};
+  VertexHit mEditVertex;  // Vertex being dragged in edit mode.
+
+  TexturedTerrain* mTerrain { nullptr };  // Sculpted in edit mode.
+  TexturedTerrain::Brush mBrush;
+  bool mSculpting { false };
+
+  int mWireframeMode { 0 };  // 0: solid, 1: solid + wireframe, 2: wireframe only.
+
+  ChunkedTerrain* mLargeTerrain { nullptr };  // From the command line, if any.
+  Planet* mPlanet { nullptr };
+  GroundGrid* mGroundGrid { nullptr };
 
   obj::Object* testObject;
+  obj::Object* mModel { nullptr };  // Drawn outside the scene, with LODs and meshlets.
 };
\ No newline at end of file
@@ -1,4 +1,10 @@
 #include "scene.h"
+#include "bvh.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
 
 namespace gloo
 {
@@ -19,6 +25,12 @@ void Scene::Render()
 {
   if (Scene::IsInitialized())
   { 
+    // Collect finished id buffer readbacks (never waits for the GPU).
+    if (mPickingPass)
+    {
+      mPickingPass->Poll();
+    }
+
     int numLights = mLights.size();
     GLuint numLightsLoc = glGetUniformLocation(mProgramHandle, "numLights");
     glUniform1i(numLightsLoc, numLights);
@@ -33,11 +45,74 @@ void Scene::Render()
       mLights[i]->Position(currentView, i);
     }
 
-    // Render all objects.
-    for (auto object : mObjects)
+    // Find the objects hidden behind occluders before submitting anything (groups of them
+    // at once through the scene BVH, unless it is out of date).
+    if (mOcclusionCuller)
+    {
+      mOcclusionCuller->Cull(mObjects, mSceneBVHDirty ? nullptr : &mSceneBVH,
+                             mCameras[mCurrentCamera], mOccluded, mGpuDrivenPass != nullptr);
+    }
+
+    // Render all objects (the wireframe and GPU-driven ones in passes of their own). Objects
+    // drawn the default way are sorted by state, then front to back, and redundant state
+    // changes are filtered; the other opaque ones follow in order. Blended objects go last,
+    // over everything opaque.
+    glm::vec3 cameraPos(glm::inverse(currentView.GetGLMatrix())[3]);
+    mRenderQueue.Begin(cameraPos);
+    mCustomObjects.clear();
+    mBlendedObjects.clear();
+
+    for (int i = 0; i < static_cast<int>(mObjects.size()); i++)
+    {
+      SceneObject* object = mObjects[i];
+      if ((!mWireframePass || !WireframePass::Draws(object)) &&
+          (!mGpuDrivenPass || !GpuDrivenPass::Draws(object)) &&
+          (!mOcclusionCuller || !mOccluded[i]))
+      {
+        if (object->IsBlended())
+          mBlendedObjects.push_back(object);
+        else if (object->HasCustomRender())
+          mCustomObjects.push_back(object);
+        else
+          mRenderQueue.Add(object);
+      }
+    }
+
+    mRenderState.BeginFrame();
+    mRenderQueue.Submit(mRenderState);
+
+    for (auto object : mCustomObjects)
     {
       object->Render();
     }
+
+    if (mGpuDrivenPass)
+    {
+      mGpuDrivenPass->Render(mObjects, mLights, mCameras[mCurrentCamera]);
+      mPipelineProgram->Bind();
+    }
+
+    if (mWireframePass)
+    {
+      mWireframePass->Render(mObjects, mLights, mCameras[mCurrentCamera]);
+      mPipelineProgram->Bind();
+    }
+
+    if (!mBlendedObjects.empty())
+    {
+      for (auto object : mBlendedObjects)
+      {
+        object->Render();
+      }
+      mPipelineProgram->Bind();
+    }
+
+    // Id buffer for pending pick requests - then restore the main program.
+    if (mPickingPass)
+    {
+      mPickingPass->Render(mObjects, mCameras[mCurrentCamera]);
+      mPipelineProgram->Bind();
+    }
   }
 }
 
@@ -63,6 +138,17 @@ void Scene::Animate()
   {
     object->Animate();
   }
+
+  // Objects moved - update the acceleration structure bounds.
+  if (mSceneBVHDirty)
+  {
+    mSceneBVH.Build(mObjects);
+    mSceneBVHDirty = false;
+  }
+  else
+  {
+    mSceneBVH.Refit();
+  }
 }
 
 void Scene::ReshapeScreen(int w, int h)
@@ -74,6 +160,11 @@ void Scene::ReshapeScreen(int w, int h)
   {
     camera->Project(0, 0, w, h);
   }
+
+  if (mPickingPass)
+  {
+    mPickingPass->Resize(w, h);
+  }
 }
 
 void Scene::Clean()
@@ -92,25 +183,275 @@ void Scene::Clean()
   {
     delete camera;
   }
+
+  delete mPickingPass;
+  mPickingPass = nullptr;
+
+  delete mWireframePass;
+  mWireframePass = nullptr;
+
+  delete mGpuDrivenPass;
+  mGpuDrivenPass = nullptr;
+
+  delete mOcclusionCuller;
+  mOcclusionCuller = nullptr;
+
+  mObjects.clear();
+  mLights.clear();
+  mCameras.clear();
+  mSceneBVHDirty = true;
 }
 
 SceneObject* Scene::SelectObject(int x, int y, int w, int h)
 {
+  // Reuse the id buffer result if it was rendered for this pixel, with every object in it.
+  // Objects missing from it could be the ones under the cursor, or hide them.
+  if (mPickingPass)
+  {
+    mPickingPass->RequestPick(x, y);
+
+    const PickingPass::Result& result = mPickingPass->GetResult();
+    if (mPickingPass->HasResult() && result.complete && result.x == x && result.y == y)
+    {
+      return (result.object >= 0 && result.object < static_cast<int>(mObjects.size())) ? 
+             mObjects[result.object] : nullptr;
+    }
+  }
+
   // Cast ray from the camera to the environment.
-  glm::vec3 r = mCameras[mCurrentCamera]->ComputeRayAt(x, y, w, h);
-  glm::vec3 C = mCameras[mCurrentCamera]->GetCenterCoordinates();
+  Ray ray = mCameras[mCurrentCamera]->ComputeRay(x, y, w, h);
 
-  for (auto object : mObjects)
+  if (mSceneBVHDirty)
+  {
+    mSceneBVH.Build(mObjects);
+    mSceneBVHDirty = false;
+  }
+
+  RayHit hit;
+  if (mSceneBVH.Intersect(ray, hit))
+  {
+    return mObjects[hit.object];
+  }
+
+  return nullptr;
+}
+
+VertexHit Scene::SelectVertex(int x, int y, int w, int h, float tolerance)
+{
+  Camera* camera = mCameras[mCurrentCamera];
+  Ray ray = camera->ComputeRay(x, y, w, h);
+
+  if (mSceneBVHDirty)
+  {
+    mSceneBVH.Build(mObjects);
+    mSceneBVHDirty = false;
+  }
+
+  // Vertices behind the visible surface can't be selected (small slack for the surface's own).
+  RayHit surface;
+  if (mSceneBVH.Intersect(ray, surface))
+  {
+    ray.tMax = surface.t * 1.001f + 1e-4f;
+  }
+
+  // Pixel size at unit distance along the ray.
+  float tangent = tolerance * 2.0f * std::tan(0.5f * camera->GetFovy()) / h;
+
+  VertexHit best;
+  for (int i = 0; i < static_cast<int>(mObjects.size()); i++)
+  {
+    VertexHit hit = mObjects[i]->SelectVertex(ray, tangent);
+    if (hit.Valid() && (hit.tangent < best.tangent || 
+                       (hit.tangent == best.tangent && hit.t < best.t)))
+    {
+      best = hit;
+      best.object = i;
+    }
+  }
+
+  return best;
+}
+
+SceneObject* Scene::GetSceneObject(int index)
+{
+  return (index >= 0 && index < static_cast<int>(mObjects.size())) ? mObjects[index] : nullptr;
+}
+
+bool Scene::EnableGPUPicking(int w, int h)
+{
+  if (!mPickingPass)
+  {
+    mPickingPass = new PickingPass();
+    if (!mPickingPass->Init(w, h, mProgramHandle))
+    {
+      std::cerr << "ERROR GPU picking is not available - falling back to ray casting.\n";
+      delete mPickingPass;
+      mPickingPass = nullptr;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool Scene::EnableWireframe()
+{
+  if (!mWireframePass)
+  {
+    mWireframePass = new WireframePass();
+    if (!mWireframePass->Init(mProgramHandle))
+    {
+      std::cerr << "ERROR Wireframe rendering is not available.\n";
+      delete mWireframePass;
+      mWireframePass = nullptr;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool Scene::EnableGpuDriven()
+{
+  if (!mGpuDrivenPass)
+  {
+    mGpuDrivenPass = new GpuDrivenPass();
+    if (!mGpuDrivenPass->Init())
+    {
+      std::cerr << "ERROR GPU-driven rendering is not available.\n";
+      delete mGpuDrivenPass;
+      mGpuDrivenPass = nullptr;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool Scene::EnableOcclusionCulling(int width, int height)
+{
+  if (width <= 0 || height <= 0)
+  {
+    std::cerr << "ERROR Invalid occlusion buffer size " << width << "x" << height << ".\n";
+    return false;
+  }
+
+  if (!mOcclusionCuller)
   {
-    if(object->IntersectRay(r, C))
+    mOcclusionCuller = new OcclusionCuller(width, height);
+  }
+
+  return true;
+}
+
+void Scene::RequestPick(int x, int y)
+{
+  if (mPickingPass)
+  {
+    mPickingPass->RequestPick(x, y);
+  }
+}
+
+SceneObject* Scene::GetHoveredObject() const
+{
+  if (mPickingPass && mPickingPass->HasResult())
+  {
+    int index = mPickingPass->GetResult().object;
+    if (index >= 0 && index < static_cast<int>(mObjects.size()))
     {
-      return object;
+      return mObjects[index];
     }
   }
 
   return nullptr;
 }
 
+void Scene::TraceRays(const std::vector<Ray>& rays, std::vector<RayHit>& hits, int packetWidth)
+{
+  int n = rays.size();
+  std::vector<Ray> localRays(rays);
+  std::vector<RayHit> localHits;
+  hits.assign(n, RayHit());
+
+  for (int k = 0; k < static_cast<int>(mObjects.size()); k++)
+  {
+    SceneObject* object = mObjects[k];
+    const BVH* bvh = object->IsInitialized() ? object->GetMesh()->GetBVH() : nullptr;
+
+    if (!bvh)  // Nothing to hit (e.g. lines).
+      continue;
+
+    // Transform rays from world to model coordinates. Directions are not normalized,
+    // so the ray parameter t is the same in both spaces.
+    glm::mat4 M_inv = glm::inverse(object->GetModelMatrix().GetGLMatrix());
+    for (int i = 0; i < n; i++)
+    {
+      localRays[i].origin = glm::vec3(M_inv * glm::vec4(rays[i].origin, 1.0f));
+      localRays[i].dir    = glm::vec3(M_inv * glm::vec4(rays[i].dir, 0.0f));
+      localRays[i].tMax   = std::min(rays[i].tMax, hits[i].t);
+    }
+
+    localHits.assign(n, RayHit());
+    bvh->IntersectStream(localRays, localHits, packetWidth);
+
+    for (int i = 0; i < n; i++)
+    {
+      if (localHits[i].Valid() && localHits[i].t < hits[i].t)
+      {
+        hits[i] = localHits[i];
+        hits[i].object = k;
+      }
+    }
+  }
+}
+
+void Scene::BenchmarkRays(int numRays, int w, int h)
+{
+  Camera* camera = mCameras[mCurrentCamera];
+  std::vector<Ray> rays(numRays);
+  std::vector<RayHit> hits;
+
+  // Random pixels - the stream path has to recover coherence by itself.
+  for (int i = 0; i < numRays; i++)
+  {
+    rays[i] = camera->ComputeRay(rand() % w, rand() % h, w, h);
+  }
+
+  // Build acceleration structures up front so they aren't timed.
+  for (auto object : mObjects)
+  {
+    if (object->IsInitialized())
+      object->GetMesh()->GetBVH();
+  }
+
+  const int packetWidths[] = { 1, 4, 8, 16 };
+  double singleRayRate = 0.0;
+
+  for (int packetWidth : packetWidths)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    Scene::TraceRays(rays, hits, packetWidth);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    RayQueryStats stats;
+    stats.numRays = numRays;
+    stats.seconds = std::chrono::duration<double>(end - start).count();
+    for (const RayHit& hit : hits)
+    {
+      stats.numHits += hit.Valid();
+    }
+
+    if (packetWidth == 1)
+      singleRayRate = stats.MRaysPerSecond();
+
+    std::cout << "Rays [width " << packetWidth << "] " << stats.MRaysPerSecond() << " Mrays/s, " 
+              << stats.numHits << " hits";
+    if (singleRayRate > 0.0)
+      std::cout << " (" << stats.MRaysPerSecond() / singleRayRate << "x single ray)";
+    std::cout << std::endl;
+  }
+}
+
 void Scene::Add(Camera::CameraType type)
 {
   // Add a default camera.
@@ -132,6 +473,23 @@ void Scene::Add(SceneObject* object)
   if (object)
   {
     mObjects.push_back(object);
+    mSceneBVHDirty = true;
+  }
+}
+
+void Scene::Remove(SceneObject* object)
+{
+  auto it = std::find(mObjects.begin(), mObjects.end(), object);
+  if (it != mObjects.end())
+  {
+    mObjects.erase(it);
+    mSceneBVHDirty = true;
+
+    // Object indices shifted - pending id buffer results are stale.
+    if (mPickingPass)
+    {
+      mPickingPass->Invalidate();
+    }
   }
 }
 
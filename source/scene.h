@@ -11,6 +11,14 @@
 #include "basic_obj_library.h"
 #include "camera.h"
 #include "light.h"
+#include "ray.h"
+#include "scene_bvh.h"
+#include "picking_pass.h"
+#include "wireframe_pass.h"
+#include "gpu_driven_pass.h"
+#include "occlusion_culler.h"
+#include "render_queue.h"
+#include "render_state.h"
 
 namespace gloo
 {
@@ -40,10 +48,57 @@ public:
   virtual void Add(Light* light);
   virtual void Add(SceneObject* object);
 
+  // Object at index (as reported in hits), or nullptr.
+  SceneObject* GetSceneObject(int index);
+
+  // Takes the object out of the scene. The caller becomes responsible for deleting it.
+  virtual void Remove(SceneObject* object);
+
   virtual void Load() {  }
 
+  // Returns the closest object under the pixel (x, y) or nullptr. With GPU picking enabled,
+  // the id buffer result is used when it is available for (x, y) and every object could be
+  // drawn into it (see SceneObject::RenderId); otherwise a ray is cast.
   SceneObject* SelectObject(int x, int y, int w, int h);
 
+  // Edit mode: returns the vertex closest to the pixel (x, y) within tolerance pixels.
+  // Vertices hidden behind the closest surface are ignored.
+  VertexHit SelectVertex(int x, int y, int w, int h, float tolerance = 8.0f);
+
+  // GPU picking: objects are rendered into an id buffer around the requested pixel and
+  // read back asynchronously, so results arrive a frame or two later without stalls.
+  // The hovered object is only approximate if some objects can't be drawn into it.
+  bool EnableGPUPicking(int w, int h);
+  void RequestPick(int x, int y);
+  SceneObject* GetHoveredObject() const;
+
+  // Objects marked with SceneObject::SetWireframe are drawn solid + wireframe in one pass
+  // (needs geometry shaders). The pass is nullptr until enabled.
+  bool EnableWireframe();
+  inline WireframePass* GetWireframePass() { return mWireframePass; }
+
+  // Objects marked with SceneObject::SetGpuDriven are culled on the GPU and drawn with a
+  // single indirect multi-draw (needs OpenGL 4.3). The pass is nullptr until enabled.
+  bool EnableGpuDriven();
+  inline GpuDrivenPass* GetGpuDrivenPass() { return mGpuDrivenPass; }
+
+  // Objects hidden behind the ones marked with SceneObject::SetOccluder are skipped, as
+  // found by a width x height software depth buffer. The culler is nullptr until enabled.
+  bool EnableOcclusionCulling(int width = 256, int height = 128);
+  inline OcclusionCuller* GetOcclusionCuller() { return mOcclusionCuller; }
+
+  // Draws and state changes of the objects sorted by the render queue, last frame.
+  inline const RenderState::Stats& GetRenderStats() const { return mRenderState.GetStats(); }
+
+  // Batch ray queries (visibility, line of sight, ...) in world coordinates.
+  // hits[i] receives the closest hit of rays[i] (object = index of the hit object).
+  // packetWidth = 1 traces single rays; 4, 8 or 16 trace coherent packets. Other widths are
+  // rounded down to the nearest of these (see BVH::IntersectStream).
+  void TraceRays(const std::vector<Ray>& rays, std::vector<RayHit>& hits, int packetWidth = 8);
+
+  // Traces numRays random camera rays with each packet width and prints the throughput.
+  void BenchmarkRays(int numRays, int w, int h);
+
   void SetPipelineProgramParam(BasicPipelineProgram *pipelineProgram, GLuint programHandle);
 
   virtual ~Scene() { Scene::Clean(); }
@@ -58,6 +113,23 @@ protected:
   std::vector<SceneObject*> mObjects;
   int mCurrentCamera { 0 };
 
+  // Top level acceleration structure over mObjects - refit every frame, rebuilt when
+  // objects are added or removed.
+  SceneBVH mSceneBVH;
+  bool mSceneBVHDirty { true };
+
+  PickingPass* mPickingPass { nullptr };
+  WireframePass* mWireframePass { nullptr };
+  GpuDrivenPass* mGpuDrivenPass { nullptr };
+
+  OcclusionCuller* mOcclusionCuller { nullptr };
+  std::vector<char> mOccluded;  // Per object, in the current frame.
+
+  RenderQueue mRenderQueue;
+  RenderState mRenderState;
+  std::vector<SceneObject*> mCustomObjects;   // Opaque, drawn after the queue, in order.
+  std::vector<SceneObject*> mBlendedObjects;  // Drawn after all the opaque ones, in order.
+
   std::vector<Mesh*> meshes;
   std::vector<Texture*> mTextures;
   std::vector<Material*> mMaterials;
@@ -0,0 +1,199 @@
+#include "scene_bvh.h"
+
+#include <algorithm>
+
+namespace gloo
+{
+
+namespace
+{
+
+const int kStackSize = 64;
+
+inline glm::vec3 InstanceCentroid(const AABB& bounds)
+{
+  return bounds.Valid() ? bounds.Center() : glm::vec3(0.0f);
+}
+
+}  // namespace.
+
+void SceneBVH::Build(const std::vector<SceneObject*>& objects)
+{
+  mInstances.clear();
+  mNodes.clear();
+
+  // Objects without geometry are kept too: their bounds may become valid on refit.
+  for (int i = 0; i < static_cast<int>(objects.size()); i++)
+  {
+    Instance instance;
+    instance.object = objects[i];
+    instance.objectIndex = i;
+    instance.bounds = objects[i]->GetWorldBounds();
+    mInstances.push_back(instance);
+  }
+
+  if (!mInstances.empty())
+  {
+    mNodes.reserve(2 * mInstances.size());
+    SceneBVH::BuildRecursive(0, mInstances.size());
+  }
+}
+
+int SceneBVH::BuildRecursive(int begin, int end)
+{
+  int nodeIndex = mNodes.size();
+  mNodes.push_back(Node());
+
+  AABB bounds, centroidBounds;
+  for (int i = begin; i < end; i++)
+  {
+    bounds.Expand(mInstances[i].bounds);
+    centroidBounds.Expand(InstanceCentroid(mInstances[i].bounds));
+  }
+
+  if (end - begin == 1)  // One instance per leaf.
+  {
+    mNodes[nodeIndex].bounds = bounds;
+    mNodes[nodeIndex].mStart = begin;
+    mNodes[nodeIndex].mCount = 1;
+    return nodeIndex;
+  }
+
+  // Median split along the largest centroid axis - scenes hold few objects.
+  int axis = centroidBounds.MaxAxis();
+  int mid = (begin + end) / 2;
+  std::nth_element(mInstances.begin() + begin, mInstances.begin() + mid, mInstances.begin() + end,
+                   [axis](const Instance& a, const Instance& b)
+                   {
+                     return InstanceCentroid(a.bounds)[axis] < InstanceCentroid(b.bounds)[axis];
+                   });
+
+  SceneBVH::BuildRecursive(begin, mid);  // Left child: nodeIndex + 1.
+  int right = SceneBVH::BuildRecursive(mid, end);
+
+  mNodes[nodeIndex].bounds = bounds;
+  mNodes[nodeIndex].mStart = right;
+  mNodes[nodeIndex].mCount = 0;
+  return nodeIndex;
+}
+
+void SceneBVH::Refit()
+{
+  for (auto& instance : mInstances)
+  {
+    instance.bounds = instance.object->GetWorldBounds();
+  }
+
+  // Nodes are stored depth-first: children always come after their parent.
+  for (int i = mNodes.size() - 1; i >= 0; i--)
+  {
+    Node& node = mNodes[i];
+    if (node.mCount > 0)
+    {
+      node.bounds = mInstances[node.mStart].bounds;
+    }
+    else
+    {
+      node.bounds = mNodes[i + 1].bounds;
+      node.bounds.Expand(mNodes[node.mStart].bounds);
+    }
+  }
+}
+
+void SceneBVH::Collect(const std::function<bool (const AABB&)>& test,
+                       std::vector<int>& objectIndices) const
+{
+  if (mNodes.empty())
+  {
+    return;
+  }
+
+  int stack[kStackSize];
+  int sp = 0;
+  stack[sp++] = 0;
+
+  while (sp > 0)
+  {
+    int index = stack[--sp];
+    const Node& node = mNodes[index];
+
+    if (!test(node.bounds))
+      continue;
+
+    if (node.mCount > 0)
+    {
+      objectIndices.push_back(mInstances[node.mStart].objectIndex);
+    }
+    else
+    {
+      stack[sp++] = node.mStart;
+      stack[sp++] = index + 1;
+    }
+  }
+}
+
+bool SceneBVH::Intersect(const Ray& ray, RayHit& hit) const
+{
+  if (mNodes.empty())
+  {
+    return false;
+  }
+
+  glm::vec3 invDir(1.0f / ray.dir[0], 1.0f / ray.dir[1], 1.0f / ray.dir[2]);
+  bool found = false;
+
+  int stack[kStackSize];
+  int sp = 0;
+  stack[sp++] = 0;
+
+  while (sp > 0)
+  {
+    int index = stack[--sp];
+    const Node& node = mNodes[index];
+
+    float tMax = std::min(ray.tMax, hit.t);
+    if (!node.bounds.Intersect(ray.origin, invDir, ray.tMin, tMax))
+      continue;
+
+    if (node.mCount > 0)
+    {
+      const Instance& instance = mInstances[node.mStart];
+      RayHit objectHit = hit;
+
+      // The object only reports hits closer than hit.t.
+      if (instance.object->IntersectRay(ray, objectHit))
+      {
+        hit = objectHit;
+        hit.object = instance.objectIndex;
+        found = true;
+      }
+    }
+    else
+    {
+      // Visit the closer child first (pushed last).
+      int left  = index + 1;
+      int right = node.mStart;
+      float tLeft, tRight;
+      bool hitLeft  = mNodes[left].bounds.Intersect(ray.origin, invDir, ray.tMin, tMax, &tLeft);
+      bool hitRight = mNodes[right].bounds.Intersect(ray.origin, invDir, ray.tMin, tMax, &tRight);
+
+      if (hitLeft && hitRight)
+      {
+        stack[sp++] = (tLeft < tRight) ? right : left;
+        stack[sp++] = (tLeft < tRight) ? left  : right;
+      }
+      else if (hitLeft)
+      {
+        stack[sp++] = left;
+      }
+      else if (hitRight)
+      {
+        stack[sp++] = right;
+      }
+    }
+  }
+
+  return found;
+}
+
+}  // namespace gloo.
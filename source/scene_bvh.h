@@ -0,0 +1,73 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include "scene_object.h"
+#include "ray.h"
+
+//  +-------------------------------------------------+
+//  |  Top level acceleration structure: a BVH over   |
+//  |  the scene objects' world bounds. Each leaf     |
+//  |  instance forwards the ray to the object, which |
+//  |  moves it to model space and traverses its mesh |
+//  |  BVH (bottom level).                            |
+//  |                                                 |
+//  |  Refit() keeps the tree topology and only       |
+//  |  updates bounds - call it every frame after     |
+//  |  objects move. Build() is only needed when      |
+//  |  objects are added or removed.                  |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class SceneBVH
+{
+public:
+  SceneBVH() { }
+
+  // Builds the tree over all objects. Instance i refers to objects[i].
+  void Build(const std::vector<SceneObject*>& objects);
+
+  // Updates the instances' world bounds and the node bounds bottom-up.
+  void Refit();
+
+  // Finds the closest hit among all objects. hit.object receives the object index.
+  bool Intersect(const Ray& ray, RayHit& hit) const;
+
+  // Appends the indices of the objects reached through nodes whose bounds pass test, which
+  // sees parents before children - a failing node drops its whole subtree.
+  void Collect(const std::function<bool (const AABB&)>& test, std::vector<int>& objectIndices) const;
+
+  inline int GetNumInstances() const { return mInstances.size(); }
+
+private:
+  struct Instance
+  {
+    SceneObject* object;
+    int objectIndex;
+    AABB bounds;  // World bounds.
+  };
+
+  struct Node  // Same layout as BVH::Node: left child = index + 1, right child = mStart.
+  {
+    AABB bounds;
+    int mStart;
+    int mCount;
+  };
+
+  int BuildRecursive(int begin, int end);
+
+  std::vector<Instance> mInstances;
+  std::vector<Node> mNodes;
+};
+
+}  // namespace gloo.
@@ -1,4 +1,6 @@
 #include "scene_object.h"
+#include "bvh.h"
+#include "render_state.h"
 
 namespace gloo
 {
@@ -8,36 +10,66 @@ void SceneObject::Render() const
   if (IsInitialized())
   {
     mPipelineProgram->SetModelMatrix(mModelMatrix);
+    SceneObject::BindSurface(mProgramHandle);
+    mMesh->Render();
+  }
+}
 
-    GLuint matLoc = glGetUniformLocation(mProgramHandle, "material_on");
-    if (HasMaterial())
-    {
-      mMaterial->Bind(mProgramHandle);
-      glUniform1i(matLoc, 1);
-    }
-    else
-    {
-      glUniform1i(matLoc, 0); 
-    }
-
-    GLuint texLoc = glGetUniformLocation(mProgramHandle, "tex_on");
-    if (HasTexture() && mTexture->Valid())
-    {
-      glEnable(GL_TEXTURE_2D);
-      mTexture->Bind(mProgramHandle);
-      glUniform1i(texLoc, 1);
-    }
-    else
-    {
-      glDisable(GL_TEXTURE_2D);
-      glUniform1i(texLoc, 0);
-    }
-
-    GLuint lightOnLoc = glGetUniformLocation(mProgramHandle, "light_on");
-    glUniform1i(lightOnLoc, mUsingLighting);
+bool SceneObject::RenderId() const
+{
+  if (HasCustomRender())
+  {
+    return false;
+  }
 
+  if (IsInitialized())
+  {
     mMesh->Render();
   }
+  return true;
+}
+
+void SceneObject::Submit(RenderState& state) const
+{
+  if (IsInitialized())
+  {
+    state.UseProgram(mPipelineProgram, mProgramHandle);
+    state.SetModelMatrix(mModelMatrix);
+    state.SetMaterial(mMaterial);
+    state.SetTexture(mTexture);
+    state.SetLighting(mUsingLighting);
+    state.Draw(mMesh);
+  }
+}
+
+void SceneObject::BindSurface(GLuint programHandle) const
+{
+  GLuint matLoc = glGetUniformLocation(programHandle, "material_on");
+  if (HasMaterial())
+  {
+    mMaterial->Bind(programHandle);
+    glUniform1i(matLoc, 1);
+  }
+  else
+  {
+    glUniform1i(matLoc, 0); 
+  }
+
+  GLuint texLoc = glGetUniformLocation(programHandle, "tex_on");
+  if (HasTexture() && mTexture->Valid())
+  {
+    glEnable(GL_TEXTURE_2D);
+    mTexture->Bind(programHandle);
+    glUniform1i(texLoc, 1);
+  }
+  else
+  {
+    glDisable(GL_TEXTURE_2D);
+    glUniform1i(texLoc, 0);
+  }
+
+  GLuint lightOnLoc = glGetUniformLocation(programHandle, "light_on");
+  glUniform1i(lightOnLoc, mUsingLighting);
 }
 
 void SceneObject::Animate()
@@ -52,51 +84,78 @@ void SceneObject::Animate()
   mModelMatrix.Rotate(mRot[0], 1, 0, 0);
   mModelMatrix.Rotate(mRot[1], 0, 1, 0);
   mModelMatrix.Scale(mScale[0], mScale[1], mScale[2]);
+
+  mWorldToModel = glm::inverse(mModelMatrix.GetGLMatrix());
 }
 
-bool SceneObject::IntersectRay(const glm::vec3& r, const glm::vec3& C) const
+bool SceneObject::IntersectRay(const Ray& ray, RayHit& hit) const
 {
-  // Transform coordinates from view to model.
-  glm::mat4 M_inv = glm::inverse(mModelMatrix.GetGLMatrix());
-  glm::vec4 v = M_inv * glm::vec4(r, 0.0);  // Orientation vector.
-  glm::vec4 O = M_inv * glm::vec4(C, 1.0);  // Line origin.
-  
-  O /= O[3];
-  v = glm::normalize(v);
+  const BVH* bvh = IsInitialized() ? mMesh->GetBVH() : nullptr;
+  if (!bvh)
+  {
+    return false;
+  }
+
+  // Transform the ray from world to model coordinates. The direction is not normalized,
+  // so t is the same in both spaces and hits from different objects can be compared.
+  Ray localRay(glm::vec3(mWorldToModel * glm::vec4(ray.origin, 1.0f)), 
+               glm::vec3(mWorldToModel * glm::vec4(ray.dir, 0.0f)), 
+               ray.tMax);
+  localRay.tMin = ray.tMin;
 
-  GLfloat* position;
-  float min_d = 100000.0f;
-  int bestPoint = -1;
-  int n = mMesh->GetNumVertices();
-  glm::vec3 P;
+  return bvh->Intersect(localRay, hit);
+}
 
-  // Loop through positions to find the closest one to the ray.
-  for (int i = 0; i < n; i++)
+VertexHit SceneObject::SelectVertex(const Ray& ray, float tolerance) const
+{
+  // Meshes owned elsewhere (e.g. shared through PrimitiveCache) aren't editable: moving a
+  // vertex would move it on every object using them.
+  if (!mIsMeshOwner)
   {
-    position = mMesh->PositionAt(i);
-    P = glm::vec3(position[0], position[1], position[2]);
-    float d = glm::length( glm::cross( P-C, r ) );
+    return VertexHit();
+  }
 
-    if (d < min_d)
-    {
-      min_d = d;
-      bestPoint = i;
-    }
+  const VertexIndex* index = IsInitialized() ? mMesh->GetVertexIndex() : nullptr;
+  if (!index)
+  {
+    return VertexHit();
   }
 
-  position = mMesh->PositionAt(bestPoint);
-  printf("vertex %.4f %.4f %.4f\n", position[0], position[1], position[2]);
+  // Same ray parameter in both spaces (see IntersectRay). Angles are preserved by rotations,
+  // translations and uniform scales.
+  Ray localRay(glm::vec3(mWorldToModel * glm::vec4(ray.origin, 1.0f)), 
+               glm::vec3(mWorldToModel * glm::vec4(ray.dir, 0.0f)), 
+               ray.tMax);
+  localRay.tMin = ray.tMin;
+
+  return index->ClosestToRay(localRay, tolerance);
+}
+
+AABB SceneObject::GetWorldBounds() const
+{
+  const BVH* bvh = IsInitialized() ? mMesh->GetBVH() : nullptr;
+  return bvh ? SceneObject::TransformBounds(bvh->GetBounds()) : AABB();
+}
 
-  // TODO: improve threshold.
-  // Check the minimum distance threshold.
-  if (min_d < 5.0f) // Success.
+AABB SceneObject::TransformBounds(const AABB& bounds) const
+{
+  AABB worldBounds;
+  if (!bounds.Valid())
   {
-    return true;
+    return worldBounds;
   }
-  else  // No point selected.
+
+  // Transform the 8 corners of the model space bounds.
+  const glm::mat4& M = mModelMatrix.GetGLMatrix();
+  for (int i = 0; i < 8; i++)
   {
-    return false;
+    glm::vec3 corner((i & 1) ? bounds.max[0] : bounds.min[0],
+                     (i & 2) ? bounds.max[1] : bounds.min[1],
+                     (i & 4) ? bounds.max[2] : bounds.min[2]);
+    worldBounds.Expand(glm::vec3(M * glm::vec4(corner, 1.0f)));
   }
+
+  return worldBounds;
 }
 
 SceneObject::~SceneObject()
@@ -12,12 +12,15 @@
 
 #include "imageIO.h"
 #include "mesh.h"
+#include "ray.h"
+#include "vertex_index.h"
 
 namespace gloo
 {
 
 struct Texture;
 struct Material;
+class RenderState;
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -65,6 +68,22 @@ public:
 
   // Render method - must be called in Scene::Render().
   virtual void Render() const;
+
+  // Same as the default Render, with the state set through a cache (see RenderQueue).
+  void Submit(RenderState& state) const;
+
+  // Draws the geometry alone, for PickingPass (which sets the program and model matrix).
+  // Returns false if the object can't be drawn this way - by default those with a custom
+  // Render - and picks then fall back to ray casts.
+  virtual bool RenderId() const;
+
+  // Subclasses with a Render of their own return true: they can't go through Submit, and
+  // are drawn after the sorted objects, in order.
+  virtual bool HasCustomRender() const { return false; }
+
+  // Subclasses that blend over the scene return true: they are drawn after every opaque
+  // object, including the GPU-driven and wireframe passes.
+  virtual bool IsBlended() const { return false; }
   virtual void Animate();
 
   // Load method - must be called after constructor to initialize everything;
@@ -75,7 +94,28 @@ public:
   inline bool HasMaterial()   const { return (mMaterial != nullptr); }
   inline bool HasTexture()    const { return (mTexture  != nullptr); }
 
-  virtual bool IntersectRay(const glm::vec3& ray, const glm::vec3& C) const;
+  // Finds the closest intersection of a world space ray closer than hit.t.
+  // The ray is moved to model coordinates and traced against the mesh BVH.
+  virtual bool IntersectRay(const Ray& ray, RayHit& hit) const;
+
+  // Finds the vertex closest in angle to a world space ray, inside the cone of the given
+  // tangent (see VertexIndex::ClosestToRay). Vertices beyond ray.tMax are ignored, and so
+  // are meshes the object doesn't own (nothing is selected).
+  virtual VertexHit SelectVertex(const Ray& ray, float tolerance) const;
+
+  // Height of the surface below a world space point (x and z are used), for objects that
+  // work as ground (terrains). Returns false if the point isn't over it.
+  virtual bool GetGroundHeight(const glm::vec3& /*point*/, float& /*height*/) const
+  {
+    return false;
+  }
+
+  // Axis aligned bounds of the transformed geometry (invalid if there is none).
+  virtual AABB GetWorldBounds() const;
+
+  // Sets material_on, tex_on and light_on (and binds the material and the texture) on a
+  // program with the same uniforms as the main one. The program must be bound.
+  void BindSurface(GLuint programHandle) const;
 
   // Getter and setters.
   void SetMeshOwner(bool isOwner) { mIsMeshOwner = isOwner; }
@@ -86,11 +126,30 @@ public:
 
   void SetScale(GLfloat sx, GLfloat sy, GLfloat sz);
   void SetLighting(bool state) { mUsingLighting = state; };
+
+  // Solid + wireframe in one pass (see WireframePass - only for triangle meshes).
+  void SetWireframe(bool state) { mWireframe = state; }
+  inline bool IsWireframe() const { return mWireframe; }
+
+  // Culled and drawn on the GPU with the other marked objects (see GpuDrivenPass - only for
+  // objects drawn by their mesh and model matrix, without texture).
+  void SetGpuDriven(bool state) { mGpuDriven = state; }
+  inline bool IsGpuDriven() const { return mGpuDriven; }
+
+  // Rasterized by the occlusion culler to hide the objects behind (see OcclusionCuller -
+  // best for large, simple meshes). Occluders are never culled themselves.
+  void SetOccluder(bool state) { mOccluder = state; }
+  inline bool IsOccluder() const { return mOccluder; }
+  inline bool IsLighting() const { return mUsingLighting; }
+
   inline virtual void SetMesh(Mesh* mesh) { mMesh = mesh; }
   inline virtual void SetTexture(Texture* texture)    { mTexture  = texture;  }
   inline virtual void SetMaterial(Material* material) { mMaterial = material; }
 
   inline virtual Mesh* GetMesh() { return mMesh; }
+  inline const Material* GetMaterial() const { return mMaterial; }
+  inline Texture* GetTexture() const { return mTexture; }
+  inline BasicPipelineProgram* GetPipelineProgram() const { return mPipelineProgram; }
   inline OpenGLMatrix& GetModelMatrix() { return mModelMatrix; }
 
   inline glm::vec3& GetPosition() { return mPos; }
@@ -101,6 +160,9 @@ public:
   virtual ~SceneObject();
 
 protected:
+  // World space bounds of a model space box (its 8 transformed corners).
+  AABB TransformBounds(const AABB& bounds) const;
+
   // SceneObject does not own material, texture and mesh pointers.
   Material* mMaterial { nullptr };
   Texture*  mTexture  { nullptr };
@@ -111,8 +173,12 @@ protected:
 
   bool mIsMeshOwner   { false };
   bool mUsingLighting { false };
+  bool mWireframe     { false };
+  bool mGpuDriven     { false };
+  bool mOccluder      { false };
 
   mutable OpenGLMatrix mModelMatrix;  // Changes everytime.
+  glm::mat4 mWorldToModel { glm::mat4(1.0f) };  // Inverse model matrix (updated in Animate).
 
   glm::vec3 mPos    {0.0f, 0.0f, 0.0f};    // Center position.
   glm::vec3 mRot    {0.0f, 0.0f, 0.0f};    // Rotations.
@@ -0,0 +1,187 @@
+#include "shader_program.h"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+
+namespace gloo
+{
+
+bool ShaderProgram::Load(const std::string& basePath, GLuint attributeSource)
+{
+  GLuint vertexShader   = ShaderProgram::CompileShader(basePath + "/vertex_shader.glsl", GL_VERTEX_SHADER);
+  GLuint fragmentShader = ShaderProgram::CompileShader(basePath + "/fragment_shader.glsl", GL_FRAGMENT_SHADER);
+
+  // The geometry shader is optional.
+  GLuint geometryShader = 0;
+  bool geometryFailed = false;
+  std::string geometryPath = basePath + "/geometry_shader.glsl";
+  if (std::ifstream(geometryPath).good())
+  {
+    geometryShader = ShaderProgram::CompileShader(geometryPath, GL_GEOMETRY_SHADER);
+    geometryFailed = (geometryShader == 0);
+  }
+
+  if (vertexShader == 0 || fragmentShader == 0 || geometryFailed)
+  {
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    glDeleteShader(geometryShader);
+    return false;
+  }
+
+  mHandle = glCreateProgram();
+  glAttachShader(mHandle, vertexShader);
+  glAttachShader(mHandle, fragmentShader);
+  if (geometryShader != 0)
+  {
+    glAttachShader(mHandle, geometryShader);
+  }
+
+  // Match the attribute locations of the source program (must happen before linking).
+  if (attributeSource != 0)
+  {
+    const char* attributes[] = { "in_position", "in_color", "in_normal", "in_tex_coord" };
+    for (const char* attribute : attributes)
+    {
+      GLint location = glGetAttribLocation(attributeSource, attribute);
+      if (location >= 0)
+      {
+        glBindAttribLocation(mHandle, location, attribute);
+      }
+    }
+  }
+
+  bool linked = ShaderProgram::Link();
+  glDeleteShader(vertexShader);
+  glDeleteShader(fragmentShader);
+  glDeleteShader(geometryShader);
+  return linked;
+}
+
+bool ShaderProgram::LoadCompute(const std::string& basePath)
+{
+  GLuint computeShader = ShaderProgram::CompileShader(basePath + "/compute_shader.glsl", GL_COMPUTE_SHADER);
+  if (computeShader == 0)
+  {
+    return false;
+  }
+
+  mHandle = glCreateProgram();
+  glAttachShader(mHandle, computeShader);
+
+  bool linked = ShaderProgram::Link();
+  glDeleteShader(computeShader);
+  return linked;
+}
+
+GLuint ShaderProgram::CompileShader(const std::string& filePath, GLenum type)
+{
+  std::ifstream input(filePath, std::ios::in);
+  if (!input.is_open())
+  {
+    std::cerr << "ERROR Couldn't open shader file " << filePath << ".\n";
+    return 0;
+  }
+
+  std::stringstream buffer;
+  buffer << input.rdbuf();
+  std::string source = buffer.str();
+  const char* sourcePtr = source.c_str();
+
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &sourcePtr, nullptr);
+  glCompileShader(shader);
+
+  GLint status;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (status != GL_TRUE)
+  {
+    GLint length;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+    std::vector<char> log(length + 1, '\0');
+    glGetShaderInfoLog(shader, length, nullptr, &log[0]);
+    std::cerr << "ERROR Couldn't compile " << filePath << ":\n" << &log[0] << "\n";
+
+    glDeleteShader(shader);
+    return 0;
+  }
+
+  return shader;
+}
+
+bool ShaderProgram::Link()
+{
+  glLinkProgram(mHandle);
+
+  GLint status;
+  glGetProgramiv(mHandle, GL_LINK_STATUS, &status);
+  if (status != GL_TRUE)
+  {
+    GLint length;
+    glGetProgramiv(mHandle, GL_INFO_LOG_LENGTH, &length);
+    std::vector<char> log(length + 1, '\0');
+    glGetProgramInfoLog(mHandle, length, nullptr, &log[0]);
+    std::cerr << "ERROR Couldn't link shader program:\n" << &log[0] << "\n";
+
+    glDeleteProgram(mHandle);
+    mHandle = 0;
+    return false;
+  }
+
+  return true;
+}
+
+// ================= Uniforms ================= //
+
+void ShaderProgram::SetMatrix(const char* name, const glm::mat4& matrix) const
+{
+  glUniformMatrix4fv(glGetUniformLocation(mHandle, name), 1, GL_FALSE, glm::value_ptr(matrix));
+}
+
+void ShaderProgram::SetMatrix(const char* name, OpenGLMatrix& matrix) const
+{
+  ShaderProgram::SetMatrix(name, matrix.GetGLMatrix());
+}
+
+void ShaderProgram::SetInt(const char* name, GLint value) const
+{
+  glUniform1i(glGetUniformLocation(mHandle, name), value);
+}
+
+void ShaderProgram::SetUInt(const char* name, GLuint value) const
+{
+  glUniform1ui(glGetUniformLocation(mHandle, name), value);
+}
+
+void ShaderProgram::SetFloat(const char* name, GLfloat value) const
+{
+  glUniform1f(glGetUniformLocation(mHandle, name), value);
+}
+
+void ShaderProgram::SetVec2(const char* name, GLfloat x, GLfloat y) const
+{
+  glUniform2f(glGetUniformLocation(mHandle, name), x, y);
+}
+
+void ShaderProgram::SetVec3(const char* name, const glm::vec3& value) const
+{
+  glUniform3f(glGetUniformLocation(mHandle, name), value[0], value[1], value[2]);
+}
+
+void ShaderProgram::SetVec4(const char* name, const glm::vec4& value) const
+{
+  glUniform4f(glGetUniformLocation(mHandle, name), value[0], value[1], value[2], value[3]);
+}
+
+ShaderProgram::~ShaderProgram()
+{
+  if (mHandle != 0)
+  {
+    glDeleteProgram(mHandle);
+  }
+}
+
+}  // namespace gloo.
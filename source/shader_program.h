@@ -0,0 +1,68 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <string>
+
+#include "openGLHeader.h"
+#include "openGLMatrix.h"
+
+//  +-------------------------------------------------+
+//  |  Auxiliar shader program for passes that don't  |
+//  |  use the main Phong pipeline (picking, terrain, |
+//  |  grid, culling, ...).                           |
+//  |                                                 |
+//  |  It loads <basePath>/vertex_shader.glsl and     |
+//  |  fragment_shader.glsl (or compute_shader.glsl), |
+//  |  and geometry_shader.glsl when there is one.    |
+//  |  Vertex attributes can be bound to the same     |
+//  |  locations of another program, so meshes whose |
+//  |  VAOs were set up for the main pipeline render  |
+//  |  with this program unchanged.                   |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class ShaderProgram
+{
+public:
+  ShaderProgram() { }
+
+  // Loads vertex + fragment shaders (and the geometry shader, if there is one). If
+  // attributeSource != 0, in_position, in_color, in_normal and in_tex_coord get the locations
+  // they have there.
+  bool Load(const std::string& basePath, GLuint attributeSource = 0);
+
+  // Loads <basePath>/compute_shader.glsl (requires OpenGL 4.3).
+  bool LoadCompute(const std::string& basePath);
+
+  inline void Bind() const { glUseProgram(mHandle); }
+  inline GLuint GetHandle() const { return mHandle; }
+  inline bool IsLoaded() const { return (mHandle != 0); }
+
+  // Uniform helpers - the program must be bound.
+  void SetMatrix(const char* name, const glm::mat4& matrix) const;
+  void SetMatrix(const char* name, OpenGLMatrix& matrix) const;
+  void SetInt(const char* name, GLint value) const;
+  void SetUInt(const char* name, GLuint value) const;
+  void SetFloat(const char* name, GLfloat value) const;
+  void SetVec2(const char* name, GLfloat x, GLfloat y) const;
+  void SetVec3(const char* name, const glm::vec3& value) const;
+  void SetVec4(const char* name, const glm::vec4& value) const;
+
+  ~ShaderProgram();
+
+private:
+  GLuint CompileShader(const std::string& filePath, GLenum type);
+  bool Link();
+
+  GLuint mHandle { 0 };
+};
+
+}  // namespace gloo.
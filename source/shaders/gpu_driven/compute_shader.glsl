@@ -0,0 +1,71 @@
+#version 430
+
+// Frustum culling of every object, writing its indirect draw command (see GpuDrivenPass).
+
+layout(local_size_x = 64) in;
+
+struct ObjectInfo
+{
+  vec4 sphere;  // Model space center and radius.
+  vec4 Ka;      // w = lighting on.
+  vec4 Kd;      // w = material on.
+  vec4 Ks;
+  uint count;   // Draw range in the packed buffers.
+  uint first_index;
+  int base_vertex;
+  uint padding;
+};
+
+struct DrawCommand  // DrawElementsIndirectCommand.
+{
+  uint count;
+  uint instance_count;
+  uint first_index;
+  int base_vertex;
+  uint base_instance;
+};
+
+layout(std430, binding = 0) readonly buffer Objects { ObjectInfo objects[]; };
+layout(std430, binding = 1) readonly buffer Transforms { mat4 models[]; };
+layout(std430, binding = 2) writeonly buffer Commands { DrawCommand commands[]; };
+layout(std430, binding = 3) buffer Counters
+{
+  uint num_visible;
+  uint num_triangles;
+};
+
+uniform vec4 planes[6];   // World space, inside when dot(n, p) + d >= 0.
+uniform uint num_objects;
+uniform int count_on;     // Update the counters.
+
+void main()
+{
+  uint i = gl_GlobalInvocationID.x;
+  if (i >= num_objects)
+  {
+    return;
+  }
+
+  // World space bounding sphere (the largest axis scale bounds the radius).
+  mat4 M = models[i];
+  ObjectInfo object = objects[i];
+  vec3 center = (M * vec4(object.sphere.xyz, 1.0)).xyz;
+  float scale = max(length(M[0].xyz), max(length(M[1].xyz), length(M[2].xyz)));
+  float radius = object.sphere.w * scale;
+
+  bool visible = true;
+  for (int k = 0; k < 6; k++)
+  {
+    visible = visible && (dot(planes[k].xyz, center) + planes[k].w >= -radius);
+  }
+
+  // Culled objects keep their command, with no instances.
+  commands[i] = DrawCommand(object.count, visible ? 1u : 0u, object.first_index,
+                            object.base_vertex, i);
+
+  if (visible && count_on == 1)
+  {
+    atomicAdd(num_visible, 1u);
+    atomicAdd(num_triangles, object.count / 3u);
+  }
+}
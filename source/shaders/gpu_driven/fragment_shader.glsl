@@ -0,0 +1,73 @@
+#version 430
+
+// Phong shading as in phong_no_shadow (no textures), with the material of the object.
+
+struct Light
+{
+  vec3 position;  // Center coordinates.
+  vec3 normal;    // Direction vector (currently not being used).
+
+  float La;   // in [0, 1].
+  float Ld;   // in [0, 1].
+  float Ls;   // in [0, 1].
+};
+
+struct ObjectInfo
+{
+  vec4 sphere;
+  vec4 Ka;      // w = lighting on.
+  vec4 Kd;      // w = material on.
+  vec4 Ks;
+  uint count;
+  uint first_index;
+  int base_vertex;
+  uint padding;
+};
+
+in vec4 v_color;
+in vec3 v_normal;
+in vec4 f_pos;
+flat in uint v_object;
+
+out vec4 c;
+
+layout(std430, binding = 0) readonly buffer Objects { ObjectInfo objects[]; };
+
+uniform int numLights;
+uniform Light light[8];
+
+void main()
+{
+  ObjectInfo object = objects[v_object];
+
+  if (object.Ka.w == 1.0)
+  {
+    // Without a material, Kd = 1 and Ka = Ks = 0 were packed.
+    vec3 Ka = object.Ka.xyz;
+    vec3 Kd = object.Kd.xyz;
+    vec3 Ks = object.Ks.xyz;
+
+    // Note: since f_pos is in camera coordinates, the incident ray is simply f_pos.xyz.
+    vec3 n = normalize(v_normal);
+    vec3 r = reflect(f_pos.xyz, n);
+
+    vec3 Id = vec3(0);
+    vec3 Ia = vec3(0);
+    vec3 Is = vec3(0);
+
+    for (int i = 0; i < numLights; i++)
+    {
+      vec3 l = normalize(light[i].position - f_pos.xyz);  // Vector from frag to light.
+
+      Ia += Ka * (light[i].La);
+      Id += Kd * (light[i].Ld * max(dot(l, n), 0.0));
+      Is += Ks * (light[i].Ls * pow(max(dot(l, r), 0.0), /* alpha = */ 1.0f));
+    }
+
+    c = vec4((Ia + Id + Is), 1.0);
+  }
+  else
+  {
+    c = v_color;
+  }
+}
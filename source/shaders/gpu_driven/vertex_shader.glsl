@@ -0,0 +1,44 @@
+#version 430
+
+// Packed vertices of every object - the object comes from the draw (see GpuDrivenPass).
+
+struct ObjectInfo
+{
+  vec4 sphere;
+  vec4 Ka;
+  vec4 Kd;
+  vec4 Ks;
+  uint count;
+  uint first_index;
+  int base_vertex;
+  uint padding;
+};
+
+in vec3 in_position;
+in vec3 in_normal;
+in vec3 in_color;
+in uint in_draw_id;  // Object index (per instance, offset by the draw's base instance).
+
+out vec4 v_color;
+out vec3 v_normal;
+out vec4 f_pos;
+flat out uint v_object;
+
+layout(std430, binding = 1) readonly buffer Transforms { mat4 models[]; };
+
+uniform mat4 V;
+uniform mat4 P;
+
+void main()
+{
+  mat4 M = models[in_draw_id];
+  gl_Position = P * (V * (M * vec4(in_position, 1.0f)));
+
+  v_color = vec4(in_color, 1.0);
+  v_object = in_draw_id;
+
+  // Position and normal in camera coordinates (as in phong_no_shadow).
+  f_pos = V * (M * vec4(in_position, 1.0f));
+  f_pos = f_pos/f_pos.w;
+  v_normal = (V * (inverse(transpose(M)) * vec4(in_normal, 0.0))).xyz;
+}
@@ -0,0 +1,62 @@
+#version 150
+
+in vec3 v_near;
+in vec3 v_far;
+
+out vec4 c;
+
+uniform mat4 mvp;
+uniform vec3 camera_pos;       // Grid model space.
+uniform vec3 line_color;
+uniform float cell_size;       // Finest spacing (model units).
+uniform float min_cell_pixels; // Cells never get smaller than this on screen.
+uniform float line_width;      // Pixels.
+uniform float fade_distance;   // Lines are gone at this distance (at least).
+
+// Coverage of the lines through multiples of spacing, box filtered over the pixel footprint.
+float Lines(vec2 p, vec2 footprint, float spacing)
+{
+  vec2 pixels = abs(fract(p / spacing + 0.5) - 0.5) * spacing / footprint;  // In pixels.
+  vec2 coverage = clamp(0.5 * line_width + 0.5 - pixels, 0.0, 1.0);
+  return max(coverage.x, coverage.y);
+}
+
+void main()
+{
+  // Pixel ray against the plane y = 0 (derivatives first - they're undefined after discard).
+  float t = v_near.y / (v_near.y - v_far.y);
+  vec3 p = mix(v_near, v_far, t);
+  vec2 footprint = max(fwidth(p.xz), vec2(1e-6));  // Model units per pixel.
+
+  if (!(t > 0.0 && t < 1.0))
+  {
+    discard;
+  }
+
+  // Spacing goes up by 10x as cells shrink on screen, blending between consecutive levels.
+  float lod = max(0.0, log(min_cell_pixels * max(footprint.x, footprint.y) / cell_size) / log(10.0));
+  float spacing = cell_size * pow(10.0, floor(lod));
+  float alpha = max(Lines(p.xz, footprint, spacing) * (1.0 - fract(lod)),
+                    Lines(p.xz, footprint, 10.0 * spacing));
+
+  // Axes: x in red, z in blue.
+  float xAxis = clamp(0.5 * line_width + 1.0 - abs(p.z) / footprint.y, 0.0, 1.0);
+  float zAxis = clamp(0.5 * line_width + 1.0 - abs(p.x) / footprint.x, 0.0, 1.0);
+  vec3 color = mix(mix(line_color, vec3(0.9, 0.2, 0.2), xAxis), vec3(0.2, 0.3, 0.9), zAxis);
+  alpha = max(alpha, max(xAxis, zAxis));
+
+  // Fade out far away (the range grows with the camera height, so zooming out keeps a grid).
+  float range = max(fade_distance, 20.0 * abs(camera_pos.y));
+  alpha *= 1.0 - smoothstep(0.3 * range, range, distance(p, camera_pos));
+
+  if (alpha < 1.0 / 255.0)
+  {
+    discard;
+  }
+
+  // Depth of the plane point, so the grid is hidden by (and hides) the scene correctly.
+  vec4 clip = mvp * vec4(p, 1.0);
+  gl_FragDepth = 0.5 * (gl_DepthRange.diff * clip.z / clip.w + gl_DepthRange.near + gl_DepthRange.far);
+
+  c = vec4(color, alpha);
+}
@@ -0,0 +1,22 @@
+#version 150
+
+// No vertex data: gl_VertexID 0, 1, 2 make one triangle covering the whole screen.
+
+uniform mat4 inv_mvp;  // Clip space to grid model space.
+
+out vec3 v_near;  // Model space points on the near and far planes under the pixel.
+out vec3 v_far;
+
+vec3 Unproject(vec2 ndc, float z)
+{
+  vec4 p = inv_mvp * vec4(ndc, z, 1.0);
+  return p.xyz / p.w;
+}
+
+void main()
+{
+  vec2 ndc = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);
+  v_near = Unproject(ndc, -1.0);
+  v_far  = Unproject(ndc, +1.0);
+  gl_Position = vec4(ndc, 0.0, 1.0);
+}
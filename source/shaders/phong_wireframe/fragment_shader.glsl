@@ -0,0 +1,109 @@
+#version 150
+
+struct Light
+{
+  vec3 position;  // Center coordinates.
+  vec3 normal;    // Direction vector (currently not being used).
+
+  float La;   // in [0, 1].
+  float Ld;   // in [0, 1].
+  float Ls;   // in [0, 1].
+};
+
+struct Material
+{
+  vec3 Ka;
+  vec3 Kd;
+  vec3 Ks;
+};
+
+in vec4 g_color;
+in vec3 g_normal;
+in vec2 g_tex_coord;
+in vec4 g_pos;
+noperspective in vec3 g_edge_distance;  // Pixels to each edge (see the geometry shader).
+
+out vec4 c;
+
+// Uniforms.
+uniform int tex_on;         // Tells if texture is active.
+uniform int light_on;       // Tells if lighting is active.
+uniform int material_on;    // Tells if current frag has a material.
+uniform int invalid_tex;    // Tells if texture is invalid - special rendering.
+
+uniform int numLights;
+uniform Light light[8];
+
+uniform sampler2D tex;
+uniform Material material;
+
+uniform vec3 wire_color;
+uniform float wire_width;   // Pixels.
+uniform int fill_on;        // Shaded faces under the wires (otherwise only the wires).
+
+vec4 Shade()
+{
+  if (light_on == 1)
+  {
+    vec3 Kd, Ka, Ks;
+
+    if (invalid_tex == 1)  // Special case - render magent instead of invalid texture.
+    {
+      Kd = vec3(1.0, 0.0, 1.0);
+      Ka = vec3(0.1, 0.1, 0.1);
+      Ks = vec3(0.0, 0.0, 0.0);
+    }
+    else
+    {
+      Kd = material_on*material.Kd + (1-material_on)*vec3(1, 1, 1);
+      Ka = material_on*material.Ka;
+      Ks = material_on*material.Ks;
+    }
+
+    // Note: since g_pos is in camera coordinates, the incident ray is simply g_pos.xyz.
+    vec3 n = normalize(g_normal);
+    vec3 r = reflect(g_pos.xyz, n);  // Compute reflection for camera ray.
+    
+    vec3 Id = vec3(0);
+    vec3 Ia = vec3(0);
+    vec3 Is = vec3(0);
+
+    for (int i = 0; i < numLights; i++) 
+    { 
+      vec3 l = normalize(light[i].position - g_pos.xyz);  // Vector from frag to light.
+      float q = length(light[i].position - g_pos.xyz);
+
+      // Basic lighting - Phong model.
+      Ia += Ka * (light[i].La);
+      Id += Kd * (light[i].Ld * max(dot(l, n), 0.0));
+      Is += Ks * (light[i].Ls * pow(max(dot(l, r), 0.0), /* alpha = */ 1.0f));
+    }
+
+    vec4 color = (1-tex_on)*vec4(1) + (tex_on)*texture(tex, g_tex_coord);
+    return color * vec4((Ia + Id + Is), 1.0);
+  }
+  else
+  {
+    return (1-tex_on)*g_color + (tex_on)*texture(tex, g_tex_coord);
+  }
+}
+
+void main()
+{
+  // Wire coverage: a box filtered line of wire_width pixels along each edge.
+  float d = min(g_edge_distance.x, min(g_edge_distance.y, g_edge_distance.z));
+  float wire = clamp(0.5 * wire_width + 0.5 - d, 0.0, 1.0);
+
+  if (fill_on == 1)
+  {
+    c = mix(Shade(), vec4(wire_color, 1.0), wire);
+  }
+  else
+  {
+    if (wire < 1.0 / 255.0)
+    {
+      discard;
+    }
+    c = vec4(wire_color, wire);
+  }
+}
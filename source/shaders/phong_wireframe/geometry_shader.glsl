@@ -0,0 +1,58 @@
+#version 150
+
+// Adds to each triangle vertex its distances (in pixels) to the three edges: (h, 0, 0) for
+// the first vertex, where h is its distance to the opposite edge, and so on. Interpolated
+// linearly in screen space, the smallest component is the distance of the pixel to the
+// closest edge.
+
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 3) out;
+
+in vec4 v_color[];
+in vec3 v_normal[];
+in vec2 v_tex_coord[];
+in vec4 v_pos[];
+
+out vec4 g_color;
+out vec3 g_normal;
+out vec2 g_tex_coord;
+out vec4 g_pos;
+noperspective out vec3 g_edge_distance;
+
+uniform vec2 viewport;  // Size in pixels.
+
+void main()
+{
+  vec2 p[3];
+  bool visible = true;
+  for (int i = 0; i < 3; i++)
+  {
+    visible = visible && (gl_in[i].gl_Position.w > 0.0);
+    p[i] = 0.5 * viewport * gl_in[i].gl_Position.xy / gl_in[i].gl_Position.w;
+  }
+
+  // Twice the area over each edge length. Triangles crossing the eye plane have no valid
+  // screen positions - they're drawn without edges.
+  float area = abs((p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y));
+  vec3 heights = vec3(area / max(length(p[2] - p[1]), 1e-6),
+                      area / max(length(p[2] - p[0]), 1e-6),
+                      area / max(length(p[1] - p[0]), 1e-6));
+  if (!visible)
+  {
+    heights = vec3(1e6);
+  }
+
+  for (int i = 0; i < 3; i++)
+  {
+    gl_Position = gl_in[i].gl_Position;
+    g_color = v_color[i];
+    g_normal = v_normal[i];
+    g_tex_coord = v_tex_coord[i];
+    g_pos = v_pos[i];
+    g_edge_distance = visible ? vec3(0.0) : vec3(1e6);
+    g_edge_distance[i] = heights[i];
+    EmitVertex();
+  }
+
+  EndPrimitive();
+}
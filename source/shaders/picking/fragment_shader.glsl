@@ -0,0 +1,11 @@
+#version 150
+
+// Object index + 1 (0 is the background).
+uniform uint object_id;
+
+out uvec2 id;
+
+void main()
+{
+  id = uvec2(object_id, uint(gl_PrimitiveID));
+}
@@ -0,0 +1,12 @@
+#version 150
+
+in vec3 in_position;
+
+uniform mat4 M;
+uniform mat4 V;
+uniform mat4 P;
+
+void main()
+{
+  gl_Position = P * (V * (M * vec4(in_position, 1.0f)));
+}
@@ -0,0 +1,30 @@
+#version 150
+
+in vec3 v_normal;
+in vec2 v_tex_coord;
+in float v_height;
+
+out vec4 c;
+
+uniform int tex_on;
+uniform sampler2D tex;
+uniform vec3 sun_dir;       // World space, towards the sun.
+uniform vec2 height_range;  // Model (min, max) height.
+
+void main()
+{
+  vec3 base;
+  if (tex_on == 1)
+  {
+    base = texture(tex, v_tex_coord).rgb;
+  }
+  else  // Height color ramp: grass, rock, snow.
+  {
+    float t = clamp((v_height - height_range.x) / max(height_range.y - height_range.x, 1e-6), 0.0, 1.0);
+    base = mix(vec3(0.25, 0.40, 0.18), vec3(0.45, 0.38, 0.30), smoothstep(0.3, 0.7, t));
+    base = mix(base, vec3(0.95), smoothstep(0.8, 0.95, t));
+  }
+
+  float diffuse = max(dot(normalize(v_normal), sun_dir), 0.0);
+  c = vec4(base * (0.3 + 0.7 * diffuse), 1.0);
+}
@@ -0,0 +1,59 @@
+#version 150
+
+in vec3 in_position;  // Grid vertex (x, 0, z), x and z in [0, grid_size].
+
+uniform mat4 M;
+uniform mat4 V;
+uniform mat4 P;
+uniform mat4 N;  // Inverse transpose of M.
+
+uniform vec4 node;          // Model (x, z) of the node corner, node size and tile layer.
+uniform vec2 morph;         // Morph start distance and 1 / morph length.
+uniform vec3 camera_pos;    // Model coordinates.
+uniform vec4 terrain_rect;  // Model (min x, min z, max x, max z).
+uniform float grid_size;
+
+uniform sampler2DArray heights;  // One texel apron around the grid.
+
+out vec3 v_normal;
+out vec2 v_tex_coord;
+out float v_height;
+
+float Height(vec2 g)
+{
+  ivec2 texel = clamp(ivec2(g) + 1, ivec2(0), ivec2(int(grid_size) + 2));
+  return texelFetch(heights, ivec3(texel, int(node.w)), 0).r;
+}
+
+vec3 Normal(vec2 g, float step)
+{
+  float scale = 1.0 / (2.0 * step * node.z / grid_size);
+  float dhdx = (Height(g + vec2(step, 0.0)) - Height(g - vec2(step, 0.0))) * scale;
+  float dhdz = (Height(g + vec2(0.0, step)) - Height(g - vec2(0.0, step))) * scale;
+  return normalize(vec3(-dhdx, 1.0, -dhdz));
+}
+
+void main()
+{
+  vec2 g = in_position.xz;
+  float cell = node.z / grid_size;
+  float h = Height(g);
+
+  // Odd vertices slide onto their even neighbors as the node reaches the end of its range,
+  // so it matches the parent level grid exactly when it's replaced.
+  vec2 p = node.xy + g * cell;
+  float k = clamp((distance(vec3(p.x, h, p.y), camera_pos) - morph.x) * morph.y, 0.0, 1.0);
+  vec2 parent = g - fract(g * 0.5) * 2.0;
+
+  vec2 gm = mix(g, parent, k);
+  float hm = mix(h, Height(parent), k);
+  vec3 n = normalize(mix(Normal(g, 1.0), Normal(parent, 2.0), k));
+
+  // Nodes on the border extend past the map - fold them onto the edge.
+  vec2 pm = clamp(node.xy + gm * cell, terrain_rect.xy, terrain_rect.zw);
+
+  gl_Position = P * (V * (M * vec4(pm.x, hm, pm.y, 1.0)));
+  v_normal = (N * vec4(n, 0.0)).xyz;
+  v_tex_coord = pm;
+  v_height = hm;
+}
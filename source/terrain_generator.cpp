@@ -0,0 +1,370 @@
+#include "terrain_generator.h"
+#include "parallel.h"
+
+#include <cmath>
+#include <iostream>
+#include <utility>
+#include <algorithm>
+
+namespace gloo
+{
+
+namespace
+{
+
+const int kLanes = 8;               // Samples per Noise8 call.
+const int kMinRowsPerThread = 16;
+const int kErosionTile = 128;       // Droplets start in a tile and stay within half a tile of it.
+const unsigned kOctaveSeedStep = 1013;
+const float kOctaveShiftX = 0.6180340f;  // Keeps the lattices of the octaves from lining up.
+const float kOctaveShiftZ = 0.4142136f;
+const float kRidgeSharpness = 2.0f;      // How much a crest suppresses the octaves above it.
+const float kThermalShare = 0.125f;      // Keeps 4 outgoing flows under half of any excess.
+
+inline unsigned Hash(int x, int y, unsigned seed)
+{
+  unsigned h = (static_cast<unsigned>(x) * 0x27D4EB2Du) ^ (static_cast<unsigned>(y) * 0x165667B1u) ^
+               (seed * 0x9E3779B9u);
+  h ^= h >> 15;
+  h *= 0x2C1B3C6Du;
+  h ^= h >> 12;
+  h *= 0x297A2D39u;
+  h ^= h >> 15;
+  return h;
+}
+
+// Dot product of a pseudo-random gradient in [-1, 1]^2 with the offset (dx, dy).
+inline float Gradient(unsigned hash, float dx, float dy)
+{
+  float gx = static_cast<float>(hash & 0xFFFF) * (2.0f / 65535.0f) - 1.0f;
+  float gy = static_cast<float>(hash >> 16)    * (2.0f / 65535.0f) - 1.0f;
+  return gx * dx + gy * dy;
+}
+
+inline float Fade(float t)
+{
+  return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+inline float Flow(float from, float to, float talus)
+{
+  return std::max(from - to - talus, 0.0f);
+}
+
+// Rescales the values to [0, range].
+void Normalize(float* data, size_t count, float range)
+{
+  if (count == 0)
+  {
+    return;
+  }
+
+  auto minMax = std::minmax_element(data, data + count);
+  float low  = *minMax.first;
+  float span = *minMax.second - low;
+  float scale = (span > 0.0f) ? range / span : 0.0f;
+
+  int numRows = static_cast<int>((count + 4095) / 4096);
+  tool::ParallelFor(0, numRows, kMinRowsPerThread, [=](int first, int last)
+  {
+    size_t end = std::min(static_cast<size_t>(last) * 4096, count);
+    for (size_t i = static_cast<size_t>(first) * 4096; i < end; i++)
+    {
+      data[i] = (data[i] - low) * scale;
+    }
+  });
+}
+
+// Runs the droplets of tile (tx, tz). They never leave the tile grown by half a tile on each
+// side, so tiles two apart can be eroded at the same time.
+void ErodeTile(int w, int h, int tx, int tz, const TerrainGenerator::Params& params,
+               float* heights)
+{
+  const int margin = kErosionTile / 2;
+  const float loX = static_cast<float>(std::max(tx * kErosionTile - margin, 0));
+  const float loZ = static_cast<float>(std::max(tz * kErosionTile - margin, 0));
+  const float hiX = static_cast<float>(std::min((tx+1) * kErosionTile + margin, w) - 1);
+  const float hiZ = static_cast<float>(std::min((tz+1) * kErosionTile + margin, h) - 1);
+
+  // Spawn area (cells whose 4 corners are on the map).
+  int spawnX = tx * kErosionTile, spawnZ = tz * kErosionTile;
+  int spawnW = std::min(kErosionTile, w - 1 - spawnX);
+  int spawnH = std::min(kErosionTile, h - 1 - spawnZ);
+  if (spawnW <= 0 || spawnH <= 0)
+  {
+    return;
+  }
+
+  int numDroplets = static_cast<int>(params.droplets * spawnW * spawnH + 0.5f);
+  unsigned state = Hash(tx, tz, params.seed) | 1u;
+  auto random = [&state]()
+  {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+  };
+
+  for (int d = 0; d < numDroplets; d++)
+  {
+    float px = spawnX + random() * spawnW;
+    float pz = spawnZ + random() * spawnH;
+    float dx = 0.0f, dz = 0.0f;
+    float speed = 1.0f, water = 1.0f, sediment = 0.0f;
+
+    for (int step = 0; step < params.dropletLifetime; step++)
+    {
+      int ix = static_cast<int>(px), iz = static_cast<int>(pz);
+      float fx = px - ix, fz = pz - iz;
+      float* cell = heights + static_cast<size_t>(iz) * w + ix;
+      float h00 = cell[0], h10 = cell[1], h01 = cell[w], h11 = cell[w+1];
+
+      float gx = (h10 - h00) * (1.0f - fz) + (h11 - h01) * fz;
+      float gz = (h01 - h00) * (1.0f - fx) + (h11 - h10) * fx;
+      float height = (h00 * (1.0f - fx) + h10 * fx) * (1.0f - fz) + (h01 * (1.0f - fx) + h11 * fx) * fz;
+
+      dx = dx * params.inertia - gx * (1.0f - params.inertia);
+      dz = dz * params.inertia - gz * (1.0f - params.inertia);
+      float length = std::sqrt(dx * dx + dz * dz);
+      if (length < 1e-6f)
+      {
+        break;  // Flat ground.
+      }
+      dx /= length;
+      dz /= length;
+
+      float nx = px + dx, nz = pz + dz;
+      if (!(nx >= loX && nx < hiX && nz >= loZ && nz < hiZ))
+      {
+        break;  // Leaves the area of the tile (with its sediment).
+      }
+
+      int jx = static_cast<int>(nx), jz = static_cast<int>(nz);
+      float gx1 = nx - jx, gz1 = nz - jz;
+      const float* next = heights + static_cast<size_t>(jz) * w + jx;
+      float newHeight = (next[0] * (1.0f - gx1) + next[1] * gx1) * (1.0f - gz1) +
+                        (next[w] * (1.0f - gx1) + next[w+1] * gx1) * gz1;
+      float dh = newHeight - height;
+
+      // Bilinear weights of the current position.
+      float w00 = (1.0f - fx) * (1.0f - fz), w10 = fx * (1.0f - fz);
+      float w01 = (1.0f - fx) * fz,          w11 = fx * fz;
+
+      float capacity = std::max(-dh * speed * water * params.capacity, params.minCapacity);
+      float amount;
+      if (dh > 0.0f || sediment > capacity)
+      {
+        // Uphill: fill the pit behind. Otherwise drop a share of the excess.
+        amount = (dh > 0.0f) ? std::min(dh, sediment) : (sediment - capacity) * params.depositionRate;
+        sediment -= amount;
+      }
+      else
+      {
+        amount = -std::min((capacity - sediment) * params.erosionRate, -dh);
+        sediment -= amount;
+      }
+
+      cell[0]   += amount * w00;
+      cell[1]   += amount * w10;
+      cell[w]   += amount * w01;
+      cell[w+1] += amount * w11;
+
+      speed = std::sqrt(std::max(speed * speed - dh * params.gravity, 0.0f));
+      water *= 1.0f - params.evaporation;
+      px = nx;
+      pz = nz;
+    }
+  }
+}
+
+}  // namespace.
+
+// ================= Noise ================= //
+
+void TerrainGenerator::Noise8(const float* x, const float* y, unsigned seed, float* out)
+{
+  for (int i = 0; i < kLanes; i++)
+  {
+    int ix = static_cast<int>(x[i]);
+    int iy = static_cast<int>(y[i]);
+    ix -= (x[i] < ix);  // Floor for negative coordinates.
+    iy -= (y[i] < iy);
+
+    float fx = x[i] - ix, fy = y[i] - iy;
+    float n00 = Gradient(Hash(ix,   iy,   seed), fx,        fy);
+    float n10 = Gradient(Hash(ix+1, iy,   seed), fx - 1.0f, fy);
+    float n01 = Gradient(Hash(ix,   iy+1, seed), fx,        fy - 1.0f);
+    float n11 = Gradient(Hash(ix+1, iy+1, seed), fx - 1.0f, fy - 1.0f);
+
+    float u = Fade(fx), v = Fade(fy);
+    float n0 = n00 + u * (n10 - n00);
+    float n1 = n01 + u * (n11 - n01);
+    out[i] = n0 + v * (n1 - n0);
+  }
+}
+
+void TerrainGenerator::GenerateNoise(int w, int h, const Params& params, float* heights)
+{
+  tool::ParallelFor(0, h, kMinRowsPerThread, [=](int first, int last)
+  {
+    float x[kLanes], y[kLanes], n[kLanes], sum[kLanes], weight[kLanes];
+
+    for (int row = first; row < last; row++)
+    {
+      float* out = heights + static_cast<size_t>(w) * row;
+
+      for (int x0 = 0; x0 < w; x0 += kLanes)
+      {
+        float frequency = params.frequency;
+        float amplitude = 1.0f;
+        for (int i = 0; i < kLanes; i++)
+        {
+          sum[i] = 0.0f;
+          weight[i] = 1.0f;
+        }
+
+        for (int o = 0; o < params.octaves; o++)
+        {
+          float shiftX = kOctaveShiftX * (o + 1), shiftZ = kOctaveShiftZ * (o + 1);
+          for (int i = 0; i < kLanes; i++)
+          {
+            x[i] = (x0 + i) * frequency + shiftX;
+            y[i] = row * frequency + shiftZ;
+          }
+
+          TerrainGenerator::Noise8(x, y, params.seed + o * kOctaveSeedStep, n);
+
+          if (params.type == kRidged)
+          {
+            for (int i = 0; i < kLanes; i++)
+            {
+              float signal = params.ridgeOffset - std::fabs(n[i]);
+              signal *= signal * weight[i];
+              weight[i] = std::min(std::max(signal * kRidgeSharpness, 0.0f), 1.0f);
+              sum[i] += signal * amplitude;
+            }
+          }
+          else
+          {
+            for (int i = 0; i < kLanes; i++)
+            {
+              sum[i] += n[i] * amplitude;
+            }
+          }
+
+          frequency *= params.lacunarity;
+          amplitude *= params.gain;
+        }
+
+        int count = std::min(kLanes, w - x0);
+        std::copy(sum, sum + count, out + x0);
+      }
+    }
+  });
+}
+
+// ================= Erosion ================= //
+
+void TerrainGenerator::ThermalErosion(int w, int h, const Params& params, float* heights)
+{
+  if (params.thermalIterations <= 0 || w < 2 || h < 2)
+  {
+    return;
+  }
+
+  std::vector<float> buffer(static_cast<size_t>(w) * h);
+  float* source = heights;
+  float* target = buffer.data();
+  const float rate  = kThermalShare * params.thermalRate;
+  const float talus = params.talus;
+
+  for (int it = 0; it < params.thermalIterations; it++)
+  {
+    // Each pair of neighbors exchanges the same amount in opposite directions: no mass is lost.
+    tool::ParallelFor(0, h, kMinRowsPerThread, [=](int first, int last)
+    {
+      for (int z = first; z < last; z++)
+      {
+        const float* row  = source + static_cast<size_t>(w) * z;
+        const float* up   = (z > 0)     ? row - w : row;
+        const float* down = (z < h - 1) ? row + w : row;
+        float* out = target + static_cast<size_t>(w) * z;
+
+        for (int x = 0; x < w; x++)
+        {
+          float c = row[x];
+          float l = row[(x > 0) ? x - 1 : x];
+          float r = row[(x < w - 1) ? x + 1 : x];
+          float u = up[x], d = down[x];
+
+          float gain = Flow(l, c, talus) + Flow(r, c, talus) + Flow(u, c, talus) + Flow(d, c, talus);
+          float loss = Flow(c, l, talus) + Flow(c, r, talus) + Flow(c, u, talus) + Flow(c, d, talus);
+          out[x] = c + rate * (gain - loss);
+        }
+      }
+    });
+
+    std::swap(source, target);
+  }
+
+  if (source != heights)
+  {
+    std::copy(source, source + static_cast<size_t>(w) * h, heights);
+  }
+}
+
+void TerrainGenerator::HydraulicErosion(int w, int h, const Params& params, float* heights)
+{
+  if (params.droplets <= 0.0f || w < 2 || h < 2)
+  {
+    return;
+  }
+
+  int tilesX = (w + kErosionTile - 1) / kErosionTile;
+  int tilesZ = (h + kErosionTile - 1) / kErosionTile;
+
+  // Checkerboard of 2x2 phases: tiles of a phase are two apart and touch disjoint cells.
+  for (int phase = 0; phase < 4; phase++)
+  {
+    int offsetX = phase & 1, offsetZ = phase >> 1;
+    int countX = (tilesX - offsetX + 1) / 2;
+    int countZ = (tilesZ - offsetZ + 1) / 2;
+
+    tool::ParallelFor(0, countX * countZ, 1, [=](int first, int last)
+    {
+      for (int k = first; k < last; k++)
+      {
+        ErodeTile(w, h, offsetX + 2 * (k % countX), offsetZ + 2 * (k / countX), params, heights);
+      }
+    });
+  }
+}
+
+// ================= Generation ================= //
+
+bool TerrainGenerator::Generate(int w, int h, const Params& params, Heightmap& heightmap)
+{
+  if (w < 2 || h < 2 || params.octaves < 1)
+  {
+    std::cerr << "ERROR Invalid terrain size " << w << "x" << h << " or octave count.\n";
+    return false;
+  }
+
+  std::vector<float> heights(static_cast<size_t>(w) * h);
+  TerrainGenerator::GenerateNoise(w, h, params, heights.data());
+
+  bool erode = (params.thermalIterations > 0 || params.droplets > 0.0f);
+  Normalize(heights.data(), heights.size(), erode ? params.relief * std::max(w, h) : 1.0f);
+
+  if (erode)
+  {
+    TerrainGenerator::ThermalErosion(w, h, params, heights.data());
+    TerrainGenerator::HydraulicErosion(w, h, params, heights.data());
+    Normalize(heights.data(), heights.size(), 1.0f);
+  }
+
+  heightmap.Set(std::move(heights), w, h);
+  return true;
+}
+
+}  // namespace gloo.
@@ -0,0 +1,80 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include "heightmap.h"
+
+//  +-------------------------------------------------+
+//  |  Procedural heightmaps: fractal gradient noise  |
+//  |  (fBm or ridged multifractal) followed by       |
+//  |  optional thermal and hydraulic erosion.        |
+//  |                                                 |
+//  |  Noise is evaluated 8 samples per call in       |
+//  |  structure of arrays form, rows are split       |
+//  |  across threads. Erosion runs in parallel too:  |
+//  |  thermal as a mass conserving Jacobi pass,      |
+//  |  hydraulic as droplets confined to tiles that   |
+//  |  are processed in a checkerboard order. Results |
+//  |  don't depend on the number of threads.         |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class TerrainGenerator
+{
+public:
+  enum NoiseType
+  {
+    kFBm,     // Sum of octaves - rolling hills.
+    kRidged,  // Ridged multifractal - sharp crests, smooth valleys.
+  };
+
+  struct Params
+  {
+    NoiseType type    { kFBm };
+    unsigned seed     { 1337 };
+    int octaves       { 8 };
+    float frequency   { 1.0f / 512.0f };  // Base octave, in cycles per sample.
+    float lacunarity  { 2.0f };           // Frequency ratio between octaves.
+    float gain        { 0.5f };           // Amplitude ratio between octaves.
+    float ridgeOffset { 1.0f };           // Ridged only.
+
+    // Erosion works on heights of relief * max(w, h) samples, so slopes are true slopes.
+    float relief { 0.1f };
+
+    // Thermal erosion: material slides down slopes steeper than talus (height / distance).
+    int thermalIterations { 0 };
+    float talus           { 0.7f };
+    float thermalRate     { 0.5f };  // Fraction of the excess moved per iteration, in (0, 1].
+
+    // Hydraulic erosion: simulated rain droplets carving and depositing sediment.
+    float droplets        { 0.0f };  // Per sample (e.g. 0.25).
+    int dropletLifetime   { 64 };    // Steps.
+    float inertia         { 0.05f };
+    float capacity        { 4.0f };
+    float minCapacity     { 0.01f };
+    float erosionRate     { 0.3f };
+    float depositionRate  { 0.3f };
+    float evaporation     { 0.02f };
+    float gravity         { 4.0f };
+  };
+
+  // Generates a w x h heightmap normalized to [0, 1].
+  static bool Generate(int w, int h, const Params& params, Heightmap& heightmap);
+
+  // Passes over a row major w x h array: raw (unnormalized) noise, then erosion in place.
+  static void GenerateNoise(int w, int h, const Params& params, float* heights);
+  static void ThermalErosion(int w, int h, const Params& params, float* heights);
+  static void HydraulicErosion(int w, int h, const Params& params, float* heights);
+
+  // Gradient noise at 8 points: out[i] = noise(x[i], y[i]), roughly in [-1, 1].
+  static void Noise8(const float* x, const float* y, unsigned seed, float* out);
+};
+
+}  // namespace gloo.
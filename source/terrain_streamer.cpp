@@ -0,0 +1,234 @@
+#include "terrain_streamer.h"
+
+#include <iostream>
+#include <algorithm>
+
+namespace gloo
+{
+
+bool TerrainStreamer::Start(const TiledHeightmap* source, size_t budgetBytes, int numThreads)
+{
+  TerrainStreamer::Stop();
+
+  if (!source || !source->IsOpen())
+  {
+    std::cerr << "ERROR Terrain streaming needs an open tiled heightmap.\n";
+    return false;
+  }
+
+  mSource = source;
+  mTileBytes = source->GetTileBytes();
+  mStats = Stats();
+  mStats.budgetBytes = budgetBytes;
+
+  for (int i = 0; i < std::max(numThreads, 1); i++)
+  {
+    mWorkers.emplace_back(&TerrainStreamer::WorkerLoop, this);
+  }
+
+  return true;
+}
+
+void TerrainStreamer::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mWakeUp.notify_all();
+
+  for (auto& worker : mWorkers)
+  {
+    worker.join();
+  }
+
+  mWorkers.clear();
+  mTiles.clear();
+  mPending.clear();
+  mLoading.clear();
+  mStopping = false;
+  mSource = nullptr;
+  mStats.residentBytes = 0;
+}
+
+void TerrainStreamer::BeginFrame()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mFrame++;
+}
+
+const uint16_t* TerrainStreamer::Acquire(int level, int tx, int tz, float priority)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  uint64_t key = Key(level, tx, tz);
+
+  // Never waits: a tile still being copied by a worker is a miss.
+  auto it = mTiles.find(key);
+  if (it != mTiles.end() && mLoading.count(key) == 0)
+  {
+    it->second.lastFrame = mFrame;  // Can't be evicted before the next frame.
+    mStats.numHits++;
+    return it->second.data.data();
+  }
+
+  mStats.numMisses++;
+
+  if (mLoading.count(key) == 0)
+  {
+    auto request = mPending.find(key);
+    if (request == mPending.end())
+    {
+      mPending[key] = { priority, mFrame };
+      mWakeUp.notify_one();
+    }
+    else
+    {
+      request->second.priority = (request->second.frame == mFrame) ?
+                                 std::min(request->second.priority, priority) : priority;
+      request->second.frame = mFrame;
+    }
+  }
+
+  return nullptr;
+}
+
+const uint16_t* TerrainStreamer::Pin(int level, int tx, int tz)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  uint64_t key = Key(level, tx, tz);
+
+  // A queued load isn't needed anymore, and one in progress is waited for (its copy would
+  // replace the data returned here).
+  mPending.erase(key);
+  mLoaded.wait(lock, [this, key] { return mLoading.count(key) == 0; });
+
+  auto it = mTiles.find(key);
+  if (it == mTiles.end())
+  {
+    // Pinned tiles are loaded even over budget.
+    TerrainStreamer::MakeRoom();
+    const uint16_t* source = mSource->GetTile(level, tx, tz);
+    it = mTiles.insert(std::make_pair(key, Tile())).first;
+    it->second.data.assign(source, source + mTileBytes / sizeof(uint16_t));
+    mStats.residentBytes += mTileBytes;
+    mStats.numLoads++;
+  }
+
+  it->second.pinned = true;
+  return it->second.data.data();
+}
+
+TerrainStreamer::Stats TerrainStreamer::GetStats() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  Stats stats = mStats;
+  stats.numResident = mTiles.size();
+  stats.numPending  = mPending.size() + mLoading.size();
+  return stats;
+}
+
+void TerrainStreamer::WorkerLoop()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  while (true)
+  {
+    mWakeUp.wait(lock, [this] { return mStopping || !mPending.empty(); });
+    if (mStopping)
+    {
+      return;
+    }
+
+    // Most urgent request among those still wanted (asked for this frame or the last one).
+    auto best = mPending.end();
+    for (auto it = mPending.begin(); it != mPending.end(); )
+    {
+      if (it->second.frame + 1 < mFrame)
+      {
+        it = mPending.erase(it);
+        mStats.numDropped++;
+        continue;
+      }
+
+      if (best == mPending.end() || it->second.priority < best->second.priority)
+      {
+        best = it;
+      }
+      ++it;
+    }
+
+    if (best == mPending.end())
+    {
+      continue;
+    }
+
+    uint64_t key = best->first;
+    mPending.erase(best);
+
+    if (!TerrainStreamer::MakeRoom())
+    {
+      mStats.numDropped++;  // Everything resident is in use - asked again next frame.
+      continue;
+    }
+
+    // Reserve the memory, then copy without the lock: page faults on the mapping (the actual
+    // disk reads) happen here rather than on the render thread.
+    mStats.residentBytes += mTileBytes;
+    mLoading.insert(key);
+    lock.unlock();
+
+    int level = static_cast<int>(key >> 56);
+    int tz = static_cast<int>((key >> 28) & 0xFFFFFFF);
+    int tx = static_cast<int>(key & 0xFFFFFFF);
+    const uint16_t* source = mSource->GetTile(level, tx, tz);
+    std::vector<uint16_t> data(source, source + mTileBytes / sizeof(uint16_t));
+
+    lock.lock();
+    mLoading.erase(key);
+
+    // Already resident (pinned meanwhile): keep that copy and give the reservation back.
+    auto it = mTiles.find(key);
+    if (it != mTiles.end())
+    {
+      mStats.residentBytes -= mTileBytes;
+    }
+    else
+    {
+      Tile& tile = mTiles[key];
+      tile.data.swap(data);
+      tile.lastFrame = mFrame;
+      mStats.numLoads++;
+    }
+    mLoaded.notify_all();
+  }
+}
+
+bool TerrainStreamer::MakeRoom()
+{
+  while (mStats.residentBytes + mTileBytes > mStats.budgetBytes)
+  {
+    auto victim = mTiles.end();
+    for (auto it = mTiles.begin(); it != mTiles.end(); ++it)
+    {
+      const Tile& tile = it->second;
+      if (!tile.pinned && tile.lastFrame < mFrame &&
+          (victim == mTiles.end() || tile.lastFrame < victim->second.lastFrame))
+      {
+        victim = it;
+      }
+    }
+
+    if (victim == mTiles.end())
+    {
+      return false;
+    }
+
+    mTiles.erase(victim);
+    mStats.residentBytes -= mTileBytes;
+    mStats.numEvictions++;
+  }
+
+  return true;
+}
+
+}  // namespace gloo.
@@ -0,0 +1,112 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <condition_variable>
+
+#include "tiled_heightmap.h"
+
+//  +-------------------------------------------------+
+//  |  Background loading of TiledHeightmap tiles     |
+//  |  into a fixed memory budget.                    |
+//  |                                                 |
+//  |  The render thread asks for tiles with a        |
+//  |  priority (e.g. distance to the camera). Hits   |
+//  |  return the resident data right away; misses   |
+//  |  queue a load and return nullptr, so the caller |
+//  |  falls back to coarser data. Worker threads     |
+//  |  load the most urgent requests first, evicting  |
+//  |  the least recently used tiles that weren't     |
+//  |  used in the current frame.                     |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class TerrainStreamer
+{
+public:
+  struct Stats
+  {
+    int numResident      { 0 };  // Tiles in memory.
+    int numPending       { 0 };  // Tiles queued or being loaded.
+    size_t residentBytes { 0 };
+    size_t budgetBytes   { 0 };
+    long long numHits      { 0 };  // Requests for resident tiles.
+    long long numMisses    { 0 };  // Requests for tiles not in memory (yet).
+    long long numLoads     { 0 };
+    long long numEvictions { 0 };
+    long long numDropped   { 0 };  // Loads given up (stale, or no room in the budget).
+  };
+
+  TerrainStreamer() { }
+
+  // Starts the worker threads. The source must stay open until Stop.
+  bool Start(const TiledHeightmap* source, size_t budgetBytes, int numThreads = 2);
+  void Stop();
+
+  // Advances the LRU clock - call once per frame, before any Acquire.
+  void BeginFrame();
+
+  // Resident tile data (valid until the next BeginFrame), or nullptr after queueing a load.
+  // Lower priorities load first.
+  const uint16_t* Acquire(int level, int tx, int tz, float priority);
+
+  // Loads a tile right away and keeps it resident (e.g. the coarsest level).
+  const uint16_t* Pin(int level, int tx, int tz);
+
+  Stats GetStats() const;
+
+  ~TerrainStreamer() { Stop(); }
+
+private:
+  struct Tile
+  {
+    std::vector<uint16_t> data;
+    unsigned lastFrame { 0 };
+    bool pinned { false };
+  };
+
+  struct Request
+  {
+    float priority;
+    unsigned frame;  // Last frame it was asked for.
+  };
+
+  void WorkerLoop();
+  bool MakeRoom();  // Evicts until a tile fits in the budget (mMutex held).
+
+  static inline uint64_t Key(int level, int tx, int tz)
+  {
+    return (static_cast<uint64_t>(level) << 56) | (static_cast<uint64_t>(tz) << 28) |
+            static_cast<uint64_t>(tx);
+  }
+
+  const TiledHeightmap* mSource { nullptr };
+  size_t mTileBytes { 0 };
+
+  mutable std::mutex mMutex;
+  std::condition_variable mWakeUp;   // Workers: requests queued.
+  std::condition_variable mLoaded;   // Pin: a tile finished loading.
+  std::vector<std::thread> mWorkers;
+  bool mStopping { false };
+
+  std::unordered_map<uint64_t, Tile> mTiles;
+  std::unordered_map<uint64_t, Request> mPending;
+  std::unordered_set<uint64_t> mLoading;
+  unsigned mFrame { 1 };
+  Stats mStats;
+};
+
+}  // namespace gloo.
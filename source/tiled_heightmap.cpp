@@ -0,0 +1,340 @@
+#include "tiled_heightmap.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace gloo
+{
+
+namespace
+{
+
+const char kMagic[4] = { 'G', 'L', 'T', 'H' };
+const uint32_t kVersion = 1;
+
+}  // namespace.
+
+// ================= Conversion ================= //
+
+bool TiledHeightmap::Convert(const std::string& inputFileName, const std::string& outputFileName,
+                             int tileSize, int blockSize)
+{
+  Heightmap::Format format;
+  if (!Heightmap::GetRawFormat(inputFileName, format))
+  {
+    // Images are decoded whole.
+    Heightmap heightmap;
+    return heightmap.Load(inputFileName) &&
+           TiledHeightmap::Convert(heightmap, outputFileName, tileSize, blockSize);
+  }
+
+  // Square raw file: the side comes from the file size.
+  std::ifstream file(inputFileName, std::ios::binary | std::ios::ate);
+  if (!file.is_open())
+  {
+    std::cerr << "ERROR Couldn't open heightmap " << inputFileName << ".\n";
+    return false;
+  }
+
+  long long numSamples = static_cast<long long>(file.tellg()) / Heightmap::GetBytesPerSample(format);
+  int side = static_cast<int>(std::sqrt(static_cast<double>(numSamples)) + 0.5);
+
+  if (static_cast<long long>(side) * side != numSamples)
+  {
+    std::cerr << "ERROR Raw heightmap " << inputFileName << " isn't square - use ConvertRaw.\n";
+    return false;
+  }
+
+  return TiledHeightmap::ConvertRaw(inputFileName, side, side, format, outputFileName,
+                                    tileSize, blockSize);
+}
+
+bool TiledHeightmap::ConvertRaw(const std::string& inputFileName, int w, int h,
+                                Heightmap::Format format, const std::string& outputFileName,
+                                int tileSize, int blockSize)
+{
+  std::ifstream file(inputFileName, std::ios::binary);
+  if (!file.is_open())
+  {
+    std::cerr << "ERROR Couldn't open heightmap " << inputFileName << ".\n";
+    return false;
+  }
+
+  size_t rowBytes = static_cast<size_t>(w) * Heightmap::GetBytesPerSample(format);
+  std::vector<unsigned char> bytes(rowBytes);
+
+  auto readRow = [&](int z, float* out)
+  {
+    file.seekg(static_cast<std::streamoff>(rowBytes) * z);
+    if (!file.read(reinterpret_cast<char*>(bytes.data()), rowBytes))
+    {
+      std::cerr << "ERROR Heightmap " << inputFileName << " is smaller than " << w << "x" << h << ".\n";
+      return false;
+    }
+
+    Heightmap::Decode(bytes.data(), w, format, out);
+    return true;
+  };
+
+  return TiledHeightmap::Write(w, h, readRow, outputFileName, tileSize, blockSize);
+}
+
+bool TiledHeightmap::Convert(const Heightmap& heightmap, const std::string& outputFileName,
+                             int tileSize, int blockSize)
+{
+  int w = heightmap.GetWidth();
+  auto readRow = [&](int z, float* out)
+  {
+    const float* row = heightmap.GetData() + static_cast<size_t>(w) * z;
+    std::copy(row, row + w, out);
+    return true;
+  };
+
+  return TiledHeightmap::Write(w, heightmap.GetHeight(), readRow, outputFileName,
+                               tileSize, blockSize);
+}
+
+bool TiledHeightmap::Write(int w, int h, const std::function<bool(int, float*)>& readRow,
+                           const std::string& fileName, int tileSize, int blockSize)
+{
+  if (w < 2 || h < 2 || blockSize <= 0 || tileSize < blockSize || tileSize % blockSize != 0)
+  {
+    std::cerr << "ERROR Invalid tiled heightmap size (" << w << "x" << h << ", tiles of "
+              << tileSize << ", blocks of " << blockSize << ").\n";
+    return false;
+  }
+
+  std::ofstream file(fileName, std::ios::binary);
+  if (!file.is_open())
+  {
+    std::cerr << "ERROR Couldn't create " << fileName << ".\n";
+    return false;
+  }
+
+  Header header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version   = kVersion;
+  header.width     = w;
+  header.height    = h;
+  header.tileSize  = tileSize;
+  header.blockSize = blockSize;
+  header.numLevels = 1;
+  while ((blockSize << (header.numLevels - 1)) < std::max(w, h) - 1)
+  {
+    header.numLevels++;
+  }
+
+  // First pass: height range and block min/max (rows on block borders belong to both).
+  int blocksX = NumCells(w, blockSize);
+  int blocksZ = NumCells(h, blockSize);
+  const float inf = std::numeric_limits<float>::infinity();
+  std::vector<glm::vec2> blocks(blocksX * blocksZ, glm::vec2(inf, -inf));
+  std::vector<float> row(w);
+
+  for (int z = 0; z < h; z++)
+  {
+    if (!readRow(z, row.data()))
+      return false;
+
+    for (int bx = 0; bx < blocksX; bx++)
+    {
+      int x0 = bx * blockSize, x1 = std::min(x0 + blockSize, w - 1);
+      auto range = std::minmax_element(row.begin() + x0, row.begin() + x1 + 1);
+
+      for (int bz = std::max(z - 1, 0) / blockSize; bz <= std::min(z / blockSize, blocksZ - 1); bz++)
+      {
+        glm::vec2& block = blocks[bz * blocksX + bx];
+        block[0] = std::min(block[0], *range.first);
+        block[1] = std::max(block[1], *range.second);
+      }
+    }
+  }
+
+  header.minHeight = inf;
+  header.maxHeight = -inf;
+  for (const auto& block : blocks)
+  {
+    header.minHeight = std::min(header.minHeight, block[0]);
+    header.maxHeight = std::max(header.maxHeight, block[1]);
+  }
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(blocks.data()), sizeof(glm::vec2) * blocks.size());
+
+  float range = header.maxHeight - header.minHeight;
+  float quantize = (range > 0.0f) ? 65535.0f / range : 0.0f;
+
+  // Second pass: each level, one row of tiles at a time.
+  int samples = tileSize + 3;
+  std::vector<std::vector<float>> rows(samples, std::vector<float>(w));
+  std::vector<uint16_t> band;
+
+  for (int level = 0; level < header.numLevels; level++)
+  {
+    int step = 1 << level;
+    int levelW = ((w - 1 + step - 1) >> level) + 1;
+    int levelH = ((h - 1 + step - 1) >> level) + 1;
+    int tilesX = NumCells(levelW, tileSize);
+    int tilesZ = NumCells(levelH, tileSize);
+    band.resize(static_cast<size_t>(tilesX) * samples * samples);
+
+    for (int tz = 0; tz < tilesZ; tz++)
+    {
+      // Source rows of the band (aprons clamped to the level).
+      int lastRow = -1;
+      for (int j = 0; j < samples; j++)
+      {
+        int levelRow = std::min(std::max(tz * tileSize + j - 1, 0), levelH - 1);
+        int sourceRow = std::min(levelRow * step, h - 1);
+        if (sourceRow == lastRow)
+        {
+          rows[j] = rows[j - 1];
+        }
+        else if (!readRow(sourceRow, rows[j].data()))
+        {
+          return false;
+        }
+        lastRow = sourceRow;
+      }
+
+      for (int tx = 0; tx < tilesX; tx++)
+      {
+        uint16_t* tile = &band[static_cast<size_t>(tx) * samples * samples];
+        for (int j = 0; j < samples; j++)
+        {
+          for (int i = 0; i < samples; i++)
+          {
+            int levelColumn = std::min(std::max(tx * tileSize + i - 1, 0), levelW - 1);
+            float value = rows[j][std::min(levelColumn * step, w - 1)];
+            tile[j * samples + i] = static_cast<uint16_t>((value - header.minHeight) * quantize + 0.5f);
+          }
+        }
+      }
+
+      file.write(reinterpret_cast<const char*>(band.data()), sizeof(uint16_t) * band.size());
+    }
+  }
+
+  if (!file)
+  {
+    std::cerr << "ERROR Couldn't write " << fileName << ".\n";
+    return false;
+  }
+
+  return true;
+}
+
+// ================= Access ================= //
+
+bool TiledHeightmap::Open(const std::string& fileName)
+{
+  TiledHeightmap::Close();
+
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    std::cerr << "ERROR Couldn't open tiled heightmap " << fileName << ".\n";
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header))
+  {
+    std::cerr << "ERROR Tiled heightmap " << fileName << " is too small.\n";
+    close(fd);
+    return false;
+  }
+
+  void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  // The mapping keeps the file.
+
+  if (mapping == MAP_FAILED)
+  {
+    std::cerr << "ERROR Couldn't map tiled heightmap " << fileName << ".\n";
+    return false;
+  }
+
+  mMapping = mapping;
+  mMappingSize = info.st_size;
+  std::memcpy(&mHeader, mapping, sizeof(Header));
+
+  if (std::memcmp(mHeader.magic, kMagic, sizeof(kMagic)) != 0 || mHeader.version != kVersion)
+  {
+    std::cerr << "ERROR " << fileName << " isn't a tiled heightmap (version " << kVersion << ").\n";
+    TiledHeightmap::Close();
+    return false;
+  }
+
+  // Tile offsets of each level, then the expected file size.
+  size_t offset = sizeof(Header) + sizeof(glm::vec2) * GetBlocksX() * GetBlocksZ();
+  mLevelOffsets.resize(mHeader.numLevels);
+  for (int level = 0; level < mHeader.numLevels; level++)
+  {
+    mLevelOffsets[level] = offset;
+    offset += GetTileBytes() * GetTilesX(level) * GetTilesZ(level);
+  }
+
+  if (offset > mMappingSize)
+  {
+    std::cerr << "ERROR Tiled heightmap " << fileName << " is truncated.\n";
+    TiledHeightmap::Close();
+    return false;
+  }
+
+  const char* bytes = static_cast<const char*>(mMapping);
+  mBlockMinMax = reinterpret_cast<const glm::vec2*>(bytes + sizeof(Header));
+  mDecodeScale = (mHeader.maxHeight - mHeader.minHeight) / 65535.0f;
+
+  return true;
+}
+
+void TiledHeightmap::Close()
+{
+  if (mMapping)
+  {
+    munmap(mMapping, mMappingSize);
+  }
+
+  mMapping = nullptr;
+  mMappingSize = 0;
+  mBlockMinMax = nullptr;
+  mLevelOffsets.clear();
+  mHeader = Header();
+}
+
+const uint16_t* TiledHeightmap::GetTile(int level, int tx, int tz) const
+{
+  size_t index = static_cast<size_t>(tz) * GetTilesX(level) + tx;
+  const char* bytes = static_cast<const char*>(mMapping);
+  return reinterpret_cast<const uint16_t*>(bytes + mLevelOffsets[level] + GetTileBytes() * index);
+}
+
+int TiledHeightmap::GetLevelWidth(int level) const
+{
+  return ((mHeader.width - 1 + (1 << level) - 1) >> level) + 1;
+}
+
+int TiledHeightmap::GetLevelHeight(int level) const
+{
+  return ((mHeader.height - 1 + (1 << level) - 1) >> level) + 1;
+}
+
+int TiledHeightmap::GetTilesX(int level) const
+{
+  return NumCells(TiledHeightmap::GetLevelWidth(level), mHeader.tileSize);
+}
+
+int TiledHeightmap::GetTilesZ(int level) const
+{
+  return NumCells(TiledHeightmap::GetLevelHeight(level), mHeader.tileSize);
+}
+
+}  // namespace gloo.
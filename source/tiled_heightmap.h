@@ -0,0 +1,126 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "heightmap.h"
+
+//  +-------------------------------------------------+
+//  |  Out-of-core heightmap (.gth files), read       |
+//  |  through a memory mapping.                      |
+//  |                                                 |
+//  |  The map is stored as a pyramid: level l keeps  |
+//  |  every 2^l-th sample of level 0 (decimated, so  |
+//  |  coarse samples are exactly fine samples). Each |
+//  |  level is split into tiles of tileSize cells    |
+//  |  with a 1 sample apron before and 2 after, so a |
+//  |  tile is self-contained for rendering and       |
+//  |  normals. Coarse versions of a region live in   |
+//  |  the tiles of the coarser levels, so distant    |
+//  |  terrain never touches fine data.               |
+//  |                                                 |
+//  |  Samples are 16-bit, quantized to the height    |
+//  |  range of the map. Per block min/max heights of |
+//  |  level 0 are stored up front (for culling).     |
+//  |                                                 |
+//  |  Layout (host byte order, little endian):       |
+//  |    header | block min/max | level 0 tiles | ... |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class TiledHeightmap
+{
+public:
+  TiledHeightmap() { }
+
+  // Converts a heightmap file. Raw formats (see Heightmap::Format) are streamed a few rows
+  // at a time, so they don't need to fit in memory; images are loaded whole.
+  static bool Convert(const std::string& inputFileName, const std::string& outputFileName,
+                      int tileSize = 256, int blockSize = 64);
+  static bool ConvertRaw(const std::string& inputFileName, int w, int h, Heightmap::Format format,
+                         const std::string& outputFileName, int tileSize = 256, int blockSize = 64);
+  static bool Convert(const Heightmap& heightmap, const std::string& outputFileName,
+                      int tileSize = 256, int blockSize = 64);
+
+  // Maps a converted file (read only). Nothing is read until tiles are touched.
+  bool Open(const std::string& fileName);
+  void Close();
+
+  // Tile (level, tx, tz): GetTileSamples()^2 quantized samples, where sample (i, j) is level
+  // sample (tx * tileSize + i - 1, tz * tileSize + j - 1), clamped to the level. Reading it
+  // may page the data in from disk.
+  const uint16_t* GetTile(int level, int tx, int tz) const;
+
+  inline float Decode(uint16_t sample) const { return mHeader.minHeight + sample * mDecodeScale; }
+
+  // Getters.
+  inline bool IsOpen() const { return (mMapping != nullptr); }
+  inline int GetWidth()       const { return mHeader.width;     }
+  inline int GetHeight()      const { return mHeader.height;    }
+  inline int GetTileSize()    const { return mHeader.tileSize;  }
+  inline int GetTileSamples() const { return mHeader.tileSize + 3; }
+  inline int GetBlockSize()   const { return mHeader.blockSize; }
+  inline int GetNumLevels()   const { return mHeader.numLevels; }
+  inline float GetMinHeight() const { return mHeader.minHeight; }
+  inline float GetMaxHeight() const { return mHeader.maxHeight; }
+  inline size_t GetTileBytes() const { return sizeof(uint16_t) * GetTileSamples() * GetTileSamples(); }
+
+  int GetLevelWidth(int level)  const;
+  int GetLevelHeight(int level) const;
+  int GetTilesX(int level) const;
+  int GetTilesZ(int level) const;
+
+  // Level 0 block (min, max) heights, row major with GetBlocksX() columns. Block (bx, bz)
+  // covers samples [bx * blockSize, (bx+1) * blockSize] (clamped) in x, same in z.
+  inline const glm::vec2* GetBlockMinMax() const { return mBlockMinMax; }
+  inline int GetBlocksX() const { return NumCells(mHeader.width,  mHeader.blockSize); }
+  inline int GetBlocksZ() const { return NumCells(mHeader.height, mHeader.blockSize); }
+
+  ~TiledHeightmap() { Close(); }
+
+private:
+  TiledHeightmap(const TiledHeightmap&) = delete;
+  TiledHeightmap& operator=(const TiledHeightmap&) = delete;
+
+  struct Header
+  {
+    char magic[4];          // "GLTH"
+    uint32_t version;
+    int32_t width, height;  // Level 0 samples.
+    int32_t tileSize;       // Cells per tile side (a multiple of blockSize).
+    int32_t blockSize;      // Cells per min/max block side.
+    int32_t numLevels;      // The coarsest level fits in one block.
+    float minHeight, maxHeight;
+  };
+
+  // Writes a file from a row reader: readRow(z, out) fills the w samples of row z.
+  static bool Write(int w, int h, const std::function<bool(int, float*)>& readRow,
+                    const std::string& fileName, int tileSize, int blockSize);
+
+  // Tiles (or blocks) of size cells covering a level with the given samples per side.
+  static inline int NumCells(int samples, int size) { return std::max(1, (samples - 2) / size + 1); }
+
+  Header mHeader {};
+  float mDecodeScale { 0.0f };
+  const glm::vec2* mBlockMinMax { nullptr };
+  std::vector<size_t> mLevelOffsets;  // Byte offset of the first tile of each level.
+
+  void* mMapping { nullptr };
+  size_t mMappingSize { 0 };
+};
+
+}  // namespace gloo.
@@ -0,0 +1,381 @@
+#include "vertex_index.h"
+
+#include <algorithm>
+
+namespace gloo
+{
+
+namespace
+{
+
+const int kMaxLeafSize = 8;    // Vertices per leaf.
+const int kStackSize   = 128;  // Traversal stack size (nodes).
+
+// Squared distance from p to the box (0 inside).
+inline float DistanceSquared(const AABB& box, const glm::vec3& p)
+{
+  glm::vec3 d = glm::max(glm::max(box.min - p, p - box.max), glm::vec3(0.0f));
+  return glm::dot(d, d);
+}
+
+// Lower bound of distance/depth (tangent of the angle to the ray) over the box, using its
+// bounding sphere. o is the ray origin, d the unit direction and [sMin, sMax] the valid range.
+inline float ConeBound(const AABB& box, const glm::vec3& o, const glm::vec3& d,
+                       float sMin, float sMax)
+{
+  glm::vec3 c = box.Center();
+  float r = 0.5f * glm::length(box.Extent());
+
+  glm::vec3 v = c - o;
+  float s = glm::dot(v, d);
+  if (s + r <= std::max(sMin, 0.0f) || s - r > sMax)
+    return kRayInfinity;
+
+  float perp = glm::length(v - s*d);
+  return (perp <= r) ? 0.0f : (perp - r) / (s + r);
+}
+
+}  // namespace.
+
+// ================= Construction ================= //
+
+bool VertexIndex::Build(const Mesh& mesh)
+{
+  if (!mesh.IsInitialized())
+  {
+    return false;
+  }
+
+  int n = mesh.GetNumVertices();
+  mPositions.resize(n);
+  for (int i = 0; i < n; i++)
+  {
+    mPositions[i] = mesh.GetPosition(i);
+  }
+
+  VertexIndex::Rebuild();
+  return IsBuilt();
+}
+
+bool VertexIndex::Build(const std::vector<glm::vec3>& positions)
+{
+  mPositions = positions;
+  VertexIndex::Rebuild();
+  return IsBuilt();
+}
+
+void VertexIndex::Rebuild()
+{
+  int n = mPositions.size();
+  mNodes.clear();
+  mOrder.resize(n);
+  mLeafOf.resize(n);
+
+  if (n == 0)
+  {
+    return;
+  }
+
+  for (int i = 0; i < n; i++)
+  {
+    mOrder[i] = i;
+  }
+
+  mNodes.reserve(4 * (n / kMaxLeafSize + 1));
+  VertexIndex::BuildRecursive(0, n, -1);
+
+  mCost = 0.0f;
+  for (const Node& node : mNodes)
+  {
+    mCost += node.mBounds.SurfaceArea();
+  }
+  mBuildCost = mCost;
+}
+
+int VertexIndex::BuildRecursive(int begin, int end, int parent)
+{
+  int index = mNodes.size();
+  mNodes.push_back(Node());
+
+  AABB bounds;
+  for (int i = begin; i < end; i++)
+  {
+    bounds.Expand(mPositions[mOrder[i]]);
+  }
+
+  mNodes[index].mBounds = bounds;
+  mNodes[index].mParent = parent;
+
+  if (end - begin <= kMaxLeafSize)
+  {
+    mNodes[index].mStart = begin;
+    mNodes[index].mCount = end - begin;
+    for (int i = begin; i < end; i++)
+    {
+      mLeafOf[mOrder[i]] = index;
+    }
+    return index;
+  }
+
+  // Median split on the largest axis.
+  int axis = bounds.MaxAxis();
+  int mid = (begin + end) / 2;
+  std::nth_element(mOrder.begin() + begin, mOrder.begin() + mid, mOrder.begin() + end,
+    [this, axis](int a, int b) { return mPositions[a][axis] < mPositions[b][axis]; });
+
+  mNodes[index].mCount = 0;
+  VertexIndex::BuildRecursive(begin, mid, index);
+  mNodes[index].mStart = VertexIndex::BuildRecursive(mid, end, index);
+  return index;
+}
+
+// ================= Updates ================= //
+
+void VertexIndex::RefitNode(int index)
+{
+  Node& node = mNodes[index];
+  AABB bounds;
+
+  if (node.IsLeaf())
+  {
+    for (int i = node.mStart; i < node.mStart + node.mCount; i++)
+    {
+      bounds.Expand(mPositions[mOrder[i]]);
+    }
+  }
+  else
+  {
+    bounds = mNodes[index + 1].mBounds;
+    bounds.Expand(mNodes[node.mStart].mBounds);
+  }
+
+  mCost += bounds.SurfaceArea() - node.mBounds.SurfaceArea();
+  node.mBounds = bounds;
+}
+
+void VertexIndex::Update(int vertex, const glm::vec3& position)
+{
+  if (!IsBuilt() || vertex < 0 || vertex >= static_cast<int>(mPositions.size()))
+  {
+    return;
+  }
+
+  mPositions[vertex] = position;
+
+  // Leaf bounds are recomputed (they may shrink), then merged up to the root.
+  for (int index = mLeafOf[vertex]; index >= 0; index = mNodes[index].mParent)
+  {
+    VertexIndex::RefitNode(index);
+  }
+
+  if (mCost > mRebuildThreshold * mBuildCost)
+  {
+    VertexIndex::Rebuild();
+  }
+}
+
+void VertexIndex::Refit(const Mesh& mesh)
+{
+  if (!IsBuilt() || mesh.GetNumVertices() != static_cast<int>(mPositions.size()))
+  {
+    VertexIndex::Build(mesh);
+    return;
+  }
+
+  for (int i = 0; i < static_cast<int>(mPositions.size()); i++)
+  {
+    mPositions[i] = mesh.GetPosition(i);
+  }
+
+  // Children are stored after their parents - refit in reverse order.
+  for (int index = mNodes.size() - 1; index >= 0; index--)
+  {
+    VertexIndex::RefitNode(index);
+  }
+
+  if (mCost > mRebuildThreshold * mBuildCost)
+  {
+    VertexIndex::Rebuild();
+  }
+}
+
+// ================= Queries ================= //
+
+VertexHit VertexIndex::ClosestToRay(const Ray& ray, float tolerance) const
+{
+  VertexHit hit;
+  float length = glm::length(ray.dir);
+  if (!IsBuilt() || length <= 0.0f)
+  {
+    return hit;
+  }
+
+  // Work with distances along the unit direction.
+  glm::vec3 o = ray.origin;
+  glm::vec3 d = ray.dir / length;
+  float sMin = ray.tMin * length;
+  float sMax = ray.tMax * length;
+
+  float bestTangent = tolerance;
+  float bestS = kRayInfinity;
+
+  int stack[kStackSize];
+  float bound[kStackSize];
+  int sp = 0;
+
+  stack[sp] = 0;
+  bound[sp++] = ConeBound(mNodes[0].mBounds, o, d, sMin, sMax);
+
+  while (sp > 0)
+  {
+    sp--;
+    if (bound[sp] > bestTangent)
+      continue;
+
+    const Node& node = mNodes[stack[sp]];
+    if (node.IsLeaf())
+    {
+      for (int i = node.mStart; i < node.mStart + node.mCount; i++)
+      {
+        glm::vec3 v = mPositions[mOrder[i]] - o;
+        float s = glm::dot(v, d);
+        if (s <= 0.0f || s < sMin || s > sMax)
+          continue;
+
+        float tangent = glm::length(v - s*d) / s;
+        if (tangent < bestTangent || (tangent == bestTangent && s < bestS))
+        {
+          bestTangent = tangent;
+          bestS = s;
+          hit.vertex = mOrder[i];
+        }
+      }
+    }
+    else
+    {
+      int left = stack[sp] + 1, right = node.mStart;
+      float leftBound  = ConeBound(mNodes[left].mBounds,  o, d, sMin, sMax);
+      float rightBound = ConeBound(mNodes[right].mBounds, o, d, sMin, sMax);
+
+      // Push the most promising child last so it is visited first.
+      if (leftBound < rightBound)
+      {
+        std::swap(left, right);
+        std::swap(leftBound, rightBound);
+      }
+
+      if (leftBound <= bestTangent)
+      {
+        stack[sp] = left;
+        bound[sp++] = leftBound;
+      }
+      if (rightBound <= bestTangent)
+      {
+        stack[sp] = right;
+        bound[sp++] = rightBound;
+      }
+    }
+  }
+
+  if (hit.Valid())
+  {
+    hit.t = bestS / length;
+    hit.tangent = bestTangent;
+  }
+
+  return hit;
+}
+
+int VertexIndex::Nearest(const glm::vec3& point, float maxDistance) const
+{
+  if (!IsBuilt())
+  {
+    return -1;
+  }
+
+  float bestDistance2 = maxDistance * maxDistance;
+  int best = -1;
+
+  int stack[kStackSize];
+  int sp = 0;
+  stack[sp++] = 0;
+
+  while (sp > 0)
+  {
+    const Node& node = mNodes[stack[--sp]];
+    if (DistanceSquared(node.mBounds, point) > bestDistance2)
+      continue;
+
+    if (node.IsLeaf())
+    {
+      for (int i = node.mStart; i < node.mStart + node.mCount; i++)
+      {
+        glm::vec3 v = mPositions[mOrder[i]] - point;
+        float distance2 = glm::dot(v, v);
+        if (distance2 <= bestDistance2)
+        {
+          bestDistance2 = distance2;
+          best = mOrder[i];
+        }
+      }
+    }
+    else
+    {
+      int left = stack[sp] + 1, right = node.mStart;
+      if (DistanceSquared(mNodes[left].mBounds, point) < DistanceSquared(mNodes[right].mBounds, point))
+      {
+        std::swap(left, right);
+      }
+
+      stack[sp++] = left;   // Farther child.
+      stack[sp++] = right;  // Nearer child - visited first.
+    }
+  }
+
+  return best;
+}
+
+int VertexIndex::WithinRadius(const glm::vec3& center, float radius,
+                              std::vector<int>& vertices) const
+{
+  vertices.clear();
+  if (!IsBuilt())
+  {
+    return 0;
+  }
+
+  float radius2 = radius * radius;
+
+  int stack[kStackSize];
+  int sp = 0;
+  stack[sp++] = 0;
+
+  while (sp > 0)
+  {
+    int index = stack[--sp];
+    const Node& node = mNodes[index];
+    if (DistanceSquared(node.mBounds, center) > radius2)
+      continue;
+
+    if (node.IsLeaf())
+    {
+      for (int i = node.mStart; i < node.mStart + node.mCount; i++)
+      {
+        glm::vec3 v = mPositions[mOrder[i]] - center;
+        if (glm::dot(v, v) <= radius2)
+        {
+          vertices.push_back(mOrder[i]);
+        }
+      }
+    }
+    else
+    {
+      stack[sp++] = node.mStart;
+      stack[sp++] = index + 1;
+    }
+  }
+
+  return vertices.size();
+}
+
+}  // namespace gloo.
@@ -0,0 +1,98 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "mesh.h"
+#include "ray.h"
+
+//  +-------------------------------------------------+
+//  |  Spatial index over the vertices of a Mesh for  |
+//  |  edit mode (snapping, vertex selection, soft    |
+//  |  selection radius).                             |
+//  |                                                 |
+//  |  It is a k-d tree (median split on the largest  |
+//  |  axis) whose nodes keep their bounding boxes.   |
+//  |  Moving a vertex refits its leaf and the path   |
+//  |  to the root in O(log n); the tree is rebuilt   |
+//  |  only when the refits loosened it too much.     |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+struct VertexHit
+{
+  inline bool Valid() const { return (vertex >= 0); }
+
+  int vertex { -1 };             // Vertex index in the mesh (-1 means nothing found).
+  int object { -1 };             // Object index in the scene (filled by scene queries).
+  float t { kRayInfinity };      // Ray parameter of the vertex projection onto the ray.
+  float tangent { kRayInfinity };  // Distance to the ray over distance along it.
+};
+
+class VertexIndex
+{
+public:
+  VertexIndex() { }
+
+  bool Build(const Mesh& mesh);
+  bool Build(const std::vector<glm::vec3>& positions);
+
+  // Moves one vertex - O(log n).
+  void Update(int vertex, const glm::vec3& position);
+
+  // Reads every position again (same number of vertices) and refits all nodes - O(n).
+  void Refit(const Mesh& mesh);
+
+  // Closest vertex (in angle) inside the cone around the ray with the given tangent, e.g.
+  // tolerance = pixels * 2*tan(fovy/2) / height for a screen space tolerance.
+  // Vertices outside [ray.tMin, ray.tMax] are ignored.
+  VertexHit ClosestToRay(const Ray& ray, float tolerance) const;
+
+  // Closest vertex to a point, up to maxDistance. Returns -1 if there is none.
+  int Nearest(const glm::vec3& point, float maxDistance = kRayInfinity) const;
+
+  // Collects the vertices within radius of center. Returns how many were found.
+  int WithinRadius(const glm::vec3& center, float radius, std::vector<int>& vertices) const;
+
+  // Getters.
+  inline bool IsBuilt() const { return !mNodes.empty(); }
+  inline int GetNumVertices() const { return mPositions.size(); }
+  inline const glm::vec3& GetPosition(int vertex) const { return mPositions[vertex]; }
+
+  // Rebuild when the sum of node areas exceeds threshold * the value at build time.
+  inline void SetRebuildThreshold(float threshold) { mRebuildThreshold = threshold; }
+
+private:
+  struct Node
+  {
+    AABB mBounds;
+    int mStart;   // Leaf: first entry in mOrder. Inner: right child (left child is next).
+    int mCount;   // Leaf: number of vertices. Inner: 0.
+    int mParent;  // -1 for the root.
+
+    inline bool IsLeaf() const { return (mCount > 0); }
+  };
+
+  void Rebuild();
+  int BuildRecursive(int begin, int end, int parent);
+  void RefitNode(int node);
+
+  std::vector<Node> mNodes;
+  std::vector<glm::vec3> mPositions;  // Indexed by vertex.
+  std::vector<int> mOrder;            // Vertex indices in leaf order.
+  std::vector<int> mLeafOf;           // Leaf node of each vertex.
+
+  float mCost      { 0.0f };  // Sum of node surface areas.
+  float mBuildCost { 0.0f };
+  float mRebuildThreshold { 2.0f };
+};
+
+}  // namespace gloo.
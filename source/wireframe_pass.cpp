@@ -0,0 +1,92 @@
+#include "wireframe_pass.h"
+
+#include <iostream>
+
+namespace gloo
+{
+
+bool WireframePass::Init(GLuint mainProgramHandle, const std::string& shaderPath)
+{
+  if (!mProgram.Load(shaderPath, mainProgramHandle))
+  {
+    std::cerr << "ERROR Couldn't load wireframe shaders at " << shaderPath << ".\n";
+    return false;
+  }
+
+  return true;
+}
+
+bool WireframePass::Draws(SceneObject* object)
+{
+  if (!object->IsWireframe() || !object->IsInitialized())
+  {
+    return false;
+  }
+
+  // The geometry shader takes triangles.
+  GLenum mode = object->GetMesh()->GetDrawMode();
+  return (mode == GL_TRIANGLES || mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN);
+}
+
+void WireframePass::Render(const std::vector<SceneObject*>& objects, 
+                           const std::vector<Light*>& lights, Camera* camera)
+{
+  if (!IsInitialized())
+  {
+    return;
+  }
+
+  bool any = false;
+  for (SceneObject* object : objects)
+  {
+    any = any || WireframePass::Draws(object);
+  }
+
+  if (!any)
+  {
+    return;
+  }
+
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+
+  mProgram.Bind();
+  mProgram.SetMatrix("V", camera->GetViewMatrix());
+  mProgram.SetMatrix("P", camera->GetProjMatrix());
+  mProgram.SetVec2("viewport", static_cast<GLfloat>(viewport[2]), static_cast<GLfloat>(viewport[3]));
+  mProgram.SetVec3("wire_color", mWireColor);
+  mProgram.SetFloat("wire_width", mWireWidth);
+  mProgram.SetInt("fill_on", mFill);
+  mProgram.SetInt("invalid_tex", 0);
+
+  mProgram.SetInt("numLights", static_cast<GLint>(lights.size()));
+  for (int i = 0; i < static_cast<int>(lights.size()); i++)
+  {
+    lights[i]->Position(camera->GetViewMatrix(), i, mProgram.GetHandle());
+  }
+
+  // Wires alone are blended (their edges are anti-aliased).
+  GLboolean blendWasOn = glIsEnabled(GL_BLEND);
+  if (!mFill)
+  {
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  }
+
+  for (SceneObject* object : objects)
+  {
+    if (!WireframePass::Draws(object))
+      continue;
+
+    mProgram.SetMatrix("M", object->GetModelMatrix());
+    object->BindSurface(mProgram.GetHandle());
+    object->GetMesh()->Render();
+  }
+
+  if (!mFill && !blendWasOn)
+  {
+    glDisable(GL_BLEND);
+  }
+}
+
+}  // namespace gloo.
@@ -0,0 +1,66 @@
+/******************************************+
+*                                          *
+*  CSCI420 - Computer Graphics USC         *
+*  Author: Rodrigo Castiel                 *
+*                                          *
++*******************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "shader_program.h"
+#include "scene_object.h"
+#include "camera.h"
+#include "light.h"
+
+//  +-------------------------------------------------+
+//  |  Solid + wireframe rendering in a single pass,  |
+//  |  for any triangle mesh.                         |
+//  |                                                 |
+//  |  A geometry shader gives each triangle vertex   |
+//  |  its screen-space distances to the 3 edges, and |
+//  |  the fragment shader (Phong, like the main      |
+//  |  pipeline) mixes in the wire color near the     |
+//  |  closest edge. No extra index buffers and no    |
+//  |  line rasterization: the wires come with the    |
+//  |  faces, anti-aliased and of constant width.     |
+//  |                                                 |
+//  |  Objects marked with SceneObject::SetWireframe  |
+//  |  are drawn by this pass instead of the main     |
+//  |  pipeline (line meshes are drawn as usual).     |
+//  +-------------------------------------------------+
+
+namespace gloo
+{
+
+class WireframePass
+{
+public:
+  WireframePass() { }
+
+  // mainProgramHandle provides the vertex attribute locations used by the meshes.
+  bool Init(GLuint mainProgramHandle, const std::string& shaderPath = "./shaders/phong_wireframe");
+
+  // The objects this pass draws (the main loop should skip them).
+  static bool Draws(SceneObject* object);
+
+  // Draws the marked objects with the lights of the scene.
+  // The caller's program is not restored - bind it again afterwards.
+  void Render(const std::vector<SceneObject*>& objects, const std::vector<Light*>& lights,
+              Camera* camera);
+
+  inline void SetWireWidth(float pixels)           { mWireWidth = pixels; }
+  inline void SetWireColor(const glm::vec3& color) { mWireColor = color; }
+  inline void SetFill(bool fill) { mFill = fill; }  // Otherwise only the wires are drawn.
+
+  inline bool IsInitialized() const { return mProgram.IsLoaded(); }
+
+private:
+  ShaderProgram mProgram;
+  float mWireWidth { 1.0f };
+  glm::vec3 mWireColor { 0.05f, 0.05f, 0.05f };
+  bool mFill { true };
+};
+
+}  // namespace gloo.